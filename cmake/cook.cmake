@@ -0,0 +1,25 @@
+# Cook every texture listed in data/textures.cook into a KTX2 file in the build tree, either next to the copy of its
+# source or at the path given after the type
+file(STRINGS "data/textures.cook" COOK_LINES REGEX "^[^#].*=")
+
+foreach(COOK_LINE ${COOK_LINES})
+	string(REGEX MATCH "^([^=]+)=([^,]+)(,(.+))?$" COOK_MATCH "${COOK_LINE}")
+	string(STRIP "${CMAKE_MATCH_1}" TEXTURE_SOURCE)
+	string(STRIP "${CMAKE_MATCH_2}" TEXTURE_TYPE)
+	string(STRIP "${CMAKE_MATCH_4}" TEXTURE_OUTPUT)
+	if(TEXTURE_OUTPUT STREQUAL "")
+		get_filename_component(FILE_NAME ${TEXTURE_SOURCE} NAME_WLE)
+		get_filename_component(PATH_NAME ${TEXTURE_SOURCE} DIRECTORY)
+		set(TEXTURE_OUTPUT "${PATH_NAME}/${FILE_NAME}.ktx2")
+	endif()
+	set(COOK_INPUT "${CMAKE_CURRENT_SOURCE_DIR}/${TEXTURE_SOURCE}")
+	set(COOK_OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${TEXTURE_OUTPUT}")
+	add_custom_command(
+		OUTPUT ${COOK_OUTPUT}
+		COMMAND asset_cooker ${COOK_INPUT} ${COOK_OUTPUT} ${TEXTURE_TYPE}
+		DEPENDS asset_cooker ${COOK_INPUT} "${CMAKE_CURRENT_SOURCE_DIR}/data/textures.cook"
+	)
+	list(APPEND COOK_OUTPUT_FILES ${COOK_OUTPUT})
+endforeach(COOK_LINE)
+
+add_custom_target(cook_target DEPENDS ${COOK_OUTPUT_FILES})
@@ -48,6 +48,7 @@ file(
 	"data/*.bin"
 	"data/*.ktx"
 	"data/*.ktx2"
+	"data/*.cfg"
 )
 
 # Copy every data file
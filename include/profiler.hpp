@@ -0,0 +1,13 @@
+#pragma once
+
+// The zones need "import cpu_profiler;" in the file that uses them. The names must live until the end of the
+// program, like string literals.
+#ifdef OGL_SCENE_PROFILER_ENABLED
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) const stw::CpuProfilerZone PROFILE_CONCAT(profilerZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#define PROFILE_FUNCTION() static_cast<void>(0)
+#endif
@@ -1,13 +1,4 @@
 #version 430
-// This is needed for CSM : https://gist.github.com/JuanDiegoMontoya/55482fc04d70e83729bb9528ecdc1c61
-#extension GL_NV_gpu_shader5: enable
-#extension GL_EXT_nonuniform_qualifier: enable
-
-#ifdef GL_EXT_nonuniform_qualifier
-    #define NonUniformIndex(x) nonuniformEXT(x)
-#else
-    #define NonUniformIndex(x) (x)
-#endif
 
 struct DirectionalLight
 {
@@ -25,7 +16,8 @@ in vec2 TexCoords;
 uniform sampler2D gPositionAmbientOcclusion;
 uniform sampler2D gNormalRoughness;
 uniform sampler2D gBaseColorMetallic;
-uniform sampler2D shadowMaps[NUM_CASCADES];
+// Every cascade is a layer of the array, compared against the reference depth by the sampler
+uniform sampler2DArrayShadow shadowMaps;
 
 uniform DirectionalLight directionalLight;
 
@@ -165,9 +157,6 @@ float ComputeShadowIntensity(int cascadeIndex, vec4 fragPosLightSpace, vec3 norm
         return 0.0;
     }
 
-    // Get closest depth value from light's perspective (using [0,1] range fragPosLight as coordinates)
-    float closestDepth = textureLod(shadowMaps[NonUniformIndex(cascadeIndex)], projectionCoords.xy, 0).r;
-
     // Get depth of current fragment from light's perspective
     float currentDepth = projectionCoords.z;
 
@@ -175,16 +164,15 @@ float ComputeShadowIntensity(int cascadeIndex, vec4 fragPosLightSpace, vec3 norm
     vec3 lightDirection = normalize(directionalLight.direction);
     float bias = max(0.0005 * (1.0 / dot(normal, lightDirection)), 0.0003);
 
-    // PCF (Percentage-Closer Filtering)
+    // PCF (Percentage-Closer Filtering), the sampler returns 1.0 when the fragment is lit
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMaps[NonUniformIndex(cascadeIndex)], 0);
+    vec2 texelSize = 1.0 / textureSize(shadowMaps, 0).xy;
     for (int x = -1; x <= 1; ++x)
     {
         for (int y = -1; y <= 1; ++y)
         {
-            float pcfDepth = textureLod(shadowMaps[NonUniformIndex(cascadeIndex)], projectionCoords.xy + vec2(x, y) * texelSize, 0).r;
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
-            // shadow += currentDepth > pcfDepth ? 1.0 : 0.0;
+            vec2 sampleCoords = projectionCoords.xy + vec2(x, y) * texelSize;
+            shadow += 1.0 - texture(shadowMaps, vec4(sampleCoords, float(cascadeIndex), currentDepth - bias));
         }
     }
 
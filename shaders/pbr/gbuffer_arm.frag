@@ -18,8 +18,10 @@ void main()
 	gPositionAmbientOcclusion.rgb = FragPos;
 	gPositionAmbientOcclusion.a  = texture(texture_arm, TexCoords).r;
 
-	vec3 tangentNormal = texture(texture_normal, TexCoords).rgb;
-	tangentNormal = tangentNormal * 2.0 - 1.0;
+	vec3 tangentNormal;
+	tangentNormal.xy = texture(texture_normal, TexCoords).rg * 2.0 - 1.0;
+	// Compressed normal maps (BC5) only store X and Y
+	tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
 	gNormalRoughness.rgb = TangentToWorldMatrix * tangentNormal;
 	gNormalRoughness.a = texture(texture_arm, TexCoords).g;
@@ -1,11 +1,11 @@
 #version 430
 
+// Used with depth.geom, which projects each triangle into every cascade.
+
 layout (location = 0) in vec3 aPos;
 layout (location = 4) in mat4 modelMatrix;
 
-uniform mat4 lightViewProjMatrix;
-
 void main()
 {
-    gl_Position = lightViewProjMatrix * modelMatrix * vec4(aPos, 1.0);
+    gl_Position = modelMatrix * vec4(aPos, 1.0);
 }
@@ -0,0 +1,21 @@
+#version 430
+// Writing gl_Layer from the vertex shader needs one of those extensions.
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+// Every mesh instance is drawn once per cascade, the model matrix divisor is set to
+// NUM_CASCADES so consecutive instances share the same matrix.
+
+const int NUM_CASCADES = 4;
+
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 modelMatrix;
+
+uniform mat4 lightViewProjMatrices[NUM_CASCADES];
+
+void main()
+{
+    int cascadeIndex = gl_InstanceID % NUM_CASCADES;
+    gl_Position = lightViewProjMatrices[cascadeIndex] * modelMatrix * vec4(aPos, 1.0);
+    gl_Layer = cascadeIndex;
+}
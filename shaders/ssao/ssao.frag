@@ -1,6 +1,10 @@
 #version 430
 
-const int SAMPLES_COUNT = 32;
+// Injected by the renderer from the render quality settings
+#ifndef SAMPLES_COUNT
+#define SAMPLES_COUNT 32
+#endif
+
 const float RANDOM_TEXTURE_SIZE = 4.0;
 const float RADIUS = 0.5;
 const float BIAS = 0.025;
@@ -16,6 +20,13 @@ uniform sampler2D texNoise;
 uniform vec3 samples[SAMPLES_COUNT];
 uniform vec2 screenSize;
 
+// With temporal accumulation, each frame only uses samplesCount samples, one every sampleStride starting at
+// sampleOffset. The kernel is sorted by distance, so the interleaving gives each frame near and far samples.
+uniform int sampleOffset = 0;
+uniform int sampleStride = 1;
+uniform int samplesCount = SAMPLES_COUNT;
+uniform vec2 noiseOffset = vec2(0.0);
+
 layout (std140, binding = 0) uniform Matrices
 {
     mat4 projection;
@@ -28,17 +39,17 @@ void main()
     vec3 normal = mat3(view) * textureLod(gNormalRoughness, TexCoords, 0).rgb;
 
     vec2 noiseScale = screenSize / RANDOM_TEXTURE_SIZE;
-    vec3 randomVec = normalize(textureLod(texNoise, TexCoords * noiseScale, 0).xyz);
+    vec3 randomVec = normalize(textureLod(texNoise, TexCoords * noiseScale + noiseOffset, 0).xyz);
 
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
     vec3 bitangent = cross(normal, tangent);
     mat3 TBN = mat3(tangent, bitangent, normal);
 
     float occlusion = 0.0;
-    for (int i = 0; i < SAMPLES_COUNT; i++)
+    for (int i = 0; i < samplesCount; i++)
     {
         // From tangent space to view space
-        vec3 samplePos = TBN * samples[i];
+        vec3 samplePos = TBN * samples[(sampleOffset + i * sampleStride) % SAMPLES_COUNT];
         samplePos = fragPos + samplePos * RADIUS;
 
         vec4 offset = vec4(samplePos, 1.0);
@@ -55,7 +66,7 @@ void main()
         float rangeCheck = smoothstep(0.0, 1.0, RADIUS / abs(fragPos.z - sampleDepth));
         occlusion += (sampleDepth >= samplePos.z + BIAS ? 1.0 : 0.0) * rangeCheck;
     }
-    occlusion = 1.0 - (occlusion / SAMPLES_COUNT);
+    occlusion = 1.0 - (occlusion / float(samplesCount));
 
     FragColor = occlusion;
 }
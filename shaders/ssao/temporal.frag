@@ -0,0 +1,61 @@
+#version 430
+
+// Weight of the current frame when the history is valid
+const float CURRENT_FRAME_WEIGHT = 0.15;
+// Relative difference of view depth above which the history is considered disoccluded
+const float DEPTH_REJECTION_THRESHOLD = 0.05;
+
+// r : accumulated ambient occlusion, g : view depth of the pixel
+layout (location = 0) out vec2 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D gSsao;
+uniform sampler2D gSsaoHistory;
+uniform sampler2D gPositionAmbientOcclusion;
+
+uniform mat4 previousViewProjection;
+uniform mat4 previousView;
+uniform bool isHistoryValid;
+
+layout (std140, binding = 0) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+void main()
+{
+    float currentOcclusion = textureLod(gSsao, TexCoords, 0).r;
+    vec4 worldPos = vec4(textureLod(gPositionAmbientOcclusion, TexCoords, 0).rgb, 1.0);
+    float viewDepth = -(view * worldPos).z;
+
+    FragColor = vec2(currentOcclusion, viewDepth);
+    if (!isHistoryValid)
+    {
+        return;
+    }
+
+    // Find where this point was on screen last frame
+    vec4 previousClipPos = previousViewProjection * worldPos;
+    if (previousClipPos.w <= 0.0)
+    {
+        return;
+    }
+
+    vec2 previousTexCoords = previousClipPos.xy / previousClipPos.w * 0.5 + 0.5;
+    if (any(lessThan(previousTexCoords, vec2(0.0))) || any(greaterThan(previousTexCoords, vec2(1.0))))
+    {
+        return;
+    }
+
+    // Reject the history when another surface was visible at that position last frame
+    vec2 history = textureLod(gSsaoHistory, previousTexCoords, 0).rg;
+    float expectedDepth = -(previousView * worldPos).z;
+    if (abs(history.g - expectedDepth) > DEPTH_REJECTION_THRESHOLD * expectedDepth)
+    {
+        return;
+    }
+
+    FragColor.r = mix(history.r, currentOcclusion, CURRENT_FRAME_WEIGHT);
+}
@@ -27,11 +27,17 @@ export module bloom_framebuffer;
 import number_types;
 import consts;
 import utils;
+import gpu_memory;
 
 export
 {
 	namespace stw
 	{
+	/**
+	 * Format of the bloom mips. It needs four channels to be usable as an image in the compute path.
+	 */
+	constexpr GLenum BloomMipFormat = GL_RGBA16F;
+
 	struct BloomMip
 	{
 		glm::vec2 size;
@@ -56,10 +62,22 @@ export
 		void UnBind() const;
 		[[nodiscard]] std::span<const BloomMip> MipChain() const;
 
+		/**
+		 * Binds every mip of the chain to the image unit of the same index, for the compute downsample.
+		 */
+		void BindMipImages() const;
+
+		/**
+		 * Gets the buffer used by the compute downsample to find the last work group.
+		 */
+		[[nodiscard]] GLuint CounterBuffer() const;
+
 	private:
 		bool m_IsInitialized = false;
 		GLuint m_FramebufferIndex = 0;
+		GLuint m_CounterBuffer = 0;
 		std::vector<BloomMip> m_MipChain{};
+		usize m_TrackedGpuSize = 0;
 	};
 
 	BloomFramebuffer::~BloomFramebuffer()
@@ -92,7 +110,7 @@ export
 			glGenTextures(1, &bloomMip.texture);
 			glBindTexture(GL_TEXTURE_2D, bloomMip.texture);
 
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, mipIntSize.x, mipIntSize.y, 0, GL_RGB, GL_FLOAT, nullptr);
+			glTexImage2D(GL_TEXTURE_2D, 0, BloomMipFormat, mipIntSize.x, mipIntSize.y, 0, GL_RGBA, GL_FLOAT, nullptr);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -115,6 +133,18 @@ export
 		}
 
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		constexpr u32 zero = 0;
+		glCreateBuffers(1, &m_CounterBuffer);
+		glNamedBufferStorage(m_CounterBuffer, sizeof(u32), &zero, 0);
+
+		m_TrackedGpuSize = sizeof(u32);
+		for (const BloomMip& bloomMip : m_MipChain)
+		{
+			m_TrackedGpuSize += QueryTextureGpuSize(bloomMip.texture);
+		}
+		GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::RenderTarget, m_TrackedGpuSize);
+
 		m_IsInitialized = true;
 		return true;
 	}
@@ -123,11 +153,18 @@ export
 	{
 		assert(m_IsInitialized);
 
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::RenderTarget, m_TrackedGpuSize);
+		m_TrackedGpuSize = 0;
+
 		for (BloomMip& bloomMip : m_MipChain)
 		{
 			glDeleteTextures(1, &bloomMip.texture);
 			bloomMip.texture = 0;
 		}
+		m_MipChain.clear();
+
+		glDeleteBuffers(1, &m_CounterBuffer);
+		m_CounterBuffer = 0;
 
 		glDeleteFramebuffers(1, &m_FramebufferIndex);
 		m_FramebufferIndex = 0;
@@ -138,6 +175,18 @@ export
 
 	std::span<const BloomMip> BloomFramebuffer::MipChain() const { return m_MipChain; }
 
+	void BloomFramebuffer::BindMipImages() const
+	{
+		assert(m_IsInitialized);
+		for (usize i = 0; i < m_MipChain.size(); i++)
+		{
+			glBindImageTexture(
+				static_cast<GLuint>(i), m_MipChain[i].texture, 0, GL_FALSE, 0, GL_READ_WRITE, BloomMipFormat);
+		}
+	}
+
+	GLuint BloomFramebuffer::CounterBuffer() const { return m_CounterBuffer; }
+
 	void BloomFramebuffer::UnBind() const
 	{
 		assert(m_IsInitialized);
@@ -18,15 +18,17 @@ import number_types;
 namespace stw
 {
 export constexpr u32 MaxPointLights = 128;
-export constexpr u32 ShadowMapSize = 4096;
-export constexpr u32 MipChainLength = 5;
 export constexpr f32 FilterRadius = 0.005f;
+export constexpr u32 MaxComputeBloomMips = 8;
+export constexpr u32 BloomDownsampleTileSize = 32;
+export constexpr u32 BloomUpsampleGroupSize = 8;
 export constexpr usize ShadowMapNumCascades = 4;
-export constexpr usize SsaoKernelSize = 32;
+export constexpr u32 MaxSsaoKernelSize = 64;
 export constexpr usize SsaoRandomTextureSize = 16;
-export constexpr u32 SkyboxResolution = 4096;
+export constexpr u32 MaxLodPixelError = 64;
 export constexpr u32 IrradianceMapResolution = 32;
 export constexpr u32 PrefilterMapResolution = 128;
+export constexpr u32 PrefilterMapMipLevels = 5;
 export constexpr u32 BrdfLutResolution = 512;
 export constexpr usize InvalidId = static_cast<usize>(-1);
 
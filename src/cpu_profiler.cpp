@@ -0,0 +1,292 @@
+/**
+ * @file cpu_profiler.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the CPU profiler that records nested zones per thread and exports them as a Chrome trace.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+export module cpu_profiler;
+
+import number_types;
+
+export namespace stw
+{
+/**
+ * If the zones are recorded. When the profiler is disabled, the PROFILE_ZONE macros of profiler.hpp expand to nothing.
+ */
+#ifdef OGL_SCENE_PROFILER_ENABLED
+constexpr bool IsCpuProfilerEnabled = true;
+#else
+constexpr bool IsCpuProfilerEnabled = false;
+#endif
+
+/**
+ * Number of zones kept for each thread, the oldest ones are overwritten by the new ones.
+ */
+constexpr usize CpuProfilerZonesPerThread = 1 << 16;
+
+struct CpuProfilerZoneRecord
+{
+	/**
+	 * Name of the zone, it must live until the end of the program, like a string literal.
+	 */
+	const char* name;
+	i64 startNanoseconds;
+	i64 endNanoseconds;
+};
+
+/**
+ * @return The time since the start of the program, in nanoseconds.
+ */
+[[nodiscard]] i64 GetCpuProfilerTimestamp();
+
+/**
+ * Records a zone of the calling thread. Each thread writes in its own buffer, so no lock is taken.
+ */
+void RecordCpuProfilerZone(const CpuProfilerZoneRecord& record);
+
+/**
+ * Sets the name of the calling thread in the exported traces.
+ */
+void SetCpuProfilerThreadName(std::string_view name);
+
+/**
+ * Writes the zones recorded so far in the Chrome Trace Event format, which chrome://tracing and Perfetto can open.
+ * The threads can keep recording while the trace is written.
+ * @param path Path of the trace file.
+ */
+std::expected<void, std::string> SaveChromeTrace(const std::filesystem::path& path);
+
+/**
+ * Records a zone from its construction to its destruction. Use the PROFILE_ZONE macros of profiler.hpp, which can be
+ * compiled out.
+ */
+class CpuProfilerZone
+{
+public:
+	explicit CpuProfilerZone(const char* name);
+	CpuProfilerZone(const CpuProfilerZone&) = delete;
+	CpuProfilerZone(CpuProfilerZone&&) = delete;
+	~CpuProfilerZone();
+
+	CpuProfilerZone& operator=(const CpuProfilerZone&) = delete;
+	CpuProfilerZone& operator=(CpuProfilerZone&&) = delete;
+
+private:
+	const char* m_Name;
+	i64 m_StartNanoseconds;
+};
+}// namespace stw
+
+namespace stw
+{
+/**
+ * Ring of the zones of a thread. Only its thread writes the records, the count is published after each record so
+ * that the export can read them without a lock.
+ */
+struct CpuProfilerThreadBuffer
+{
+	std::unique_ptr<CpuProfilerZoneRecord[]> records = std::make_unique<CpuProfilerZoneRecord[]>(
+		CpuProfilerZonesPerThread);
+	std::atomic<u64> recordsCount = 0;
+	u32 threadId = 0;
+	// Protected by the mutex of the registry
+	std::string threadName;
+};
+
+/**
+ * Buffers of every thread that recorded a zone. The lock is only taken when a thread records its first zone, when a
+ * thread is named and when a trace is exported.
+ */
+struct CpuProfilerRegistry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<CpuProfilerThreadBuffer>> buffers;
+};
+
+const std::chrono::steady_clock::time_point CpuProfilerEpoch = std::chrono::steady_clock::now();
+
+CpuProfilerRegistry& GetCpuProfilerRegistry()
+{
+	static CpuProfilerRegistry registry{};
+	return registry;
+}
+
+CpuProfilerThreadBuffer& GetCpuProfilerThreadBuffer()
+{
+	// The buffers are never freed, so a trace can still be exported after their thread ended
+	thread_local CpuProfilerThreadBuffer* threadBuffer = nullptr;
+	if (threadBuffer == nullptr)
+	{
+		CpuProfilerRegistry& registry = GetCpuProfilerRegistry();
+		std::scoped_lock lock{ registry.mutex };
+		auto& buffer = registry.buffers.emplace_back(std::make_unique<CpuProfilerThreadBuffer>());
+		buffer->threadId = static_cast<u32>(registry.buffers.size());
+		buffer->threadName = std::format("Thread {}", buffer->threadId);
+		threadBuffer = buffer.get();
+	}
+
+	return *threadBuffer;
+}
+
+void AppendJsonString(std::string& json, const std::string_view value)
+{
+	json.push_back('"');
+	for (const char character : value)
+	{
+		switch (character)
+		{
+		case '"':
+			json.append("\\\"");
+			break;
+		case '\\':
+			json.append("\\\\");
+			break;
+		case '\n':
+			json.append("\\n");
+			break;
+		default:
+			if (static_cast<u8>(character) < 0x20)
+			{
+				std::format_to(std::back_inserter(json), "\\u{:04x}", static_cast<u32>(character));
+			}
+			else
+			{
+				json.push_back(character);
+			}
+			break;
+		}
+	}
+	json.push_back('"');
+}
+
+i64 GetCpuProfilerTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - CpuProfilerEpoch)
+		.count();
+}
+
+void RecordCpuProfilerZone(const CpuProfilerZoneRecord& record)
+{
+	CpuProfilerThreadBuffer& buffer = GetCpuProfilerThreadBuffer();
+	const u64 recordsCount = buffer.recordsCount.load(std::memory_order_relaxed);
+	buffer.records[recordsCount % CpuProfilerZonesPerThread] = record;
+	buffer.recordsCount.store(recordsCount + 1, std::memory_order_release);
+}
+
+void SetCpuProfilerThreadName(const std::string_view name)
+{
+	CpuProfilerThreadBuffer& buffer = GetCpuProfilerThreadBuffer();
+	std::scoped_lock lock{ GetCpuProfilerRegistry().mutex };
+	buffer.threadName = name;
+}
+
+std::expected<void, std::string> SaveChromeTrace(const std::filesystem::path& path)
+{
+	if constexpr (!IsCpuProfilerEnabled)
+	{
+		return std::unexpected(std::string{ "The CPU profiler is disabled in this build" });
+	}
+
+	std::string json{ "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" };
+	usize zonesCount = 0;
+	bool isFirstEvent = true;
+	const auto beginEvent = [&json, &isFirstEvent] {
+		if (!isFirstEvent)
+		{
+			json.append(",\n");
+		}
+		isFirstEvent = false;
+	};
+
+	{
+		CpuProfilerRegistry& registry = GetCpuProfilerRegistry();
+		std::scoped_lock lock{ registry.mutex };
+		std::vector<CpuProfilerZoneRecord> records{};
+		for (const auto& buffer : registry.buffers)
+		{
+			beginEvent();
+			json.append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":",
+				buffer->threadId));
+			AppendJsonString(json, buffer->threadName);
+			json.append("}}");
+
+			const u64 endIndex = buffer->recordsCount.load(std::memory_order_acquire);
+			const u64 beginIndex = endIndex > CpuProfilerZonesPerThread ? endIndex - CpuProfilerZonesPerThread : 0;
+			records.clear();
+			for (u64 i = beginIndex; i < endIndex; i++)
+			{
+				records.push_back(buffer->records[i % CpuProfilerZonesPerThread]);
+			}
+
+			// The thread kept recording while the records were copied, the oldest ones may have been overwritten
+			const u64 newEndIndex = buffer->recordsCount.load(std::memory_order_acquire);
+			const u64 validBeginIndex = newEndIndex > CpuProfilerZonesPerThread
+											? std::max(beginIndex, newEndIndex - CpuProfilerZonesPerThread)
+											: beginIndex;
+			const auto skippedCount =
+				static_cast<usize>(std::min(validBeginIndex - beginIndex, endIndex - beginIndex));
+
+			for (usize i = skippedCount; i < records.size(); i++)
+			{
+				const CpuProfilerZoneRecord& record = records[i];
+				beginEvent();
+				json.append("{\"name\":");
+				AppendJsonString(json, record.name);
+				json.append(std::format(",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":0,"
+										"\"tid\":{}}}",
+					static_cast<f64>(record.startNanoseconds) / 1'000.0,
+					static_cast<f64>(record.endNanoseconds - record.startNanoseconds) / 1'000.0,
+					buffer->threadId));
+			}
+			zonesCount += records.size() - skippedCount;
+		}
+	}
+
+	json.append("]}\n");
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return std::unexpected(std::format("Could not open {}", path.string()));
+	}
+
+	file.write(json.data(), static_cast<std::streamsize>(json.size()));
+	if (!file)
+	{
+		return std::unexpected(std::format("Could not write {}", path.string()));
+	}
+
+	spdlog::info("Saved {} CPU profiler zones to {}", zonesCount, path.string());
+	return {};
+}
+
+CpuProfilerZone::CpuProfilerZone(const char* name) : m_Name(name), m_StartNanoseconds(GetCpuProfilerTimestamp()) {}
+
+CpuProfilerZone::~CpuProfilerZone()
+{
+	RecordCpuProfilerZone({ m_Name, m_StartNanoseconds, GetCpuProfilerTimestamp() });
+}
+}// namespace stw
@@ -0,0 +1,385 @@
+/**
+ * @file dynamic_resolution.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the GPU frame timer and the dynamic resolution controller.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+export module dynamic_resolution;
+
+import number_types;
+import timer;
+import utils;
+
+export namespace stw
+{
+/**
+ * Measures the time the GPU takes to render a frame with GL_TIME_ELAPSED queries.
+ * The queries are kept in a ring so that reading a result never stalls the pipeline,
+ * which means the measured time is a few frames late.
+ */
+class GpuFrameTimer
+{
+public:
+	static constexpr usize QueriesCount = 4;
+
+	GpuFrameTimer() = default;
+	GpuFrameTimer(const GpuFrameTimer&) = delete;
+	GpuFrameTimer(GpuFrameTimer&&) = delete;
+	~GpuFrameTimer();
+
+	GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+	GpuFrameTimer& operator=(GpuFrameTimer&&) = delete;
+
+	void Init();
+	void Delete();
+
+	/**
+	 * Starts timing the GPU commands. Does nothing if every query of the ring is still waiting for its result.
+	 */
+	void Begin();
+	void End();
+
+	/**
+	 * Reads every query result that is available without waiting.
+	 * @return The most recent GPU frame time, if a new one is available.
+	 */
+	[[nodiscard]] std::optional<Duration> PollElapsedTime();
+
+private:
+	bool m_IsInitialized = false;
+	bool m_IsTiming = false;
+	usize m_WriteIndex = 0;
+	usize m_ReadIndex = 0;
+	std::array<GLuint, QueriesCount> m_Queries{};
+	std::array<bool, QueriesCount> m_IsQueryPending{};
+};
+
+struct DynamicResolutionSettings
+{
+	bool enabled = false;
+	f32 targetFrameTimeMs = 16.6f;
+	f32 minScale = 0.5f;
+	f32 maxScale = 1.0f;
+
+	/**
+	 * The scale is always a multiple of this value, so that small variations of the frame time do not recreate the
+	 * render targets.
+	 */
+	f32 scaleStep = 0.05f;
+
+	/**
+	 * Minimum number of measured frames between two scale changes.
+	 */
+	u32 cooldownFrames = 30;
+
+	/**
+	 * Clamps every value in a range that makes sense.
+	 */
+	void Validate();
+};
+
+/**
+ * Loads the dynamic resolution settings from a config file made of "key = value" lines.
+ * @param path Path of the config file.
+ * @return The loaded settings or an error message.
+ */
+std::expected<DynamicResolutionSettings, std::string> LoadDynamicResolutionSettings(const std::filesystem::path& path);
+
+/**
+ * Chooses the render scale from the measured GPU frame times to stay under a target frame time.
+ */
+class DynamicResolutionController
+{
+public:
+	/**
+	 * Upper bound of the frame time, relative to the target, before the scale is lowered.
+	 */
+	static constexpr f32 ScaleDownThreshold = 1.05f;
+
+	/**
+	 * Lower bound of the frame time, relative to the target, before the scale is raised.
+	 * It is lower than one so that the scale does not oscillate around the target.
+	 */
+	static constexpr f32 ScaleUpThreshold = 0.85f;
+
+	/**
+	 * Weight of a new frame time in the exponential moving average.
+	 */
+	static constexpr f32 SmoothingFactor = 0.1f;
+
+	void SetSettings(const DynamicResolutionSettings& settings);
+	[[nodiscard]] const DynamicResolutionSettings& GetSettings() const;
+	[[nodiscard]] f32 GetScale() const;
+	[[nodiscard]] f32 GetSmoothedFrameTimeMs() const;
+
+	/**
+	 * Feeds a new GPU frame time to the controller.
+	 * @param gpuFrameTime Time taken by the GPU to render a frame.
+	 * @return The new scale if it changed.
+	 */
+	[[nodiscard]] std::optional<f32> Update(Duration gpuFrameTime);
+
+private:
+	DynamicResolutionSettings m_Settings{};
+	f32 m_Scale = 1.0f;
+	f32 m_SmoothedFrameTimeMs = 0.0f;
+	bool m_HasFrameTime = false;
+	u32 m_FramesSinceChange = 0;
+
+	[[nodiscard]] f32 QuantizeScale(f32 scale) const;
+};
+
+GpuFrameTimer::~GpuFrameTimer()
+{
+	if (m_IsInitialized)
+	{
+		spdlog::error("Destructor called on GPU frame timer that is still initialized");
+	}
+}
+
+void GpuFrameTimer::Init()
+{
+	assert(!m_IsInitialized);
+
+	glGenQueries(static_cast<GLsizei>(m_Queries.size()), m_Queries.data());
+	m_IsQueryPending.fill(false);
+	m_WriteIndex = 0;
+	m_ReadIndex = 0;
+	m_IsInitialized = true;
+}
+
+void GpuFrameTimer::Delete()
+{
+	assert(m_IsInitialized);
+
+	glDeleteQueries(static_cast<GLsizei>(m_Queries.size()), m_Queries.data());
+	m_Queries.fill(0);
+	m_IsInitialized = false;
+}
+
+void GpuFrameTimer::Begin()
+{
+	assert(m_IsInitialized);
+
+	if (m_IsQueryPending[m_WriteIndex])
+	{
+		m_IsTiming = false;
+		return;
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, m_Queries[m_WriteIndex]);
+	m_IsTiming = true;
+}
+
+void GpuFrameTimer::End()
+{
+	if (!m_IsTiming)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_IsQueryPending[m_WriteIndex] = true;
+	m_WriteIndex = (m_WriteIndex + 1) % QueriesCount;
+	m_IsTiming = false;
+}
+
+std::optional<Duration> GpuFrameTimer::PollElapsedTime()
+{
+	assert(m_IsInitialized);
+
+	std::optional<Duration> elapsedTime{};
+	while (m_IsQueryPending[m_ReadIndex])
+	{
+		GLint isAvailable = GL_FALSE;
+		glGetQueryObjectiv(m_Queries[m_ReadIndex], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+		if (isAvailable == GL_FALSE)
+		{
+			break;
+		}
+
+		GLuint64 elapsedNanoseconds = 0;
+		glGetQueryObjectui64v(m_Queries[m_ReadIndex], GL_QUERY_RESULT, &elapsedNanoseconds);
+		elapsedTime = Duration::FromMicroSeconds(static_cast<f64>(elapsedNanoseconds) / 1'000.0);
+
+		m_IsQueryPending[m_ReadIndex] = false;
+		m_ReadIndex = (m_ReadIndex + 1) % QueriesCount;
+	}
+
+	return elapsedTime;
+}
+
+void DynamicResolutionSettings::Validate()
+{
+	constexpr f32 minAllowedScale = 0.25f;
+	constexpr f32 maxAllowedScale = 2.0f;
+
+	targetFrameTimeMs = std::max(targetFrameTimeMs, 1.0f);
+	minScale = std::clamp(minScale, minAllowedScale, maxAllowedScale);
+	maxScale = std::clamp(maxScale, minScale, maxAllowedScale);
+	scaleStep = std::clamp(scaleStep, 0.01f, 0.5f);
+}
+
+std::expected<DynamicResolutionSettings, std::string> LoadDynamicResolutionSettings(const std::filesystem::path& path)
+{
+	const auto entries = ReadConfigFile(path);
+	if (!entries)
+	{
+		return std::unexpected(entries.error());
+	}
+
+	DynamicResolutionSettings settings{};
+	for (const ConfigEntry& entry : entries.value())
+	{
+		if (entry.key == "enabled")
+		{
+			if (entry.value != "true" && entry.value != "false")
+			{
+				return std::unexpected(
+					std::format("{}:{} : expected true or false, got \"{}\"", path.string(), entry.lineNumber, entry.value));
+			}
+			settings.enabled = entry.value == "true";
+			continue;
+		}
+
+		if (entry.key == "cooldown_frames")
+		{
+			const auto cooldownFrames = ParseNumber<u32>(entry.value);
+			if (!cooldownFrames)
+			{
+				return std::unexpected(
+					std::format("{}:{} : {}", path.string(), entry.lineNumber, cooldownFrames.error()));
+			}
+			settings.cooldownFrames = cooldownFrames.value();
+			continue;
+		}
+
+		const auto value = ParseNumber<f32>(entry.value);
+		if (!value)
+		{
+			return std::unexpected(std::format("{}:{} : {}", path.string(), entry.lineNumber, value.error()));
+		}
+
+		if (entry.key == "target_frame_time_ms")
+		{
+			settings.targetFrameTimeMs = value.value();
+		}
+		else if (entry.key == "min_scale")
+		{
+			settings.minScale = value.value();
+		}
+		else if (entry.key == "max_scale")
+		{
+			settings.maxScale = value.value();
+		}
+		else if (entry.key == "scale_step")
+		{
+			settings.scaleStep = value.value();
+		}
+		else
+		{
+			spdlog::warn("Unknown dynamic resolution key \"{}\" in {}", entry.key, path.string());
+		}
+	}
+
+	settings.Validate();
+	return settings;
+}
+
+void DynamicResolutionController::SetSettings(const DynamicResolutionSettings& settings)
+{
+	m_Settings = settings;
+	m_Settings.Validate();
+
+	m_Scale = m_Settings.maxScale;
+	m_HasFrameTime = false;
+	m_FramesSinceChange = 0;
+}
+
+const DynamicResolutionSettings& DynamicResolutionController::GetSettings() const { return m_Settings; }
+
+f32 DynamicResolutionController::GetScale() const { return m_Scale; }
+
+f32 DynamicResolutionController::GetSmoothedFrameTimeMs() const { return m_SmoothedFrameTimeMs; }
+
+std::optional<f32> DynamicResolutionController::Update(const Duration gpuFrameTime)
+{
+	if (!m_Settings.enabled)
+	{
+		return std::nullopt;
+	}
+
+	const auto frameTimeMs = static_cast<f32>(gpuFrameTime.GetInMilliseconds());
+	if (m_HasFrameTime)
+	{
+		m_SmoothedFrameTimeMs += (frameTimeMs - m_SmoothedFrameTimeMs) * SmoothingFactor;
+	}
+	else
+	{
+		m_SmoothedFrameTimeMs = frameTimeMs;
+		m_HasFrameTime = true;
+	}
+
+	m_FramesSinceChange++;
+	if (m_FramesSinceChange < m_Settings.cooldownFrames)
+	{
+		return std::nullopt;
+	}
+
+	const f32 targetFrameTimeMs = m_Settings.targetFrameTimeMs;
+	const bool isOverBudget = m_SmoothedFrameTimeMs > targetFrameTimeMs * ScaleDownThreshold;
+	const bool isUnderBudget = m_SmoothedFrameTimeMs < targetFrameTimeMs * ScaleUpThreshold;
+	if (!isOverBudget && !isUnderBudget)
+	{
+		return std::nullopt;
+	}
+
+	// The cost of a frame is roughly proportional to its pixel count, so to the square of the scale
+	const f32 desiredScale = m_Scale * std::sqrt(targetFrameTimeMs / std::max(m_SmoothedFrameTimeMs, 0.001f));
+	f32 newScale = QuantizeScale(desiredScale);
+	if (isOverBudget && newScale >= m_Scale)
+	{
+		newScale = QuantizeScale(m_Scale - m_Settings.scaleStep);
+	}
+	else if (isUnderBudget && newScale <= m_Scale)
+	{
+		newScale = QuantizeScale(m_Scale + m_Settings.scaleStep);
+	}
+
+	if (std::abs(newScale - m_Scale) < m_Settings.scaleStep * 0.5f)
+	{
+		return std::nullopt;
+	}
+
+	m_Scale = newScale;
+	m_HasFrameTime = false;
+	m_FramesSinceChange = 0;
+	return m_Scale;
+}
+
+f32 DynamicResolutionController::QuantizeScale(const f32 scale) const
+{
+	const f32 quantizedScale = std::round(scale / m_Settings.scaleStep) * m_Settings.scaleStep;
+	return std::clamp(quantizedScale, m_Settings.minScale, m_Settings.maxScale);
+}
+}// namespace stw
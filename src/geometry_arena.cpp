@@ -0,0 +1,271 @@
+/**
+ * @file geometry_arena.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the GeometryArena class that stores the CPU copies of the meshes.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+export module geometry_arena;
+
+import number_types;
+import utils;
+
+export namespace stw
+{
+/**
+ * Size of the blocks of the arena. An allocation that does not fit in a block gets a block of its own.
+ */
+constexpr usize GeometryArenaBlockSize = 16 * 1024 * 1024;
+
+/**
+ * What the CPU keeps of a mesh once it is uploaded to the GPU.
+ */
+enum class GeometryResidency : u8
+{
+	/**
+	 * Nothing is kept, the GPU has the only copy.
+	 */
+	DropAfterUpload,
+	/**
+	 * The positions and the indices of the full detail level are kept, to test rays against the triangles.
+	 */
+	KeepForPicking,
+	/**
+	 * The vertices and every index are kept, so that the mesh can be uploaded again.
+	 */
+	KeepForReupload,
+};
+
+[[nodiscard]] std::string_view ToString(GeometryResidency residency);
+[[nodiscard]] std::optional<GeometryResidency> ParseGeometryResidency(std::string_view name);
+
+struct GeometrySettings
+{
+	/**
+	 * What the CPU keeps of the meshes of the models loaded afterwards.
+	 */
+	GeometryResidency residency = GeometryResidency::DropAfterUpload;
+};
+
+/**
+ * Reads the geometry settings from a file of "key = value" lines.
+ * The "residency" key is drop_after_upload, keep_for_picking or keep_for_reupload.
+ */
+std::expected<GeometrySettings, std::string> LoadGeometrySettings(const std::filesystem::path& path);
+
+/**
+ * Allocates the arrays of the meshes one after the other in big blocks, which avoids one heap allocation per array.
+ * The arrays are only freed all at once, when the arena is cleared. Allocating is not thread safe.
+ */
+class GeometryArena
+{
+public:
+	GeometryArena() = default;
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena(GeometryArena&&) noexcept = default;
+	~GeometryArena() = default;
+
+	GeometryArena& operator=(const GeometryArena&) = delete;
+	GeometryArena& operator=(GeometryArena&&) noexcept = default;
+
+	/**
+	 * Allocates an array of value initialized elements.
+	 * @param count Number of elements.
+	 * @return The array, valid until the arena is cleared.
+	 */
+	template<typename T>
+	std::span<T> Allocate(usize count);
+
+	/**
+	 * Allocates an array and copies values into it.
+	 * @param values Values to copy.
+	 * @return The copy, valid until the arena is cleared.
+	 */
+	template<typename T>
+	std::span<T> Copy(std::span<const T> values);
+
+	/**
+	 * Frees every block, which invalidates every array allocated by the arena.
+	 */
+	void Clear();
+
+	/**
+	 * Gets the number of bytes used by the arrays, including the padding between them.
+	 */
+	[[nodiscard]] usize GetUsedSize() const;
+
+	/**
+	 * Gets the number of bytes allocated for the blocks.
+	 */
+	[[nodiscard]] usize GetReservedSize() const;
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::byte[]> data;
+		usize size;
+		usize used;
+	};
+
+	std::vector<Block> m_Blocks{};
+	usize m_UsedSize = 0;
+	usize m_ReservedSize = 0;
+
+	std::byte* AllocateBytes(usize size, usize alignment);
+};
+
+template<typename T>
+std::span<T> GeometryArena::Allocate(const usize count)
+{
+	// The blocks are freed without calling destructors
+	static_assert(std::is_trivially_destructible_v<T>);
+
+	if (count == 0)
+	{
+		return {};
+	}
+
+	auto* elements = reinterpret_cast<T*>(AllocateBytes(count * sizeof(T), alignof(T)));
+	std::uninitialized_value_construct_n(elements, count);
+
+	return { elements, count };
+}
+
+template<typename T>
+std::span<T> GeometryArena::Copy(const std::span<const T> values)
+{
+	static_assert(std::is_trivially_destructible_v<T>);
+
+	if (values.empty())
+	{
+		return {};
+	}
+
+	auto* elements = reinterpret_cast<T*>(AllocateBytes(values.size_bytes(), alignof(T)));
+	std::uninitialized_copy(values.begin(), values.end(), elements);
+
+	return { elements, values.size() };
+}
+
+std::string_view ToString(const GeometryResidency residency)
+{
+	switch (residency)
+	{
+	case GeometryResidency::DropAfterUpload:
+		return "drop_after_upload";
+	case GeometryResidency::KeepForPicking:
+		return "keep_for_picking";
+	case GeometryResidency::KeepForReupload:
+		return "keep_for_reupload";
+	}
+
+	return "unknown";
+}
+
+std::optional<GeometryResidency> ParseGeometryResidency(const std::string_view name)
+{
+	for (const GeometryResidency residency : { GeometryResidency::DropAfterUpload,
+			 GeometryResidency::KeepForPicking,
+			 GeometryResidency::KeepForReupload })
+	{
+		if (ToString(residency) == name)
+		{
+			return residency;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::expected<GeometrySettings, std::string> LoadGeometrySettings(const std::filesystem::path& path)
+{
+	const auto entries = ReadConfigFile(path);
+	if (!entries)
+	{
+		return std::unexpected(entries.error());
+	}
+
+	GeometrySettings settings{};
+	for (const ConfigEntry& entry : entries.value())
+	{
+		if (entry.key == "residency")
+		{
+			const std::optional<GeometryResidency> residency = ParseGeometryResidency(entry.value);
+			if (!residency)
+			{
+				return std::unexpected(
+					std::format("{}:{} : unknown residency \"{}\"", path.string(), entry.lineNumber, entry.value));
+			}
+			settings.residency = residency.value();
+		}
+		else
+		{
+			spdlog::warn("Unknown geometry key \"{}\" in {}", entry.key, path.string());
+		}
+	}
+
+	return settings;
+}
+
+void GeometryArena::Clear()
+{
+	m_Blocks.clear();
+	m_UsedSize = 0;
+	m_ReservedSize = 0;
+}
+
+usize GeometryArena::GetUsedSize() const { return m_UsedSize; }
+
+usize GeometryArena::GetReservedSize() const { return m_ReservedSize; }
+
+std::byte* GeometryArena::AllocateBytes(const usize size, const usize alignment)
+{
+	if (!m_Blocks.empty())
+	{
+		Block& block = m_Blocks.back();
+		const usize offset = (block.used + alignment - 1) / alignment * alignment;
+		if (offset + size <= block.size)
+		{
+			m_UsedSize += offset + size - block.used;
+			block.used = offset + size;
+			return block.data.get() + offset;
+		}
+	}
+
+	// new[] aligns its storage for any fundamental type, which covers the vertices and indices
+	const usize blockSize = std::max(size, GeometryArenaBlockSize);
+	m_Blocks.push_back({ std::make_unique_for_overwrite<std::byte[]>(blockSize), blockSize, size });
+	m_UsedSize += size;
+	m_ReservedSize += blockSize;
+
+	// An oversized block is full right away, so it is moved before the last block to keep filling that one
+	if (size >= GeometryArenaBlockSize && m_Blocks.size() > 1)
+	{
+		std::swap(m_Blocks[m_Blocks.size() - 1], m_Blocks[m_Blocks.size() - 2]);
+		return m_Blocks[m_Blocks.size() - 2].data.get();
+	}
+
+	return m_Blocks.back().data.get();
+}
+}// namespace stw
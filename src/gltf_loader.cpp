@@ -0,0 +1,1014 @@
+/**
+ * @file gltf_loader.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the glTF 2.0 importer that reads the models without going through Assimp.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <future>
+#include <limits>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <spdlog/spdlog.h>
+
+#include "profiler.hpp"
+
+export module gltf_loader;
+
+import number_types;
+import cpu_profiler;
+import json;
+import mapped_file;
+import mesh;
+import material_manager;
+import model_cache;
+import thread_pool;
+import timer;
+
+export namespace stw
+{
+constexpr u32 GlbMagic = 0x46546C67;
+constexpr u32 GlbJsonChunkType = 0x4E4F534A;
+constexpr u32 GlbBinaryChunkType = 0x004E4942;
+
+constexpr u32 GltfComponentByte = 5120;
+constexpr u32 GltfComponentUnsignedByte = 5121;
+constexpr u32 GltfComponentShort = 5122;
+constexpr u32 GltfComponentUnsignedShort = 5123;
+constexpr u32 GltfComponentUnsignedInt = 5125;
+constexpr u32 GltfComponentFloat = 5126;
+
+constexpr usize GltfTrianglesMode = 4;
+
+/**
+ * Checks if a model can be read by ImportGltfModel, only from its extension.
+ */
+[[nodiscard]] bool IsGltfPath(const std::filesystem::path& path);
+
+/**
+ * Lists the external buffers of a glTF model, which the model cache depends on as much as on the model itself.
+ * @param path Path of the model.
+ * @return The paths of the buffers or an error message if the model could not be read.
+ */
+std::expected<std::vector<std::filesystem::path>, std::string> GetGltfBufferPaths(const std::filesystem::path& path);
+
+/**
+ * Imports a glTF 2.0 model, either a .gltf with external buffers or a .glb, and converts it to the layout used by the
+ * renderer and by the model cache. The buffers are mapped in memory and the accessors are read straight from them.
+ * @param path Path of the model.
+ * @param flipUVs If the texture coordinates should be flipped, with the same meaning as for the Assimp import.
+ * @param threadPool Thread pool that converts the primitives.
+ * @return The converted model or an error message, in which case the model can still be imported by Assimp.
+ */
+std::expected<ImportedModel, std::string> ImportGltfModel(
+	const std::filesystem::path& path, bool flipUVs, ThreadPool& threadPool);
+
+/**
+ * Strided view of the elements of an accessor inside of a buffer.
+ */
+struct GltfAccessor
+{
+	// Starts at the first element and ends after the last one
+	std::span<const u8> data;
+	usize count;
+	usize stride;
+	u32 componentType;
+	usize componentsCount;
+	bool normalized;
+};
+
+/**
+ * Accessors of a triangle primitive, everything a task needs to convert it.
+ */
+struct GltfPrimitive
+{
+	GltfAccessor positions;
+	GltfAccessor normals;
+	std::optional<GltfAccessor> texCoords;
+	std::optional<GltfAccessor> tangents;
+	std::optional<GltfAccessor> indices;
+};
+
+/**
+ * Splits the content of a .glb file in its JSON and binary chunks.
+ * @param content Content of the file.
+ * @param json Text of the JSON chunk.
+ * @param binary Content of the binary chunk, empty if the file has none.
+ * @return An error message if the file is not a valid .glb.
+ */
+std::expected<void, std::string> ReadGlbChunks(
+	std::span<const u8> content, std::string_view& json, std::span<const u8>& binary);
+
+/**
+ * Decodes the percent encoded characters of an URI, to get a path relative to the model.
+ */
+std::string DecodeGltfUri(std::string_view uri);
+
+/**
+ * Finds an accessor and checks that its elements are inside of its buffer.
+ * @param document glTF document.
+ * @param buffers Content of the buffers of the document.
+ * @param accessorIndex Index of the accessor.
+ * @param componentsCount Number of components expected in each element.
+ * @return The accessor or an error message.
+ */
+std::expected<GltfAccessor, std::string> GetGltfAccessor(const JsonValue& document,
+	std::span<const std::span<const u8>> buffers,
+	usize accessorIndex,
+	usize componentsCount);
+
+/**
+ * Reads a component of an element as a float, applying the normalization of the accessor.
+ */
+f32 ReadGltfComponent(const u8* data, u32 componentType, bool normalized);
+
+/**
+ * Reads an element of an accessor of floats or normalized integers.
+ */
+template<glm::length_t N>
+glm::vec<N, f32> ReadGltfVector(const GltfAccessor& accessor, usize index);
+
+/**
+ * Reads an index of an accessor of unsigned integers.
+ */
+u32 ReadGltfIndex(const GltfAccessor& accessor, usize index);
+
+/**
+ * Finds the URI of the image of a texture of a material.
+ * @param document glTF document.
+ * @param textureInfo Texture info of the material, like its normalTexture.
+ * @return The URI relative to the model or nothing if the texture is missing or embedded.
+ */
+std::optional<std::string> GetGltfTextureUri(const JsonValue& document, const JsonValue* textureInfo);
+
+/**
+ * Maps a glTF material on the materials of the renderer.
+ * @param document glTF document.
+ * @param material Material to map.
+ * @return The descriptor of the material or nothing if the renderer cannot draw it.
+ */
+std::optional<MaterialDescriptor> ReadGltfMaterialDescriptor(const JsonValue& document, const JsonValue& material);
+
+/**
+ * Computes the local transform of a node, from its matrix or from its translation, rotation and scale.
+ */
+glm::mat4 ReadGltfNodeTransform(const JsonValue& node);
+
+/**
+ * Converts the vertices and indices of a primitive. It can run on any thread.
+ * @param primitive Accessors of the primitive.
+ * @param flipUVs If the texture coordinates should be flipped.
+ * @param vertices Converted vertices, sized to the number of vertices of the primitive.
+ * @param indices Converted indices, sized to the number of indices of the primitive.
+ * @return False if an index is outside of the vertices.
+ */
+bool ConvertGltfPrimitive(
+	const GltfPrimitive& primitive, bool flipUVs, std::span<Vertex> vertices, std::span<u32> indices);
+
+/**
+ * Computes the tangents of the vertices from their texture coordinates, for the primitives that have none.
+ */
+void GenerateTangents(std::span<Vertex> vertices, std::span<const u32> indices);
+
+bool IsGltfPath(const std::filesystem::path& path)
+{
+	const auto extension = path.extension();
+	return extension == ".gltf" || extension == ".glb";
+}
+
+std::expected<std::vector<std::filesystem::path>, std::string> GetGltfBufferPaths(const std::filesystem::path& path)
+{
+	PROFILE_FUNCTION();
+
+	const auto mappedFile = MappedFile::Open(path);
+	if (!mappedFile)
+	{
+		return std::unexpected(mappedFile.error());
+	}
+
+	std::string_view jsonText{};
+	std::span<const u8> glbBinary{};
+	if (path.extension() == ".glb")
+	{
+		const auto chunksResult = ReadGlbChunks(mappedFile->GetData(), jsonText, glbBinary);
+		if (!chunksResult)
+		{
+			return std::unexpected(chunksResult.error());
+		}
+	}
+	else
+	{
+		jsonText = { reinterpret_cast<const char*>(mappedFile->GetData().data()), mappedFile->GetSize() };
+	}
+
+	const auto document = ParseJson(jsonText);
+	if (!document)
+	{
+		return std::unexpected(std::format("Invalid glTF JSON : {}", document.error()));
+	}
+
+	const auto workingDirectory = path.parent_path();
+	std::vector<std::filesystem::path> bufferPaths{};
+	for (const JsonValue& buffer : document->FindArray("buffers"))
+	{
+		const JsonValue* uri = buffer.Find("uri");
+		if (uri != nullptr && uri->GetString() && !uri->GetString()->starts_with("data:"))
+		{
+			bufferPaths.push_back(workingDirectory / DecodeGltfUri(uri->GetString().value()));
+		}
+	}
+
+	return bufferPaths;
+}
+
+std::expected<void, std::string> ReadGlbChunks(
+	const std::span<const u8> content, std::string_view& json, std::span<const u8>& binary)
+{
+	constexpr usize headerSize = 12;
+	constexpr usize chunkHeaderSize = 8;
+
+	const auto readU32 = [content](const usize offset) {
+		u32 value = 0;
+		std::memcpy(&value, content.data() + offset, sizeof(value));
+		return value;
+	};
+
+	if (content.size() < headerSize || readU32(0) != GlbMagic)
+	{
+		return std::unexpected("The file is not a binary glTF");
+	}
+
+	const usize length = std::min<usize>(readU32(8), content.size());
+	usize offset = headerSize;
+	bool hasJson = false;
+	binary = {};
+	while (offset + chunkHeaderSize <= length)
+	{
+		const usize chunkLength = readU32(offset);
+		const u32 chunkType = readU32(offset + 4);
+		offset += chunkHeaderSize;
+		if (chunkLength > length - offset)
+		{
+			return std::unexpected("A chunk of the binary glTF is truncated");
+		}
+
+		const std::span<const u8> chunk = content.subspan(offset, chunkLength);
+		if (chunkType == GlbJsonChunkType && !hasJson)
+		{
+			json = { reinterpret_cast<const char*>(chunk.data()), chunk.size() };
+			hasJson = true;
+		}
+		else if (chunkType == GlbBinaryChunkType && binary.empty())
+		{
+			binary = chunk;
+		}
+
+		// The chunks are aligned on 4 bytes
+		offset += (chunkLength + 3) / 4 * 4;
+	}
+
+	if (!hasJson)
+	{
+		return std::unexpected("The binary glTF has no JSON chunk");
+	}
+
+	return {};
+}
+
+std::string DecodeGltfUri(const std::string_view uri)
+{
+	std::string decoded{};
+	decoded.reserve(uri.size());
+	for (usize i = 0; i < uri.size(); i++)
+	{
+		if (uri[i] == '%' && i + 2 < uri.size())
+		{
+			const std::string hex{ uri.substr(i + 1, 2) };
+			char* end = nullptr;
+			const auto character = std::strtol(hex.c_str(), &end, 16);
+			if (end == hex.c_str() + hex.size())
+			{
+				decoded.push_back(static_cast<char>(character));
+				i += 2;
+				continue;
+			}
+		}
+
+		decoded.push_back(uri[i]);
+	}
+
+	return decoded;
+}
+
+std::expected<GltfAccessor, std::string> GetGltfAccessor(const JsonValue& document,
+	const std::span<const std::span<const u8>> buffers,
+	const usize accessorIndex,
+	const usize componentsCount)
+{
+	const std::span<const JsonValue> accessors = document.FindArray("accessors");
+	if (accessorIndex >= accessors.size())
+	{
+		return std::unexpected(std::format("Invalid accessor {}", accessorIndex));
+	}
+
+	const JsonValue& accessor = accessors[accessorIndex];
+	if (accessor.Find("sparse") != nullptr)
+	{
+		return std::unexpected(std::format("The accessor {} is sparse", accessorIndex));
+	}
+
+	const auto bufferViewIndex = accessor.FindIndex("bufferView");
+	const auto componentType = accessor.FindIndex("componentType");
+	const auto count = accessor.FindIndex("count");
+	const JsonValue* type = accessor.Find("type");
+	if (!bufferViewIndex || !componentType || !count || type == nullptr)
+	{
+		return std::unexpected(std::format("The accessor {} is incomplete", accessorIndex));
+	}
+
+	constexpr std::array<std::string_view, 4> types{ "SCALAR", "VEC2", "VEC3", "VEC4" };
+	if (type->GetString() != types[componentsCount - 1])
+	{
+		return std::unexpected(std::format("The accessor {} is not a {}", accessorIndex, types[componentsCount - 1]));
+	}
+
+	usize componentSize = 0;
+	switch (componentType.value())
+	{
+	case GltfComponentByte:
+	case GltfComponentUnsignedByte:
+		componentSize = 1;
+		break;
+	case GltfComponentShort:
+	case GltfComponentUnsignedShort:
+		componentSize = 2;
+		break;
+	case GltfComponentUnsignedInt:
+	case GltfComponentFloat:
+		componentSize = 4;
+		break;
+	default:
+		return std::unexpected(std::format("The accessor {} has an invalid component type", accessorIndex));
+	}
+
+	const std::span<const JsonValue> bufferViews = document.FindArray("bufferViews");
+	if (bufferViewIndex.value() >= bufferViews.size())
+	{
+		return std::unexpected(std::format("The accessor {} has an invalid buffer view", accessorIndex));
+	}
+
+	const JsonValue& bufferView = bufferViews[bufferViewIndex.value()];
+	const auto bufferIndex = bufferView.FindIndex("buffer");
+	const auto viewLength = bufferView.FindIndex("byteLength");
+	const usize viewOffset = bufferView.FindIndex("byteOffset").value_or(0);
+	if (!bufferIndex || !viewLength || bufferIndex.value() >= buffers.size()
+		|| viewOffset > buffers[bufferIndex.value()].size()
+		|| viewLength.value() > buffers[bufferIndex.value()].size() - viewOffset)
+	{
+		return std::unexpected(std::format("The buffer view {} is invalid", bufferViewIndex.value()));
+	}
+
+	const usize elementSize = componentSize * componentsCount;
+	const usize stride = bufferView.FindIndex("byteStride").value_or(elementSize);
+	const usize accessorOffset = accessor.FindIndex("byteOffset").value_or(0);
+	if (stride < elementSize)
+	{
+		return std::unexpected(std::format("The buffer view {} has an invalid stride", bufferViewIndex.value()));
+	}
+
+	const usize accessorSize = count.value() > 0 ? (count.value() - 1) * stride + elementSize : 0;
+	if (accessorOffset > viewLength.value() || accessorSize > viewLength.value() - accessorOffset)
+	{
+		return std::unexpected(std::format("The accessor {} is outside of its buffer view", accessorIndex));
+	}
+
+	const std::span<const u8> data =
+		buffers[bufferIndex.value()].subspan(viewOffset + accessorOffset, accessorSize);
+
+	return GltfAccessor{
+		data,
+		count.value(),
+		stride,
+		static_cast<u32>(componentType.value()),
+		componentsCount,
+		accessor.Find("normalized") != nullptr && accessor.Find("normalized")->GetBool().value_or(false),
+	};
+}
+
+f32 ReadGltfComponent(const u8* data, const u32 componentType, const bool normalized)
+{
+	const auto read = [data]<typename T>(T) {
+		T value{};
+		std::memcpy(&value, data, sizeof(T));
+		return value;
+	};
+
+	switch (componentType)
+	{
+	case GltfComponentFloat:
+		return read(f32{});
+	case GltfComponentUnsignedByte:
+	{
+		const auto value = static_cast<f32>(read(u8{}));
+		return normalized ? value / 255.0f : value;
+	}
+	case GltfComponentByte:
+	{
+		const auto value = static_cast<f32>(read(i8{}));
+		return normalized ? std::max(value / 127.0f, -1.0f) : value;
+	}
+	case GltfComponentUnsignedShort:
+	{
+		const auto value = static_cast<f32>(read(u16{}));
+		return normalized ? value / 65535.0f : value;
+	}
+	case GltfComponentShort:
+	{
+		const auto value = static_cast<f32>(read(i16{}));
+		return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+	}
+	default:
+		return static_cast<f32>(read(u32{}));
+	}
+}
+
+template<glm::length_t N>
+glm::vec<N, f32> ReadGltfVector(const GltfAccessor& accessor, const usize index)
+{
+	const u8* element = accessor.data.data() + index * accessor.stride;
+
+	glm::vec<N, f32> vector{};
+	if (accessor.componentType == GltfComponentFloat)
+	{
+		// The layout of the floats matches glm, so the element is copied as a whole
+		std::memcpy(glm::value_ptr(vector), element, sizeof(vector));
+		return vector;
+	}
+
+	const usize componentSize = accessor.componentType <= GltfComponentUnsignedByte ? 1 : 2;
+	for (glm::length_t i = 0; i < N; i++)
+	{
+		vector[i] = ReadGltfComponent(
+			element + static_cast<usize>(i) * componentSize, accessor.componentType, accessor.normalized);
+	}
+
+	return vector;
+}
+
+u32 ReadGltfIndex(const GltfAccessor& accessor, const usize index)
+{
+	const u8* element = accessor.data.data() + index * accessor.stride;
+	switch (accessor.componentType)
+	{
+	case GltfComponentUnsignedByte:
+		return *element;
+	case GltfComponentUnsignedShort:
+	{
+		u16 value = 0;
+		std::memcpy(&value, element, sizeof(value));
+		return value;
+	}
+	default:
+	{
+		u32 value = 0;
+		std::memcpy(&value, element, sizeof(value));
+		return value;
+	}
+	}
+}
+
+std::optional<std::string> GetGltfTextureUri(const JsonValue& document, const JsonValue* textureInfo)
+{
+	if (textureInfo == nullptr)
+	{
+		return std::nullopt;
+	}
+
+	const auto textureIndex = textureInfo->FindIndex("index");
+	const std::span<const JsonValue> textures = document.FindArray("textures");
+	if (!textureIndex || textureIndex.value() >= textures.size())
+	{
+		return std::nullopt;
+	}
+
+	// The KTX2 images are referenced by the extension, with an optional fallback in the source of the texture
+	const JsonValue& texture = textures[textureIndex.value()];
+	const JsonValue* extensions = texture.Find("extensions");
+	const JsonValue* basisu = extensions != nullptr ? extensions->Find("KHR_texture_basisu") : nullptr;
+	const auto imageIndex = basisu != nullptr ? basisu->FindIndex("source") : texture.FindIndex("source");
+
+	const std::span<const JsonValue> images = document.FindArray("images");
+	if (!imageIndex || imageIndex.value() >= images.size())
+	{
+		return std::nullopt;
+	}
+
+	const JsonValue* uri = images[imageIndex.value()].Find("uri");
+	if (uri == nullptr || !uri->GetString() || uri->GetString()->starts_with("data:"))
+	{
+		return std::nullopt;
+	}
+
+	return DecodeGltfUri(uri->GetString().value());
+}
+
+std::optional<MaterialDescriptor> ReadGltfMaterialDescriptor(const JsonValue& document, const JsonValue& material)
+{
+	const JsonValue* pbr = material.Find("pbrMetallicRoughness");
+	if (pbr == nullptr)
+	{
+		spdlog::debug("Unhandled material");
+		return std::nullopt;
+	}
+
+	auto baseColorPath = GetGltfTextureUri(document, pbr->Find("baseColorTexture"));
+	auto metallicRoughnessPath = GetGltfTextureUri(document, pbr->Find("metallicRoughnessTexture"));
+	auto normalPath = GetGltfTextureUri(document, material.Find("normalTexture"));
+	auto ambientOcclusionPath = GetGltfTextureUri(document, material.Find("occlusionTexture"));
+	if (!baseColorPath || !metallicRoughnessPath || !normalPath)
+	{
+		spdlog::debug("Unhandled material");
+		return std::nullopt;
+	}
+
+	MaterialDescriptor descriptor{};
+	descriptor.baseColorPath = std::move(baseColorPath.value());
+	descriptor.normalPath = std::move(normalPath.value());
+
+	// glTF stores the occlusion in red, the roughness in green and the metalness in blue, which is the ARM layout when
+	// the occlusion shares the texture of the roughness and metalness
+	if (ambientOcclusionPath == metallicRoughnessPath)
+	{
+		descriptor.type = MaterialDescriptorType::PbrNormalArm;
+		descriptor.armPath = std::move(metallicRoughnessPath.value());
+		return descriptor;
+	}
+
+	descriptor.type = ambientOcclusionPath ? MaterialDescriptorType::PbrNormal : MaterialDescriptorType::PbrNormalNoAo;
+	descriptor.ambientOcclusionPath = ambientOcclusionPath.value_or(std::string{});
+	descriptor.roughnessPath = metallicRoughnessPath.value();
+	descriptor.metallicPath = std::move(metallicRoughnessPath.value());
+
+	return descriptor;
+}
+
+glm::mat4 ReadGltfNodeTransform(const JsonValue& node)
+{
+	const auto readFloats = [](const JsonValue* value, const std::span<f32> floats) {
+		if (value == nullptr)
+		{
+			return;
+		}
+
+		const std::span<const JsonValue> elements = value->GetArray();
+		for (usize i = 0; i < std::min(elements.size(), floats.size()); i++)
+		{
+			floats[i] = static_cast<f32>(elements[i].GetNumber().value_or(floats[i]));
+		}
+	};
+
+	if (const JsonValue* matrix = node.Find("matrix"))
+	{
+		// Both glTF and glm store the matrices column by column
+		glm::mat4 transform{ 1.0f };
+		readFloats(matrix, { glm::value_ptr(transform), 16 });
+		return transform;
+	}
+
+	glm::vec3 translation{ 0.0f };
+	std::array<f32, 4> rotation{ 0.0f, 0.0f, 0.0f, 1.0f };
+	glm::vec3 scale{ 1.0f };
+	readFloats(node.Find("translation"), { glm::value_ptr(translation), 3 });
+	readFloats(node.Find("rotation"), rotation);
+	readFloats(node.Find("scale"), { glm::value_ptr(scale), 3 });
+
+	// The rotation of glTF is stored as x, y, z, w
+	const glm::quat quaternion{ rotation[3], rotation[0], rotation[1], rotation[2] };
+
+	return glm::translate(glm::mat4{ 1.0f }, translation) * glm::mat4_cast(quaternion)
+		   * glm::scale(glm::mat4{ 1.0f }, scale);
+}
+
+bool ConvertGltfPrimitive(
+	const GltfPrimitive& primitive, const bool flipUVs, const std::span<Vertex> vertices, const std::span<u32> indices)
+{
+	for (usize i = 0; i < vertices.size(); i++)
+	{
+		Vertex& vertex = vertices[i];
+		vertex.position = ReadGltfVector<3>(primitive.positions, i);
+		vertex.normal = ReadGltfVector<3>(primitive.normals, i);
+
+		if (primitive.texCoords)
+		{
+			// The Assimp glTF importer flips V and flipUVs flips it back, which is matched here for the same results
+			const glm::vec2 texCoords = ReadGltfVector<2>(primitive.texCoords.value(), i);
+			vertex.texCoords = { texCoords.x, flipUVs ? texCoords.y : 1.0f - texCoords.y };
+		}
+		else
+		{
+			vertex.texCoords = glm::vec2{ 0.0f };
+		}
+
+		if (primitive.tangents)
+		{
+			vertex.tangent = glm::vec3{ ReadGltfVector<4>(primitive.tangents.value(), i) };
+		}
+	}
+
+	for (usize i = 0; i < indices.size(); i++)
+	{
+		indices[i] = primitive.indices ? ReadGltfIndex(primitive.indices.value(), i) : static_cast<u32>(i);
+		if (indices[i] >= vertices.size())
+		{
+			return false;
+		}
+	}
+
+	if (!primitive.tangents)
+	{
+		GenerateTangents(vertices, indices);
+	}
+
+	return true;
+}
+
+void GenerateTangents(const std::span<Vertex> vertices, const std::span<const u32> indices)
+{
+	for (Vertex& vertex : vertices)
+	{
+		vertex.tangent = glm::vec3{ 0.0f };
+	}
+
+	// The tangent of a triangle follows the U direction of its texture coordinates, and each vertex accumulates the
+	// tangents of its triangles, weighted by their area
+	for (usize i = 0; i + 2 < indices.size(); i += 3)
+	{
+		Vertex& vertex0 = vertices[indices[i]];
+		Vertex& vertex1 = vertices[indices[i + 1]];
+		Vertex& vertex2 = vertices[indices[i + 2]];
+
+		const glm::vec3 edge1 = vertex1.position - vertex0.position;
+		const glm::vec3 edge2 = vertex2.position - vertex0.position;
+		const glm::vec2 deltaUv1 = vertex1.texCoords - vertex0.texCoords;
+		const glm::vec2 deltaUv2 = vertex2.texCoords - vertex0.texCoords;
+
+		const f32 determinant = deltaUv1.x * deltaUv2.y - deltaUv2.x * deltaUv1.y;
+		if (std::abs(determinant) < 1e-12f)
+		{
+			continue;
+		}
+
+		const glm::vec3 tangent = (edge1 * deltaUv2.y - edge2 * deltaUv1.y) / determinant;
+		vertex0.tangent += tangent;
+		vertex1.tangent += tangent;
+		vertex2.tangent += tangent;
+	}
+
+	for (Vertex& vertex : vertices)
+	{
+		glm::vec3 tangent = vertex.tangent - vertex.normal * glm::dot(vertex.normal, vertex.tangent);
+		if (glm::dot(tangent, tangent) < 1e-12f)
+		{
+			// Any direction orthogonal to the normal does for the vertices without texture coordinates
+			const glm::vec3 axis = std::abs(vertex.normal.x) < 0.9f ? glm::vec3{ 1.0f, 0.0f, 0.0f }
+																	 : glm::vec3{ 0.0f, 1.0f, 0.0f };
+			tangent = glm::cross(vertex.normal, axis);
+		}
+
+		vertex.tangent = glm::normalize(tangent);
+	}
+}
+
+std::expected<ImportedModel, std::string> ImportGltfModel(
+	const std::filesystem::path& path, const bool flipUVs, ThreadPool& threadPool)
+{
+	PROFILE_FUNCTION();
+
+	Timer timer;
+	timer.Start();
+
+	const auto mappedFile = MappedFile::Open(path);
+	if (!mappedFile)
+	{
+		return std::unexpected(mappedFile.error());
+	}
+
+	std::string_view jsonText{};
+	std::span<const u8> glbBinary{};
+	if (path.extension() == ".glb")
+	{
+		const auto chunksResult = ReadGlbChunks(mappedFile->GetData(), jsonText, glbBinary);
+		if (!chunksResult)
+		{
+			return std::unexpected(chunksResult.error());
+		}
+	}
+	else
+	{
+		jsonText = { reinterpret_cast<const char*>(mappedFile->GetData().data()), mappedFile->GetSize() };
+	}
+
+	const auto document = ParseJson(jsonText);
+	if (!document)
+	{
+		return std::unexpected(std::format("Invalid glTF JSON : {}", document.error()));
+	}
+
+	// Compressed geometry and the other extensions are left to Assimp, only the KTX2 textures are read here
+	for (const JsonValue& extension : document->FindArray("extensionsRequired"))
+	{
+		if (extension.GetString() != "KHR_texture_basisu")
+		{
+			return std::unexpected(
+				std::format("The glTF requires the extension {}", extension.GetString().value_or("unknown")));
+		}
+	}
+
+	// The external buffers are mapped too, so the accessors are read without copying the buffers
+	const auto workingDirectory = path.parent_path();
+	const std::span<const JsonValue> gltfBuffers = document->FindArray("buffers");
+	std::vector<MappedFile> bufferFiles{};
+	std::vector<std::span<const u8>> buffers{};
+	bufferFiles.reserve(gltfBuffers.size());
+	buffers.reserve(gltfBuffers.size());
+	for (usize i = 0; i < gltfBuffers.size(); i++)
+	{
+		const usize byteLength = gltfBuffers[i].FindIndex("byteLength").value_or(0);
+		const JsonValue* uri = gltfBuffers[i].Find("uri");
+
+		std::span<const u8> buffer{};
+		if (uri == nullptr && i == 0)
+		{
+			buffer = glbBinary;
+		}
+		else if (uri != nullptr && uri->GetString() && !uri->GetString()->starts_with("data:"))
+		{
+			auto bufferFile = MappedFile::Open(workingDirectory / DecodeGltfUri(uri->GetString().value()));
+			if (!bufferFile)
+			{
+				return std::unexpected(bufferFile.error());
+			}
+
+			buffer = bufferFile->GetData();
+			bufferFiles.push_back(std::move(bufferFile.value()));
+		}
+		else
+		{
+			return std::unexpected(std::format("The buffer {} is embedded in the glTF", i));
+		}
+
+		if (buffer.size() < byteLength)
+		{
+			return std::unexpected(std::format("The buffer {} is truncated", i));
+		}
+
+		buffers.push_back(buffer.first(byteLength));
+	}
+
+	ImportedModel importedModel{};
+	ModelData& model = importedModel.data;
+
+	const std::span<const JsonValue> gltfMaterials = document->FindArray("materials");
+	std::vector<u32> materialIndices(gltfMaterials.size(), InvalidModelIndex);
+	for (usize i = 0; i < gltfMaterials.size(); i++)
+	{
+		auto descriptor = ReadGltfMaterialDescriptor(document.value(), gltfMaterials[i]);
+		if (descriptor)
+		{
+			materialIndices[i] = static_cast<u32>(model.materials.size());
+			model.materials.push_back(std::move(descriptor.value()));
+		}
+	}
+
+	// Each primitive becomes a mesh, converted on the thread pool while the nodes are read. The primitives without a
+	// loaded material are skipped.
+	const std::span<const JsonValue> gltfMeshes = document->FindArray("meshes");
+	std::vector<std::vector<u32>> primitiveMeshIndices(gltfMeshes.size());
+	usize primitivesCount = 0;
+	for (const JsonValue& gltfMesh : gltfMeshes)
+	{
+		primitivesCount += gltfMesh.FindArray("primitives").size();
+	}
+
+	// The arrays are sized before the tasks start and are never resized, so the spans given to the tasks stay valid
+	std::vector<std::future<bool>> primitiveTasks{};
+	importedModel.vertexArrays.reserve(primitivesCount);
+	importedModel.indexArrays.reserve(primitivesCount);
+	importedModel.lodArrays.reserve(primitivesCount);
+	for (usize meshIndex = 0; meshIndex < gltfMeshes.size(); meshIndex++)
+	{
+		for (const JsonValue& gltfPrimitive : gltfMeshes[meshIndex].FindArray("primitives"))
+		{
+			const auto materialIndex = gltfPrimitive.FindIndex("material");
+			if (!materialIndex || materialIndex.value() >= materialIndices.size()
+				|| materialIndices[materialIndex.value()] == InvalidModelIndex)
+			{
+				primitiveMeshIndices[meshIndex].push_back(InvalidModelIndex);
+				continue;
+			}
+
+			// Everything is drawn as triangles
+			if (gltfPrimitive.FindIndex("mode").value_or(GltfTrianglesMode) != GltfTrianglesMode)
+			{
+				return std::unexpected(std::format("The mesh {} has primitives that are not triangles", meshIndex));
+			}
+
+			const JsonValue* attributes = gltfPrimitive.Find("attributes");
+			const auto positionsIndex = attributes != nullptr ? attributes->FindIndex("POSITION") : std::nullopt;
+			const auto normalsIndex = attributes != nullptr ? attributes->FindIndex("NORMAL") : std::nullopt;
+			if (!positionsIndex || !normalsIndex)
+			{
+				return std::unexpected(std::format("The mesh {} has primitives without normals", meshIndex));
+			}
+
+			const auto readAccessor = [&](const std::optional<usize> accessorIndex, const usize componentsCount)
+				-> std::expected<std::optional<GltfAccessor>, std::string> {
+				if (!accessorIndex)
+				{
+					return std::nullopt;
+				}
+
+				return GetGltfAccessor(document.value(), buffers, accessorIndex.value(), componentsCount);
+			};
+
+			const auto positions = readAccessor(positionsIndex, 3);
+			const auto normals = readAccessor(normalsIndex, 3);
+			const auto texCoords = readAccessor(attributes->FindIndex("TEXCOORD_0"), 2);
+			const auto tangents = readAccessor(attributes->FindIndex("TANGENT"), 4);
+			const auto indices = readAccessor(gltfPrimitive.FindIndex("indices"), 1);
+			for (const auto* accessor : { &positions, &normals, &texCoords, &tangents, &indices })
+			{
+				if (!accessor->has_value())
+				{
+					return std::unexpected(accessor->error());
+				}
+			}
+
+			const GltfPrimitive primitive{
+				positions->value(),
+				normals->value(),
+				texCoords.value(),
+				tangents.value(),
+				indices.value(),
+			};
+
+			// The texture coordinates can also be normalized bytes or shorts, the other attributes are floats
+			const usize verticesCount = primitive.positions.count;
+			const usize indicesCount = primitive.indices ? primitive.indices->count : verticesCount;
+			const auto isValidAttribute = [verticesCount](const GltfAccessor& accessor, const bool canBeNormalized) {
+				const bool isNormalized = accessor.normalized
+										  && (accessor.componentType == GltfComponentUnsignedByte
+											  || accessor.componentType == GltfComponentUnsignedShort);
+				return accessor.count == verticesCount
+					   && (accessor.componentType == GltfComponentFloat || (canBeNormalized && isNormalized));
+			};
+			const bool hasInvalidTexCoords =
+				primitive.texCoords && !isValidAttribute(primitive.texCoords.value(), true);
+			const bool hasInvalidTangents =
+				primitive.tangents && !isValidAttribute(primitive.tangents.value(), false);
+			const bool hasInvalidAttribute = !isValidAttribute(primitive.positions, false)
+											 || !isValidAttribute(primitive.normals, false) || hasInvalidTexCoords
+											 || hasInvalidTangents;
+			const bool hasInvalidIndices =
+				indicesCount % 3 != 0
+				|| (primitive.indices && primitive.indices->componentType != GltfComponentUnsignedByte
+					&& primitive.indices->componentType != GltfComponentUnsignedShort
+					&& primitive.indices->componentType != GltfComponentUnsignedInt);
+			if (hasInvalidAttribute || hasInvalidIndices)
+			{
+				return std::unexpected(std::format("The mesh {} has invalid accessors", meshIndex));
+			}
+
+			const std::span<Vertex> vertices = importedModel.vertexArrays.emplace_back(verticesCount);
+			const std::span<u32> meshIndices = importedModel.indexArrays.emplace_back(indicesCount);
+			importedModel.lodArrays.emplace_back();
+			primitiveTasks.push_back(threadPool.Submit([primitive, flipUVs, vertices, meshIndices] {
+				PROFILE_ZONE("ConvertGltfPrimitive");
+				return ConvertGltfPrimitive(primitive, flipUVs, vertices, meshIndices);
+			}));
+
+			primitiveMeshIndices[meshIndex].push_back(static_cast<u32>(model.meshes.size()));
+			model.meshes.push_back({ vertices, meshIndices, {}, {}, materialIndices[materialIndex.value()] });
+		}
+	}
+
+	// Add the node that holds the model
+	model.nodes.push_back({ ModelNodeLink::Root, InvalidModelIndex, InvalidModelIndex, glm::mat4(1.0f) });
+
+	// Each node is linked to its parent if it is the first child, or to the previous child otherwise
+	std::vector<u32> lastChildren{ InvalidModelIndex };
+	const auto addNode = [&model, &lastChildren](
+							 const u32 parentIndex, const u32 meshIndex, const glm::mat4& transform) {
+		const u32 lastChild = lastChildren[parentIndex];
+		if (lastChild == InvalidModelIndex)
+		{
+			model.nodes.push_back({ ModelNodeLink::Child, parentIndex, meshIndex, transform });
+		}
+		else
+		{
+			model.nodes.push_back({ ModelNodeLink::Sibling, lastChild, meshIndex, transform });
+		}
+
+		const auto nodeIndex = static_cast<u32>(model.nodes.size() - 1);
+		lastChildren[parentIndex] = nodeIndex;
+		lastChildren.push_back(InvalidModelIndex);
+		return nodeIndex;
+	};
+
+	const std::span<const JsonValue> gltfNodes = document->FindArray("nodes");
+	const std::span<const JsonValue> gltfScenes = document->FindArray("scenes");
+	const usize sceneIndex = document->FindIndex("scene").value_or(0);
+	if (sceneIndex >= gltfScenes.size())
+	{
+		return std::unexpected("The glTF has no scene");
+	}
+
+	// Each glTF node becomes an empty node with its transform, that holds one node per primitive of its mesh. The
+	// nodes are pushed in reverse so that they are added in the order of the file.
+	constexpr usize invalidNodeIndex = std::numeric_limits<usize>::max();
+	std::vector<std::pair<usize, u32>> nodesToVisit{};
+	for (const JsonValue& node : gltfScenes[sceneIndex].FindArray("nodes") | std::views::reverse)
+	{
+		nodesToVisit.emplace_back(node.GetIndex().value_or(invalidNodeIndex), 0);
+	}
+
+	std::vector<bool> visitedNodes(gltfNodes.size(), false);
+	while (!nodesToVisit.empty())
+	{
+		const auto [gltfNodeIndex, parentIndex] = nodesToVisit.back();
+		nodesToVisit.pop_back();
+
+		if (gltfNodeIndex >= gltfNodes.size() || visitedNodes[gltfNodeIndex])
+		{
+			return std::unexpected(std::format("The node {} is invalid or has several parents", gltfNodeIndex));
+		}
+
+		visitedNodes[gltfNodeIndex] = true;
+		const JsonValue& gltfNode = gltfNodes[gltfNodeIndex];
+		const u32 nodeIndex = addNode(parentIndex, InvalidModelIndex, ReadGltfNodeTransform(gltfNode));
+
+		const auto meshIndex = gltfNode.FindIndex("mesh");
+		if (meshIndex && meshIndex.value() < primitiveMeshIndices.size())
+		{
+			for (const u32 primitiveMeshIndex : primitiveMeshIndices[meshIndex.value()])
+			{
+				if (primitiveMeshIndex != InvalidModelIndex)
+				{
+					addNode(nodeIndex, primitiveMeshIndex, glm::mat4{ 1.0f });
+				}
+			}
+		}
+
+		for (const JsonValue& child : gltfNode.FindArray("children") | std::views::reverse)
+		{
+			nodesToVisit.emplace_back(child.GetIndex().value_or(invalidNodeIndex), nodeIndex);
+		}
+	}
+
+	bool hasConverted = true;
+	for (std::future<bool>& primitiveTask : primitiveTasks)
+	{
+		hasConverted = primitiveTask.get() && hasConverted;
+	}
+
+	if (!hasConverted)
+	{
+		return std::unexpected("A primitive has indices outside of its vertices");
+	}
+
+	spdlog::info("Read the glTF model {} and converted {} meshes on {} threads in {:0.0f} ms",
+		path.string(),
+		model.meshes.size(),
+		threadPool.GetThreadsCount(),
+		timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	return importedModel;
+}
+}// namespace stw
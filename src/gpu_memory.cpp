@@ -0,0 +1,376 @@
+/**
+ * @file gpu_memory.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the tracker of the video memory allocated by the renderer.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+export module gpu_memory;
+
+import number_types;
+import utils;
+
+export namespace stw
+{
+enum class GpuMemoryCategory : u8
+{
+	Texture,
+	Environment,
+	RenderTarget,
+	VertexBuffer,
+	IndexBuffer,
+	UniformBuffer,
+};
+
+constexpr usize GpuMemoryCategoriesCount = 6;
+
+[[nodiscard]] std::string_view GetGpuMemoryCategoryName(GpuMemoryCategory category);
+
+struct GpuMemorySettings
+{
+	/**
+	 * Video memory that the renderer should not use more than, in mebibytes. Zero means no budget.
+	 */
+	u32 budgetMb = 2048;
+
+	/**
+	 * Clamps every value in a range that makes sense.
+	 */
+	void Validate();
+};
+
+/**
+ * Loads the GPU memory settings from a config file made of "key = value" lines.
+ * @param path Path of the config file.
+ * @return The loaded settings or an error message.
+ */
+std::expected<GpuMemorySettings, std::string> LoadGpuMemorySettings(const std::filesystem::path& path);
+
+struct GpuMemoryReport
+{
+	std::array<usize, GpuMemoryCategoriesCount> categoriesBytes{};
+	std::array<usize, GpuMemoryCategoriesCount> allocationsCounts{};
+	usize totalBytes = 0;
+	usize peakBytes = 0;
+	usize budgetBytes = 0;
+};
+
+/**
+ * Counts the bytes of video memory allocated by the OpenGL wrappers, by category.
+ * The sizes are computed from the formats and dimensions of the allocations, the driver may use a bit more for
+ * alignment and metadata.
+ */
+class GpuMemoryTracker
+{
+public:
+	/**
+	 * Called on every budget check with the tracked memory and the budget, in bytes. The budget is zero when there is
+	 * none.
+	 */
+	using BudgetCallback = std::function<void(usize usedBytes, usize budgetBytes)>;
+
+	void TrackAllocation(GpuMemoryCategory category, usize bytes);
+	void TrackDeallocation(GpuMemoryCategory category, usize bytes);
+
+	/**
+	 * Changes the size of an allocation, like a buffer whose data is specified again. The number of allocations does
+	 * not change.
+	 */
+	void TrackReallocation(GpuMemoryCategory category, usize oldBytes, usize newBytes);
+
+	void SetSettings(const GpuMemorySettings& settings);
+	[[nodiscard]] const GpuMemorySettings& GetSettings() const;
+	void SetBudgetCallback(BudgetCallback callback);
+
+	/**
+	 * Calls the budget callback, so that the memory that can shrink adapts to the memory that is left. Must be called
+	 * once per frame.
+	 */
+	void CheckBudget() const;
+
+	[[nodiscard]] GpuMemoryReport GetReport() const;
+	void LogReport() const;
+
+private:
+	GpuMemorySettings m_Settings{};
+	std::array<usize, GpuMemoryCategoriesCount> m_CategoriesBytes{};
+	std::array<usize, GpuMemoryCategoriesCount> m_AllocationsCounts{};
+	usize m_TotalBytes = 0;
+	usize m_PeakBytes = 0;
+	BudgetCallback m_BudgetCallback{};
+};
+
+/**
+ * Gets the tracker shared by every OpenGL wrapper. Like OpenGL, it must only be used from the thread of the context.
+ */
+GpuMemoryTracker& GetGpuMemoryTracker();
+
+/**
+ * Computes the size of every level of a texture from the formats reported by OpenGL.
+ * @param texture ID of the texture.
+ * @return The size in bytes, every face and layer included.
+ */
+[[nodiscard]] usize QueryTextureGpuSize(GLuint texture);
+
+/**
+ * Computes the size of a renderbuffer from the format reported by OpenGL.
+ * @param renderbuffer ID of the renderbuffer.
+ * @return The size in bytes, every sample included.
+ */
+[[nodiscard]] usize QueryRenderbufferGpuSize(GLuint renderbuffer);
+
+std::string_view GetGpuMemoryCategoryName(const GpuMemoryCategory category)
+{
+	switch (category)
+	{
+	case GpuMemoryCategory::Texture:
+		return "Textures";
+	case GpuMemoryCategory::Environment:
+		return "Environment";
+	case GpuMemoryCategory::RenderTarget:
+		return "Render targets";
+	case GpuMemoryCategory::VertexBuffer:
+		return "Vertex buffers";
+	case GpuMemoryCategory::IndexBuffer:
+		return "Index buffers";
+	case GpuMemoryCategory::UniformBuffer:
+		return "Uniform buffers";
+	}
+
+	return "Unknown";
+}
+
+void GpuMemorySettings::Validate() { budgetMb = std::min(budgetMb, 1024u * 1024u); }
+
+std::expected<GpuMemorySettings, std::string> LoadGpuMemorySettings(const std::filesystem::path& path)
+{
+	const auto entries = ReadConfigFile(path);
+	if (!entries)
+	{
+		return std::unexpected(entries.error());
+	}
+
+	GpuMemorySettings settings{};
+	for (const ConfigEntry& entry : entries.value())
+	{
+		const auto value = ParseNumber<u32>(entry.value);
+		if (!value)
+		{
+			return std::unexpected(std::format("{}:{} : {}", path.string(), entry.lineNumber, value.error()));
+		}
+
+		if (entry.key == "budget_mb")
+		{
+			settings.budgetMb = value.value();
+		}
+		else
+		{
+			spdlog::warn("Unknown GPU memory key \"{}\" in {}", entry.key, path.string());
+		}
+	}
+
+	settings.Validate();
+	return settings;
+}
+
+void GpuMemoryTracker::TrackAllocation(const GpuMemoryCategory category, const usize bytes)
+{
+	const auto index = static_cast<usize>(category);
+	m_CategoriesBytes[index] += bytes;
+	m_AllocationsCounts[index]++;
+	m_TotalBytes += bytes;
+	m_PeakBytes = std::max(m_PeakBytes, m_TotalBytes);
+}
+
+void GpuMemoryTracker::TrackDeallocation(const GpuMemoryCategory category, const usize bytes)
+{
+	const auto index = static_cast<usize>(category);
+	if (m_CategoriesBytes[index] < bytes || m_AllocationsCounts[index] == 0)
+	{
+		spdlog::error(
+			"Deallocation of {} bytes of {} that were never allocated", bytes, GetGpuMemoryCategoryName(category));
+		return;
+	}
+
+	m_CategoriesBytes[index] -= bytes;
+	m_AllocationsCounts[index]--;
+	m_TotalBytes -= bytes;
+}
+
+void GpuMemoryTracker::TrackReallocation(const GpuMemoryCategory category, const usize oldBytes, const usize newBytes)
+{
+	const auto index = static_cast<usize>(category);
+	const usize removedBytes = std::min({ oldBytes, m_CategoriesBytes[index], m_TotalBytes });
+	m_CategoriesBytes[index] = m_CategoriesBytes[index] - removedBytes + newBytes;
+	m_TotalBytes = m_TotalBytes - removedBytes + newBytes;
+	m_PeakBytes = std::max(m_PeakBytes, m_TotalBytes);
+}
+
+void GpuMemoryTracker::SetSettings(const GpuMemorySettings& settings)
+{
+	m_Settings = settings;
+	m_Settings.Validate();
+}
+
+const GpuMemorySettings& GpuMemoryTracker::GetSettings() const { return m_Settings; }
+
+void GpuMemoryTracker::SetBudgetCallback(BudgetCallback callback) { m_BudgetCallback = std::move(callback); }
+
+void GpuMemoryTracker::CheckBudget() const
+{
+	if (!m_BudgetCallback)
+	{
+		return;
+	}
+
+	m_BudgetCallback(m_TotalBytes, static_cast<usize>(m_Settings.budgetMb) * 1024 * 1024);
+}
+
+GpuMemoryReport GpuMemoryTracker::GetReport() const
+{
+	return { m_CategoriesBytes,
+		m_AllocationsCounts,
+		m_TotalBytes,
+		m_PeakBytes,
+		static_cast<usize>(m_Settings.budgetMb) * 1024 * 1024 };
+}
+
+void GpuMemoryTracker::LogReport() const
+{
+	constexpr f64 bytesPerMebibyte = 1024.0 * 1024.0;
+
+	spdlog::info("GPU memory : {:0.1f} MiB used, {:0.1f} MiB peak, {} MiB budget",
+		static_cast<f64>(m_TotalBytes) / bytesPerMebibyte,
+		static_cast<f64>(m_PeakBytes) / bytesPerMebibyte,
+		m_Settings.budgetMb);
+
+	for (usize i = 0; i < GpuMemoryCategoriesCount; i++)
+	{
+		spdlog::info("  {:<16} {:>8.1f} MiB in {} allocations",
+			GetGpuMemoryCategoryName(static_cast<GpuMemoryCategory>(i)),
+			static_cast<f64>(m_CategoriesBytes[i]) / bytesPerMebibyte,
+			m_AllocationsCounts[i]);
+	}
+}
+
+GpuMemoryTracker& GetGpuMemoryTracker()
+{
+	static GpuMemoryTracker tracker{};
+	return tracker;
+}
+
+usize QueryTextureGpuSize(const GLuint texture)
+{
+	if (texture == 0)
+	{
+		return 0;
+	}
+
+	GLint target = 0;
+	glGetTextureParameteriv(texture, GL_TEXTURE_TARGET, &target);
+
+	GLint levelsCount = 0;
+	glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levelsCount);
+	if (levelsCount == 0)
+	{
+		// Mutable textures do not know their number of levels, so the query goes on until a level is empty
+		levelsCount = std::numeric_limits<GLint>::max();
+	}
+
+	usize size = 0;
+	for (GLint level = 0; level < levelsCount; level++)
+	{
+		GLint width = 0;
+		GLint height = 0;
+		GLint depth = 0;
+		glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_WIDTH, &width);
+		glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_HEIGHT, &height);
+		glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_DEPTH, &depth);
+		if (width == 0 || height == 0)
+		{
+			break;
+		}
+
+		GLint isCompressed = GL_FALSE;
+		glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_COMPRESSED, &isCompressed);
+		if (isCompressed == GL_TRUE)
+		{
+			GLint compressedSize = 0;
+			glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressedSize);
+			size += static_cast<usize>(compressedSize);
+			continue;
+		}
+
+		GLint bitsPerTexel = 0;
+		for (const GLenum sizeQuery : { GL_TEXTURE_RED_SIZE,
+				 GL_TEXTURE_GREEN_SIZE,
+				 GL_TEXTURE_BLUE_SIZE,
+				 GL_TEXTURE_ALPHA_SIZE,
+				 GL_TEXTURE_DEPTH_SIZE,
+				 GL_TEXTURE_STENCIL_SIZE })
+		{
+			GLint componentSize = 0;
+			glGetTextureLevelParameteriv(texture, level, sizeQuery, &componentSize);
+			bitsPerTexel += componentSize;
+		}
+
+		size += static_cast<usize>(width) * static_cast<usize>(height) * static_cast<usize>(std::max(depth, 1))
+				* static_cast<usize>(bitsPerTexel) / 8;
+	}
+
+	// The level queries of a cube map only describe one face
+	const usize facesCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	return size * facesCount;
+}
+
+usize QueryRenderbufferGpuSize(const GLuint renderbuffer)
+{
+	if (renderbuffer == 0)
+	{
+		return 0;
+	}
+
+	GLint width = 0;
+	GLint height = 0;
+	GLint samplesCount = 0;
+	glGetNamedRenderbufferParameteriv(renderbuffer, GL_RENDERBUFFER_WIDTH, &width);
+	glGetNamedRenderbufferParameteriv(renderbuffer, GL_RENDERBUFFER_HEIGHT, &height);
+	glGetNamedRenderbufferParameteriv(renderbuffer, GL_RENDERBUFFER_SAMPLES, &samplesCount);
+
+	GLint bitsPerTexel = 0;
+	for (const GLenum sizeQuery : { GL_RENDERBUFFER_RED_SIZE,
+			 GL_RENDERBUFFER_GREEN_SIZE,
+			 GL_RENDERBUFFER_BLUE_SIZE,
+			 GL_RENDERBUFFER_ALPHA_SIZE,
+			 GL_RENDERBUFFER_DEPTH_SIZE,
+			 GL_RENDERBUFFER_STENCIL_SIZE })
+	{
+		GLint componentSize = 0;
+		glGetNamedRenderbufferParameteriv(renderbuffer, sizeQuery, &componentSize);
+		bitsPerTexel += componentSize;
+	}
+
+	return static_cast<usize>(width) * static_cast<usize>(height) * static_cast<usize>(std::max(samplesCount, 1))
+		   * static_cast<usize>(bitsPerTexel) / 8;
+}
+}// namespace stw
@@ -0,0 +1,355 @@
+/**
+ * @file gpu_profiler.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the GPU profiler that times the render passes with timestamp queries.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+export module gpu_profiler;
+
+import number_types;
+
+export namespace stw
+{
+/**
+ * Rolling GPU time of a render pass.
+ */
+struct GpuPassTiming
+{
+	std::string name;
+	f64 averageMs = 0.0;
+	f64 maxMs = 0.0;
+	usize samplesCount = 0;
+};
+
+/**
+ * Times the render passes on the GPU with GL_TIMESTAMP queries, and surrounds them with debug groups so that the
+ * external GPU tools show the same names.
+ * The queries of each frame are kept in a ring so that reading a result never stalls the pipeline, which means the
+ * timings are a few frames late. The passes can be nested, each one is timed on its own.
+ */
+class GpuProfiler
+{
+public:
+	static constexpr usize FramesCount = 4;
+	static constexpr usize MaxZonesPerFrame = 32;
+
+	/**
+	 * Number of frames that the averages and maxima are computed on.
+	 */
+	static constexpr usize SamplesCount = 120;
+
+	GpuProfiler() = default;
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler(GpuProfiler&&) = delete;
+	~GpuProfiler();
+
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+	void Init();
+	void Delete();
+
+	/**
+	 * Reads the results of the previous frames that are available, then starts timing a new frame. The frame is not
+	 * timed if every frame of the ring is still waiting for its results.
+	 */
+	void BeginFrame();
+	void EndFrame();
+
+	/**
+	 * Starts a pass, which must be ended in the same frame. Prefer GpuProfilerScope.
+	 * @param name Name of the pass.
+	 */
+	void BeginZone(std::string_view name);
+	void EndZone();
+
+	/**
+	 * Sets how often the timings are logged.
+	 * @param logIntervalFrames Number of frames between two logs, zero never logs.
+	 */
+	void SetLogInterval(u32 logIntervalFrames);
+
+	/**
+	 * @return The rolling average and maximum GPU time of every pass measured so far.
+	 */
+	[[nodiscard]] std::vector<GpuPassTiming> GetPassTimings() const;
+	void LogPassTimings() const;
+
+private:
+	struct Frame
+	{
+		// Start and end timestamps of each zone
+		std::array<GLuint, MaxZonesPerFrame * 2> queries{};
+		// Pass measured by each zone
+		std::vector<usize> zones;
+		bool isPending = false;
+	};
+
+	struct PassSamples
+	{
+		std::string name;
+		std::array<f64, SamplesCount> samplesMs{};
+		usize count = 0;
+		usize nextIndex = 0;
+	};
+
+	bool m_IsInitialized = false;
+	bool m_IsTimingFrame = false;
+	usize m_WriteIndex = 0;
+	usize m_ReadIndex = 0;
+	std::array<Frame, FramesCount> m_Frames{};
+
+	// Zones that are begun but not ended, with their index in the current frame or none if they are not timed
+	std::vector<std::optional<usize>> m_OpenZones;
+
+	std::vector<PassSamples> m_Passes;
+	u32 m_LogIntervalFrames = 600;
+	u32 m_FramesSinceLog = 0;
+
+	void ReadAvailableFrames();
+	[[nodiscard]] usize FindOrAddPass(std::string_view name);
+};
+
+/**
+ * Times a render pass on the GPU until the end of the scope.
+ */
+class GpuProfilerScope
+{
+public:
+	GpuProfilerScope(GpuProfiler& profiler, std::string_view name);
+	GpuProfilerScope(const GpuProfilerScope&) = delete;
+	GpuProfilerScope(GpuProfilerScope&&) = delete;
+	~GpuProfilerScope();
+
+	GpuProfilerScope& operator=(const GpuProfilerScope&) = delete;
+	GpuProfilerScope& operator=(GpuProfilerScope&&) = delete;
+
+private:
+	GpuProfiler& m_Profiler;
+};
+
+GpuProfiler::~GpuProfiler()
+{
+	if (m_IsInitialized)
+	{
+		spdlog::error("Destructor called on GPU profiler that is still initialized");
+	}
+}
+
+void GpuProfiler::Init()
+{
+	assert(!m_IsInitialized);
+
+	for (Frame& frame : m_Frames)
+	{
+		glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame.zones.reserve(MaxZonesPerFrame);
+		frame.isPending = false;
+	}
+
+	m_WriteIndex = 0;
+	m_ReadIndex = 0;
+	m_IsInitialized = true;
+}
+
+void GpuProfiler::Delete()
+{
+	assert(m_IsInitialized);
+
+	for (Frame& frame : m_Frames)
+	{
+		glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame.queries.fill(0);
+		frame.zones.clear();
+	}
+
+	m_IsInitialized = false;
+}
+
+void GpuProfiler::BeginFrame()
+{
+	assert(m_IsInitialized);
+
+	ReadAvailableFrames();
+
+	Frame& frame = m_Frames[m_WriteIndex];
+	m_IsTimingFrame = !frame.isPending;
+	if (m_IsTimingFrame)
+	{
+		frame.zones.clear();
+	}
+}
+
+void GpuProfiler::EndFrame()
+{
+	assert(m_OpenZones.empty());
+
+	if (m_IsTimingFrame)
+	{
+		m_Frames[m_WriteIndex].isPending = true;
+		m_WriteIndex = (m_WriteIndex + 1) % FramesCount;
+		m_IsTimingFrame = false;
+	}
+
+	m_FramesSinceLog++;
+	if (m_LogIntervalFrames > 0 && m_FramesSinceLog >= m_LogIntervalFrames)
+	{
+		LogPassTimings();
+		m_FramesSinceLog = 0;
+	}
+}
+
+void GpuProfiler::BeginZone(const std::string_view name)
+{
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, static_cast<GLsizei>(name.size()), name.data());
+
+	Frame& frame = m_Frames[m_WriteIndex];
+	if (!m_IsTimingFrame || frame.zones.size() >= MaxZonesPerFrame)
+	{
+		m_OpenZones.emplace_back(std::nullopt);
+		return;
+	}
+
+	const usize zoneIndex = frame.zones.size();
+	frame.zones.push_back(FindOrAddPass(name));
+	glQueryCounter(frame.queries[zoneIndex * 2], GL_TIMESTAMP);
+	m_OpenZones.emplace_back(zoneIndex);
+}
+
+void GpuProfiler::EndZone()
+{
+	assert(!m_OpenZones.empty());
+
+	const std::optional<usize> zoneIndex = m_OpenZones.back();
+	m_OpenZones.pop_back();
+	if (zoneIndex.has_value())
+	{
+		glQueryCounter(m_Frames[m_WriteIndex].queries[zoneIndex.value() * 2 + 1], GL_TIMESTAMP);
+	}
+
+	glPopDebugGroup();
+}
+
+void GpuProfiler::SetLogInterval(const u32 logIntervalFrames)
+{
+	m_LogIntervalFrames = logIntervalFrames;
+	m_FramesSinceLog = 0;
+}
+
+std::vector<GpuPassTiming> GpuProfiler::GetPassTimings() const
+{
+	std::vector<GpuPassTiming> timings{};
+	timings.reserve(m_Passes.size());
+	for (const PassSamples& pass : m_Passes)
+	{
+		GpuPassTiming timing{ pass.name, 0.0, 0.0, pass.count };
+		for (usize i = 0; i < pass.count; i++)
+		{
+			timing.averageMs += pass.samplesMs[i];
+			timing.maxMs = std::max(timing.maxMs, pass.samplesMs[i]);
+		}
+
+		if (pass.count > 0)
+		{
+			timing.averageMs /= static_cast<f64>(pass.count);
+		}
+
+		timings.push_back(std::move(timing));
+	}
+
+	return timings;
+}
+
+void GpuProfiler::LogPassTimings() const
+{
+	const std::vector<GpuPassTiming> timings = GetPassTimings();
+	if (timings.empty())
+	{
+		return;
+	}
+
+	spdlog::info("GPU passes over the last {} frames :", SamplesCount);
+	for (const GpuPassTiming& timing : timings)
+	{
+		spdlog::info("  {:<24} {:>7.3f} ms average {:>7.3f} ms max", timing.name, timing.averageMs, timing.maxMs);
+	}
+}
+
+void GpuProfiler::ReadAvailableFrames()
+{
+	while (m_Frames[m_ReadIndex].isPending)
+	{
+		Frame& frame = m_Frames[m_ReadIndex];
+
+		// The results of a frame are only read once all of them are available, so that reading never waits
+		for (usize i = 0; i < frame.zones.size() * 2; i++)
+		{
+			GLint isAvailable = GL_FALSE;
+			glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+			if (isAvailable == GL_FALSE)
+			{
+				return;
+			}
+		}
+
+		for (usize i = 0; i < frame.zones.size(); i++)
+		{
+			GLuint64 startNanoseconds = 0;
+			GLuint64 endNanoseconds = 0;
+			glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &startNanoseconds);
+			glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &endNanoseconds);
+
+			PassSamples& pass = m_Passes[frame.zones[i]];
+			const GLuint64 elapsedNanoseconds =
+				endNanoseconds > startNanoseconds ? endNanoseconds - startNanoseconds : 0;
+			pass.samplesMs[pass.nextIndex] = static_cast<f64>(elapsedNanoseconds) / 1'000'000.0;
+			pass.nextIndex = (pass.nextIndex + 1) % SamplesCount;
+			pass.count = std::min(pass.count + 1, SamplesCount);
+		}
+
+		frame.isPending = false;
+		m_ReadIndex = (m_ReadIndex + 1) % FramesCount;
+	}
+}
+
+usize GpuProfiler::FindOrAddPass(const std::string_view name)
+{
+	// There are only a few passes, a linear search is faster than hashing the name
+	const auto pass =
+		std::ranges::find_if(m_Passes, [name](const PassSamples& samples) { return samples.name == name; });
+	if (pass != m_Passes.end())
+	{
+		return static_cast<usize>(std::distance(m_Passes.begin(), pass));
+	}
+
+	m_Passes.push_back({ std::string{ name }, {}, 0, 0 });
+	return m_Passes.size() - 1;
+}
+
+GpuProfilerScope::GpuProfilerScope(GpuProfiler& profiler, const std::string_view name) : m_Profiler(profiler)
+{
+	m_Profiler.BeginZone(name);
+}
+
+GpuProfilerScope::~GpuProfilerScope() { m_Profiler.EndZone(); }
+}// namespace stw
@@ -0,0 +1,343 @@
+/**
+ * @file headless_window.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the HeadlessWindow class, which renders a scene offscreen without a display.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <expected>
+#include <format>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <glad/glad.h>
+#include <glm/common.hpp>
+#include <glm/vec2.hpp>
+#include <spdlog/spdlog.h>
+
+#ifdef OGL_SCENE_HAS_EGL
+// The X11 headers define macros like None and Bool that collide with the rest of the code
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+#include "profiler.hpp"
+
+export module headless_window;
+
+import number_types;
+import utils;
+import timer;
+import cpu_profiler;
+import gpu_memory;
+import scene;
+import window;
+
+export namespace stw
+{
+/**
+ * Runs a scene without a window, for benchmarks and machines without a display. The OpenGL context is created with
+ * EGL on the surfaceless platform, which works on render nodes and with Mesa llvmpipe on machines without a GPU.
+ * The scene renders to an offscreen framebuffer instead of the default one.
+ * @tparam T Scene to render.
+ */
+template<Derived<Scene> T>
+class HeadlessWindow
+{
+public:
+	/**
+	 * Creates the OpenGL context and the offscreen framebuffer, then initializes the scene.
+	 * @param size Size of the offscreen framebuffer.
+	 * @return The headless window or an error message if no context could be created.
+	 */
+	static std::expected<std::unique_ptr<HeadlessWindow>, std::string> Create(glm::uvec2 size);
+
+	HeadlessWindow(const HeadlessWindow&) = delete;
+	HeadlessWindow(HeadlessWindow&&) = delete;
+	~HeadlessWindow();
+
+	HeadlessWindow& operator=(const HeadlessWindow&) = delete;
+	HeadlessWindow& operator=(HeadlessWindow&&) = delete;
+
+	/**
+	 * Updates and renders the scene for a fixed number of frames, with a fixed time step so that the runs can be
+	 * compared, then logs the frame times.
+	 * @param framesCount Number of frames to render.
+	 */
+	void Loop(u32 framesCount);
+
+private:
+	/**
+	 * Time step given to the scene, as if it ran at 60 frames per second.
+	 */
+	static constexpr f32 FixedDeltaTime = 1.0f / 60.0f;
+
+	std::unique_ptr<T> m_Scene;
+	glm::uvec2 m_Size{};
+	GLuint m_Framebuffer = 0;
+	GLuint m_ColorRenderbuffer = 0;
+	GLuint m_DepthStencilRenderbuffer = 0;
+	bool m_IsSceneInitialized = false;
+
+#ifdef OGL_SCENE_HAS_EGL
+	EGLDisplay m_Display = EGL_NO_DISPLAY;
+	EGLContext m_Context = EGL_NO_CONTEXT;
+
+	std::expected<void, std::string> CreateContext();
+#endif
+
+	explicit HeadlessWindow(glm::uvec2 size);
+
+	void CreateFramebuffer();
+	void DeleteFramebuffer();
+	[[nodiscard]] usize GetFramebufferGpuSize() const;
+};
+
+template<Derived<Scene> T>
+HeadlessWindow<T>::HeadlessWindow(const glm::uvec2 size) : m_Scene(std::make_unique<T>()), m_Size(size)
+{
+}
+
+template<Derived<Scene> T>
+std::expected<std::unique_ptr<HeadlessWindow<T>>, std::string> HeadlessWindow<T>::Create(const glm::uvec2 size)
+{
+#ifdef OGL_SCENE_HAS_EGL
+	spdlog::info("Creating headless context...");
+	SetCpuProfilerThreadName("Main");
+
+	std::unique_ptr<HeadlessWindow> window{ new HeadlessWindow{ glm::max(size, glm::uvec2{ 1 }) } };
+	const auto contextResult = window->CreateContext();
+	if (!contextResult)
+	{
+		return std::unexpected(contextResult.error());
+	}
+
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(GLDebugMessageCallback, nullptr);
+
+	spdlog::info("Rendering headless on {} at {}x{}",
+		reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+		window->m_Size.x,
+		window->m_Size.y);
+
+	window->CreateFramebuffer();
+	window->m_Scene->Init(window->m_Size);
+	window->m_Scene->SetOutputFramebuffer(window->m_Framebuffer);
+	window->m_IsSceneInitialized = true;
+
+	return window;
+#else
+	static_cast<void>(size);
+	return std::unexpected(std::string{ "The headless mode needs EGL, which was not found when building" });
+#endif
+}
+
+template<Derived<Scene> T>
+HeadlessWindow<T>::~HeadlessWindow()
+{
+	spdlog::info("Closing headless context");
+
+	if (m_IsSceneInitialized)
+	{
+		m_Scene->Delete();
+	}
+
+	if (m_Framebuffer != 0)
+	{
+		DeleteFramebuffer();
+	}
+
+#ifdef OGL_SCENE_HAS_EGL
+	if (m_Display != EGL_NO_DISPLAY)
+	{
+		eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (m_Context != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(m_Display, m_Context);
+		}
+		eglTerminate(m_Display);
+	}
+#endif
+}
+
+template<Derived<Scene> T>
+void HeadlessWindow<T>::Loop(const u32 framesCount)
+{
+	Timer timer;
+	f64 totalTimeMs = 0.0;
+	f64 minTimeMs = std::numeric_limits<f64>::max();
+	f64 maxTimeMs = 0.0;
+
+	for (u32 frame = 0; frame < framesCount; frame++)
+	{
+		PROFILE_ZONE("Frame");
+		timer.Start();
+
+		// The scene clears the bound framebuffer before drawing
+		glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+		{
+			PROFILE_ZONE("SceneUpdate");
+			m_Scene->Update(FixedDeltaTime);
+		}
+
+		// Without a swap nothing limits how far the CPU runs ahead, so each frame waits for the GPU to be measured
+		{
+			PROFILE_ZONE("Finish");
+			glFinish();
+		}
+
+		const f64 frameTimeMs = timer.RestartAndGetElapsedTime().GetInMilliseconds();
+		totalTimeMs += frameTimeMs;
+		minTimeMs = std::min(minTimeMs, frameTimeMs);
+		maxTimeMs = std::max(maxTimeMs, frameTimeMs);
+	}
+
+	if (framesCount > 0)
+	{
+		spdlog::info("Rendered {} headless frames in {:0.0f} ms : {:0.2f} ms average, {:0.2f} ms min, {:0.2f} ms max",
+			framesCount,
+			totalTimeMs,
+			totalTimeMs / static_cast<f64>(framesCount),
+			minTimeMs,
+			maxTimeMs);
+	}
+}
+
+#ifdef OGL_SCENE_HAS_EGL
+template<Derived<Scene> T>
+std::expected<void, std::string> HeadlessWindow<T>::CreateContext()
+{
+	// The surfaceless platform does not need a display server, the default display is the fallback for the drivers
+	// that do not have it
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	const std::string_view clientExtensionsView = clientExtensions != nullptr ? clientExtensions : "";
+	const auto getPlatformDisplay =
+		reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay != nullptr && clientExtensionsView.contains("EGL_MESA_platform_surfaceless"))
+	{
+		m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+
+	if (m_Display == EGL_NO_DISPLAY)
+	{
+		m_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint majorVersion = 0;
+	EGLint minorVersion = 0;
+	if (m_Display == EGL_NO_DISPLAY || eglInitialize(m_Display, &majorVersion, &minorVersion) == EGL_FALSE)
+	{
+		m_Display = EGL_NO_DISPLAY;
+		return std::unexpected(std::format("Could not initialize an EGL display, error 0x{:x}", eglGetError()));
+	}
+
+	spdlog::info("Initialized EGL {}.{} from {}", majorVersion, minorVersion, eglQueryString(m_Display, EGL_VENDOR));
+
+	const std::string_view displayExtensions = eglQueryString(m_Display, EGL_EXTENSIONS);
+	if (!displayExtensions.contains("EGL_KHR_surfaceless_context"))
+	{
+		return std::unexpected(std::string{ "The EGL display does not support surfaceless contexts" });
+	}
+
+	if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+	{
+		return std::unexpected(std::format("Could not bind the OpenGL API, error 0x{:x}", eglGetError()));
+	}
+
+	// The context never draws to a surface, so any config that renders with desktop OpenGL works
+	constexpr std::array<EGLint, 3> configAttributes{ EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = nullptr;
+	EGLint configsCount = 0;
+	if (eglChooseConfig(m_Display, configAttributes.data(), &config, 1, &configsCount) == EGL_FALSE
+		|| configsCount == 0)
+	{
+		return std::unexpected(std::format("No EGL config renders with OpenGL, error 0x{:x}", eglGetError()));
+	}
+
+	constexpr std::array<EGLint, 7> contextAttributes{ EGL_CONTEXT_MAJOR_VERSION,
+		4,
+		EGL_CONTEXT_MINOR_VERSION,
+		5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK,
+		EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE };
+	m_Context = eglCreateContext(m_Display, config, EGL_NO_CONTEXT, contextAttributes.data());
+	if (m_Context == EGL_NO_CONTEXT)
+	{
+		return std::unexpected(std::format("Could not create an OpenGL 4.5 core context, error 0x{:x}", eglGetError()));
+	}
+
+	if (eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_Context) == EGL_FALSE)
+	{
+		return std::unexpected(std::format("Could not make the context current, error 0x{:x}", eglGetError()));
+	}
+
+	if (!gladLoadGLLoader([](const char* name) { return reinterpret_cast<void*>(eglGetProcAddress(name)); }))
+	{
+		return std::unexpected(std::string{ "Failed to initialize OpenGL context" });
+	}
+
+	return {};
+}
+#endif
+
+template<Derived<Scene> T>
+void HeadlessWindow<T>::CreateFramebuffer()
+{
+	const auto width = static_cast<GLsizei>(m_Size.x);
+	const auto height = static_cast<GLsizei>(m_Size.y);
+
+	glCreateRenderbuffers(1, &m_ColorRenderbuffer);
+	glNamedRenderbufferStorage(m_ColorRenderbuffer, GL_RGBA8, width, height);
+	glCreateRenderbuffers(1, &m_DepthStencilRenderbuffer);
+	glNamedRenderbufferStorage(m_DepthStencilRenderbuffer, GL_DEPTH24_STENCIL8, width, height);
+
+	glCreateFramebuffers(1, &m_Framebuffer);
+	glNamedFramebufferRenderbuffer(m_Framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorRenderbuffer);
+	glNamedFramebufferRenderbuffer(
+		m_Framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthStencilRenderbuffer);
+
+	if (glCheckNamedFramebufferStatus(m_Framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::error("The offscreen framebuffer is not complete");
+	}
+
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::RenderTarget, GetFramebufferGpuSize());
+}
+
+template<Derived<Scene> T>
+void HeadlessWindow<T>::DeleteFramebuffer()
+{
+	GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::RenderTarget, GetFramebufferGpuSize());
+
+	glDeleteFramebuffers(1, &m_Framebuffer);
+	glDeleteRenderbuffers(1, &m_ColorRenderbuffer);
+	glDeleteRenderbuffers(1, &m_DepthStencilRenderbuffer);
+	m_Framebuffer = 0;
+	m_ColorRenderbuffer = 0;
+	m_DepthStencilRenderbuffer = 0;
+}
+
+template<Derived<Scene> T>
+usize HeadlessWindow<T>::GetFramebufferGpuSize() const
+{
+	// Both attachments use 4 bytes per pixel
+	return static_cast<usize>(m_Size.x) * m_Size.y * 4 * 2;
+}
+}// namespace stw
@@ -0,0 +1,292 @@
+/**
+ * @file ibl_cache.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions to save and load the baked image based lighting textures as KTX2 files.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <ktx.h>
+#include <spdlog/spdlog.h>
+
+export module ibl_cache;
+
+import number_types;
+import utils;
+
+export namespace stw
+{
+/**
+ * Increase this when the layout of the cached files changes, to invalidate the existing caches.
+ */
+constexpr u32 IblCacheVersion = 1;
+
+/**
+ * Pixel format of a cached texture, as seen by Vulkan (for KTX2) and by OpenGL.
+ */
+struct CachedTextureFormat
+{
+	u32 vkFormat;
+	GLenum glInternalFormat;
+	GLenum glFormat;
+	GLenum glType;
+	u32 bytesPerPixel;
+};
+
+// Values of VK_FORMAT_R16G16_SFLOAT and VK_FORMAT_R16G16B16_SFLOAT
+constexpr CachedTextureFormat CachedRg16F{ 83, GL_RG16F, GL_RG, GL_HALF_FLOAT, 4 };
+constexpr CachedTextureFormat CachedRgb16F{ 90, GL_RGB16F, GL_RGB, GL_HALF_FLOAT, 6 };
+
+/**
+ * Computes the key of the IBL cache from everything the bake depends on.
+ * @param hdrPath Path of the equirectangular HDR map.
+ * @param shaderPaths Path of every shader used by the bake.
+ * @param parameters Resolutions and any other constant that changes the result of the bake.
+ * @return The key or an error message if an input could not be read.
+ */
+std::expected<u64, std::string> ComputeIblCacheKey(const std::filesystem::path& hdrPath,
+	std::span<const std::filesystem::path> shaderPaths,
+	std::span<const u32> parameters);
+
+/**
+ * Gets the directory that contains the cached textures of a key.
+ */
+std::filesystem::path GetIblCacheDirectory(u64 key);
+
+/**
+ * Reads back a 2D or cube map texture from the GPU and writes it to a KTX2 file.
+ * @param texture Texture to save.
+ * @param target GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.
+ * @param levelsCount Number of mip levels to save, starting from the base level.
+ * @param format Format of the texture.
+ * @param generateMipmaps Set this to true to let the loader generate the missing mip levels.
+ * @param path Path of the KTX2 file.
+ */
+std::expected<void, std::string> SaveTextureToKtx2(GLuint texture,
+	GLenum target,
+	u32 levelsCount,
+	const CachedTextureFormat& format,
+	bool generateMipmaps,
+	const std::filesystem::path& path);
+
+/**
+ * Loads a KTX2 file into a new OpenGL texture.
+ * @param path Path of the KTX2 file.
+ * @return The ID of the new texture or an error message.
+ */
+std::expected<GLuint, std::string> LoadTextureFromKtx2(const std::filesystem::path& path);
+
+/**
+ * Copies the base level of a 2D KTX2 file into an existing texture of the same size.
+ * @param path Path of the KTX2 file.
+ * @param texture Texture that receives the pixels.
+ * @param format Format of the pixels in the file.
+ */
+std::expected<void, std::string> CopyKtx2ToTexture(
+	const std::filesystem::path& path, GLuint texture, const CachedTextureFormat& format);
+
+std::expected<u64, std::string> ComputeIblCacheKey(const std::filesystem::path& hdrPath,
+	const std::span<const std::filesystem::path> shaderPaths,
+	const std::span<const u32> parameters)
+{
+	u64 hash = HashFnv1a(std::as_bytes(std::span{ &IblCacheVersion, 1 }));
+
+	const auto hdrHash = HashFileFnv1a(hdrPath, hash);
+	if (!hdrHash)
+	{
+		return std::unexpected(std::format("Could not read {}", hdrPath.string()));
+	}
+	hash = hdrHash.value();
+
+	for (const auto& shaderPath : shaderPaths)
+	{
+		const auto shaderHash = HashFileFnv1a(shaderPath, hash);
+		if (!shaderHash)
+		{
+			return std::unexpected(std::format("Could not read {}", shaderPath.string()));
+		}
+		hash = shaderHash.value();
+	}
+
+	return HashFnv1a(std::as_bytes(parameters), hash);
+}
+
+std::filesystem::path GetIblCacheDirectory(const u64 key)
+{
+	return std::filesystem::path{ "cache" } / "ibl" / std::format("{:016x}", key);
+}
+
+std::expected<void, std::string> SaveTextureToKtx2(const GLuint texture,
+	const GLenum target,
+	const u32 levelsCount,
+	const CachedTextureFormat& format,
+	const bool generateMipmaps,
+	const std::filesystem::path& path)
+{
+	const u32 facesCount = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+	GLint width = 0;
+	GLint height = 0;
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+
+	ktxTextureCreateInfo createInfo{};
+	createInfo.vkFormat = format.vkFormat;
+	createInfo.baseWidth = static_cast<ktx_uint32_t>(width);
+	createInfo.baseHeight = static_cast<ktx_uint32_t>(height);
+	createInfo.baseDepth = 1;
+	createInfo.numDimensions = 2;
+	createInfo.numLevels = levelsCount;
+	createInfo.numLayers = 1;
+	createInfo.numFaces = facesCount;
+	createInfo.isArray = KTX_FALSE;
+	createInfo.generateMipmaps = generateMipmaps ? KTX_TRUE : KTX_FALSE;
+
+	ktxTexture2* kTexture = nullptr;
+	KTX_error_code result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &kTexture);
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not create KTX2 texture : {}", ktxErrorString(result)));
+	}
+
+	// KTX2 rows are tightly packed
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	std::vector<u8> pixels{};
+	for (u32 level = 0; level < levelsCount; level++)
+	{
+		const auto levelWidth = static_cast<GLsizei>(std::max(width >> level, 1));
+		const auto levelHeight = static_cast<GLsizei>(std::max(height >> level, 1));
+		const usize faceSize = static_cast<usize>(levelWidth) * static_cast<usize>(levelHeight) * format.bytesPerPixel;
+		pixels.resize(faceSize);
+
+		for (u32 face = 0; face < facesCount; face++)
+		{
+			glGetTextureSubImage(texture,
+				static_cast<GLint>(level),
+				0,
+				0,
+				static_cast<GLint>(face),
+				levelWidth,
+				levelHeight,
+				1,
+				format.glFormat,
+				format.glType,
+				static_cast<GLsizei>(faceSize),
+				pixels.data());
+
+			result = ktxTexture_SetImageFromMemory(
+				ktxTexture(kTexture), level, 0, face, pixels.data(), static_cast<ktx_size_t>(faceSize));
+			if (result != KTX_SUCCESS)
+			{
+				glPixelStorei(GL_PACK_ALIGNMENT, 4);
+				ktxTexture_Destroy(ktxTexture(kTexture));
+				return std::unexpected(std::format("Could not set KTX2 image : {}", ktxErrorString(result)));
+			}
+		}
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	std::error_code errorCode{};
+	std::filesystem::create_directories(path.parent_path(), errorCode);
+	if (errorCode)
+	{
+		ktxTexture_Destroy(ktxTexture(kTexture));
+		return std::unexpected(
+			std::format("Could not create directory {} : {}", path.parent_path().string(), errorCode.message()));
+	}
+
+	result = ktxTexture_WriteToNamedFile(ktxTexture(kTexture), path.string().c_str());
+	ktxTexture_Destroy(ktxTexture(kTexture));
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not write {} : {}", path.string(), ktxErrorString(result)));
+	}
+
+	return {};
+}
+
+std::expected<GLuint, std::string> LoadTextureFromKtx2(const std::filesystem::path& path)
+{
+	ktxTexture* kTexture = nullptr;
+	KTX_error_code result =
+		ktxTexture_CreateFromNamedFile(path.string().c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not load {} : {}", path.string(), ktxErrorString(result)));
+	}
+
+	GLuint texture = 0;
+	GLenum target = 0;
+	GLenum glError = 0;
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	result = ktxTexture_GLUpload(kTexture, &texture, &target, &glError);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	ktxTexture_Destroy(kTexture);
+
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format(
+			"Could not upload {} : {} (OpenGL error {:#x})", path.string(), ktxErrorString(result), glError));
+	}
+
+	return texture;
+}
+
+std::expected<void, std::string> CopyKtx2ToTexture(
+	const std::filesystem::path& path, const GLuint texture, const CachedTextureFormat& format)
+{
+	ktxTexture2* kTexture = nullptr;
+	KTX_error_code result =
+		ktxTexture2_CreateFromNamedFile(path.string().c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not load {} : {}", path.string(), ktxErrorString(result)));
+	}
+
+	GLint width = 0;
+	GLint height = 0;
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+	if (kTexture->vkFormat != format.vkFormat || kTexture->baseWidth != static_cast<ktx_uint32_t>(width)
+		|| kTexture->baseHeight != static_cast<ktx_uint32_t>(height))
+	{
+		ktxTexture_Destroy(ktxTexture(kTexture));
+		return std::unexpected(std::format("{} does not match the format or size of the texture", path.string()));
+	}
+
+	ktx_size_t offset = 0;
+	ktxTexture_GetImageOffset(ktxTexture(kTexture), 0, 0, 0, &offset);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTextureSubImage2D(texture,
+		0,
+		0,
+		0,
+		width,
+		height,
+		format.glFormat,
+		format.glType,
+		ktxTexture_GetData(ktxTexture(kTexture)) + offset);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	ktxTexture_Destroy(ktxTexture(kTexture));
+	return {};
+}
+}// namespace stw
@@ -0,0 +1,598 @@
+/**
+ * @file json.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains a small JSON parser, used to read the glTF files.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <expected>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+export module json;
+
+import number_types;
+
+export namespace stw
+{
+/**
+ * Maximum number of nested arrays and objects, to not overflow the stack on a malicious file.
+ */
+constexpr usize JsonMaxDepth = 256;
+
+class JsonValue;
+struct JsonMember;
+
+using JsonArray = std::vector<JsonValue>;
+using JsonObject = std::vector<JsonMember>;
+
+/**
+ * Read only JSON document. The members of an object keep the order of the file and are found with a linear search,
+ * which is fast enough for the small objects of glTF.
+ */
+class JsonValue
+{
+public:
+	using Storage = std::variant<std::nullptr_t, bool, f64, std::string, JsonArray, JsonObject>;
+
+	JsonValue() = default;
+	explicit JsonValue(Storage value);
+
+	[[nodiscard]] bool IsNull() const;
+	[[nodiscard]] bool IsObject() const;
+	[[nodiscard]] bool IsArray() const;
+
+	[[nodiscard]] std::optional<bool> GetBool() const;
+	[[nodiscard]] std::optional<f64> GetNumber() const;
+	[[nodiscard]] std::optional<std::string_view> GetString() const;
+
+	/**
+	 * Gets the elements of an array, or nothing if the value is not an array.
+	 */
+	[[nodiscard]] std::span<const JsonValue> GetArray() const;
+
+	/**
+	 * Gets a non-negative integer, like the indices of glTF.
+	 */
+	[[nodiscard]] std::optional<usize> GetIndex() const;
+
+	/**
+	 * Finds a member of an object.
+	 * @param key Name of the member.
+	 * @return The value of the member or nullptr if the value is not an object or has no such member.
+	 */
+	[[nodiscard]] const JsonValue* Find(std::string_view key) const;
+
+	/**
+	 * Gets a member of an object that holds a non-negative integer.
+	 */
+	[[nodiscard]] std::optional<usize> FindIndex(std::string_view key) const;
+
+	/**
+	 * Gets the elements of a member of an object, or nothing if the member is missing or is not an array.
+	 */
+	[[nodiscard]] std::span<const JsonValue> FindArray(std::string_view key) const;
+
+private:
+	Storage m_Value{};
+};
+
+struct JsonMember
+{
+	std::string key;
+	JsonValue value;
+};
+
+/**
+ * Parses a JSON document.
+ * @param text Content of the document, in UTF-8.
+ * @return The root value or an error message with the offset of the error.
+ */
+std::expected<JsonValue, std::string> ParseJson(std::string_view text);
+
+/**
+ * Recursive descent parser that goes through the text once.
+ */
+class JsonParser
+{
+public:
+	explicit JsonParser(std::string_view text);
+
+	std::expected<JsonValue, std::string> ParseDocument();
+
+private:
+	std::string_view m_Text;
+	usize m_Offset = 0;
+	usize m_Depth = 0;
+
+	std::expected<JsonValue, std::string> ParseValue();
+	std::expected<JsonValue, std::string> ParseObject();
+	std::expected<JsonValue, std::string> ParseArray();
+	std::expected<std::string, std::string> ParseString();
+	std::expected<JsonValue, std::string> ParseNumber();
+	std::expected<JsonValue, std::string> ParseLiteral(std::string_view literal, JsonValue value);
+
+	void SkipWhitespace();
+	[[nodiscard]] bool Consume(char character);
+	[[nodiscard]] std::string MakeError(std::string_view message) const;
+};
+
+/**
+ * Appends a code point to a string in UTF-8.
+ */
+void AppendUtf8(std::string& text, u32 codePoint);
+
+JsonValue::JsonValue(Storage value) : m_Value(std::move(value)) {}
+
+bool JsonValue::IsNull() const { return std::holds_alternative<std::nullptr_t>(m_Value); }
+
+bool JsonValue::IsObject() const { return std::holds_alternative<JsonObject>(m_Value); }
+
+bool JsonValue::IsArray() const { return std::holds_alternative<JsonArray>(m_Value); }
+
+std::optional<bool> JsonValue::GetBool() const
+{
+	if (const auto* value = std::get_if<bool>(&m_Value))
+	{
+		return *value;
+	}
+
+	return std::nullopt;
+}
+
+std::optional<f64> JsonValue::GetNumber() const
+{
+	if (const auto* value = std::get_if<f64>(&m_Value))
+	{
+		return *value;
+	}
+
+	return std::nullopt;
+}
+
+std::optional<std::string_view> JsonValue::GetString() const
+{
+	if (const auto* value = std::get_if<std::string>(&m_Value))
+	{
+		return *value;
+	}
+
+	return std::nullopt;
+}
+
+std::span<const JsonValue> JsonValue::GetArray() const
+{
+	if (const auto* value = std::get_if<JsonArray>(&m_Value))
+	{
+		return *value;
+	}
+
+	return {};
+}
+
+const JsonValue* JsonValue::Find(const std::string_view key) const
+{
+	const auto* object = std::get_if<JsonObject>(&m_Value);
+	if (object == nullptr)
+	{
+		return nullptr;
+	}
+
+	for (const JsonMember& member : *object)
+	{
+		if (member.key == key)
+		{
+			return &member.value;
+		}
+	}
+
+	return nullptr;
+}
+
+std::optional<usize> JsonValue::GetIndex() const
+{
+	const std::optional<f64> number = GetNumber();
+	if (!number || number.value() < 0.0 || number.value() >= static_cast<f64>(std::numeric_limits<u32>::max())
+		|| number.value() != std::floor(number.value()))
+	{
+		return std::nullopt;
+	}
+
+	return static_cast<usize>(number.value());
+}
+
+std::optional<usize> JsonValue::FindIndex(const std::string_view key) const
+{
+	const JsonValue* member = Find(key);
+	if (member == nullptr)
+	{
+		return std::nullopt;
+	}
+
+	return member->GetIndex();
+}
+
+std::span<const JsonValue> JsonValue::FindArray(const std::string_view key) const
+{
+	const JsonValue* member = Find(key);
+	if (member == nullptr)
+	{
+		return {};
+	}
+
+	return member->GetArray();
+}
+
+std::expected<JsonValue, std::string> ParseJson(const std::string_view text)
+{
+	JsonParser parser{ text };
+	return parser.ParseDocument();
+}
+
+JsonParser::JsonParser(const std::string_view text) : m_Text(text) {}
+
+std::expected<JsonValue, std::string> JsonParser::ParseDocument()
+{
+	auto value = ParseValue();
+	if (!value)
+	{
+		return value;
+	}
+
+	SkipWhitespace();
+	if (m_Offset != m_Text.size())
+	{
+		return std::unexpected(MakeError("Unexpected content after the document"));
+	}
+
+	return value;
+}
+
+std::expected<JsonValue, std::string> JsonParser::ParseValue()
+{
+	SkipWhitespace();
+	if (m_Offset >= m_Text.size())
+	{
+		return std::unexpected(MakeError("Unexpected end of the document"));
+	}
+
+	switch (m_Text[m_Offset])
+	{
+	case '{':
+		return ParseObject();
+	case '[':
+		return ParseArray();
+	case '"':
+	{
+		auto text = ParseString();
+		if (!text)
+		{
+			return std::unexpected(text.error());
+		}
+
+		return JsonValue{ std::move(text.value()) };
+	}
+	case 't':
+		return ParseLiteral("true", JsonValue{ true });
+	case 'f':
+		return ParseLiteral("false", JsonValue{ false });
+	case 'n':
+		return ParseLiteral("null", JsonValue{ nullptr });
+	default:
+		return ParseNumber();
+	}
+}
+
+std::expected<JsonValue, std::string> JsonParser::ParseObject()
+{
+	if (m_Depth >= JsonMaxDepth)
+	{
+		return std::unexpected(MakeError("The document is nested too deeply"));
+	}
+
+	m_Depth++;
+	m_Offset++;
+
+	JsonObject object{};
+	SkipWhitespace();
+	if (Consume('}'))
+	{
+		m_Depth--;
+		return JsonValue{ std::move(object) };
+	}
+
+	while (true)
+	{
+		SkipWhitespace();
+		if (m_Offset >= m_Text.size() || m_Text[m_Offset] != '"')
+		{
+			return std::unexpected(MakeError("Expected the key of a member"));
+		}
+
+		auto key = ParseString();
+		if (!key)
+		{
+			return std::unexpected(key.error());
+		}
+
+		SkipWhitespace();
+		if (!Consume(':'))
+		{
+			return std::unexpected(MakeError("Expected ':' after the key of a member"));
+		}
+
+		auto value = ParseValue();
+		if (!value)
+		{
+			return value;
+		}
+
+		object.push_back({ std::move(key.value()), std::move(value.value()) });
+
+		SkipWhitespace();
+		if (Consume('}'))
+		{
+			break;
+		}
+
+		if (!Consume(','))
+		{
+			return std::unexpected(MakeError("Expected ',' or '}' in an object"));
+		}
+	}
+
+	m_Depth--;
+	return JsonValue{ std::move(object) };
+}
+
+std::expected<JsonValue, std::string> JsonParser::ParseArray()
+{
+	if (m_Depth >= JsonMaxDepth)
+	{
+		return std::unexpected(MakeError("The document is nested too deeply"));
+	}
+
+	m_Depth++;
+	m_Offset++;
+
+	JsonArray array{};
+	SkipWhitespace();
+	if (Consume(']'))
+	{
+		m_Depth--;
+		return JsonValue{ std::move(array) };
+	}
+
+	while (true)
+	{
+		auto value = ParseValue();
+		if (!value)
+		{
+			return value;
+		}
+
+		array.push_back(std::move(value.value()));
+
+		SkipWhitespace();
+		if (Consume(']'))
+		{
+			break;
+		}
+
+		if (!Consume(','))
+		{
+			return std::unexpected(MakeError("Expected ',' or ']' in an array"));
+		}
+	}
+
+	m_Depth--;
+	return JsonValue{ std::move(array) };
+}
+
+std::expected<std::string, std::string> JsonParser::ParseString()
+{
+	// Skip the opening quote
+	m_Offset++;
+
+	std::string text{};
+	while (m_Offset < m_Text.size())
+	{
+		const char character = m_Text[m_Offset];
+		m_Offset++;
+
+		if (character == '"')
+		{
+			return text;
+		}
+
+		if (static_cast<u8>(character) < 0x20)
+		{
+			return std::unexpected(MakeError("Control character in a string"));
+		}
+
+		if (character != '\\')
+		{
+			text.push_back(character);
+			continue;
+		}
+
+		if (m_Offset >= m_Text.size())
+		{
+			break;
+		}
+
+		const char escaped = m_Text[m_Offset];
+		m_Offset++;
+		switch (escaped)
+		{
+		case '"':
+		case '\\':
+		case '/':
+			text.push_back(escaped);
+			break;
+		case 'b':
+			text.push_back('\b');
+			break;
+		case 'f':
+			text.push_back('\f');
+			break;
+		case 'n':
+			text.push_back('\n');
+			break;
+		case 'r':
+			text.push_back('\r');
+			break;
+		case 't':
+			text.push_back('\t');
+			break;
+		case 'u':
+		{
+			const auto readCodeUnit = [this]() -> std::optional<u32> {
+				constexpr usize hexDigitsCount = 4;
+				u32 codeUnit = 0;
+				if (m_Offset + hexDigitsCount > m_Text.size())
+				{
+					return std::nullopt;
+				}
+
+				const char* begin = m_Text.data() + m_Offset;
+				const auto [end, error] = std::from_chars(begin, begin + hexDigitsCount, codeUnit, 16);
+				if (error != std::errc{} || end != begin + hexDigitsCount)
+				{
+					return std::nullopt;
+				}
+
+				m_Offset += hexDigitsCount;
+				return codeUnit;
+			};
+
+			std::optional<u32> codePoint = readCodeUnit();
+			if (!codePoint)
+			{
+				return std::unexpected(MakeError("Invalid unicode escape"));
+			}
+
+			// Characters outside the basic plane are escaped as a pair of UTF-16 surrogates
+			if (codePoint.value() >= 0xD800 && codePoint.value() <= 0xDBFF && m_Offset + 1 < m_Text.size()
+				&& m_Text[m_Offset] == '\\' && m_Text[m_Offset + 1] == 'u')
+			{
+				m_Offset += 2;
+				const std::optional<u32> lowSurrogate = readCodeUnit();
+				if (!lowSurrogate || lowSurrogate.value() < 0xDC00 || lowSurrogate.value() > 0xDFFF)
+				{
+					return std::unexpected(MakeError("Invalid unicode surrogate pair"));
+				}
+
+				codePoint = 0x10000 + ((codePoint.value() - 0xD800) << 10) + (lowSurrogate.value() - 0xDC00);
+			}
+
+			AppendUtf8(text, codePoint.value());
+			break;
+		}
+		default:
+			return std::unexpected(MakeError("Invalid escape sequence"));
+		}
+	}
+
+	return std::unexpected(MakeError("Unterminated string"));
+}
+
+std::expected<JsonValue, std::string> JsonParser::ParseNumber()
+{
+	// from_chars does not accept a leading '+', and neither does JSON
+	const char* begin = m_Text.data() + m_Offset;
+	const char* end = m_Text.data() + m_Text.size();
+
+	f64 number = 0.0;
+	const auto [numberEnd, error] = std::from_chars(begin, end, number);
+	if (error != std::errc{} || numberEnd == begin)
+	{
+		return std::unexpected(MakeError("Invalid value"));
+	}
+
+	m_Offset += static_cast<usize>(numberEnd - begin);
+	return JsonValue{ number };
+}
+
+std::expected<JsonValue, std::string> JsonParser::ParseLiteral(const std::string_view literal, JsonValue value)
+{
+	if (!m_Text.substr(m_Offset).starts_with(literal))
+	{
+		return std::unexpected(MakeError("Invalid value"));
+	}
+
+	m_Offset += literal.size();
+	return value;
+}
+
+void JsonParser::SkipWhitespace()
+{
+	while (m_Offset < m_Text.size())
+	{
+		const char character = m_Text[m_Offset];
+		if (character != ' ' && character != '\t' && character != '\n' && character != '\r')
+		{
+			return;
+		}
+
+		m_Offset++;
+	}
+}
+
+bool JsonParser::Consume(const char character)
+{
+	if (m_Offset < m_Text.size() && m_Text[m_Offset] == character)
+	{
+		m_Offset++;
+		return true;
+	}
+
+	return false;
+}
+
+std::string JsonParser::MakeError(const std::string_view message) const
+{
+	return std::format("{} at byte {}", message, m_Offset);
+}
+
+void AppendUtf8(std::string& text, const u32 codePoint)
+{
+	if (codePoint < 0x80)
+	{
+		text.push_back(static_cast<char>(codePoint));
+	}
+	else if (codePoint < 0x800)
+	{
+		text.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+		text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+	}
+	else if (codePoint < 0x10000)
+	{
+		text.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+		text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+		text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+	}
+	else
+	{
+		text.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+		text.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+		text.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+		text.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+	}
+}
+}// namespace stw
@@ -1,14 +1,78 @@
+#include <expected>
+#include <format>
 #include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 
+#include <glm/vec2.hpp>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/spdlog.h>
 
 import number_types;
+import utils;
 import window;
+import headless_window;
 import ssao_scene;
 
-int main(int, char*[])
+namespace
+{
+struct CommandLineOptions
+{
+	bool isHeadless = false;
+	glm::uvec2 headlessSize{ 1280, 720 };
+	u32 headlessFramesCount = 600;
+};
+
+/**
+ * Reads the options "--headless", "--frames=<count>" and "--size=<width>x<height>".
+ */
+std::expected<CommandLineOptions, std::string> ParseCommandLine(const std::span<char*> arguments)
+{
+	constexpr std::string_view framesPrefix = "--frames=";
+	constexpr std::string_view sizePrefix = "--size=";
+
+	CommandLineOptions options{};
+	for (const std::string_view argument : arguments.subspan(1))
+	{
+		if (argument == "--headless")
+		{
+			options.isHeadless = true;
+		}
+		else if (argument.starts_with(framesPrefix))
+		{
+			const auto framesCount = stw::ParseNumber<u32>(argument.substr(framesPrefix.size()));
+			if (!framesCount)
+			{
+				return std::unexpected(std::format("{} : {}", argument, framesCount.error()));
+			}
+			options.headlessFramesCount = framesCount.value();
+		}
+		else if (argument.starts_with(sizePrefix))
+		{
+			const std::string_view size = argument.substr(sizePrefix.size());
+			const usize separator = size.find('x');
+			const auto width = stw::ParseNumber<u32>(size.substr(0, separator));
+			const auto height = stw::ParseNumber<u32>(
+				separator == std::string_view::npos ? std::string_view{} : size.substr(separator + 1));
+			if (!width || !height || width.value() == 0 || height.value() == 0)
+			{
+				return std::unexpected(std::format("{} : expected a size like 1920x1080", argument));
+			}
+			options.headlessSize = { width.value(), height.value() };
+		}
+		else
+		{
+			return std::unexpected(std::format("Unknown option {}", argument));
+		}
+	}
+
+	return options;
+}
+}// namespace
+
+int main(const int argc, char* argv[])
 {
 	auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
 	console_sink->set_level(spdlog::level::info);
@@ -25,6 +89,26 @@ int main(int, char*[])
 
 	spdlog::set_default_logger(logger);
 
+	const auto options = ParseCommandLine(std::span{ argv, static_cast<usize>(argc) });
+	if (!options)
+	{
+		spdlog::error("{}", options.error());
+		return 1;
+	}
+
+	if (options->isHeadless)
+	{
+		auto headlessWindow = stw::HeadlessWindow<stw::SsaoScene>::Create(options->headlessSize);
+		if (!headlessWindow)
+		{
+			spdlog::error("Could not create the headless context : {}", headlessWindow.error());
+			return 1;
+		}
+
+		headlessWindow.value()->Loop(options->headlessFramesCount);
+		return 0;
+	}
+
 	stw::Window<stw::SsaoScene> window("OpenGL Scene");
 	window.Loop();
 	return 0;
@@ -0,0 +1,224 @@
+/**
+ * @file mapped_file.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the MappedFile class.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+export module mapped_file;
+
+import number_types;
+
+export namespace stw
+{
+/**
+ * Read only view of a whole file mapped in memory. The pages are only read from the disk when they are touched, and
+ * the OS can drop them again under memory pressure, so even very large files do not need a copy on the heap.
+ */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	/**
+	 * Maps a file in memory.
+	 * @param path Path of the file to map.
+	 * @return The mapped file or an error message.
+	 */
+	static std::expected<MappedFile, std::string> Open(const std::filesystem::path& path);
+
+	/**
+	 * Gets the content of the file. It stays valid as long as the mapped file is alive.
+	 */
+	[[nodiscard]] std::span<const u8> GetData() const;
+	[[nodiscard]] usize GetSize() const;
+
+	/**
+	 * Tells the OS that the file will be read from start to end, so that it reads ahead more aggressively.
+	 */
+	void AdviseSequential() const;
+
+private:
+	const u8* m_Data = nullptr;
+	usize m_Size = 0;
+
+#ifdef _WIN32
+	HANDLE m_File = INVALID_HANDLE_VALUE;
+	HANDLE m_Mapping = nullptr;
+#endif
+
+	void Close();
+};
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0))
+#ifdef _WIN32
+	  ,
+	  m_File(std::exchange(other.m_File, INVALID_HANDLE_VALUE)), m_Mapping(std::exchange(other.m_Mapping, nullptr))
+#endif
+{
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+
+	Close();
+
+	m_Data = std::exchange(other.m_Data, nullptr);
+	m_Size = std::exchange(other.m_Size, 0);
+#ifdef _WIN32
+	m_File = std::exchange(other.m_File, INVALID_HANDLE_VALUE);
+	m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#endif
+
+	return *this;
+}
+
+std::expected<MappedFile, std::string> MappedFile::Open(const std::filesystem::path& path)
+{
+	MappedFile mappedFile;
+
+	std::error_code errorCode{};
+	const auto fileSize = std::filesystem::file_size(path, errorCode);
+	if (errorCode)
+	{
+		return std::unexpected(std::format("Could not get the size of {} : {}", path.string(), errorCode.message()));
+	}
+
+	// Mapping an empty file fails, there is nothing to read anyway
+	if (fileSize == 0)
+	{
+		return mappedFile;
+	}
+
+#ifdef _WIN32
+	mappedFile.m_File = CreateFileW(path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+	if (mappedFile.m_File == INVALID_HANDLE_VALUE)
+	{
+		return std::unexpected(std::format("Could not open {} (error {})", path.string(), GetLastError()));
+	}
+
+	mappedFile.m_Mapping = CreateFileMappingW(mappedFile.m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappedFile.m_Mapping == nullptr)
+	{
+		return std::unexpected(std::format("Could not map {} (error {})", path.string(), GetLastError()));
+	}
+
+	const void* data = MapViewOfFile(mappedFile.m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		return std::unexpected(std::format("Could not map {} (error {})", path.string(), GetLastError()));
+	}
+#else
+	const int fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return std::unexpected(std::format("Could not open {}", path.string()));
+	}
+
+	void* data = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	// The mapping keeps its own reference to the file
+	close(fileDescriptor);
+	if (data == MAP_FAILED)
+	{
+		return std::unexpected(std::format("Could not map {}", path.string()));
+	}
+#endif
+
+	mappedFile.m_Data = static_cast<const u8*>(data);
+	mappedFile.m_Size = static_cast<usize>(fileSize);
+
+	return mappedFile;
+}
+
+std::span<const u8> MappedFile::GetData() const { return { m_Data, m_Size }; }
+
+usize MappedFile::GetSize() const { return m_Size; }
+
+void MappedFile::AdviseSequential() const
+{
+#ifndef _WIN32
+	if (m_Data != nullptr)
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+		madvise(const_cast<u8*>(m_Data), m_Size, MADV_SEQUENTIAL);
+	}
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_Data != nullptr)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping != nullptr)
+	{
+		CloseHandle(m_Mapping);
+	}
+	if (m_File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_File);
+	}
+	m_Mapping = nullptr;
+	m_File = INVALID_HANDLE_VALUE;
+#else
+	if (m_Data != nullptr)
+	{
+		// NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+		munmap(const_cast<u8*>(m_Data), m_Size);
+	}
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+}
+}// namespace stw
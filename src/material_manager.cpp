@@ -12,7 +12,10 @@
 module;
 
 #include <filesystem>
+#include <optional>
 #include <span>
+#include <string>
+#include <variant>
 #include <vector>
 
 #include <assimp/scene.h>
@@ -24,245 +27,235 @@ import number_types;
 import texture;
 import texture_manager;
 import material;
+import utils;
 
 export namespace stw
 {
+enum class MaterialDescriptorType : u8
+{
+	PbrNormal,
+	PbrNormalNoAo,
+	PbrNormalArm,
+};
+
+/**
+ * Describes which textures a material uses, so that it can be loaded again without going through Assimp.
+ * The paths are relative to the directory of the model.
+ */
+struct MaterialDescriptor
+{
+	MaterialDescriptorType type = MaterialDescriptorType::PbrNormal;
+	std::string baseColorPath{};
+	std::string normalPath{};
+	// Only used by the ARM materials
+	std::string armPath{};
+	// Only used by the materials that have separate maps
+	std::string ambientOcclusionPath{};
+	std::string roughnessPath{};
+	std::string metallicPath{};
+};
+
 class MaterialManager
 {
 public:
-	std::vector<std::size_t> LoadMaterialsFromAssimpScene(
-		const aiScene* assimpScene, const std::filesystem::path& workingDirectory, TextureManager& textureManager);
+	/**
+	 * Finds the textures of an Assimp material.
+	 * @param material Material to read.
+	 * @return The descriptor of the material or nothing if the renderer cannot draw this kind of material.
+	 */
+	static std::optional<MaterialDescriptor> ReadMaterialDescriptor(const aiMaterial* material);
+
+	/**
+	 * Loads the textures of a material and adds it at the end of the materials.
+	 * @param descriptor Textures of the material.
+	 * @param workingDirectory Directory that the paths of the descriptor are relative to.
+	 * @param textureManager Texture manager that loads the textures.
+	 */
+	void LoadMaterial(const MaterialDescriptor& descriptor,
+		const std::filesystem::path& workingDirectory,
+		TextureManager& textureManager);
+
+	/**
+	 * Releases the textures of a material and replaces it by an invalid material, so that the indices of the other
+	 * materials do not change.
+	 * @param index Index of the material.
+	 * @param textureManager Texture manager that loaded the textures of the material.
+	 */
+	void ReleaseMaterial(std::size_t index, TextureManager& textureManager);
 	Material& operator[](std::size_t index);
 	const Material& operator[](std::size_t index) const;
 	[[nodiscard]] std::size_t Size() const;
 
 private:
-	void LoadPbrNormal(
-		const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager);
-	void LoadPbrNormalNoAo(
-		const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager);
-	void LoadPbrNormalArm(
-		const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager);
-
 	std::vector<Material> m_Materials;
 };
 
-std::vector<std::size_t> MaterialManager::LoadMaterialsFromAssimpScene(
-	const aiScene* assimpScene, const std::filesystem::path& workingDirectory, TextureManager& textureManager)
+/**
+ * Gets the path of the first texture of a type in an Assimp material.
+ */
+std::optional<std::string> GetAssimpTexturePath(const aiMaterial* material, aiTextureType type)
 {
-	const std::span assimpMaterials{ assimpScene->mMaterials, assimpScene->mNumMaterials };
-
-	std::vector<std::size_t> assimpMaterialIndicesLoaded;
-	assimpMaterialIndicesLoaded.reserve(assimpMaterials.size());
-
-	for (usize i = 0; i < assimpMaterials.size(); i++)
+	aiString relativePath;
+	if (material->GetTexture(type, 0, &relativePath) != aiReturn_SUCCESS)
 	{
-		const aiMaterial* material = assimpMaterials[i];
-		const auto diffuseCount = material->GetTextureCount(aiTextureType_DIFFUSE);
-		const auto baseColorCount = material->GetTextureCount(aiTextureType_BASE_COLOR);
-		const auto normalCount = material->GetTextureCount(aiTextureType_NORMALS);
-		const auto roughnessCount = material->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS);
-		const auto ambientCount = material->GetTextureCount(aiTextureType_AMBIENT);
-		const auto ambientOcclusionCount = material->GetTextureCount(aiTextureType_AMBIENT_OCCLUSION);
-		const auto metallicCount = material->GetTextureCount(aiTextureType_METALNESS);
-		const auto unknownCount = material->GetTextureCount(aiTextureType_UNKNOWN);
-
-		if ((diffuseCount > 0 || baseColorCount > 0) && normalCount > 0 && roughnessCount > 0 && metallicCount > 0)
-		{
-			if (unknownCount == 0)
-			{
-				if (ambientCount > 0 || ambientOcclusionCount > 0)
-				{
-					LoadPbrNormal(material, workingDirectory, textureManager);
-					assimpMaterialIndicesLoaded.push_back(i);
-				}
-				else
-				{
-					LoadPbrNormalNoAo(material, workingDirectory, textureManager);
-					assimpMaterialIndicesLoaded.push_back(i);
-				}
-			}
-			else
-			{
-				LoadPbrNormalArm(material, workingDirectory, textureManager);
-				assimpMaterialIndicesLoaded.push_back(i);
-			}
-		}
-		else
-		{
-			spdlog::debug("Unhandled material");
-		}
+		return std::nullopt;
 	}
 
-	return assimpMaterialIndicesLoaded;
+	return std::string{ relativePath.C_Str() };
 }
 
-Material& MaterialManager::operator[](const std::size_t index) { return m_Materials[index]; }
+std::optional<MaterialDescriptor> MaterialManager::ReadMaterialDescriptor(const aiMaterial* material)
+{
+	const auto diffuseCount = material->GetTextureCount(aiTextureType_DIFFUSE);
+	const auto baseColorCount = material->GetTextureCount(aiTextureType_BASE_COLOR);
+	const auto normalCount = material->GetTextureCount(aiTextureType_NORMALS);
+	const auto roughnessCount = material->GetTextureCount(aiTextureType_DIFFUSE_ROUGHNESS);
+	const auto ambientCount = material->GetTextureCount(aiTextureType_AMBIENT);
+	const auto ambientOcclusionCount = material->GetTextureCount(aiTextureType_AMBIENT_OCCLUSION);
+	const auto metallicCount = material->GetTextureCount(aiTextureType_METALNESS);
+	const auto unknownCount = material->GetTextureCount(aiTextureType_UNKNOWN);
+
+	if ((diffuseCount == 0 && baseColorCount == 0) || normalCount == 0 || roughnessCount == 0 || metallicCount == 0)
+	{
+		spdlog::debug("Unhandled material");
+		return std::nullopt;
+	}
 
-const Material& MaterialManager::operator[](const std::size_t index) const { return m_Materials[index]; }
+	MaterialDescriptor descriptor{};
 
-void MaterialManager::LoadPbrNormal(
-	const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager)
-{
-	aiString relativePath;
-	aiReturn result = material->GetTexture(aiTextureType_NORMALS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	const auto normalPath = GetAssimpTexturePath(material, aiTextureType_NORMALS);
+	if (!normalPath)
 	{
 		spdlog::error("Could not get normal map");
-		return;
+		return std::nullopt;
 	}
+	descriptor.normalPath = normalPath.value();
 
-	const std::filesystem::path normalPath = workingDirectory / relativePath.C_Str();
-	const std::size_t normalIndex =
-		textureManager.LoadTextureFromPath(normalPath, TextureType::Normal, TextureSpace::Linear).value();
-
-	result = material->GetTexture(aiTextureType_DIFFUSE, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	auto baseColorPath = GetAssimpTexturePath(material, aiTextureType_DIFFUSE);
+	if (!baseColorPath)
 	{
-		result = material->GetTexture(aiTextureType_BASE_COLOR, 0, &relativePath);
-		if (result != aiReturn_SUCCESS)
+		baseColorPath = GetAssimpTexturePath(material, aiTextureType_BASE_COLOR);
+		if (!baseColorPath)
 		{
 			spdlog::error("Could not get diffuse / base color map");
-			return;
+			return std::nullopt;
 		}
 	}
-	const std::filesystem::path baseColorPath = workingDirectory / relativePath.C_Str();
-	const std::size_t baseColorIndex =
-		textureManager.LoadTextureFromPath(baseColorPath, TextureType::BaseColor, TextureSpace::Srgb).value();
+	descriptor.baseColorPath = baseColorPath.value();
 
-	result = material->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
-	{
-		spdlog::error("Could not get roughness map");
-		return;
-	}
-	const std::filesystem::path roughnessPath = workingDirectory / relativePath.C_Str();
-	const std::size_t roughnessIndex =
-		textureManager.LoadTextureFromPath(roughnessPath, TextureType::Roughness, TextureSpace::Linear).value();
-
-	result = material->GetTexture(aiTextureType_AMBIENT, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	// Load ARM (ambient, roughness, metallic) map
+	if (unknownCount > 0)
 	{
-		result = material->GetTexture(aiTextureType_AMBIENT_OCCLUSION, 0, &relativePath);
-		if (result != aiReturn_SUCCESS)
+		const auto armPath = GetAssimpTexturePath(material, aiTextureType_UNKNOWN);
+		if (!armPath)
 		{
-			spdlog::error("Could not get ambient occlusion map");
-			return;
+			spdlog::error("Could not get ARM map");
+			return std::nullopt;
 		}
-	}
-	const std::filesystem::path ambientOcclusionPath = workingDirectory / relativePath.C_Str();
-	const std::size_t ambientOcclusionIndex =
-		textureManager.LoadTextureFromPath(ambientOcclusionPath, TextureType::AmbientOcclusion, TextureSpace::Linear)
-			.value();
+		descriptor.type = MaterialDescriptorType::PbrNormalArm;
+		descriptor.armPath = armPath.value();
 
-	result = material->GetTexture(aiTextureType_METALNESS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
-	{
-		spdlog::error("Could not get metallic map");
-		return;
+		return descriptor;
 	}
-	const std::filesystem::path metallicPath = workingDirectory / relativePath.C_Str();
-	const std::size_t metallicIndex =
-		textureManager.LoadTextureFromPath(metallicPath, TextureType::Metallic, TextureSpace::Linear).value();
 
-	m_Materials.emplace_back(
-		MaterialPbrNormal{ baseColorIndex, normalIndex, ambientOcclusionIndex, roughnessIndex, metallicIndex });
-}
-void MaterialManager::LoadPbrNormalNoAo(
-	const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager)
-{
-
-	aiString relativePath;
-	aiReturn result = material->GetTexture(aiTextureType_NORMALS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	const auto roughnessPath = GetAssimpTexturePath(material, aiTextureType_DIFFUSE_ROUGHNESS);
+	if (!roughnessPath)
 	{
-		spdlog::error("Could not get normal map");
-		return;
+		spdlog::error("Could not get roughness map");
+		return std::nullopt;
 	}
+	descriptor.roughnessPath = roughnessPath.value();
 
-	const std::filesystem::path normalPath = workingDirectory / relativePath.C_Str();
-	const std::size_t normalIndex =
-		textureManager.LoadTextureFromPath(normalPath, TextureType::Normal, TextureSpace::Linear).value();
-
-	result = material->GetTexture(aiTextureType_DIFFUSE, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	const auto metallicPath = GetAssimpTexturePath(material, aiTextureType_METALNESS);
+	if (!metallicPath)
 	{
-		result = material->GetTexture(aiTextureType_BASE_COLOR, 0, &relativePath);
-		if (result != aiReturn_SUCCESS)
-		{
-			spdlog::error("Could not get diffuse / base color map");
-			return;
-		}
+		spdlog::error("Could not get metallic map");
+		return std::nullopt;
 	}
-	const std::filesystem::path baseColorPath = workingDirectory / relativePath.C_Str();
-	const std::size_t baseColorIndex =
-		textureManager.LoadTextureFromPath(baseColorPath, TextureType::BaseColor, TextureSpace::Srgb).value();
+	descriptor.metallicPath = metallicPath.value();
 
-	result = material->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	if (ambientCount == 0 && ambientOcclusionCount == 0)
 	{
-		spdlog::error("Could not get roughness map");
-		return;
+		descriptor.type = MaterialDescriptorType::PbrNormalNoAo;
+		return descriptor;
 	}
-	const std::filesystem::path roughnessPath = workingDirectory / relativePath.C_Str();
-	const std::size_t roughnessIndex =
-		textureManager.LoadTextureFromPath(roughnessPath, TextureType::Roughness, TextureSpace::Linear).value();
 
-	result = material->GetTexture(aiTextureType_METALNESS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	auto ambientOcclusionPath = GetAssimpTexturePath(material, aiTextureType_AMBIENT);
+	if (!ambientOcclusionPath)
 	{
-		spdlog::error("Could not get metallic map");
-		return;
+		ambientOcclusionPath = GetAssimpTexturePath(material, aiTextureType_AMBIENT_OCCLUSION);
+		if (!ambientOcclusionPath)
+		{
+			spdlog::error("Could not get ambient occlusion map");
+			return std::nullopt;
+		}
 	}
-	const std::filesystem::path metallicPath = workingDirectory / relativePath.C_Str();
-	const std::size_t metallicIndex =
-		textureManager.LoadTextureFromPath(metallicPath, TextureType::Metallic, TextureSpace::Linear).value();
+	descriptor.type = MaterialDescriptorType::PbrNormal;
+	descriptor.ambientOcclusionPath = ambientOcclusionPath.value();
 
-	m_Materials.emplace_back(MaterialPbrNormalNoAo{ baseColorIndex, normalIndex, roughnessIndex, metallicIndex });
+	return descriptor;
 }
 
-void MaterialManager::LoadPbrNormalArm(
-	const aiMaterial* material, const std::filesystem::path& workingDirectory, TextureManager& textureManager)
+void MaterialManager::LoadMaterial(const MaterialDescriptor& descriptor,
+	const std::filesystem::path& workingDirectory,
+	TextureManager& textureManager)
 {
-	aiString relativePath;
-	aiReturn result = material->GetTexture(aiTextureType_NORMALS, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
-	{
-		spdlog::error("Could not get normal map");
-		return;
-	}
-
-	const std::filesystem::path normalPath = workingDirectory / relativePath.C_Str();
+	const std::filesystem::path normalPath = workingDirectory / descriptor.normalPath;
 	const std::size_t normalIndex =
 		textureManager.LoadTextureFromPath(normalPath, TextureType::Normal, TextureSpace::Linear).value();
 
-	result = material->GetTexture(aiTextureType_DIFFUSE, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
-	{
-		result = material->GetTexture(aiTextureType_BASE_COLOR, 0, &relativePath);
-		if (result != aiReturn_SUCCESS)
-		{
-			spdlog::error("Could not get diffuse / base color map");
-			return;
-		}
-	}
-	const std::filesystem::path baseColorPath = workingDirectory / relativePath.C_Str();
+	const std::filesystem::path baseColorPath = workingDirectory / descriptor.baseColorPath;
 	const std::size_t baseColorIndex =
 		textureManager.LoadTextureFromPath(baseColorPath, TextureType::BaseColor, TextureSpace::Srgb).value();
 
-	// Load ARM (ambient, roughness, metallic) map
-	result = material->GetTexture(aiTextureType_UNKNOWN, 0, &relativePath);
-	if (result != aiReturn_SUCCESS)
+	const std::filesystem::path roughnessPath = workingDirectory / descriptor.roughnessPath;
+	const std::filesystem::path metallicPath = workingDirectory / descriptor.metallicPath;
+
+	std::size_t armIndex = 0;
+	switch (descriptor.type)
+	{
+	case MaterialDescriptorType::PbrNormal:
 	{
-		spdlog::error("Could not get ARM map");
-		return;
+		// The separate maps are packed in one texture, so that the material uses the same pipeline as the ARM materials
+		const std::filesystem::path ambientOcclusionPath = workingDirectory / descriptor.ambientOcclusionPath;
+		armIndex =
+			textureManager.LoadOrmTextureFromPaths(ambientOcclusionPath, roughnessPath, metallicPath).value();
+		break;
+	}
+	case MaterialDescriptorType::PbrNormalNoAo:
+		// Without an ambient occlusion map, the red channel of the packed texture is fully unoccluded
+		armIndex = textureManager.LoadOrmTextureFromPaths(std::nullopt, roughnessPath, metallicPath).value();
+		break;
+	case MaterialDescriptorType::PbrNormalArm:
+	{
+		const std::filesystem::path armPath = workingDirectory / descriptor.armPath;
+		armIndex = textureManager.LoadTextureFromPath(armPath, TextureType::Roughness, TextureSpace::Linear).value();
+		break;
+	}
 	}
-	const std::filesystem::path armPath = workingDirectory / relativePath.C_Str();
-	const std::size_t armIndex =
-		textureManager.LoadTextureFromPath(armPath, TextureType::Roughness, TextureSpace::Linear).value();
 
 	m_Materials.emplace_back(MaterialPbrNormalArm{ baseColorIndex, normalIndex, armIndex });
 }
 
+void MaterialManager::ReleaseMaterial(const std::size_t index, TextureManager& textureManager)
+{
+	const auto releaseTextures = [&textureManager](const auto&... textureIndices) {
+		(textureManager.ReleaseTexture(textureIndices), ...);
+	};
+
+	const auto invalid = [](const InvalidMaterial&) {};
+	const auto pbrNormalArm = [&releaseTextures](const MaterialPbrNormalArm& material) {
+		releaseTextures(material.baseColorMapIndex, material.normalMapIndex, material.armMapIndex);
+	};
+
+	std::visit(Overloaded{ invalid, pbrNormalArm }, m_Materials[index]);
+
+	m_Materials[index] = InvalidMaterial{};
+}
+
+Material& MaterialManager::operator[](const std::size_t index) { return m_Materials[index]; }
+
+const Material& MaterialManager::operator[](const std::size_t index) const { return m_Materials[index]; }
+
 std::size_t MaterialManager::Size() const { return m_Materials.size(); }
 }// namespace stw
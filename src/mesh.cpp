@@ -11,11 +11,20 @@
 
 module;
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <numbers>
 #include <span>
+#include <utility>
 #include <vector>
 
 #include <glad/glad.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
@@ -30,9 +39,16 @@ import index_buffer;
 import vertex_array;
 import vertex_buffer;
 import vertex_buffer_layout;
+import geometry_arena;
+import gpu_memory;
 
 export namespace stw
 {
+/**
+ * First attribute location of the per instance model matrix, it takes four locations.
+ */
+constexpr GLuint ModelMatrixAttributeLocation = 4;
+
 struct Vertex
 {
 	glm::vec3 position;
@@ -42,6 +58,94 @@ struct Vertex
 	glm::vec3 tangent;
 };
 
+/**
+ * Compressed vertex, 20 bytes instead of the 44 of Vertex. The position is a normalized int16 relative to the bounds of
+ * the mesh, the normal and the tangent are normalized 10_10_10_2 and the texture coordinates are normalized uint16.
+ */
+struct QuantizedVertex
+{
+	// The fourth component keeps the next attributes 4 bytes aligned
+	std::array<i16, 4> position;
+	u32 normal;
+	std::array<u16, 2> texCoords;
+	u32 tangent;
+};
+
+static_assert(sizeof(QuantizedVertex) == 20);
+
+/**
+ * Layout of the vertices in the vertex buffer of a mesh.
+ */
+enum class VertexFormat : u8
+{
+	Float,
+	/**
+	 * Uses QuantizedVertex. A mesh whose texture coordinates are outside [0, 1] stays in the float format, since they
+	 * cannot be normalized without a visible loss.
+	 */
+	Quantized,
+};
+
+/**
+ * Range of the index buffer of a mesh that draws one level of detail. Every level shares the vertices of the mesh.
+ */
+struct MeshLod
+{
+	u32 firstIndex;
+	u32 indicesCount;
+	/**
+	 * Estimated deviation of this level from the full detail mesh, in model space. It is the square root of the largest
+	 * quadric error of the collapses, which is an area weighted mean of the squared distances to the planes of the
+	 * merged triangles, summed over the levels. It is a root mean square distance, so some vertices can move further
+	 * than it.
+	 */
+	f32 error;
+};
+
+/**
+ * Small cluster of neighbouring triangles of the full detail level, culled on its own by the GPU. The layout matches
+ * the std430 struct of the meshlet culling shader.
+ */
+struct Meshlet
+{
+	/**
+	 * Bounding sphere of the triangles, in model space.
+	 */
+	glm::vec3 center;
+	f32 radius;
+	/**
+	 * Average normal of the triangles. Every triangle faces away from a viewer for which the dot product between the
+	 * normalized direction to the meshlet and this axis is greater than the cutoff. A cutoff of 1 never culls.
+	 */
+	glm::vec3 coneAxis;
+	f32 coneCutoff;
+	u32 firstIndex;
+	u32 trianglesCount;
+	std::array<u32, 2> padding;
+};
+
+static_assert(sizeof(Meshlet) == 48);
+
+/**
+ * Copy of a mesh kept on the CPU after the upload, which arrays depend on the GeometryResidency of the mesh. The mesh
+ * does not own them, they usually live in a GeometryArena.
+ */
+struct MeshCpuData
+{
+	/**
+	 * Positions of the vertices, only kept for picking.
+	 */
+	std::span<const glm::vec3> positions;
+	/**
+	 * Complete vertices, only kept for a re-upload.
+	 */
+	std::span<const Vertex> vertices;
+	/**
+	 * Indices of the full detail level for picking, or of every level for a re-upload.
+	 */
+	std::span<const u32> indices;
+};
+
 class Mesh
 {
 public:
@@ -58,34 +162,147 @@ class Mesh
 	static Mesh CreateInsideCube();
 	static Mesh CreateUvSphere(f32 radius, u32 latitudes, u32 longitudes);
 
-	void Init(std::vector<Vertex> vertices, std::vector<u32> indices);
+	/**
+	 * Uploads the vertices and indices to the GPU. The mesh does not keep a copy of them, so they can point to a mapped
+	 * file or to a buffer that is freed right after.
+	 * @param vertices Vertices of the mesh.
+	 * @param indices Indices of the triangles of the mesh.
+	 * @param format Layout of the vertices on the GPU.
+	 * @param lods Levels of detail of the mesh, from the most detailed. When empty, the mesh has a single level that
+	 * uses every index.
+	 * @param meshlets Meshlets of the most detailed level, uploaded to a storage buffer for the GPU culling.
+	 */
+	void Init(std::span<const Vertex> vertices,
+		std::span<const u32> indices,
+		VertexFormat format = VertexFormat::Float,
+		std::span<const MeshLod> lods = {},
+		std::span<const Meshlet> meshlets = {});
 	void Delete();
 
+	/**
+	 * Sets the copy of the mesh that the CPU keeps after the upload.
+	 * @param residency What the copy contains.
+	 * @param cpuData Arrays of the copy, they must stay alive as long as the mesh.
+	 */
+	void SetCpuData(GeometryResidency residency, const MeshCpuData& cpuData);
+	[[nodiscard]] GeometryResidency GetResidency() const;
+	[[nodiscard]] const MeshCpuData& GetCpuData() const;
+
+	/**
+	 * Uploads the CPU copy of the mesh again, for example after the GPU buffers were dropped. The residency of the mesh
+	 * must be KeepForReupload.
+	 */
+	void Reupload();
+
 	[[nodiscard]] std::size_t GetIndicesSize() const;
+	[[nodiscard]] std::span<const MeshLod> GetLods() const;
+
+	/**
+	 * Gets the offset of the first index of a level of detail, to give to glDrawElements.
+	 */
+	[[nodiscard]] const void* GetLodIndicesOffset(usize lodIndex) const;
+
+	/**
+	 * Gets the type of the indices, to give to glDrawElements.
+	 */
+	[[nodiscard]] GLenum GetIndexType() const;
+	[[nodiscard]] GLuint GetIndexBufferId() const;
+	[[nodiscard]] VertexFormat GetVertexFormat() const;
+
+	/**
+	 * Gets the storage buffer of the meshlets, or 0 if the mesh has none.
+	 */
+	[[nodiscard]] GLuint GetMeshletBuffer() const;
+	[[nodiscard]] u32 GetMeshletsCount() const;
 	[[nodiscard]] const VertexArray& GetVertexArray() const;
 
+	/**
+	 * Gets the center of a sphere that contains every vertex of the mesh, in model space.
+	 */
+	[[nodiscard]] glm::vec3 GetBoundingSphereCenter() const;
+	[[nodiscard]] f32 GetBoundingSphereRadius() const;
+
 	void Bind(std::span<const glm::mat4> modelMatrices) const;
 	void UnBind() const;
 
+	/**
+	 * Sets how many consecutive instances use the same model matrix. The default is one.
+	 * The mesh needs to be bound.
+	 * @param divisor Number of instances that share each model matrix.
+	 */
+	void SetModelMatrixDivisor(u32 divisor) const;
+
 private:
-	std::vector<Vertex> m_Vertices{};
-	std::vector<u32> m_Indices{};
+	usize m_IndicesCount = 0;
+	std::vector<MeshLod> m_Lods{};
 
 	VertexArray m_VertexArray{};
 	VertexBuffer<Vertex> m_VertexBuffer{};
+	VertexBuffer<QuantizedVertex> m_QuantizedVertexBuffer{};
 	VertexBuffer<glm::mat4> m_ModelMatrixBuffer{};
 	IndexBuffer m_IndexBuffer{};
+	VertexFormat m_VertexFormat = VertexFormat::Float;
+
+	GLuint m_MeshletBuffer = 0;
+	u32 m_MeshletsCount = 0;
+
+	/**
+	 * Maps the quantized positions back to model space. It is folded in the model matrices when the mesh is bound, so
+	 * that the shaders do not depend on the vertex format.
+	 */
+	glm::mat4 m_DequantizationMatrix{ 1.0f };
+	mutable std::vector<glm::mat4> m_DequantizedModelMatrices{};
+
+	glm::vec3 m_BoundingSphereCenter{ 0.0f };
+	f32 m_BoundingSphereRadius = 0.0f;
+
+	GeometryResidency m_Residency = GeometryResidency::DropAfterUpload;
+	MeshCpuData m_CpuData{};
 
 	bool m_IsInitialized = false;
 
-	void SetupMesh();
+	void SetupMesh(std::span<const Vertex> vertices, std::span<const u32> indices, VertexFormat format);
+	void ComputeBoundingSphere(std::span<const Vertex> vertices);
+	void SetupMeshlets(std::span<const Meshlet> meshlets);
+	void DeleteMeshlets();
 };
 
+/**
+ * Checks that the vertices can be quantized without a visible loss of precision.
+ */
+[[nodiscard]] bool CanQuantizeVertices(std::span<const Vertex> vertices);
+
+/**
+ * Converts vertices to the quantized format.
+ * @param vertices Vertices to convert.
+ * @param center Center of the bounds of the vertices.
+ * @param halfExtent Half of the largest side of the bounds of the vertices. The same scale is used on every axis, so
+ * that the normals are not skewed by the dequantization.
+ * @return The quantized vertices.
+ */
+[[nodiscard]] std::vector<QuantizedVertex> QuantizeVertices(
+	std::span<const Vertex> vertices, const glm::vec3& center, f32 halfExtent);
+
+/**
+ * Converts a float in [-1, 1] to a normalized int16.
+ */
+[[nodiscard]] i16 QuantizeSnorm16(f32 value);
+
+/**
+ * Converts a float in [0, 1] to a normalized uint16.
+ */
+[[nodiscard]] u16 QuantizeUnorm16(f32 value);
+
 Mesh::Mesh(Mesh&& other) noexcept
-	: m_Vertices(std::move(other.m_Vertices)), m_Indices(std::move(other.m_Indices)),
-	  m_VertexArray(std::move(other.m_VertexArray)), m_VertexBuffer(std::move(other.m_VertexBuffer)),
+	: m_IndicesCount(other.m_IndicesCount), m_Lods(std::move(other.m_Lods)),
+	  m_VertexArray(std::move(other.m_VertexArray)),
+	  m_VertexBuffer(std::move(other.m_VertexBuffer)),
+	  m_QuantizedVertexBuffer(std::move(other.m_QuantizedVertexBuffer)),
 	  m_ModelMatrixBuffer(std::move(other.m_ModelMatrixBuffer)), m_IndexBuffer(std::move(other.m_IndexBuffer)),
-	  m_IsInitialized(other.m_IsInitialized)
+	  m_VertexFormat(other.m_VertexFormat), m_MeshletBuffer(std::exchange(other.m_MeshletBuffer, 0)),
+	  m_MeshletsCount(std::exchange(other.m_MeshletsCount, 0)), m_DequantizationMatrix(other.m_DequantizationMatrix),
+	  m_BoundingSphereCenter(other.m_BoundingSphereCenter), m_BoundingSphereRadius(other.m_BoundingSphereRadius),
+	  m_Residency(other.m_Residency), m_CpuData(other.m_CpuData), m_IsInitialized(other.m_IsInitialized)
 {
 	other.m_IsInitialized = false;
 }
@@ -105,23 +322,45 @@ Mesh& Mesh::operator=(Mesh&& other) noexcept
 		return *this;
 	}
 
-	m_Vertices = std::move(other.m_Vertices);
-	m_Indices = std::move(other.m_Indices);
+	m_IndicesCount = other.m_IndicesCount;
+	m_Lods = std::move(other.m_Lods);
 	m_VertexArray = std::move(other.m_VertexArray);
 	m_VertexBuffer = std::move(other.m_VertexBuffer);
+	m_QuantizedVertexBuffer = std::move(other.m_QuantizedVertexBuffer);
 	m_ModelMatrixBuffer = std::move(other.m_ModelMatrixBuffer);
 	m_IndexBuffer = std::move(other.m_IndexBuffer);
+	m_VertexFormat = other.m_VertexFormat;
+	m_MeshletBuffer = std::exchange(other.m_MeshletBuffer, 0);
+	m_MeshletsCount = std::exchange(other.m_MeshletsCount, 0);
+	m_DequantizationMatrix = other.m_DequantizationMatrix;
+	m_BoundingSphereCenter = other.m_BoundingSphereCenter;
+	m_BoundingSphereRadius = other.m_BoundingSphereRadius;
+	m_Residency = other.m_Residency;
+	m_CpuData = other.m_CpuData;
 	m_IsInitialized = other.m_IsInitialized;
 	other.m_IsInitialized = false;
 
 	return *this;
 }
 
-void Mesh::Init(std::vector<Vertex> vertices, std::vector<u32> indices)
+void Mesh::Init(const std::span<const Vertex> vertices,
+	const std::span<const u32> indices,
+	const VertexFormat format,
+	const std::span<const MeshLod> lods,
+	const std::span<const Meshlet> meshlets)
 {
-	m_Vertices = std::move(vertices);
-	m_Indices = std::move(indices);
-	SetupMesh();
+	m_IndicesCount = indices.size();
+	if (lods.empty())
+	{
+		m_Lods = { { 0, static_cast<u32>(indices.size()), 0.0f } };
+	}
+	else
+	{
+		m_Lods.assign(lods.begin(), lods.end());
+	}
+	ComputeBoundingSphere(vertices);
+	SetupMesh(vertices, indices, format);
+	SetupMeshlets(meshlets);
 
 	m_IsInitialized = true;
 }
@@ -134,19 +373,90 @@ void Mesh::Delete()
 	}
 
 	m_VertexBuffer.Delete();
+	m_QuantizedVertexBuffer.Delete();
 	m_IndexBuffer.Delete();
 	m_VertexArray.Delete();
 	m_ModelMatrixBuffer.Delete();
+	DeleteMeshlets();
 
 	m_IsInitialized = false;
 }
 
-std::size_t Mesh::GetIndicesSize() const { return m_Indices.size(); }
+void Mesh::SetCpuData(const GeometryResidency residency, const MeshCpuData& cpuData)
+{
+	m_Residency = residency;
+	m_CpuData = cpuData;
+}
+
+GeometryResidency Mesh::GetResidency() const { return m_Residency; }
+
+const MeshCpuData& Mesh::GetCpuData() const { return m_CpuData; }
+
+void Mesh::Reupload()
+{
+	if (m_Residency != GeometryResidency::KeepForReupload)
+	{
+		spdlog::error("Reupload called on a mesh that did not keep its vertices");
+		return;
+	}
+
+	if (m_IsInitialized)
+	{
+		m_VertexBuffer.Delete();
+		m_QuantizedVertexBuffer.Delete();
+		m_IndexBuffer.Delete();
+		m_VertexArray.Delete();
+		m_ModelMatrixBuffer.Delete();
+	}
+
+	// Quantizing the same vertices again gives the same format
+	SetupMesh(m_CpuData.vertices, m_CpuData.indices, m_VertexFormat);
+	m_IsInitialized = true;
+}
+
+std::size_t Mesh::GetIndicesSize() const { return m_IndicesCount; }
+
+std::span<const MeshLod> Mesh::GetLods() const { return m_Lods; }
+
+const void* Mesh::GetLodIndicesOffset(const usize lodIndex) const
+{
+	const usize indexSize = GetIndexType() == GL_UNSIGNED_SHORT ? sizeof(u16) : sizeof(u32);
+	return reinterpret_cast<const void*>(static_cast<std::uintptr_t>(m_Lods[lodIndex].firstIndex * indexSize));
+}
+
+GLenum Mesh::GetIndexType() const { return m_IndexBuffer.GetType(); }
+
+GLuint Mesh::GetIndexBufferId() const { return m_IndexBuffer.GetId(); }
+
+GLuint Mesh::GetMeshletBuffer() const { return m_MeshletBuffer; }
+
+u32 Mesh::GetMeshletsCount() const { return m_MeshletsCount; }
+
+VertexFormat Mesh::GetVertexFormat() const { return m_VertexFormat; }
 
 void Mesh::Bind(const std::span<const glm::mat4> modelMatrices) const
 {
 	m_VertexArray.Bind();
-	m_ModelMatrixBuffer.SetData(modelMatrices);
+
+	if (m_VertexFormat == VertexFormat::Float)
+	{
+		m_ModelMatrixBuffer.SetData(modelMatrices);
+		return;
+	}
+
+	m_DequantizedModelMatrices.resize(modelMatrices.size());
+	std::ranges::transform(modelMatrices, m_DequantizedModelMatrices.begin(), [this](const glm::mat4& modelMatrix) {
+		return modelMatrix * m_DequantizationMatrix;
+	});
+	m_ModelMatrixBuffer.SetData(m_DequantizedModelMatrices);
+}
+
+void Mesh::SetModelMatrixDivisor(const u32 divisor) const
+{
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glVertexAttribDivisor(ModelMatrixAttributeLocation + i, divisor);
+	}
 }
 
 void Mesh::UnBind() const
@@ -156,21 +466,60 @@ void Mesh::UnBind() const
 	glActiveTexture(GL_TEXTURE0);
 }
 
-void Mesh::SetupMesh()
+void Mesh::SetupMesh(
+	const std::span<const Vertex> vertices, const std::span<const u32> indices, const VertexFormat format)
 {
 	m_VertexArray.Init();
 
-	m_VertexBuffer.Init(m_Vertices);
-	m_IndexBuffer.Init(m_Indices);
+	m_IndexBuffer.Init(indices);
 	m_ModelMatrixBuffer.Init();
 
-	VertexBufferLayout vertexLayout;
-	vertexLayout.Push<float>(3);
-	vertexLayout.Push<float>(3);
-	vertexLayout.Push<float>(2);
-	vertexLayout.Push<float>(3);
+	m_VertexFormat = format == VertexFormat::Quantized && CanQuantizeVertices(vertices) ? VertexFormat::Quantized
+																						  : VertexFormat::Float;
+	if (m_VertexFormat == VertexFormat::Quantized)
+	{
+		glm::vec3 min = vertices[0].position;
+		glm::vec3 max = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+
+		const glm::vec3 center = (min + max) * 0.5f;
+		const glm::vec3 halfExtents = (max - min) * 0.5f;
+		f32 halfExtent = std::max({ halfExtents.x, halfExtents.y, halfExtents.z });
+		if (halfExtent <= 0.0f)
+		{
+			halfExtent = 1.0f;
+		}
 
-	m_VertexArray.AddBuffer(m_VertexBuffer, vertexLayout);
+		m_DequantizationMatrix = glm::scale(glm::translate(glm::mat4{ 1.0f }, center), glm::vec3{ halfExtent });
+
+		const std::vector<QuantizedVertex> quantizedVertices = QuantizeVertices(vertices, center, halfExtent);
+		m_QuantizedVertexBuffer.Init(quantizedVertices);
+
+		VertexBufferLayout vertexLayout;
+		vertexLayout.Push(GL_SHORT, 4, true);
+		vertexLayout.Push(GL_INT_2_10_10_10_REV, 4, true);
+		vertexLayout.Push(GL_UNSIGNED_SHORT, 2, true);
+		vertexLayout.Push(GL_INT_2_10_10_10_REV, 4, true);
+
+		m_VertexArray.AddBuffer(m_QuantizedVertexBuffer, vertexLayout);
+	}
+	else
+	{
+		m_DequantizationMatrix = glm::mat4{ 1.0f };
+		m_VertexBuffer.Init(vertices);
+
+		VertexBufferLayout vertexLayout;
+		vertexLayout.Push<float>(3);
+		vertexLayout.Push<float>(3);
+		vertexLayout.Push<float>(2);
+		vertexLayout.Push<float>(3);
+
+		m_VertexArray.AddBuffer(m_VertexBuffer, vertexLayout);
+	}
 
 	VertexBufferLayout modelMatrixLayout;
 	modelMatrixLayout.Push<float>(4, 1);
@@ -180,6 +529,34 @@ void Mesh::SetupMesh()
 
 	m_VertexArray.AddBuffer(m_ModelMatrixBuffer, modelMatrixLayout);
 }
+
+void Mesh::SetupMeshlets(const std::span<const Meshlet> meshlets)
+{
+	if (meshlets.empty())
+	{
+		return;
+	}
+
+	glCreateBuffers(1, &m_MeshletBuffer);
+	glNamedBufferStorage(m_MeshletBuffer, static_cast<GLsizeiptr>(meshlets.size_bytes()), meshlets.data(), 0);
+	m_MeshletsCount = static_cast<u32>(meshlets.size());
+
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::VertexBuffer, meshlets.size_bytes());
+}
+
+void Mesh::DeleteMeshlets()
+{
+	if (m_MeshletBuffer == 0)
+	{
+		return;
+	}
+
+	GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::VertexBuffer, m_MeshletsCount * sizeof(Meshlet));
+	glDeleteBuffers(1, &m_MeshletBuffer);
+	m_MeshletBuffer = 0;
+	m_MeshletsCount = 0;
+}
+
 Mesh Mesh::CreateQuad()
 {
 	std::vector vertices = {
@@ -191,13 +568,46 @@ Mesh Mesh::CreateQuad()
 	std::vector<u32> indices = { 0, 1, 2, 1, 3, 2 };
 
 	Mesh mesh;
-	mesh.Init(std::move(vertices), std::move(indices));
+	mesh.Init(vertices, indices);
 
 	return mesh;
 }
 
 const VertexArray& Mesh::GetVertexArray() const { return m_VertexArray; }
 
+glm::vec3 Mesh::GetBoundingSphereCenter() const { return m_BoundingSphereCenter; }
+
+f32 Mesh::GetBoundingSphereRadius() const { return m_BoundingSphereRadius; }
+
+void Mesh::ComputeBoundingSphere(const std::span<const Vertex> vertices)
+{
+	if (vertices.empty())
+	{
+		m_BoundingSphereCenter = glm::vec3{ 0.0f };
+		m_BoundingSphereRadius = 0.0f;
+		return;
+	}
+
+	// The center of the bounding box is not the tightest center, but it is close enough and cheap to find
+	glm::vec3 min = vertices[0].position;
+	glm::vec3 max = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+
+	m_BoundingSphereCenter = (min + max) * 0.5f;
+
+	f32 squaredRadius = 0.0f;
+	for (const Vertex& vertex : vertices)
+	{
+		const glm::vec3 offset = vertex.position - m_BoundingSphereCenter;
+		squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+	}
+	m_BoundingSphereRadius = std::sqrt(squaredRadius);
+}
+
 Mesh Mesh::CreateCube()
 {
 	constexpr f32 size = 1.0f;
@@ -224,7 +634,7 @@ Mesh Mesh::CreateCube()
 	// clang-format on
 
 	Mesh mesh;
-	mesh.Init(std::move(vertices), std::move(indices));
+	mesh.Init(vertices, indices);
 
 	return mesh;
 }
@@ -255,7 +665,7 @@ Mesh Mesh::CreateInsideCube()
 	// clang-format on
 
 	Mesh mesh;
-	mesh.Init(std::move(vertices), std::move(indices));
+	mesh.Init(vertices, indices);
 
 	return mesh;
 }
@@ -325,8 +735,54 @@ Mesh Mesh::CreateUvSphere(f32 radius, u32 latitudes, u32 longitudes)
 	}
 
 	Mesh mesh;
-	mesh.Init(std::move(vertices), std::move(indices));
+	mesh.Init(vertices, indices);
 
 	return mesh;
 }
+
+bool CanQuantizeVertices(const std::span<const Vertex> vertices)
+{
+	if (vertices.empty())
+	{
+		return false;
+	}
+
+	return std::ranges::all_of(vertices, [](const Vertex& vertex) {
+		return vertex.texCoords.x >= 0.0f && vertex.texCoords.x <= 1.0f && vertex.texCoords.y >= 0.0f
+			   && vertex.texCoords.y <= 1.0f;
+	});
+}
+
+std::vector<QuantizedVertex> QuantizeVertices(
+	const std::span<const Vertex> vertices, const glm::vec3& center, const f32 halfExtent)
+{
+	const f32 inverseHalfExtent = 1.0f / halfExtent;
+
+	std::vector<QuantizedVertex> quantizedVertices{};
+	quantizedVertices.reserve(vertices.size());
+	for (const Vertex& vertex : vertices)
+	{
+		const glm::vec3 position = (vertex.position - center) * inverseHalfExtent;
+		quantizedVertices.push_back({
+			{ QuantizeSnorm16(position.x), QuantizeSnorm16(position.y), QuantizeSnorm16(position.z), 0 },
+			glm::packSnorm3x10_1x2(glm::vec4{ vertex.normal, 0.0f }),
+			{ QuantizeUnorm16(vertex.texCoords.x), QuantizeUnorm16(vertex.texCoords.y) },
+			glm::packSnorm3x10_1x2(glm::vec4{ vertex.tangent, 0.0f }),
+		});
+	}
+
+	return quantizedVertices;
+}
+
+i16 QuantizeSnorm16(const f32 value)
+{
+	constexpr f32 maxValue = 32767.0f;
+	return static_cast<i16>(std::round(std::clamp(value, -1.0f, 1.0f) * maxValue));
+}
+
+u16 QuantizeUnorm16(const f32 value)
+{
+	constexpr f32 maxValue = 65535.0f;
+	return static_cast<u16>(std::round(std::clamp(value, 0.0f, 1.0f) * maxValue));
+}
 }// namespace stw
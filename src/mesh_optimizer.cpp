@@ -0,0 +1,460 @@
+/**
+ * @file mesh_optimizer.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions that reorder the triangles and the vertices of a mesh to render it faster.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+export module mesh_optimizer;
+
+import number_types;
+import mesh;
+
+export namespace stw
+{
+/**
+ * Size of the FIFO post-transform cache that the optimizations and the ACMR assume. Most GPUs have a larger cache,
+ * and an order that is good for a small cache stays good for a larger one.
+ */
+constexpr u32 VertexCacheSize = 16;
+
+/**
+ * How much worse the vertex cache is allowed to become to reduce the overdraw. 1.05 accepts 5% more cache misses.
+ */
+constexpr f32 OverdrawCacheThreshold = 1.05f;
+
+struct MeshOptimizationStats
+{
+	/**
+	 * Average cache miss ratio, the number of transformed vertices per triangle. It is 3 without any reuse and 0.5 in
+	 * the best case.
+	 */
+	f32 acmrBefore = 0.0f;
+	f32 acmrAfter = 0.0f;
+	usize trianglesCount = 0;
+};
+
+/**
+ * Runs every optimization on a triangle mesh: vertex cache reordering, overdraw reordering, then vertex fetch
+ * reordering. The sizes of the arrays do not change.
+ * @param vertices Vertices of the mesh, they are reordered in place.
+ * @param indices Indices of the triangles of the mesh, they are reordered and remapped in place.
+ * @return The ACMR before and after the optimizations.
+ */
+MeshOptimizationStats OptimizeMesh(std::span<Vertex> vertices, std::span<u32> indices);
+
+/**
+ * Computes the average cache miss ratio of a triangle list with a FIFO cache.
+ * @param indices Indices of the triangles.
+ * @param verticesCount Number of vertices the indices refer to.
+ * @param cacheSize Number of vertices in the cache.
+ * @return The number of cache misses per triangle.
+ */
+f32 ComputeAcmr(std::span<const u32> indices, usize verticesCount, u32 cacheSize = VertexCacheSize);
+
+/**
+ * Reorders the triangles to reuse the post-transform vertex cache, with the Tipsify algorithm from
+ * "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab and Barczak).
+ * @param indices Indices of the triangles, reordered in place.
+ * @param verticesCount Number of vertices the indices refer to.
+ * @param cacheSize Number of vertices in the cache.
+ * @return The index of the first triangle of each cluster. A cluster starts each time the algorithm had to jump to
+ * a vertex that is not in the cache, so the clusters can be moved around without losing much cache reuse.
+ */
+std::vector<usize> OptimizeVertexCache(std::span<u32> indices, usize verticesCount, u32 cacheSize = VertexCacheSize);
+
+/**
+ * Reorders clusters of triangles so that the ones facing outwards from the center of the mesh are drawn first, which
+ * lets the depth test reject more of the hidden fragments.
+ * @param indices Indices of the triangles, already optimized for the vertex cache, reordered in place.
+ * @param vertices Vertices of the mesh.
+ * @param clusters Index of the first triangle of each cluster, as returned by OptimizeVertexCache. The clusters are
+ * split further where it does not hurt the vertex cache too much.
+ * @param threshold How much worse the vertex cache is allowed to become.
+ */
+void OptimizeOverdraw(std::span<u32> indices,
+	std::span<const Vertex> vertices,
+	std::span<const usize> clusters,
+	f32 threshold = OverdrawCacheThreshold);
+
+/**
+ * Reorders the vertices in the order the triangles first use them, so that the vertex fetch reads memory linearly.
+ * The vertices that no triangle uses are moved at the end.
+ * @param vertices Vertices of the mesh, reordered in place.
+ * @param indices Indices of the triangles, remapped in place.
+ */
+void OptimizeVertexFetch(std::span<Vertex> vertices, std::span<u32> indices);
+
+/**
+ * FIFO post-transform cache, used to count the cache misses of a triangle order.
+ */
+class VertexCacheSimulator
+{
+public:
+	VertexCacheSimulator(usize verticesCount, u32 cacheSize);
+
+	/**
+	 * Transforms a vertex if it is not in the cache.
+	 * @return True if the vertex was not in the cache.
+	 */
+	bool Access(u32 vertex);
+	void Reset();
+
+private:
+	std::vector<u32> m_InsertionTimes;
+	u32 m_CacheSize;
+	u32 m_Time;
+};
+
+MeshOptimizationStats OptimizeMesh(const std::span<Vertex> vertices, const std::span<u32> indices)
+{
+	MeshOptimizationStats stats{};
+	stats.trianglesCount = indices.size() / 3;
+	stats.acmrBefore = ComputeAcmr(indices, vertices.size());
+
+	const std::vector<usize> clusters = OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices, clusters);
+	OptimizeVertexFetch(vertices, indices);
+
+	stats.acmrAfter = ComputeAcmr(indices, vertices.size());
+
+	return stats;
+}
+
+f32 ComputeAcmr(const std::span<const u32> indices, const usize verticesCount, const u32 cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	VertexCacheSimulator cache{ verticesCount, cacheSize };
+
+	usize missesCount = 0;
+	for (const u32 index : indices)
+	{
+		missesCount += cache.Access(index) ? 1 : 0;
+	}
+
+	return static_cast<f32>(missesCount) / static_cast<f32>(indices.size() / 3);
+}
+
+std::vector<usize> OptimizeVertexCache(const std::span<u32> indices, const usize verticesCount, const u32 cacheSize)
+{
+	const usize trianglesCount = indices.size() / 3;
+	std::vector<usize> clusters{};
+	if (trianglesCount == 0)
+	{
+		return clusters;
+	}
+
+	// Triangles that use each vertex, stored as one array with the offset of each vertex
+	std::vector<u32> liveTrianglesCounts(verticesCount, 0);
+	for (const u32 index : indices)
+	{
+		liveTrianglesCounts[index]++;
+	}
+
+	std::vector<usize> adjacencyOffsets(verticesCount + 1, 0);
+	std::inclusive_scan(liveTrianglesCounts.begin(), liveTrianglesCounts.end(), adjacencyOffsets.begin() + 1);
+
+	std::vector<u32> adjacency(indices.size());
+	std::vector<usize> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (usize i = 0; i < indices.size(); i++)
+	{
+		adjacency[adjacencyFill[indices[i]]++] = static_cast<u32>(i / 3);
+	}
+
+	std::vector<u32> cacheTimes(verticesCount, 0);
+	std::vector<bool> isTriangleEmitted(trianglesCount, false);
+	std::vector<u32> deadEnds{};
+	std::vector<u32> candidates{};
+	std::vector<u32> output{};
+	output.reserve(indices.size());
+
+	u32 time = cacheSize + 1;
+	usize cursor = 0;
+
+	// Finds a vertex that still has triangles when every candidate is exhausted, this breaks the cache locality
+	const auto skipDeadEnd = [&]() -> i64 {
+		while (!deadEnds.empty())
+		{
+			const u32 vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTrianglesCounts[vertex] > 0)
+			{
+				return vertex;
+			}
+		}
+
+		while (cursor < verticesCount)
+		{
+			cursor++;
+			if (liveTrianglesCounts[cursor - 1] > 0)
+			{
+				return static_cast<i64>(cursor - 1);
+			}
+		}
+
+		return -1;
+	};
+
+	i64 fanningVertex = skipDeadEnd();
+	clusters.push_back(0);
+	while (fanningVertex >= 0)
+	{
+		candidates.clear();
+
+		const auto vertex = static_cast<usize>(fanningVertex);
+		for (usize i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+		{
+			const u32 triangle = adjacency[i];
+			if (isTriangleEmitted[triangle])
+			{
+				continue;
+			}
+
+			for (usize corner = 0; corner < 3; corner++)
+			{
+				const u32 triangleVertex = indices[triangle * 3 + corner];
+				output.push_back(triangleVertex);
+				deadEnds.push_back(triangleVertex);
+				candidates.push_back(triangleVertex);
+				liveTrianglesCounts[triangleVertex]--;
+
+				if (time - cacheTimes[triangleVertex] > cacheSize)
+				{
+					cacheTimes[triangleVertex] = time;
+					time++;
+				}
+			}
+
+			isTriangleEmitted[triangle] = true;
+		}
+
+		// The next fanning vertex is the candidate that will stay in the cache the longest once its triangles are
+		// emitted
+		fanningVertex = -1;
+		i64 bestPriority = -1;
+		for (const u32 candidate : candidates)
+		{
+			if (liveTrianglesCounts[candidate] == 0)
+			{
+				continue;
+			}
+
+			i64 priority = 0;
+			if (time - cacheTimes[candidate] + 2 * liveTrianglesCounts[candidate] <= cacheSize)
+			{
+				priority = time - cacheTimes[candidate];
+			}
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				fanningVertex = candidate;
+			}
+		}
+
+		if (fanningVertex < 0)
+		{
+			fanningVertex = skipDeadEnd();
+			if (fanningVertex >= 0 && output.size() < indices.size())
+			{
+				clusters.push_back(output.size() / 3);
+			}
+		}
+	}
+
+	std::ranges::copy(output, indices.begin());
+
+	return clusters;
+}
+
+void OptimizeOverdraw(const std::span<u32> indices,
+	const std::span<const Vertex> vertices,
+	const std::span<const usize> clusters,
+	const f32 threshold)
+{
+	const usize trianglesCount = indices.size() / 3;
+	if (clusters.size() == 0 || trianglesCount == 0)
+	{
+		return;
+	}
+
+	VertexCacheSimulator cache{ vertices.size(), VertexCacheSize };
+
+	// The hard clusters are split again wherever the cache misses from the start of the new cluster stay close to the
+	// ones of the whole cluster, smaller clusters give more freedom to the sort
+	std::vector<usize> softClusters{};
+	for (usize clusterIndex = 0; clusterIndex < clusters.size(); clusterIndex++)
+	{
+		const usize start = clusters[clusterIndex];
+		const usize end = clusterIndex + 1 < clusters.size() ? clusters[clusterIndex + 1] : trianglesCount;
+
+		cache.Reset();
+		usize clusterMissesCount = 0;
+		for (usize i = start * 3; i < end * 3; i++)
+		{
+			clusterMissesCount += cache.Access(indices[i]) ? 1 : 0;
+		}
+		const f32 thresholdAcmr = static_cast<f32>(clusterMissesCount) / static_cast<f32>(end - start) * threshold;
+
+		cache.Reset();
+		usize softStart = start;
+		usize missesCount = 0;
+		softClusters.push_back(start);
+		for (usize triangle = start; triangle < end; triangle++)
+		{
+			for (usize corner = 0; corner < 3; corner++)
+			{
+				missesCount += cache.Access(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+
+			const f32 acmr = static_cast<f32>(missesCount) / static_cast<f32>(triangle + 1 - softStart);
+			if (triangle + 1 < end && acmr <= thresholdAcmr)
+			{
+				softClusters.push_back(triangle + 1);
+				softStart = triangle + 1;
+				missesCount = 0;
+				cache.Reset();
+			}
+		}
+	}
+
+	glm::vec3 meshCentroid{ 0.0f };
+	for (const u32 index : indices)
+	{
+		meshCentroid += vertices[index].position;
+	}
+	meshCentroid /= static_cast<f32>(indices.size());
+
+	struct ClusterSortData
+	{
+		usize start;
+		usize end;
+		f32 key;
+	};
+
+	std::vector<ClusterSortData> sortData{};
+	sortData.reserve(softClusters.size());
+	for (usize clusterIndex = 0; clusterIndex < softClusters.size(); clusterIndex++)
+	{
+		const usize start = softClusters[clusterIndex];
+		const usize end = clusterIndex + 1 < softClusters.size() ? softClusters[clusterIndex + 1] : trianglesCount;
+
+		// Centroid and normal weighted by the area of the triangles, the cross product is twice the area
+		glm::vec3 centroid{ 0.0f };
+		glm::vec3 normal{ 0.0f };
+		f32 area = 0.0f;
+		for (usize triangle = start; triangle < end; triangle++)
+		{
+			const glm::vec3& a = vertices[indices[triangle * 3]].position;
+			const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+			const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+			const glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+			const f32 triangleArea = glm::length(triangleNormal);
+
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		f32 key = 0.0f;
+		const f32 normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+		{
+			key = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+		}
+
+		sortData.push_back({ start, end, key });
+	}
+
+	// The clusters that are the most outwards facing occlude the others, so they are drawn first
+	std::ranges::stable_sort(sortData, std::ranges::greater{}, &ClusterSortData::key);
+
+	std::vector<u32> output{};
+	output.reserve(indices.size());
+	for (const ClusterSortData& cluster : sortData)
+	{
+		output.insert(output.end(), indices.begin() + static_cast<std::ptrdiff_t>(cluster.start * 3),
+			indices.begin() + static_cast<std::ptrdiff_t>(cluster.end * 3));
+	}
+
+	std::ranges::copy(output, indices.begin());
+}
+
+void OptimizeVertexFetch(const std::span<Vertex> vertices, const std::span<u32> indices)
+{
+	constexpr u32 unmapped = ~0u;
+	std::vector<u32> remap(vertices.size(), unmapped);
+
+	u32 nextVertex = 0;
+	for (u32& index : indices)
+	{
+		if (remap[index] == unmapped)
+		{
+			remap[index] = nextVertex;
+			nextVertex++;
+		}
+
+		index = remap[index];
+	}
+
+	for (u32& newIndex : remap)
+	{
+		if (newIndex == unmapped)
+		{
+			newIndex = nextVertex;
+			nextVertex++;
+		}
+	}
+
+	std::vector<Vertex> reorderedVertices(vertices.size());
+	for (usize i = 0; i < vertices.size(); i++)
+	{
+		reorderedVertices[remap[i]] = vertices[i];
+	}
+
+	std::ranges::copy(reorderedVertices, vertices.begin());
+}
+
+VertexCacheSimulator::VertexCacheSimulator(const usize verticesCount, const u32 cacheSize)
+	: m_InsertionTimes(verticesCount, 0), m_CacheSize(cacheSize), m_Time(cacheSize + 1)
+{
+}
+
+bool VertexCacheSimulator::Access(const u32 vertex)
+{
+	// A vertex is still in the FIFO if fewer than cacheSize vertices were inserted after it
+	if (m_Time - m_InsertionTimes[vertex] > m_CacheSize)
+	{
+		m_InsertionTimes[vertex] = m_Time;
+		m_Time++;
+		return true;
+	}
+
+	return false;
+}
+
+void VertexCacheSimulator::Reset()
+{
+	// Moving the time forward evicts every vertex without touching the whole array
+	m_Time += m_CacheSize + 1;
+}
+}// namespace stw
@@ -0,0 +1,488 @@
+/**
+ * @file mesh_simplifier.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the edge collapse simplification that generates the levels of detail of the meshes.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+export module mesh_simplifier;
+
+import number_types;
+import mesh;
+import mesh_optimizer;
+
+export namespace stw
+{
+/**
+ * Number of levels of detail of a mesh, including the full detail one.
+ */
+constexpr usize MaxLodsCount = 4;
+
+/**
+ * Each level of detail aims for this ratio of the triangles of the previous level.
+ */
+constexpr f32 LodTrianglesRatio = 0.5f;
+
+/**
+ * A level is dropped if it does not remove at least this ratio of the triangles of the previous level, as it would
+ * cost memory without making the rendering faster.
+ */
+constexpr f32 LodMinReduction = 0.15f;
+
+/**
+ * Meshes with fewer triangles than this are not simplified further.
+ */
+constexpr usize LodMinTrianglesCount = 64;
+
+/**
+ * Largest error allowed for a collapse, relative to the bounding sphere radius of the mesh. The selection in the
+ * renderer decides at which distance this error becomes invisible.
+ */
+constexpr f32 LodMaxRelativeError = 0.1f;
+
+struct SimplifiedIndices
+{
+	std::vector<u32> indices;
+	/**
+	 * Error of the most expensive collapse, as a distance in model space.
+	 */
+	f32 error = 0.0f;
+};
+
+/**
+ * Quadric error of Garland and Heckbert, the sum of the squared distances to a set of planes weighted by their area.
+ * The symmetric matrix is stored as its upper triangle.
+ */
+struct Quadric
+{
+	f64 a00 = 0.0;
+	f64 a01 = 0.0;
+	f64 a02 = 0.0;
+	f64 a11 = 0.0;
+	f64 a12 = 0.0;
+	f64 a22 = 0.0;
+	f64 b0 = 0.0;
+	f64 b1 = 0.0;
+	f64 b2 = 0.0;
+	f64 c = 0.0;
+	f64 weight = 0.0;
+
+	/**
+	 * Adds the plane of a triangle to the quadric, weighted by the area of the triangle.
+	 */
+	void AddTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2);
+	void Add(const Quadric& other);
+
+	/**
+	 * Computes the mean squared distance between a point and the planes of the quadric.
+	 */
+	[[nodiscard]] f64 Evaluate(const glm::vec3& point) const;
+};
+
+/**
+ * Simplifies a triangle mesh by collapsing the edges with the lowest quadric error first. The vertices are never
+ * moved, each collapse merges a vertex into one of its neighbours, so every level of detail can share the vertex
+ * buffer of the mesh. The vertices on a border of the mesh or on a seam (the same position with other attributes) are
+ * never collapsed, so the simplified mesh does not open holes or stretch the texture coordinates.
+ * @param vertices Vertices of the mesh.
+ * @param indices Indices of the triangles to simplify.
+ * @param targetIndicesCount The simplification stops once the mesh has this number of indices or fewer.
+ * @param maxError The simplification stops before a collapse with a larger error, as a distance in model space.
+ * @return The indices of the simplified triangles and the error of the simplification.
+ */
+SimplifiedIndices SimplifyMesh(std::span<const Vertex> vertices,
+	std::span<const u32> indices,
+	usize targetIndicesCount,
+	f32 maxError);
+
+/**
+ * Generates the levels of detail of a mesh. The indices of each level are appended after the ones of the mesh, and
+ * are reordered for the vertex cache.
+ * @param vertices Vertices of the mesh.
+ * @param indices Indices of the triangles of the mesh, the indices of the levels of detail are appended to it.
+ * @return The levels of detail, the first one is the full detail mesh.
+ */
+std::vector<MeshLod> GenerateLods(std::span<const Vertex> vertices, std::vector<u32>& indices);
+
+void Quadric::AddTriangle(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	const glm::dvec3 cross = glm::cross(glm::dvec3{ p1 - p0 }, glm::dvec3{ p2 - p0 });
+	const f64 length = glm::length(cross);
+	if (length <= 0.0)
+	{
+		return;
+	}
+
+	const f64 area = length * 0.5;
+	const glm::dvec3 normal = cross / length;
+	const f64 distance = -glm::dot(normal, glm::dvec3{ p0 });
+
+	a00 += area * normal.x * normal.x;
+	a01 += area * normal.x * normal.y;
+	a02 += area * normal.x * normal.z;
+	a11 += area * normal.y * normal.y;
+	a12 += area * normal.y * normal.z;
+	a22 += area * normal.z * normal.z;
+	b0 += area * normal.x * distance;
+	b1 += area * normal.y * distance;
+	b2 += area * normal.z * distance;
+	c += area * distance * distance;
+	weight += area;
+}
+
+void Quadric::Add(const Quadric& other)
+{
+	a00 += other.a00;
+	a01 += other.a01;
+	a02 += other.a02;
+	a11 += other.a11;
+	a12 += other.a12;
+	a22 += other.a22;
+	b0 += other.b0;
+	b1 += other.b1;
+	b2 += other.b2;
+	c += other.c;
+	weight += other.weight;
+}
+
+f64 Quadric::Evaluate(const glm::vec3& point) const
+{
+	if (weight <= 0.0)
+	{
+		return 0.0;
+	}
+
+	const f64 x = point.x;
+	const f64 y = point.y;
+	const f64 z = point.z;
+
+	// pᵀAp + 2bᵀp + c
+	const f64 error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+					  + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+
+	return std::max(error, 0.0) / weight;
+}
+
+SimplifiedIndices SimplifyMesh(const std::span<const Vertex> vertices,
+	const std::span<const u32> indices,
+	const usize targetIndicesCount,
+	const f32 maxError)
+{
+	SimplifiedIndices result{ { indices.begin(), indices.end() }, 0.0f };
+	std::vector<u32>& triangles = result.indices;
+	if (triangles.size() <= targetIndicesCount)
+	{
+		return result;
+	}
+
+	// The vertices at the same position are welded, so that the topology is not split by the seams of the attributes
+	std::vector<u32> sortedVertices{ triangles.begin(), triangles.end() };
+	std::ranges::sort(sortedVertices);
+	const auto duplicates = std::ranges::unique(sortedVertices);
+	sortedVertices.erase(duplicates.begin(), duplicates.end());
+	std::ranges::sort(sortedVertices, [&vertices](const u32 a, const u32 b) {
+		const glm::vec3& positionA = vertices[a].position;
+		const glm::vec3& positionB = vertices[b].position;
+		if (positionA.x != positionB.x)
+		{
+			return positionA.x < positionB.x;
+		}
+		if (positionA.y != positionB.y)
+		{
+			return positionA.y < positionB.y;
+		}
+		return positionA.z < positionB.z;
+	});
+
+	std::vector<u32> weldedVertices(vertices.size());
+	std::iota(weldedVertices.begin(), weldedVertices.end(), 0u);
+	std::vector<bool> isLocked(vertices.size(), false);
+	for (usize i = 1; i < sortedVertices.size(); i++)
+	{
+		const u32 previous = sortedVertices[i - 1];
+		const u32 current = sortedVertices[i];
+		if (vertices[previous].position == vertices[current].position)
+		{
+			weldedVertices[current] = weldedVertices[previous];
+			isLocked[weldedVertices[current]] = true;
+			isLocked[current] = true;
+		}
+	}
+
+	// An edge that is not shared by exactly two triangles is on a border or is not manifold
+	std::vector<std::pair<u32, u32>> edges{};
+	edges.reserve(triangles.size());
+	for (usize i = 0; i < triangles.size(); i += 3)
+	{
+		for (usize corner = 0; corner < 3; corner++)
+		{
+			const u32 a = weldedVertices[triangles[i + corner]];
+			const u32 b = weldedVertices[triangles[i + (corner + 1) % 3]];
+			edges.emplace_back(std::min(a, b), std::max(a, b));
+		}
+	}
+	std::ranges::sort(edges);
+	for (usize i = 0; i < edges.size();)
+	{
+		usize end = i + 1;
+		while (end < edges.size() && edges[end] == edges[i])
+		{
+			end++;
+		}
+
+		if (end - i != 2)
+		{
+			isLocked[edges[i].first] = true;
+			isLocked[edges[i].second] = true;
+		}
+		i = end;
+	}
+
+	std::vector<Quadric> quadrics(vertices.size());
+	for (usize i = 0; i < triangles.size(); i += 3)
+	{
+		Quadric triangleQuadric{};
+		triangleQuadric.AddTriangle(vertices[triangles[i]].position,
+			vertices[triangles[i + 1]].position,
+			vertices[triangles[i + 2]].position);
+
+		for (usize corner = 0; corner < 3; corner++)
+		{
+			quadrics[weldedVertices[triangles[i + corner]]].Add(triangleQuadric);
+		}
+	}
+
+	struct Collapse
+	{
+		u32 source;
+		u32 target;
+		f64 error;
+	};
+
+	const f64 maxSquaredError = static_cast<f64>(maxError) * static_cast<f64>(maxError);
+	f64 largestError = 0.0;
+
+	std::vector<Collapse> collapses{};
+	std::vector<u32> remap(vertices.size());
+	std::vector<bool> isTouched(vertices.size());
+	std::vector<u32> adjacencyOffsets(vertices.size() + 1);
+	std::vector<u32> adjacency{};
+
+	// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, so that the collapses of a pass do
+	// not invalidate each other
+	while (triangles.size() > targetIndicesCount)
+	{
+		std::ranges::fill(adjacencyOffsets, 0u);
+		for (const u32 index : triangles)
+		{
+			adjacencyOffsets[index + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+		adjacency.resize(triangles.size());
+		std::vector<u32> adjacencyFill{ adjacencyOffsets.begin(), adjacencyOffsets.end() - 1 };
+		for (usize i = 0; i < triangles.size(); i++)
+		{
+			adjacency[adjacencyFill[triangles[i]]++] = static_cast<u32>(i / 3);
+		}
+
+		// A collapsed vertex is not a seam, so it is used by its triangles with its own index and can be merged into
+		// the vertex that the triangles of the edge use
+		collapses.clear();
+		for (usize i = 0; i < triangles.size(); i += 3)
+		{
+			for (usize corner = 0; corner < 3; corner++)
+			{
+				const u32 a = triangles[i + corner];
+				const u32 b = triangles[i + (corner + 1) % 3];
+
+				for (const auto [source, target] : { std::pair{ a, b }, std::pair{ b, a } })
+				{
+					if (isLocked[source])
+					{
+						continue;
+					}
+
+					Quadric quadric = quadrics[source];
+					quadric.Add(quadrics[weldedVertices[target]]);
+					collapses.push_back({ source, target, quadric.Evaluate(vertices[target].position) });
+				}
+			}
+		}
+
+		std::ranges::sort(collapses, {}, &Collapse::error);
+
+		std::iota(remap.begin(), remap.end(), 0u);
+		std::ranges::fill(isTouched, false);
+
+		const usize trianglesToRemove = (triangles.size() - targetIndicesCount) / 3;
+		const usize maxCollapsesCount = std::max<usize>(trianglesToRemove / 2, 1);
+		usize collapsesCount = 0;
+
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > maxSquaredError || collapsesCount >= maxCollapsesCount)
+			{
+				break;
+			}
+
+			const u32 weldedTarget = weldedVertices[collapse.target];
+			if (isTouched[collapse.source] || isTouched[weldedTarget])
+			{
+				continue;
+			}
+
+			const std::span sourceTriangles{ adjacency.begin() + adjacencyOffsets[collapse.source],
+				adjacency.begin() + adjacencyOffsets[collapse.source + 1] };
+
+			// The collapse is rejected if it flips a triangle that stays
+			bool isFlipping = false;
+			for (const u32 triangle : sourceTriangles)
+			{
+				const u32* corners = &triangles[static_cast<usize>(triangle) * 3];
+				if (weldedVertices[corners[0]] == weldedTarget || weldedVertices[corners[1]] == weldedTarget
+					|| weldedVertices[corners[2]] == weldedTarget)
+				{
+					continue;
+				}
+
+				std::array<glm::vec3, 3> positions{};
+				std::array<glm::vec3, 3> collapsedPositions{};
+				for (usize corner = 0; corner < 3; corner++)
+				{
+					positions[corner] = vertices[corners[corner]].position;
+					collapsedPositions[corner] = corners[corner] == collapse.source
+													 ? vertices[collapse.target].position
+													 : positions[corner];
+				}
+
+				const glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+				const glm::vec3 collapsedNormal = glm::cross(
+					collapsedPositions[1] - collapsedPositions[0], collapsedPositions[2] - collapsedPositions[0]);
+				if (glm::dot(normal, collapsedNormal) <= 0.0f)
+				{
+					isFlipping = true;
+					break;
+				}
+			}
+
+			if (isFlipping)
+			{
+				continue;
+			}
+
+			for (const u32 triangle : sourceTriangles)
+			{
+				for (usize corner = 0; corner < 3; corner++)
+				{
+					isTouched[weldedVertices[triangles[static_cast<usize>(triangle) * 3 + corner]]] = true;
+				}
+			}
+			isTouched[weldedTarget] = true;
+
+			remap[collapse.source] = collapse.target;
+			quadrics[weldedTarget].Add(quadrics[collapse.source]);
+			largestError = std::max(largestError, collapse.error);
+			collapsesCount++;
+		}
+
+		if (collapsesCount == 0)
+		{
+			break;
+		}
+
+		// Remaps the collapsed vertices and removes the triangles that became degenerate
+		usize writeIndex = 0;
+		for (usize i = 0; i < triangles.size(); i += 3)
+		{
+			const u32 a = remap[triangles[i]];
+			const u32 b = remap[triangles[i + 1]];
+			const u32 c = remap[triangles[i + 2]];
+			if (weldedVertices[a] == weldedVertices[b] || weldedVertices[b] == weldedVertices[c]
+				|| weldedVertices[a] == weldedVertices[c])
+			{
+				continue;
+			}
+
+			triangles[writeIndex] = a;
+			triangles[writeIndex + 1] = b;
+			triangles[writeIndex + 2] = c;
+			writeIndex += 3;
+		}
+		triangles.resize(writeIndex);
+	}
+
+	result.error = static_cast<f32>(std::sqrt(largestError));
+
+	return result;
+}
+
+std::vector<MeshLod> GenerateLods(const std::span<const Vertex> vertices, std::vector<u32>& indices)
+{
+	std::vector<MeshLod> lods{ { 0, static_cast<u32>(indices.size()), 0.0f } };
+	if (vertices.empty() || indices.size() / 3 < LodMinTrianglesCount * 2)
+	{
+		return lods;
+	}
+
+	glm::vec3 min = vertices[0].position;
+	glm::vec3 max = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+	const f32 radius = glm::length(max - min) * 0.5f;
+	const f32 maxError = radius * LodMaxRelativeError;
+
+	// Each level is simplified from the previous one, which is faster and keeps the levels similar to each other
+	std::vector<u32> previousIndices{ indices.begin(), indices.end() };
+	f32 previousError = 0.0f;
+	while (lods.size() < MaxLodsCount)
+	{
+		const usize previousTrianglesCount = previousIndices.size() / 3;
+		const auto targetTrianglesCount =
+			static_cast<usize>(static_cast<f32>(previousTrianglesCount) * LodTrianglesRatio);
+		if (targetTrianglesCount < LodMinTrianglesCount)
+		{
+			break;
+		}
+
+		SimplifiedIndices simplified = SimplifyMesh(vertices, previousIndices, targetTrianglesCount * 3, maxError);
+		const usize trianglesCount = simplified.indices.size() / 3;
+		if (static_cast<f32>(trianglesCount) > static_cast<f32>(previousTrianglesCount) * (1.0f - LodMinReduction))
+		{
+			break;
+		}
+
+		OptimizeVertexCache(simplified.indices, vertices.size());
+
+		// The quadrics start over at each level, so the errors of the levels add up
+		const f32 error = previousError + simplified.error;
+		lods.push_back({ static_cast<u32>(indices.size()), static_cast<u32>(simplified.indices.size()), error });
+		indices.insert(indices.end(), simplified.indices.begin(), simplified.indices.end());
+
+		previousIndices = std::move(simplified.indices);
+		previousError = error;
+	}
+
+	return lods;
+}
+}// namespace stw
@@ -0,0 +1,202 @@
+/**
+ * @file meshlet_builder.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions that split the meshes in meshlets for the GPU culling.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+export module meshlet_builder;
+
+import number_types;
+import mesh;
+
+export namespace stw
+{
+/**
+ * Maximum number of unique vertices in a meshlet.
+ */
+constexpr usize MeshletMaxVertices = 64;
+
+/**
+ * Maximum number of triangles in a meshlet.
+ */
+constexpr usize MeshletMaxTriangles = 124;
+
+/**
+ * Under this dot product between the cone axis and a normal of the meshlet, the normals are too spread for the cone
+ * to ever cull the meshlet, so it is disabled.
+ */
+constexpr f32 MeshletMinConeSpread = 0.1f;
+
+/**
+ * Splits a range of triangles in meshlets. The triangles are scanned in order and a new meshlet is started when the
+ * current one is full, so the triangles must already be sorted for the vertex cache to get tight meshlets.
+ * @param vertices Vertices of the mesh.
+ * @param indices Indices of the mesh.
+ * @param firstIndex Index of the first triangle to split.
+ * @param indicesCount Number of indices to split.
+ * @return The meshlets, which reference the indices in place.
+ */
+std::vector<Meshlet> BuildMeshlets(
+	std::span<const Vertex> vertices, std::span<const u32> indices, u32 firstIndex, u32 indicesCount);
+
+/**
+ * Computes the bounding sphere and the normal cone of the triangles of a meshlet.
+ * @param vertices Vertices of the mesh.
+ * @param indices Indices of the mesh.
+ * @param firstIndex Index of the first triangle of the meshlet.
+ * @param trianglesCount Number of triangles of the meshlet.
+ * @return The meshlet.
+ */
+Meshlet ComputeMeshletBounds(
+	std::span<const Vertex> vertices, std::span<const u32> indices, u32 firstIndex, u32 trianglesCount);
+
+std::vector<Meshlet> BuildMeshlets(const std::span<const Vertex> vertices,
+	const std::span<const u32> indices,
+	const u32 firstIndex,
+	const u32 indicesCount)
+{
+	std::vector<Meshlet> meshlets{};
+
+	// The meshlet that last used each vertex, to count the unique vertices of the current meshlet without a set
+	constexpr u32 noMeshlet = std::numeric_limits<u32>::max();
+	std::vector<u32> vertexMeshlets(vertices.size(), noMeshlet);
+
+	const auto countNewVertices = [indices, &vertexMeshlets, &meshlets](const u32 triangleIndex) {
+		const auto currentMeshlet = static_cast<u32>(meshlets.size());
+		usize count = 0;
+		for (u32 j = 0; j < 3; j++)
+		{
+			const u32 index = indices[triangleIndex + j];
+			const bool isRepeated = (j > 0 && index == indices[triangleIndex])
+									|| (j == 2 && index == indices[triangleIndex + 1]);
+			if (vertexMeshlets[index] != currentMeshlet && !isRepeated)
+			{
+				count++;
+			}
+		}
+
+		return count;
+	};
+
+	u32 meshletFirstIndex = firstIndex;
+	usize meshletTrianglesCount = 0;
+	usize meshletVerticesCount = 0;
+	const u32 endIndex = firstIndex + indicesCount;
+	for (u32 i = firstIndex; i + 2 < endIndex; i += 3)
+	{
+		usize newVerticesCount = countNewVertices(i);
+		if (meshletTrianglesCount == MeshletMaxTriangles
+			|| meshletVerticesCount + newVerticesCount > MeshletMaxVertices)
+		{
+			meshlets.push_back(ComputeMeshletBounds(
+				vertices, indices, meshletFirstIndex, static_cast<u32>(meshletTrianglesCount)));
+			meshletFirstIndex = i;
+			meshletTrianglesCount = 0;
+			meshletVerticesCount = 0;
+			newVerticesCount = countNewVertices(i);
+		}
+
+		for (u32 j = 0; j < 3; j++)
+		{
+			vertexMeshlets[indices[i + j]] = static_cast<u32>(meshlets.size());
+		}
+
+		meshletVerticesCount += newVerticesCount;
+		meshletTrianglesCount++;
+	}
+
+	if (meshletTrianglesCount > 0)
+	{
+		meshlets.push_back(
+			ComputeMeshletBounds(vertices, indices, meshletFirstIndex, static_cast<u32>(meshletTrianglesCount)));
+	}
+
+	return meshlets;
+}
+
+Meshlet ComputeMeshletBounds(const std::span<const Vertex> vertices,
+	const std::span<const u32> indices,
+	const u32 firstIndex,
+	const u32 trianglesCount)
+{
+	const std::span<const u32> meshletIndices = indices.subspan(firstIndex, static_cast<usize>(trianglesCount) * 3);
+
+	// Same approximation as the bounding sphere of the meshes, centered on the bounding box
+	glm::vec3 min = vertices[meshletIndices[0]].position;
+	glm::vec3 max = min;
+	for (const u32 index : meshletIndices)
+	{
+		min = glm::min(min, vertices[index].position);
+		max = glm::max(max, vertices[index].position);
+	}
+
+	const glm::vec3 center = (min + max) * 0.5f;
+	f32 squaredRadius = 0.0f;
+	for (const u32 index : meshletIndices)
+	{
+		const glm::vec3 offset = vertices[index].position - center;
+		squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+	}
+
+	// The normals of the triangles are computed from their winding, the vertex normals can be smoothed over the edges
+	std::vector<glm::vec3> normals{};
+	normals.reserve(trianglesCount);
+	glm::vec3 axis{ 0.0f };
+	for (usize i = 0; i < meshletIndices.size(); i += 3)
+	{
+		const glm::vec3& position0 = vertices[meshletIndices[i]].position;
+		const glm::vec3 normal = glm::cross(vertices[meshletIndices[i + 1]].position - position0,
+			vertices[meshletIndices[i + 2]].position - position0);
+		const f32 length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+	}
+
+	Meshlet meshlet{ center, std::sqrt(squaredRadius), glm::vec3{ 0.0f }, 1.0f, firstIndex, trianglesCount, {} };
+
+	const f32 axisLength = glm::length(axis);
+	if (axisLength <= 0.0f)
+	{
+		return meshlet;
+	}
+
+	axis /= axisLength;
+	f32 minDot = 1.0f;
+	for (const glm::vec3& normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+
+	if (minDot <= MeshletMinConeSpread)
+	{
+		return meshlet;
+	}
+
+	// The cutoff is the sine of the half angle of the cone, which is the cosine of the angle between the axis and the
+	// directions that see the edge of the cone
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+
+	return meshlet;
+}
+}// namespace stw
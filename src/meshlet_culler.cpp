@@ -0,0 +1,384 @@
+/**
+ * @file meshlet_culler.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the MeshletCuller class that culls the meshlets of the meshes on the GPU.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <format>
+#include <optional>
+#include <span>
+
+#include <glad/glad.h>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <spdlog/spdlog.h>
+
+export module meshlet_culler;
+
+import number_types;
+import consts;
+import mesh;
+import pipeline;
+import gpu_memory;
+
+export namespace stw
+{
+/**
+ * Number of meshlets handled by a work group of the culling shader.
+ */
+constexpr u32 MeshletCullingGroupSize = 64;
+
+/**
+ * Maximum number of frustums a meshlet can be tested against in one pass, one per cascade of the shadow map.
+ */
+constexpr usize MeshletCullingMaxFrustums = ShadowMapNumCascades;
+
+constexpr usize FrustumPlanesCount = 6;
+
+/**
+ * Under this number of meshlets, a mesh is drawn whole instead of being culled.
+ */
+constexpr u32 MeshletCullingMinMeshletsCount = 16;
+
+/**
+ * Command read by glDrawElementsIndirect.
+ */
+struct DrawElementsIndirectCommand
+{
+	u32 count;
+	u32 instanceCount;
+	u32 firstIndex;
+	i32 baseVertex;
+	u32 baseInstance;
+};
+
+/**
+ * Culls the meshlets of the meshes in a compute shader, against the view frustums and with their normal cones, and
+ * appends the triangles of the visible meshlets to an index stream that is drawn with glDrawElementsIndirect.
+ *
+ * A pass starts with one of the Begin functions, then every mesh of the pass is culled, then EndCulling waits for the
+ * culling and the meshes are drawn. Each pass needs its own culler, since the draws of a pass read the buffers that
+ * the next culling writes.
+ */
+class MeshletCuller
+{
+public:
+	void Init();
+	void Delete();
+
+	/**
+	 * Starts a pass seen from a perspective camera.
+	 * @param viewProjectionMatrix View projection matrix of the camera.
+	 * @param viewPosition Position of the camera, in world space.
+	 * @param isConeCullingEnabled If the meshlets that only have back faces should be culled, only valid when the
+	 * back faces are culled by OpenGL.
+	 */
+	void BeginPerspective(
+		const glm::mat4& viewProjectionMatrix, const glm::vec3& viewPosition, bool isConeCullingEnabled);
+
+	/**
+	 * Starts a pass seen from orthographic projections, like the cascades of a directional shadow map. A meshlet is
+	 * kept if any of them sees it. The near and far planes are ignored, since the depth is clamped.
+	 * @param viewProjectionMatrices View projection matrices of the frustums.
+	 * @param viewDirection Direction in which the projections look, in world space.
+	 * @param isConeCullingEnabled If the meshlets that only have back faces should be culled.
+	 */
+	void BeginOrthographic(std::span<const glm::mat4> viewProjectionMatrices,
+		const glm::vec3& viewDirection,
+		bool isConeCullingEnabled);
+
+	/**
+	 * Culls the meshlets of a mesh for a group of instances. A meshlet is kept if any instance sees it.
+	 * @param mesh Mesh to cull, it needs meshlets.
+	 * @param modelMatrices Model matrices of the instances.
+	 * @param instanceCount Number of instances drawn, which can be more than the number of matrices.
+	 * @return The index of the draw command to give to Draw, or nothing if the buffers of the pass are full. They are
+	 * grown at the start of the next pass.
+	 */
+	std::optional<u32> Cull(const Mesh& mesh, std::span<const glm::mat4> modelMatrices, u32 instanceCount);
+
+	/**
+	 * Makes the draws wait for the culling of the pass.
+	 */
+	void EndCulling();
+
+	/**
+	 * Draws the visible triangles of a mesh culled in this pass. The mesh needs to be bound.
+	 * @param mesh Mesh given to Cull.
+	 * @param commandIndex Index returned by Cull.
+	 */
+	void Draw(const Mesh& mesh, u32 commandIndex) const;
+
+private:
+	Pipeline m_Pipeline{};
+
+	GLuint m_CulledIndexBuffer = 0;
+	GLuint m_CommandBuffer = 0;
+	GLuint m_InstanceBuffer = 0;
+
+	usize m_IndicesCapacity = 1024 * 1024;
+	usize m_CommandsCapacity = 256;
+	usize m_InstancesCapacity = 1024;
+
+	usize m_UsedIndices = 0;
+	usize m_UsedCommands = 0;
+	usize m_UsedInstances = 0;
+
+	// What the last pass needed, including what did not fit
+	usize m_WantedIndices = 0;
+	usize m_WantedCommands = 0;
+	usize m_WantedInstances = 0;
+
+	bool m_IsInitialized = false;
+
+	void Begin();
+	void CreateBuffers();
+	void DeleteBuffers();
+	[[nodiscard]] usize GetBuffersSize() const;
+};
+
+/**
+ * Extracts the planes of a frustum from its view projection matrix, with their normals pointing inside.
+ */
+std::array<glm::vec4, FrustumPlanesCount> ExtractFrustumPlanes(const glm::mat4& viewProjectionMatrix);
+
+void MeshletCuller::Init()
+{
+	m_Pipeline.InitComputeFromPath("shaders/culling/meshlet_cull.comp");
+	CreateBuffers();
+	m_IsInitialized = true;
+}
+
+void MeshletCuller::Delete()
+{
+	assert(m_IsInitialized);
+
+	DeleteBuffers();
+	m_Pipeline.Delete();
+	m_IsInitialized = false;
+}
+
+void MeshletCuller::BeginPerspective(
+	const glm::mat4& viewProjectionMatrix, const glm::vec3& viewPosition, const bool isConeCullingEnabled)
+{
+	Begin();
+
+	const std::array<glm::vec4, FrustumPlanesCount> planes = ExtractFrustumPlanes(viewProjectionMatrix);
+	for (usize i = 0; i < planes.size(); i++)
+	{
+		m_Pipeline.SetVec4(std::format("frustumPlanes[{}]", i), planes.at(i));
+	}
+
+	m_Pipeline.SetInt("frustumsCount", 1);
+	m_Pipeline.SetBool("isConeCullingEnabled", isConeCullingEnabled);
+	m_Pipeline.SetBool("isOrthographic", false);
+	m_Pipeline.SetVec3("viewPosition", viewPosition);
+}
+
+void MeshletCuller::BeginOrthographic(const std::span<const glm::mat4> viewProjectionMatrices,
+	const glm::vec3& viewDirection,
+	const bool isConeCullingEnabled)
+{
+	Begin();
+
+	const usize frustumsCount = std::min(viewProjectionMatrices.size(), MeshletCullingMaxFrustums);
+	for (usize i = 0; i < frustumsCount; i++)
+	{
+		std::array<glm::vec4, FrustumPlanesCount> planes = ExtractFrustumPlanes(viewProjectionMatrices[i]);
+
+		// A plane without a normal keeps every meshlet, which disables the near and far planes
+		planes[4] = glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+		planes[5] = glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f };
+		for (usize j = 0; j < planes.size(); j++)
+		{
+			m_Pipeline.SetVec4(std::format("frustumPlanes[{}]", i * FrustumPlanesCount + j), planes.at(j));
+		}
+	}
+
+	m_Pipeline.SetInt("frustumsCount", static_cast<i32>(frustumsCount));
+	m_Pipeline.SetBool("isConeCullingEnabled", isConeCullingEnabled);
+	m_Pipeline.SetBool("isOrthographic", true);
+	m_Pipeline.SetVec3("viewDirection", glm::normalize(viewDirection));
+}
+
+std::optional<u32> MeshletCuller::Cull(
+	const Mesh& mesh, const std::span<const glm::mat4> modelMatrices, const u32 instanceCount)
+{
+	const usize indicesCount = mesh.GetLods()[0].indicesCount;
+	m_WantedIndices += indicesCount;
+	m_WantedCommands++;
+	m_WantedInstances += modelMatrices.size();
+
+	if (m_UsedIndices + indicesCount > m_IndicesCapacity || m_UsedCommands + 1 > m_CommandsCapacity
+		|| m_UsedInstances + modelMatrices.size() > m_InstancesCapacity)
+	{
+		return std::nullopt;
+	}
+
+	// The count is incremented by the shader for each visible meshlet
+	const auto commandIndex = static_cast<u32>(m_UsedCommands);
+	const DrawElementsIndirectCommand command{ 0, instanceCount, static_cast<u32>(m_UsedIndices), 0, 0 };
+	glNamedBufferSubData(m_CommandBuffer,
+		static_cast<GLintptr>(commandIndex * sizeof(DrawElementsIndirectCommand)),
+		sizeof(DrawElementsIndirectCommand),
+		&command);
+	glNamedBufferSubData(m_InstanceBuffer,
+		static_cast<GLintptr>(m_UsedInstances * sizeof(glm::mat4)),
+		static_cast<GLsizeiptr>(modelMatrices.size_bytes()),
+		modelMatrices.data());
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.GetMeshletBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mesh.GetIndexBufferId());
+
+	m_Pipeline.SetUnsignedInt("meshletsCount", mesh.GetMeshletsCount());
+	m_Pipeline.SetUnsignedInt("firstInstance", static_cast<u32>(m_UsedInstances));
+	m_Pipeline.SetUnsignedInt("instancesCount", static_cast<u32>(modelMatrices.size()));
+	m_Pipeline.SetUnsignedInt("commandIndex", commandIndex);
+	m_Pipeline.SetUnsignedInt("outputOffset", static_cast<u32>(m_UsedIndices));
+	m_Pipeline.SetBool("hasShortIndices", mesh.GetIndexType() == GL_UNSIGNED_SHORT);
+
+	glDispatchCompute((mesh.GetMeshletsCount() + MeshletCullingGroupSize - 1) / MeshletCullingGroupSize, 1, 1);
+
+	m_UsedIndices += indicesCount;
+	m_UsedCommands++;
+	m_UsedInstances += modelMatrices.size();
+
+	return commandIndex;
+}
+
+void MeshletCuller::EndCulling()
+{
+	glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	for (GLuint i = 0; i < 5; i++)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+	}
+	m_Pipeline.UnBind();
+}
+
+void MeshletCuller::Draw(const Mesh& mesh, const u32 commandIndex) const
+{
+	// The index stream replaces the index buffer of the vertex array for this draw only
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_CulledIndexBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+
+	glDrawElementsIndirect(GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		reinterpret_cast<const void*>(
+			static_cast<std::uintptr_t>(commandIndex * sizeof(DrawElementsIndirectCommand))));
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.GetIndexBufferId());
+}
+
+void MeshletCuller::Begin()
+{
+	assert(m_IsInitialized);
+
+	// The buffers only grow between passes, since the culling of the current pass may already be using them
+	if (m_WantedIndices > m_IndicesCapacity || m_WantedCommands > m_CommandsCapacity
+		|| m_WantedInstances > m_InstancesCapacity)
+	{
+		DeleteBuffers();
+		m_IndicesCapacity = std::max(m_IndicesCapacity, m_WantedIndices + m_WantedIndices / 2);
+		m_CommandsCapacity = std::max(m_CommandsCapacity, m_WantedCommands + m_WantedCommands / 2);
+		m_InstancesCapacity = std::max(m_InstancesCapacity, m_WantedInstances + m_WantedInstances / 2);
+		CreateBuffers();
+
+		spdlog::info("Grew the meshlet culling buffers to {:.2f} MiB",
+			static_cast<f64>(GetBuffersSize()) / (1024.0 * 1024.0));
+	}
+
+	m_UsedIndices = 0;
+	m_UsedCommands = 0;
+	m_UsedInstances = 0;
+	m_WantedIndices = 0;
+	m_WantedCommands = 0;
+	m_WantedInstances = 0;
+
+	m_Pipeline.Bind();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CulledIndexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_CommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_InstanceBuffer);
+}
+
+void MeshletCuller::CreateBuffers()
+{
+	glCreateBuffers(1, &m_CulledIndexBuffer);
+	glNamedBufferStorage(m_CulledIndexBuffer, static_cast<GLsizeiptr>(m_IndicesCapacity * sizeof(u32)), nullptr, 0);
+
+	glCreateBuffers(1, &m_CommandBuffer);
+	glNamedBufferStorage(m_CommandBuffer,
+		static_cast<GLsizeiptr>(m_CommandsCapacity * sizeof(DrawElementsIndirectCommand)),
+		nullptr,
+		GL_DYNAMIC_STORAGE_BIT);
+
+	glCreateBuffers(1, &m_InstanceBuffer);
+	glNamedBufferStorage(m_InstanceBuffer,
+		static_cast<GLsizeiptr>(m_InstancesCapacity * sizeof(glm::mat4)),
+		nullptr,
+		GL_DYNAMIC_STORAGE_BIT);
+
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::IndexBuffer, GetBuffersSize());
+}
+
+void MeshletCuller::DeleteBuffers()
+{
+	GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::IndexBuffer, GetBuffersSize());
+
+	glDeleteBuffers(1, &m_CulledIndexBuffer);
+	glDeleteBuffers(1, &m_CommandBuffer);
+	glDeleteBuffers(1, &m_InstanceBuffer);
+	m_CulledIndexBuffer = 0;
+	m_CommandBuffer = 0;
+	m_InstanceBuffer = 0;
+}
+
+usize MeshletCuller::GetBuffersSize() const
+{
+	return m_IndicesCapacity * sizeof(u32) + m_CommandsCapacity * sizeof(DrawElementsIndirectCommand)
+		   + m_InstancesCapacity * sizeof(glm::mat4);
+}
+
+std::array<glm::vec4, FrustumPlanesCount> ExtractFrustumPlanes(const glm::mat4& viewProjectionMatrix)
+{
+	// glm stores the matrices by column, the planes are combinations of its rows
+	const auto row = [&viewProjectionMatrix](const glm::length_t index) {
+		return glm::vec4{ viewProjectionMatrix[0][index],
+			viewProjectionMatrix[1][index],
+			viewProjectionMatrix[2][index],
+			viewProjectionMatrix[3][index] };
+	};
+
+	std::array<glm::vec4, FrustumPlanesCount> planes{
+		row(3) + row(0),
+		row(3) - row(0),
+		row(3) + row(1),
+		row(3) - row(1),
+		row(3) + row(2),
+		row(3) - row(2),
+	};
+
+	// Normalized so that the distance of a point to a plane can be compared to a radius
+	for (glm::vec4& plane : planes)
+	{
+		plane /= glm::length(glm::vec3{ plane });
+	}
+
+	return planes;
+}
+}// namespace stw
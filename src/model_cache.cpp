@@ -0,0 +1,557 @@
+/**
+ * @file model_cache.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions to save and load the binary cache of the imported models.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "profiler.hpp"
+
+export module model_cache;
+
+import number_types;
+import cpu_profiler;
+import mesh;
+import material_manager;
+import utils;
+
+export namespace stw
+{
+/**
+ * Increase this when the layout of the cache files or the processing of the meshes changes, to invalidate the existing
+ * caches.
+ */
+constexpr u32 ModelCacheVersion = 6;
+
+/**
+ * "STWM" in little endian.
+ */
+constexpr u32 ModelCacheMagic = 0x4D575453;
+
+constexpr u32 InvalidModelIndex = std::numeric_limits<u32>::max();
+
+struct ModelMeshData
+{
+	std::span<const Vertex> vertices;
+	/**
+	 * Indices of every level of detail, one after the other.
+	 */
+	std::span<const u32> indices;
+	std::span<const MeshLod> lods;
+	/**
+	 * Meshlets of the most detailed level, empty if the mesh was not split.
+	 */
+	std::span<const Meshlet> meshlets;
+	/**
+	 * Index of the material in ModelData::materials.
+	 */
+	u32 materialIndex;
+};
+
+/**
+ * How a node is added to the scene graph, relative to a node of the model that was added before it.
+ */
+enum class ModelNodeLink : u32
+{
+	Root,
+	Child,
+	Sibling,
+};
+
+struct ModelNodeData
+{
+	ModelNodeLink link;
+	/**
+	 * Index, in ModelData::nodes, of the parent or of the sibling of this node. Unused for the root.
+	 */
+	u32 linkedNodeIndex;
+	/**
+	 * Index of the mesh in ModelData::meshes, or InvalidModelIndex for an empty node.
+	 */
+	u32 meshIndex;
+	glm::mat4 transform;
+};
+
+/**
+ * Everything the renderer needs to add a model to the scene. The nodes are in the order they must be added to the
+ * scene graph. The meshes do not own their vertices and indices.
+ */
+struct ModelData
+{
+	std::vector<MaterialDescriptor> materials;
+	std::vector<ModelMeshData> meshes;
+	std::vector<ModelNodeData> nodes;
+};
+
+/**
+ * Model converted by one of the importers. It owns the arrays that the meshes of its data point to.
+ */
+struct ImportedModel
+{
+	std::vector<std::vector<Vertex>> vertexArrays;
+	std::vector<std::vector<u32>> indexArrays;
+	std::vector<std::vector<MeshLod>> lodArrays;
+	std::vector<std::vector<Meshlet>> meshletArrays;
+	ModelData data;
+};
+
+/**
+ * Everything that a cache file depends on. If one of them changes, the source has to be imported again.
+ */
+struct ModelCacheKey
+{
+	u64 sourceSize;
+	i64 sourceWriteTime;
+	/**
+	 * Hash of the size and of the last write time of the files that the source references, like the buffers of a glTF.
+	 */
+	u64 dependenciesHash;
+	u32 importFlags;
+};
+
+/**
+ * Gets the path of the cache of a model, which is next to the model.
+ */
+std::filesystem::path GetModelCachePath(const std::filesystem::path& sourcePath);
+
+/**
+ * Computes the key of the cache of a model from the size and the last write time of the source and of the files it
+ * references, which is much cheaper than hashing big source files on every start.
+ * @param sourcePath Path of the model.
+ * @param dependencyPaths Paths of the files that the model references, like the buffers of a glTF.
+ * @param importFlags Post processing flags given to Assimp.
+ * @return The key or an error message if the source or one of its dependencies could not be found.
+ */
+std::expected<ModelCacheKey, std::string> ComputeModelCacheKey(const std::filesystem::path& sourcePath,
+	std::span<const std::filesystem::path> dependencyPaths,
+	u32 importFlags);
+
+/**
+ * Writes a model to a cache file.
+ * @param cachePath Path of the cache file.
+ * @param key Key of the source of the model.
+ * @param model Model to save.
+ */
+std::expected<void, std::string> SaveModelCache(
+	const std::filesystem::path& cachePath, const ModelCacheKey& key, const ModelData& model);
+
+/**
+ * Reads a model from the content of a cache file. The vertices and indices of the meshes point into the content, so
+ * it has to stay alive until the meshes are uploaded.
+ * @param content Content of the cache file, usually a mapped file.
+ * @param key Key of the source of the model, the cache is rejected if it was made from another source.
+ * @return The model or an error message if the cache is invalid or stale.
+ */
+std::expected<ModelData, std::string> ReadModelCache(std::span<const u8> content, const ModelCacheKey& key);
+
+struct ModelCacheHeader
+{
+	u32 magic;
+	u32 version;
+	u32 importFlags;
+	u32 materialsCount;
+	u64 sourceSize;
+	i64 sourceWriteTime;
+	u64 dependenciesHash;
+	u32 meshesCount;
+	u32 nodesCount;
+};
+
+// The arrays are used straight from the mapped file, so they must be copyable as bytes and 4 bytes aligned
+static_assert(std::is_trivially_copyable_v<Vertex> && alignof(Vertex) <= 4);
+static_assert(std::is_trivially_copyable_v<MeshLod> && alignof(MeshLod) <= 4);
+static_assert(std::is_trivially_copyable_v<ModelCacheHeader> && sizeof(ModelCacheHeader) % 4 == 0);
+
+constexpr usize ModelCacheAlignment = 4;
+
+/**
+ * Appends bytes at the end of a cache, then pads it to keep the next array aligned.
+ */
+void AppendCacheBytes(std::vector<u8>& cache, const std::span<const std::byte> bytes)
+{
+	const auto* data = reinterpret_cast<const u8*>(bytes.data());
+	cache.insert(cache.end(), data, data + bytes.size());
+	cache.resize((cache.size() + ModelCacheAlignment - 1) / ModelCacheAlignment * ModelCacheAlignment, 0);
+}
+
+template<typename T>
+void AppendCacheValue(std::vector<u8>& cache, const T& value)
+{
+	AppendCacheBytes(cache, std::as_bytes(std::span{ &value, 1 }));
+}
+
+void AppendCacheString(std::vector<u8>& cache, const std::string& text)
+{
+	AppendCacheValue(cache, static_cast<u32>(text.size()));
+	AppendCacheBytes(cache, std::as_bytes(std::span{ text.data(), text.size() }));
+}
+
+/**
+ * Reads the content of a cache in the order it was written. Once a read goes past the end, every next read fails.
+ */
+class ModelCacheReader
+{
+public:
+	explicit ModelCacheReader(std::span<const u8> content);
+
+	template<typename T>
+	T ReadValue()
+	{
+		T value{};
+		const std::span<const u8> bytes = ReadBytes(sizeof(T));
+		if (!bytes.empty())
+		{
+			std::memcpy(&value, bytes.data(), sizeof(T));
+		}
+
+		return value;
+	}
+
+	template<typename T>
+	std::span<const T> ReadArray(const usize count)
+	{
+		const std::span<const u8> bytes = ReadBytes(count * sizeof(T));
+		if (bytes.empty())
+		{
+			return {};
+		}
+
+		return { reinterpret_cast<const T*>(bytes.data()), count };
+	}
+
+	std::string ReadString();
+	[[nodiscard]] bool HasFailed() const;
+
+	/**
+	 * Bounds a count read from the cache by the number of records that the rest of the content can hold, so that a
+	 * corrupted count never reserves more memory than the file could fill.
+	 */
+	[[nodiscard]] usize BoundCount(usize count, usize minRecordSize) const;
+
+private:
+	std::span<const u8> m_Content;
+	usize m_Offset = 0;
+	bool m_HasFailed = false;
+
+	std::span<const u8> ReadBytes(usize size);
+};
+
+ModelCacheReader::ModelCacheReader(const std::span<const u8> content) : m_Content(content) {}
+
+std::string ModelCacheReader::ReadString()
+{
+	const auto size = ReadValue<u32>();
+	const std::span<const char> characters = ReadArray<char>(size);
+
+	return { characters.begin(), characters.end() };
+}
+
+bool ModelCacheReader::HasFailed() const { return m_HasFailed; }
+
+usize ModelCacheReader::BoundCount(const usize count, const usize minRecordSize) const
+{
+	return std::min(count, (m_Content.size() - m_Offset) / minRecordSize);
+}
+
+std::span<const u8> ModelCacheReader::ReadBytes(const usize size)
+{
+	if (m_HasFailed || size > m_Content.size() - m_Offset)
+	{
+		m_HasFailed = true;
+		return {};
+	}
+
+	const std::span<const u8> bytes = m_Content.subspan(m_Offset, size);
+	m_Offset += (size + ModelCacheAlignment - 1) / ModelCacheAlignment * ModelCacheAlignment;
+	m_Offset = std::min(m_Offset, m_Content.size());
+
+	return bytes;
+}
+
+std::filesystem::path GetModelCachePath(const std::filesystem::path& sourcePath)
+{
+	std::filesystem::path cachePath = sourcePath;
+	cachePath += ".meshcache";
+
+	return cachePath;
+}
+
+/**
+ * Size and last write time of a file, which tell if it changed without reading it.
+ */
+struct ModelCacheFileStamp
+{
+	u64 size;
+	i64 writeTime;
+};
+
+std::expected<ModelCacheFileStamp, std::string> GetModelCacheFileStamp(const std::filesystem::path& path)
+{
+	std::error_code errorCode{};
+	const auto size = std::filesystem::file_size(path, errorCode);
+	if (errorCode)
+	{
+		return std::unexpected(std::format("Could not get the size of {} : {}", path.string(), errorCode.message()));
+	}
+
+	const auto writeTime = std::filesystem::last_write_time(path, errorCode);
+	if (errorCode)
+	{
+		return std::unexpected(
+			std::format("Could not get the write time of {} : {}", path.string(), errorCode.message()));
+	}
+
+	return ModelCacheFileStamp{ static_cast<u64>(size), static_cast<i64>(writeTime.time_since_epoch().count()) };
+}
+
+std::expected<ModelCacheKey, std::string> ComputeModelCacheKey(const std::filesystem::path& sourcePath,
+	const std::span<const std::filesystem::path> dependencyPaths,
+	const u32 importFlags)
+{
+	const auto sourceStamp = GetModelCacheFileStamp(sourcePath);
+	if (!sourceStamp)
+	{
+		return std::unexpected(sourceStamp.error());
+	}
+
+	// The paths are hashed too, so that pointing the source to another file of the same size is noticed
+	u64 dependenciesHash = Fnv1aOffsetBasis;
+	for (const std::filesystem::path& dependencyPath : dependencyPaths)
+	{
+		const auto dependencyStamp = GetModelCacheFileStamp(dependencyPath);
+		if (!dependencyStamp)
+		{
+			return std::unexpected(dependencyStamp.error());
+		}
+
+		dependenciesHash = HashFnv1a(dependencyPath.generic_string(), dependenciesHash);
+		dependenciesHash = HashFnv1a(std::as_bytes(std::span{ &dependencyStamp.value(), 1 }), dependenciesHash);
+	}
+
+	return ModelCacheKey{
+		sourceStamp->size,
+		sourceStamp->writeTime,
+		dependenciesHash,
+		importFlags,
+	};
+}
+
+std::expected<void, std::string> SaveModelCache(
+	const std::filesystem::path& cachePath, const ModelCacheKey& key, const ModelData& model)
+{
+	PROFILE_FUNCTION();
+
+	usize arraysSize = 0;
+	for (const ModelMeshData& mesh : model.meshes)
+	{
+		arraysSize += mesh.vertices.size_bytes() + mesh.indices.size_bytes() + mesh.lods.size_bytes()
+					  + mesh.meshlets.size_bytes();
+	}
+
+	std::vector<u8> cache{};
+	cache.reserve(sizeof(ModelCacheHeader) + arraysSize + model.nodes.size() * sizeof(ModelNodeData));
+
+	const ModelCacheHeader header{
+		ModelCacheMagic,
+		ModelCacheVersion,
+		key.importFlags,
+		static_cast<u32>(model.materials.size()),
+		key.sourceSize,
+		key.sourceWriteTime,
+		key.dependenciesHash,
+		static_cast<u32>(model.meshes.size()),
+		static_cast<u32>(model.nodes.size()),
+	};
+	AppendCacheValue(cache, header);
+
+	for (const MaterialDescriptor& material : model.materials)
+	{
+		AppendCacheValue(cache, static_cast<u32>(material.type));
+		AppendCacheString(cache, material.baseColorPath);
+		AppendCacheString(cache, material.normalPath);
+		AppendCacheString(cache, material.armPath);
+		AppendCacheString(cache, material.ambientOcclusionPath);
+		AppendCacheString(cache, material.roughnessPath);
+		AppendCacheString(cache, material.metallicPath);
+	}
+
+	for (const ModelMeshData& mesh : model.meshes)
+	{
+		AppendCacheValue(cache, static_cast<u32>(mesh.vertices.size()));
+		AppendCacheValue(cache, static_cast<u32>(mesh.indices.size()));
+		AppendCacheValue(cache, static_cast<u32>(mesh.lods.size()));
+		AppendCacheValue(cache, static_cast<u32>(mesh.meshlets.size()));
+		AppendCacheValue(cache, mesh.materialIndex);
+		AppendCacheBytes(cache, std::as_bytes(mesh.vertices));
+		AppendCacheBytes(cache, std::as_bytes(mesh.indices));
+		AppendCacheBytes(cache, std::as_bytes(mesh.lods));
+		AppendCacheBytes(cache, std::as_bytes(mesh.meshlets));
+	}
+
+	for (const ModelNodeData& node : model.nodes)
+	{
+		AppendCacheValue(cache, static_cast<u32>(node.link));
+		AppendCacheValue(cache, node.linkedNodeIndex);
+		AppendCacheValue(cache, node.meshIndex);
+		AppendCacheValue(cache, node.transform);
+	}
+
+	// Write to another file first, so that a crash in the middle never leaves a truncated cache behind
+	std::filesystem::path temporaryPath = cachePath;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			return std::unexpected(std::format("Could not open {}", temporaryPath.string()));
+		}
+
+		file.write(reinterpret_cast<const char*>(cache.data()), static_cast<std::streamsize>(cache.size()));
+		if (!file)
+		{
+			return std::unexpected(std::format("Could not write {}", temporaryPath.string()));
+		}
+	}
+
+	std::error_code errorCode{};
+	std::filesystem::rename(temporaryPath, cachePath, errorCode);
+	if (errorCode)
+	{
+		std::filesystem::remove(temporaryPath, errorCode);
+		return std::unexpected(std::format("Could not write {} : {}", cachePath.string(), errorCode.message()));
+	}
+
+	return {};
+}
+
+std::expected<ModelData, std::string> ReadModelCache(const std::span<const u8> content, const ModelCacheKey& key)
+{
+	PROFILE_FUNCTION();
+
+	ModelCacheReader reader{ content };
+
+	const auto header = reader.ReadValue<ModelCacheHeader>();
+	if (reader.HasFailed() || header.magic != ModelCacheMagic)
+	{
+		return std::unexpected("Not a model cache");
+	}
+
+	if (header.version != ModelCacheVersion)
+	{
+		return std::unexpected(std::format("Version {} is outdated", header.version));
+	}
+
+	if (header.importFlags != key.importFlags || header.sourceSize != key.sourceSize
+		|| header.sourceWriteTime != key.sourceWriteTime || header.dependenciesHash != key.dependenciesHash)
+	{
+		return std::unexpected("The source or the import flags changed");
+	}
+
+	ModelData model{};
+
+	// Type and length of each path
+	model.materials.reserve(reader.BoundCount(header.materialsCount, sizeof(u32) * 7));
+	for (u32 i = 0; i < header.materialsCount && !reader.HasFailed(); i++)
+	{
+		MaterialDescriptor& material = model.materials.emplace_back();
+		material.type = static_cast<MaterialDescriptorType>(reader.ReadValue<u32>());
+		material.baseColorPath = reader.ReadString();
+		material.normalPath = reader.ReadString();
+		material.armPath = reader.ReadString();
+		material.ambientOcclusionPath = reader.ReadString();
+		material.roughnessPath = reader.ReadString();
+		material.metallicPath = reader.ReadString();
+	}
+
+	// Counts and material index
+	model.meshes.reserve(reader.BoundCount(header.meshesCount, sizeof(u32) * 5));
+	for (u32 i = 0; i < header.meshesCount && !reader.HasFailed(); i++)
+	{
+		const auto verticesCount = reader.ReadValue<u32>();
+		const auto indicesCount = reader.ReadValue<u32>();
+		const auto lodsCount = reader.ReadValue<u32>();
+		const auto meshletsCount = reader.ReadValue<u32>();
+		const auto materialIndex = reader.ReadValue<u32>();
+		const std::span<const Vertex> vertices = reader.ReadArray<Vertex>(verticesCount);
+		const std::span<const u32> indices = reader.ReadArray<u32>(indicesCount);
+		const std::span<const MeshLod> lods = reader.ReadArray<MeshLod>(lodsCount);
+		const std::span<const Meshlet> meshlets = reader.ReadArray<Meshlet>(meshletsCount);
+
+		if (materialIndex >= header.materialsCount)
+		{
+			return std::unexpected(std::format("Mesh {} uses the invalid material {}", i, materialIndex));
+		}
+
+		const bool areLodsValid = std::ranges::all_of(lods, [indicesCount](const MeshLod& lod) {
+			return static_cast<u64>(lod.firstIndex) + lod.indicesCount <= indicesCount;
+		});
+		if (!areLodsValid)
+		{
+			return std::unexpected(std::format("Mesh {} has a level of detail outside of its indices", i));
+		}
+
+		const bool areMeshletsValid = std::ranges::all_of(meshlets, [indicesCount](const Meshlet& meshlet) {
+			return static_cast<u64>(meshlet.firstIndex) + static_cast<u64>(meshlet.trianglesCount) * 3 <= indicesCount;
+		});
+		if (!areMeshletsValid)
+		{
+			return std::unexpected(std::format("Mesh {} has a meshlet outside of its indices", i));
+		}
+
+		model.meshes.push_back({ vertices, indices, lods, meshlets, materialIndex });
+	}
+
+	// Link, indices and transform
+	model.nodes.reserve(reader.BoundCount(header.nodesCount, sizeof(u32) * 3 + sizeof(glm::mat4)));
+	for (u32 i = 0; i < header.nodesCount && !reader.HasFailed(); i++)
+	{
+		ModelNodeData node{};
+		const auto link = reader.ReadValue<u32>();
+		if (link > static_cast<u32>(ModelNodeLink::Sibling))
+		{
+			return std::unexpected(std::format("Node {} has the invalid link {}", i, link));
+		}
+
+		node.link = static_cast<ModelNodeLink>(link);
+		node.linkedNodeIndex = reader.ReadValue<u32>();
+		node.meshIndex = reader.ReadValue<u32>();
+		node.transform = reader.ReadValue<glm::mat4>();
+
+		const bool isLinkValid = node.link == ModelNodeLink::Root || node.linkedNodeIndex < i;
+		if (!isLinkValid || (node.meshIndex != InvalidModelIndex && node.meshIndex >= header.meshesCount))
+		{
+			return std::unexpected(std::format("Node {} is invalid", i));
+		}
+
+		model.nodes.push_back(node);
+	}
+
+	if (reader.HasFailed())
+	{
+		return std::unexpected("The cache is truncated");
+	}
+
+	return model;
+}
+}// namespace stw
@@ -28,6 +28,7 @@ import number_types;
 import consts;
 import utils;
 import texture;
+import gpu_memory;
 
 
 export namespace stw
@@ -101,6 +102,17 @@ struct FramebufferDepthStencilAttachment
 	bool hasStencil = true;
 	bool isRenderbufferObject = false;
 
+	/**
+	 * Number of layers of the attachment. When bigger than one, a 2D array texture is created and attached as a
+	 * layered attachment, so that shaders can select the layer to render to with gl_Layer.
+	 */
+	u32 layerCount = 1;
+
+	/**
+	 * Set this to true to sample the attachment with a shadow sampler (GL_COMPARE_REF_TO_TEXTURE).
+	 */
+	bool hasDepthCompare = false;
+
 	[[nodiscard]] AttachmentType GetAttachmentType() const;
 };
 
@@ -122,7 +134,8 @@ struct FramebufferDescription
 };
 
 /**
- * Wrapper around an OpenGL framebuffer. It does not free the object, so don't forget to call Framebuffer::Delete()
+ * Wrapper around an OpenGL framebuffer and its attachments. It does not free the object, so don't forget to call
+ * Framebuffer::Delete()
  */
 class Framebuffer
 {
@@ -173,8 +186,14 @@ class Framebuffer
 	usize m_ColorAttachmentsCount = 0;
 	std::array<GLuint, FramebufferDescription::MaxColorAttachments> m_ColorAttachments{};
 	std::optional<GLuint> m_DepthStencilAttachment{};
+	usize m_TrackedGpuSize = 0;
 
 	void HandleColorAttachments(const FramebufferDescription& description);
+
+	/**
+	 * Computes the size of every attachment from the formats reported by OpenGL.
+	 */
+	[[nodiscard]] usize ComputeGpuSize() const;
 };
 
 bool CheckFramebufferStatus();
@@ -221,6 +240,33 @@ void Framebuffer::Init(const FramebufferDescription& description)
 			glFramebufferRenderbuffer(
 				GL_FRAMEBUFFER, attachmentEnum, GL_RENDERBUFFER, m_DepthStencilAttachment.value());
 		}
+		else if (depthAttachmentInfo.layerCount > 1)
+		{
+			GLuint index = 0;
+			glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &index);
+			m_DepthStencilAttachment = index;
+
+			glTextureParameteri(index, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTextureParameteri(index, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTextureParameteri(index, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTextureParameteri(index, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			if (depthAttachmentInfo.hasDepthCompare)
+			{
+				glTextureParameteri(index, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+				glTextureParameteri(index, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			}
+
+			glTextureStorage3D(index,
+				1,
+				static_cast<GLenum>(attachmentType.internalFormat),
+				width,
+				height,
+				static_cast<GLsizei>(depthAttachmentInfo.layerCount));
+
+			const auto attachmentEnum =
+				depthAttachmentInfo.hasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+			glFramebufferTexture(GL_FRAMEBUFFER, attachmentEnum, index, 0);
+		}
 		else
 		{
 			GLuint index = 0;
@@ -232,6 +278,11 @@ void Framebuffer::Init(const FramebufferDescription& description)
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			if (depthAttachmentInfo.hasDepthCompare)
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+			}
 
 			glTexImage2D(GL_TEXTURE_2D,
 				0,
@@ -251,6 +302,9 @@ void Framebuffer::Init(const FramebufferDescription& description)
 
 	CheckFramebufferStatus();
 	UnBind();
+
+	m_TrackedGpuSize = ComputeGpuSize();
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::RenderTarget, m_TrackedGpuSize);
 }
 
 void Framebuffer::HandleColorAttachments(const FramebufferDescription& description)
@@ -350,10 +404,67 @@ void Framebuffer::UnBind() const
 
 void Framebuffer::Delete()
 {
+	if (m_Fbo != 0)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::RenderTarget, m_TrackedGpuSize);
+		m_TrackedGpuSize = 0;
+	}
+
+	for (usize i = 0; i < m_ColorAttachmentsCount; i++)
+	{
+		GLuint& colorAttachmentId = m_ColorAttachments.at(i);
+		if (m_Description.colorAttachments.at(i).isRenderbufferObject)
+		{
+			glDeleteRenderbuffers(1, &colorAttachmentId);
+		}
+		else
+		{
+			glDeleteTextures(1, &colorAttachmentId);
+		}
+		colorAttachmentId = 0;
+	}
+	m_ColorAttachmentsCount = 0;
+
+	if (m_DepthStencilAttachment.has_value())
+	{
+		GLuint depthStencilAttachmentId = m_DepthStencilAttachment.value();
+		if (m_Description.depthStencilAttachment.has_value()
+			&& m_Description.depthStencilAttachment->isRenderbufferObject)
+		{
+			glDeleteRenderbuffers(1, &depthStencilAttachmentId);
+		}
+		else
+		{
+			glDeleteTextures(1, &depthStencilAttachmentId);
+		}
+		m_DepthStencilAttachment.reset();
+	}
+
 	glDeleteFramebuffers(1, &m_Fbo);
 	m_Fbo = 0;
 }
 
+usize Framebuffer::ComputeGpuSize() const
+{
+	usize size = 0;
+	for (usize i = 0; i < m_ColorAttachmentsCount; i++)
+	{
+		const GLuint colorAttachmentId = m_ColorAttachments.at(i);
+		size += m_Description.colorAttachments.at(i).isRenderbufferObject ? QueryRenderbufferGpuSize(colorAttachmentId)
+																		   : QueryTextureGpuSize(colorAttachmentId);
+	}
+
+	if (m_DepthStencilAttachment.has_value())
+	{
+		const bool isRenderbufferObject = m_Description.depthStencilAttachment.has_value()
+										  && m_Description.depthStencilAttachment->isRenderbufferObject;
+		size += isRenderbufferObject ? QueryRenderbufferGpuSize(m_DepthStencilAttachment.value())
+									 : QueryTextureGpuSize(m_DepthStencilAttachment.value());
+	}
+
+	return size;
+}
+
 std::optional<GLuint> Framebuffer::GetDepthStencilAttachment() const { return m_DepthStencilAttachment; }
 
 GLuint Framebuffer::GetColorAttachment(const usize index) const { return m_ColorAttachments.at(index); }
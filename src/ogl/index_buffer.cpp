@@ -11,7 +11,10 @@
 
 module;
 
+#include <algorithm>
+#include <limits>
 #include <span>
+#include <vector>
 
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
@@ -20,6 +23,7 @@ export module index_buffer;
 
 import utils;
 import number_types;
+import gpu_memory;
 
 export namespace stw
 {
@@ -39,9 +43,10 @@ class IndexBuffer
 
 	/**
 	 * Creates the index buffer with the provided indices.
+	 * When every index fits in 16 bits, they are stored as GL_UNSIGNED_SHORT to halve the size of the buffer.
 	 * @param indices Indices that will be in the buffer.
 	 */
-	void Init(std::span<GLuint> indices);
+	void Init(std::span<const GLuint> indices);
 	void Bind() const;
 	static void UnBind();
 	void Delete();
@@ -51,18 +56,28 @@ class IndexBuffer
 	 */
 	[[nodiscard]] u32 GetCount() const;
 
+	/**
+	 * Gets the type of the indices, to give to glDrawElements.
+	 */
+	[[nodiscard]] GLenum GetType() const;
+	[[nodiscard]] GLuint GetId() const;
+
 private:
 	GLuint m_BufferId{};
 	u32 m_Count{};
+	GLenum m_Type = GL_UNSIGNED_INT;
 	bool m_IsInitialized = false;
+	usize m_Size = 0;
 };
 
 IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
-	: m_BufferId(other.m_BufferId), m_Count(other.m_Count), m_IsInitialized(other.m_IsInitialized)
+	: m_BufferId(other.m_BufferId), m_Count(other.m_Count), m_Type(other.m_Type),
+	  m_IsInitialized(other.m_IsInitialized), m_Size(other.m_Size)
 {
 	other.m_BufferId = 0;
 	other.m_Count = 0;
 	other.m_IsInitialized = false;
+	other.m_Size = 0;
 }
 
 IndexBuffer::~IndexBuffer()
@@ -77,22 +92,43 @@ IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept
 {
 	m_BufferId = other.m_BufferId;
 	m_Count = other.m_Count;
+	m_Type = other.m_Type;
 	m_IsInitialized = other.m_IsInitialized;
+	m_Size = other.m_Size;
 
 	other.m_BufferId = 0;
 	other.m_Count = 0;
 	other.m_IsInitialized = false;
+	other.m_Size = 0;
 
 	return *this;
 }
 
-void IndexBuffer::Init(const std::span<u32> indices)
+void IndexBuffer::Init(const std::span<const u32> indices)
 {
 	m_Count = static_cast<u32>(indices.size());
 	glGenBuffers(1, &m_BufferId);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_BufferId);
-	glBufferData(
-		GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size_bytes()), indices.data(), GL_STATIC_DRAW);
+
+	const bool hasShortIndices = std::ranges::all_of(
+		indices, [](const GLuint index) { return index <= std::numeric_limits<GLushort>::max(); });
+	if (hasShortIndices)
+	{
+		// The buffer is padded to a multiple of 4 bytes, so that compute shaders can read it as 32 bits words
+		std::vector<GLushort> shortIndices(indices.begin(), indices.end());
+		shortIndices.resize((shortIndices.size() + 1) / 2 * 2, 0);
+		m_Type = GL_UNSIGNED_SHORT;
+		m_Size = std::span{ shortIndices }.size_bytes();
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_Size), shortIndices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		m_Type = GL_UNSIGNED_INT;
+		m_Size = indices.size_bytes();
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(m_Size), indices.data(), GL_STATIC_DRAW);
+	}
+
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::IndexBuffer, m_Size);
 
 	m_IsInitialized = true;
 }
@@ -107,10 +143,20 @@ void IndexBuffer::UnBind() { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); }
 
 void IndexBuffer::Delete()
 {
+	if (m_IsInitialized)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::IndexBuffer, m_Size);
+		m_Size = 0;
+	}
+
 	glDeleteBuffers(1, &m_BufferId);
 
 	m_IsInitialized = false;
 }
 
 u32 IndexBuffer::GetCount() const { return m_Count; }
+
+GLenum IndexBuffer::GetType() const { return m_Type; }
+
+GLuint IndexBuffer::GetId() const { return m_BufferId; }
 }// namespace stw
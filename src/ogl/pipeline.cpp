@@ -14,7 +14,10 @@ module;
 
 #include <array>
 #include <filesystem>
+#include <format>
+#include <optional>
 #include <span>
+#include <string>
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
@@ -32,9 +35,27 @@ export namespace stw
 {
 constexpr std::size_t LogSize = 512;
 
+/**
+ * A preprocessor define injected in a shader source, used to compile variants of the same shader.
+ */
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+/**
+ * Inserts the defines right after the #version directive of a shader source.
+ * @param source Source of the shader.
+ * @param defines Defines to insert.
+ * @return The source with the defines.
+ */
+[[nodiscard]] std::string InjectShaderDefines(std::string source, std::span<const ShaderDefine> defines);
+
 /**
  * This is equivalent to the Shader class in LearnOpenGL.
- * It represents a pair of vertex and fragment shaders that will be used for rendering.
+ * It represents a pair of vertex and fragment shaders (with an optional geometry shader) that will be used for
+ * rendering, or a single compute shader that will be dispatched.
  */
 class Pipeline
 {
@@ -46,8 +67,16 @@ class Pipeline
 	Pipeline& operator=(Pipeline&& other) = default;
 	~Pipeline();
 
-	void InitFromPath(const std::filesystem::path& vertexPath, const std::filesystem::path& fragmentPath);
+	void InitFromPath(const std::filesystem::path& vertexPath,
+		const std::filesystem::path& fragmentPath,
+		std::span<const ShaderDefine> defines = {});
+	void InitFromPath(const std::filesystem::path& vertexPath,
+		const std::filesystem::path& geometryPath,
+		const std::filesystem::path& fragmentPath);
 	void InitFromSource(std::string_view vertexSource, std::string_view fragmentSource);
+	void InitFromSource(std::string_view vertexSource, std::string_view geometrySource, std::string_view fragmentSource);
+	void InitComputeFromPath(const std::filesystem::path& computePath);
+	void InitComputeFromSource(std::string_view computeSource);
 
 	void Delete();
 
@@ -135,12 +164,13 @@ class Pipeline
 	bool m_IsInitialized = false;
 
 	GLuint m_ProgramId{};
-	GLuint m_VertexShaderId{};
-	GLuint m_FragmentShaderId{};
 	usize m_TexturesCount{};
 
 	[[nodiscard]] GLint GetUniformLocation(std::string_view name) const;
 	[[nodiscard]] usize GetTextureCountFromOpenGl() const;
+	[[nodiscard]] static std::optional<GLuint> CompileShader(GLenum shaderType, std::string_view source);
+	[[nodiscard]] static std::string_view GetShaderStageName(GLenum shaderType);
+	void LinkProgram(std::span<const GLuint> shaderIds);
 };
 
 void Pipeline::Bind()
@@ -216,7 +246,9 @@ Pipeline::~Pipeline()
 	}
 }
 
-void Pipeline::InitFromPath(const std::filesystem::path& vertexPath, const std::filesystem::path& fragmentPath)
+void Pipeline::InitFromPath(const std::filesystem::path& vertexPath,
+	const std::filesystem::path& fragmentPath,
+	const std::span<const ShaderDefine> defines)
 {
 	// TODO : Cache already opened shaders
 	const auto vertexResult = ReadFileAsString(vertexPath);
@@ -235,64 +267,187 @@ void Pipeline::InitFromPath(const std::filesystem::path& vertexPath, const std::
 		return;
 	}
 
-	InitFromSource(vertexResult.value(), fragmentResult.value());
+	if (defines.empty())
+	{
+		InitFromSource(vertexResult.value(), fragmentResult.value());
+		return;
+	}
+
+	InitFromSource(InjectShaderDefines(vertexResult.value(), defines),
+		InjectShaderDefines(fragmentResult.value(), defines));
+}
+
+void Pipeline::InitFromPath(const std::filesystem::path& vertexPath,
+	const std::filesystem::path& geometryPath,
+	const std::filesystem::path& fragmentPath)
+{
+	const auto vertexResult = ReadFileAsString(vertexPath);
+
+	if (!vertexResult.has_value())
+	{
+		spdlog::error("Could not load vertex shader file {}", vertexPath.string());
+		return;
+	}
+
+	const auto geometryResult = ReadFileAsString(geometryPath);
+
+	if (!geometryResult.has_value())
+	{
+		spdlog::error("Could not load geometry shader file {}", geometryPath.string());
+		return;
+	}
+
+	const auto fragmentResult = ReadFileAsString(fragmentPath);
+
+	if (!fragmentResult.has_value())
+	{
+		spdlog::error("Could not load fragment shader file {}", fragmentPath.string());
+		return;
+	}
+
+	InitFromSource(vertexResult.value(), geometryResult.value(), fragmentResult.value());
 }
 
 void Pipeline::InitFromSource(const std::string_view vertexSource, const std::string_view fragmentSource)
 {
-	const char* vertexSourcePtr = vertexSource.data();
-	m_VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(m_VertexShaderId, 1, &vertexSourcePtr, nullptr);
-	glCompileShader(m_VertexShaderId);
+	const auto vertexShaderId = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	if (!vertexShaderId)
+	{
+		return;
+	}
 
-	GLint success = 0;
-	glGetShaderiv(m_VertexShaderId, GL_COMPILE_STATUS, &success);
-	if (success == 0)
+	const auto fragmentShaderId = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (!fragmentShaderId)
 	{
-		std::array<char, LogSize> infoLog{};
-		glGetShaderInfoLog(m_VertexShaderId, LogSize, nullptr, infoLog.data());
-		spdlog::error("Error while loading vertex shader.\n{}", infoLog.data());
+		glDeleteShader(vertexShaderId.value());
+		return;
+	}
+
+	const std::array shaderIds{ vertexShaderId.value(), fragmentShaderId.value() };
+	LinkProgram(shaderIds);
+}
+
+void Pipeline::InitFromSource(
+	const std::string_view vertexSource, const std::string_view geometrySource, const std::string_view fragmentSource)
+{
+	const auto vertexShaderId = CompileShader(GL_VERTEX_SHADER, vertexSource);
+	if (!vertexShaderId)
+	{
+		return;
+	}
+
+	const auto geometryShaderId = CompileShader(GL_GEOMETRY_SHADER, geometrySource);
+	if (!geometryShaderId)
+	{
+		glDeleteShader(vertexShaderId.value());
+		return;
+	}
+
+	const auto fragmentShaderId = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
+	if (!fragmentShaderId)
+	{
+		glDeleteShader(vertexShaderId.value());
+		glDeleteShader(geometryShaderId.value());
+		return;
+	}
+
+	const std::array shaderIds{ vertexShaderId.value(), geometryShaderId.value(), fragmentShaderId.value() };
+	LinkProgram(shaderIds);
+}
+
+void Pipeline::InitComputeFromPath(const std::filesystem::path& computePath)
+{
+	const auto computeResult = ReadFileAsString(computePath);
+
+	if (!computeResult.has_value())
+	{
+		spdlog::error("Could not load compute shader file {}", computePath.string());
 		return;
 	}
 
-	const char* fragmentSourcePtr = fragmentSource.data();
-	m_FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(m_FragmentShaderId, 1, &fragmentSourcePtr, nullptr);
-	glCompileShader(m_FragmentShaderId);
+	InitComputeFromSource(computeResult.value());
+}
+
+void Pipeline::InitComputeFromSource(const std::string_view computeSource)
+{
+	const auto computeShaderId = CompileShader(GL_COMPUTE_SHADER, computeSource);
+	if (!computeShaderId)
+	{
+		return;
+	}
 
-	glGetShaderiv(m_FragmentShaderId, GL_COMPILE_STATUS, &success);
+	const std::array shaderIds{ computeShaderId.value() };
+	LinkProgram(shaderIds);
+}
+
+std::optional<GLuint> Pipeline::CompileShader(const GLenum shaderType, const std::string_view source)
+{
+	const char* sourcePtr = source.data();
+	const GLuint shaderId = glCreateShader(shaderType);
+	glShaderSource(shaderId, 1, &sourcePtr, nullptr);
+	glCompileShader(shaderId);
+
+	GLint success = 0;
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &success);
 	if (success == 0)
 	{
 		std::array<char, LogSize> infoLog{};
-		glGetShaderInfoLog(m_FragmentShaderId, LogSize, nullptr, infoLog.data());
-		spdlog::error("Error while loading fragment shader.\n{}", infoLog.data());
-		return;
+		glGetShaderInfoLog(shaderId, LogSize, nullptr, infoLog.data());
+		spdlog::error("Error while loading {} shader.\n{}", GetShaderStageName(shaderType), infoLog.data());
+		glDeleteShader(shaderId);
+		return std::nullopt;
 	}
 
+	return shaderId;
+}
+
+void Pipeline::LinkProgram(const std::span<const GLuint> shaderIds)
+{
 	m_ProgramId = glCreateProgram();
-	glAttachShader(m_ProgramId, m_VertexShaderId);
-	glAttachShader(m_ProgramId, m_FragmentShaderId);
+	for (const GLuint shaderId : shaderIds)
+	{
+		glAttachShader(m_ProgramId, shaderId);
+	}
 	glLinkProgram(m_ProgramId);
 
+	GLint success = 0;
 	glGetProgramiv(m_ProgramId, GL_LINK_STATUS, &success);
+
+	for (const GLuint shaderId : shaderIds)
+	{
+		glDeleteShader(shaderId);
+	}
+
 	if (success == 0)
 	{
 		std::array<char, LogSize> infoLog{};
 		glGetProgramInfoLog(m_ProgramId, LogSize, nullptr, infoLog.data());
 		spdlog::error("Error while linking shader program.\n{}", infoLog.data());
-		glDeleteShader(m_FragmentShaderId);
-		glDeleteShader(m_VertexShaderId);
 		return;
 	}
 
-	glDeleteShader(m_FragmentShaderId);
-	glDeleteShader(m_VertexShaderId);
-
 	m_IsInitialized = true;
 
 	m_TexturesCount = GetTextureCountFromOpenGl();
 }
 
+std::string_view Pipeline::GetShaderStageName(const GLenum shaderType)
+{
+	switch (shaderType)
+	{
+	case GL_VERTEX_SHADER:
+		return "vertex";
+	case GL_GEOMETRY_SHADER:
+		return "geometry";
+	case GL_FRAGMENT_SHADER:
+		return "fragment";
+	case GL_COMPUTE_SHADER:
+		return "compute";
+	default:
+		return "unknown";
+	}
+}
+
 void Pipeline::Delete()
 {
 	// Check if the pipeline was initialized
@@ -361,4 +516,25 @@ void Pipeline::SetVec3V(const std::string_view name, const std::span<const glm::
 
 	glUniform3fv(location, static_cast<GLsizei>(values.size()), value_ptr(values[0]));
 }
+
+std::string InjectShaderDefines(std::string source, const std::span<const ShaderDefine> defines)
+{
+	std::string definesString;
+	for (const auto& [name, value] : defines)
+	{
+		definesString += std::format("#define {} {}\n", name, value);
+	}
+
+	// The #version directive has to stay the first line of the shader
+	usize insertPosition = 0;
+	const usize versionPosition = source.find("#version");
+	if (versionPosition != std::string::npos)
+	{
+		const usize lineEnd = source.find('\n', versionPosition);
+		insertPosition = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+	}
+
+	source.insert(insertPosition, definesString);
+	return source;
+}
 }// namespace stw
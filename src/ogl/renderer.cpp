@@ -14,16 +14,23 @@ module;
 #include "glm/detail/_noise.hpp"
 
 
+#include <algorithm>
 #include <array>
 #include <expected>
 #include <filesystem>
+#include <future>
+#include <memory>
 #include <queue>
 #include <span>
+#include <string_view>
 
+#include <absl/container/flat_hash_map.h>
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 #include <glad/glad.h>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <glm/gtc/bitfield.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/mat4x4.hpp>
@@ -32,6 +39,8 @@ module;
 #include <gsl/pointers>
 #include <spdlog/spdlog.h>
 
+#include "profiler.hpp"
+
 export module renderer;
 
 import number_types;
@@ -50,11 +59,32 @@ import uniform_buffer;
 import pipeline;
 import scene_graph;
 import texture;
+import render_quality;
+import dynamic_resolution;
+import ibl_cache;
+import thread_pool;
+import texture_residency;
+import gpu_memory;
+import mapped_file;
+import model_cache;
+import mesh_optimizer;
+import mesh_simplifier;
+import meshlet_builder;
+import meshlet_culler;
+import geometry_arena;
+import gltf_loader;
+import gpu_profiler;
+import cpu_profiler;
 
 export namespace stw
 {
 constexpr f32 MinLightIntensity = 5.0f;
 
+/**
+ * Ratio of the maximum error on screen that a coarser level of detail must go under before it is selected.
+ */
+constexpr f32 LodHysteresis = 0.25f;
+
 struct DirectionalLight
 {
 	glm::vec3 direction;
@@ -71,14 +101,9 @@ struct PointLight
 };
 
 /**
- * Represents a mesh and its materials.
- * This is what you get after processing an assimp mesh in Renderer::ProcessMesh.
+ * Number of vertices or faces of an Assimp mesh that are converted by one task of the thread pool.
  */
-struct ProcessMeshResult
-{
-	Mesh mesh;
-	std::size_t materialIndex;
-};
+constexpr usize MeshProcessingChunkSize = 16 * 1024;
 
 /**
  * This class is the mastermind of this OpenGL renderer.
@@ -102,6 +127,14 @@ class Renderer
 	void InitSsao();
 	void InitSkybox();
 
+	/**
+	 * Applies new quality settings. When the renderer is already initialized, only the render targets and pipelines
+	 * affected by a changed value are recreated.
+	 * @param settings New quality settings.
+	 */
+	void ApplyQualitySettings(RenderQualitySettings settings);
+	[[nodiscard]] const RenderQualitySettings& GetQualitySettings() const;
+
 	void SetEnableMultisample(bool enableMultisample);
 	void SetEnableDepthTest(bool enableDepthTest);
 	void SetDepthFunc(GLenum depthFunction);
@@ -109,10 +142,80 @@ class Renderer
 	[[maybe_unused]] void SetCullFace(GLenum cullFace);
 	[[maybe_unused]] void SetFrontFace(GLenum frontFace);
 	[[maybe_unused]] void SetClearColor(const glm::vec4& clearColor);
+	[[maybe_unused]] void SetEnableComputeBloom(bool enableComputeBloom);
+	[[nodiscard]] bool IsComputeBloomEnabled() const;
+
+	/**
+	 * Enables the culling of the meshlets on the GPU, which only draws the parts of the dense meshes that are in the
+	 * view and, when the back faces are culled, that face the camera.
+	 */
+	[[maybe_unused]] void SetEnableMeshletCulling(bool enableMeshletCulling);
+	[[nodiscard]] bool IsMeshletCullingEnabled() const;
 	void UpdateProjectionMatrix();
 	void UpdateViewMatrix();
 	void SetViewport(const glm::ivec2& pos, const glm::uvec2& size);
 
+	/**
+	 * Sets the framebuffer that the HDR composite is drawn to. It is the default framebuffer of the window unless the
+	 * scene is rendered offscreen.
+	 * @param framebuffer OpenGL name of the framebuffer, 0 for the default framebuffer.
+	 */
+	void SetOutputFramebuffer(GLuint framebuffer);
+
+	/**
+	 * Sets the scale of the internal render size compared to the window size.
+	 * The G-buffer, lighting, SSAO and bloom are rendered at this size and the HDR composite upscales to the window.
+	 * @param renderScale Scale of the render size, 1.0 renders at the window size.
+	 */
+	void SetRenderScale(f32 renderScale);
+	[[nodiscard]] f32 GetRenderScale() const;
+	[[nodiscard]] glm::uvec2 GetRenderSize() const;
+
+	/**
+	 * Sets the settings of the dynamic resolution. When enabled, the render scale follows the GPU frame time to
+	 * stay under the target frame time.
+	 */
+	void SetDynamicResolutionSettings(const DynamicResolutionSettings& settings);
+	[[nodiscard]] const DynamicResolutionSettings& GetDynamicResolutionSettings() const;
+
+	/**
+	 * Sets the settings of the texture streaming. They must be set before loading models, as they change the size at
+	 * which the textures are first loaded.
+	 */
+	void SetTextureStreamingSettings(const TextureStreamingSettings& settings);
+	[[nodiscard]] const TextureStreamingSettings& GetTextureStreamingSettings() const;
+
+	/**
+	 * Sets the budget of the video memory. When every tracked allocation together is over budget, the streamed
+	 * textures drop their largest mips.
+	 */
+	void SetGpuMemorySettings(const GpuMemorySettings& settings);
+	[[nodiscard]] GpuMemoryReport GetGpuMemoryReport() const;
+	void LogGpuMemoryReport() const;
+
+	/**
+	 * @return The rolling average and maximum GPU time of each render pass, measured a few frames late.
+	 */
+	[[nodiscard]] std::vector<GpuPassTiming> GetGpuPassTimings() const;
+
+	/**
+	 * Sets how often the GPU time of the render passes is logged.
+	 * @param logIntervalFrames Number of frames between two logs, zero never logs.
+	 */
+	[[maybe_unused]] void SetGpuPassTimingsLogInterval(u32 logIntervalFrames);
+
+	/**
+	 * Sets what the CPU keeps of the meshes once they are uploaded. It only applies to the models loaded after it.
+	 */
+	void SetGeometryResidency(GeometryResidency residency);
+	[[nodiscard]] GeometryResidency GetGeometryResidency() const;
+
+	/**
+	 * Uploads the meshes whose residency is KeepForReupload again from their CPU copy.
+	 * @return The number of meshes uploaded.
+	 */
+	usize ReuploadMeshes();
+
 	SceneGraph& GetSceneGraph();
 
 	void SetDirectionalLight(DirectionalLight directionalLight);
@@ -136,21 +239,47 @@ class Renderer
 	bool m_EnableDepthTest = false;
 	bool m_EnableCullFace = false;
 	bool m_IsInitialized = false;
+	// The compute path reduces the levels inside its tiles with a box filter instead of the 13 tap filter, so the
+	// fragment path stays the reference
+	bool m_EnableComputeBloom = false;
+	bool m_EnableMeshletCulling = true;
 	GLenum m_DepthFunction = GL_LESS;
 	GLenum m_CullFace = GL_BACK;
 	GLenum m_FrontFace = GL_CCW;
+	/**
+	 * Size of the internal render targets, which is the window size multiplied by the render scale.
+	 */
 	glm::uvec2 m_ViewportSize{};
+	glm::uvec2 m_WindowSize{};
+	GLuint m_OutputFramebuffer = 0;
+	f32 m_RenderScale = 1.0f;
+	GpuFrameTimer m_GpuFrameTimer;
+	GpuProfiler m_GpuProfiler;
+	DynamicResolutionController m_DynamicResolutionController;
 	glm::vec4 m_ClearColor{ 0.0f, 0.0f, 0.0f, 1.0f };
+	RenderQualitySettings m_QualitySettings{};
 	UniformBuffer m_MatricesUniformBuffer;
 	gsl::not_null<Camera*> m_Camera;
 
+	ThreadPool m_ThreadPool;
 	TextureManager m_TextureManager;
 	MaterialManager m_MaterialManager;
+	TextureResidencyManager m_TextureResidencyManager;
 	std::vector<Mesh> m_Meshes;
+	GeometryResidency m_GeometryResidency = GeometryResidency::DropAfterUpload;
+	GeometryArena m_GeometryArena;
 	SceneGraph m_SceneGraph;
 
+	MeshletCuller m_GBufferMeshletCuller;
+	MeshletCuller m_ShadowMeshletCuller;
+	/**
+	 * Draw command of each group of instances culled by the meshlet culler in the current pass.
+	 */
+	absl::flat_hash_map<SceneGraphElementIndex, u32, std::hash<SceneGraphElementIndex>> m_MeshletDrawCommands;
+
 	Pipeline m_DepthPipeline;
-	std::array<Framebuffer, ShadowMapNumCascades> m_LightDepthMapFramebuffers;
+	Framebuffer m_ShadowMapFramebuffer;
+	bool m_HasVertexShaderLayer = false;
 	Framebuffer m_HdrFramebuffer;
 	Pipeline m_HdrPipeline;
 	Mesh m_RenderQuad{};
@@ -158,10 +287,10 @@ class Renderer
 	BloomFramebuffer m_BloomFramebuffer;
 	Pipeline m_DownsamplePipeline;
 	Pipeline m_UpsamplePipeline;
+	Pipeline m_DownsampleComputePipeline;
+	Pipeline m_UpsampleComputePipeline;
 
 	Framebuffer m_GBufferFramebuffer;
-	Pipeline m_GBufferPipeline;
-	Pipeline m_GBufferNoAoPipeline;
 	Pipeline m_GBufferArmPipeline;
 	Pipeline m_DebugLightsPipeline;
 	Mesh m_DebugSphereLight{};
@@ -172,13 +301,20 @@ class Renderer
 	glm::vec3 m_OldCamViewPos{};
 	std::array<f32, ShadowMapNumCascades> m_Intervals{};
 
-	std::array<glm::vec3, SsaoKernelSize> m_SsaoKernel{};
+	std::vector<glm::vec3> m_SsaoKernel{};
 	std::array<glm::vec3, SsaoRandomTextureSize> m_SsaoRandomTexture{};
 	GLuint m_SsaoGlRandomTexture{};
 	Framebuffer m_SsaoFramebuffer{};
 	Framebuffer m_SsaoBlurFramebuffer{};
 	Pipeline m_SsaoPipeline{};
 	Pipeline m_SsaoBlurPipeline{};
+	std::array<Framebuffer, 2> m_SsaoHistoryFramebuffers{};
+	Pipeline m_SsaoTemporalPipeline{};
+	usize m_SsaoHistoryIndex = 0;
+	u32 m_SsaoFrameIndex = 0;
+	bool m_IsSsaoHistoryValid = false;
+	glm::mat4 m_PreviousView{ 1.0f };
+	glm::mat4 m_PreviousViewProjection{ 1.0f };
 
 	Framebuffer m_SkyboxCaptureFramebuffer;
 	Pipeline m_EquirectangularToCubemapPipeline;
@@ -189,6 +325,7 @@ class Renderer
 	GLuint m_IrradianceMap{};
 	Pipeline m_IrradiancePipeline{};
 	GLuint m_PrefilterMap{};
+	usize m_BakedSkyboxGpuSize = 0;
 	Pipeline m_PrefilterShader;
 	Pipeline m_BrdfPipeline;
 	Framebuffer m_BrdfFramebuffer;
@@ -200,19 +337,87 @@ class Renderer
 
 	static void SetOpenGlCapability(bool enabled, GLenum capability, bool& field);
 
-	static std::optional<ProcessMeshResult> ProcessMesh(const aiMesh* assimpMesh,
-		std::size_t materialIndexOffset,
-		const std::vector<std::size_t>& loadedMaterialsIndices);
+	void InitSsaoPipeline();
+	void InitBloomFramebuffer(const glm::uvec2& screenSize);
+	[[nodiscard]] glm::uvec2 ComputeRenderSize() const;
+	void ResizeRenderTargets();
+	void UpdateDynamicResolution();
+	void LoadOrBakeSkybox();
+	bool LoadCachedSkybox(const std::filesystem::path& cacheDirectory);
+	void SaveSkyboxToCache(const std::filesystem::path& cacheDirectory) const;
+	void BakeSkybox();
+	void TrackBakedSkyboxGpuSize();
+	void DeleteBakedSkybox();
+
+	/**
+	 * Imports a model with Assimp and converts it to the layout used by the renderer and by the model cache.
+	 * @param path Path of the model.
+	 * @param importFlags Post processing flags given to Assimp.
+	 * @param threadPool Thread pool that converts the meshes.
+	 * @return The converted model or the error message of Assimp.
+	 */
+	static std::expected<ImportedModel, std::string> ImportModel(
+		const std::filesystem::path& path, u32 importFlags, ThreadPool& threadPool);
+	/**
+	 * Reorders the triangles and vertices of the meshes of an imported model and generates their levels of detail.
+	 * @param importedModel Model to optimize, the spans of its meshes are updated.
+	 * @param threadPool Thread pool that optimizes the meshes.
+	 */
+	static void OptimizeImportedModel(ImportedModel& importedModel, ThreadPool& threadPool);
+	/**
+	 * Converts a range of vertices of an Assimp mesh. It can run on any thread.
+	 * @param assimpMesh Mesh to convert.
+	 * @param firstVertex Index of the first vertex to convert.
+	 * @param vertices Converted vertices, its size is the number of vertices to convert.
+	 */
+	static void ProcessMeshVertices(const aiMesh* assimpMesh, usize firstVertex, std::span<Vertex> vertices);
+	/**
+	 * Copies the indices of a range of faces of an Assimp mesh. It can run on any thread.
+	 * @param assimpMesh Mesh to convert.
+	 * @param firstFace Index of the first face to convert.
+	 * @param indices Indices of the faces, its size is the number of faces multiplied by the indices per face.
+	 */
+	static void ProcessMeshIndices(const aiMesh* assimpMesh, usize firstFace, std::span<u32> indices);
+	/**
+	 * Loads the materials, uploads the meshes and adds the nodes of a model to the scene graph.
+	 * @param model Model to add.
+	 * @param workingDirectory Directory that the texture paths of the materials are relative to.
+	 * @return The indices of the added nodes in the scene graph.
+	 */
+	std::vector<usize> InstantiateModel(const ModelData& model, const std::filesystem::path& workingDirectory);
 	void RenderShadowMaps(const std::array<glm::mat4, ShadowMapNumCascades>& lightViewProjMatrices);
 	void RenderBloomToBloomFramebuffer(GLuint hdrTexture, float filterRadius);
 	void RenderDownsamples(GLuint hdrTexture);
 	void RenderUpsamples(float filterRadius);
+	void ComputeDownsamples(GLuint hdrTexture);
+	void ComputeUpsamples(float filterRadius);
+	/**
+	 * Selects the level of detail of each instance from the size of its error on screen.
+	 */
+	void SelectLods();
+	/**
+	 * Culls the meshlets of the groups of instances drawn with their full detail level, in a pass begun by the culler.
+	 * The draw command of each culled group is stored in m_MeshletDrawCommands.
+	 * @param culler Culler of the pass.
+	 * @param instancesPerMatrix Number of times each instance is drawn.
+	 */
+	void CullMeshlets(MeshletCuller& culler, u32 instancesPerMatrix);
+	/**
+	 * The meshlets can only be culled with their normal cone if the back faces of the imported winding are culled.
+	 */
+	[[nodiscard]] bool CanConeCullMeshlets() const;
 	void RenderGBuffer();
 	void RenderLightsToHdrFramebuffer();
 	void RenderDebugLights();
 	void RenderPointLights();
 	void RenderDirectionalLight(const std::array<glm::mat4, ShadowMapNumCascades>& lightViewProjMatrices);
 	void RenderSsao();
+
+	/**
+	 * Blends the SSAO of this frame with the reprojected SSAO of the previous frames.
+	 * @return The texture containing the accumulated ambient occlusion.
+	 */
+	GLuint RenderSsaoTemporalAccumulation();
 	void RenderCubemap();
 	std::optional<std::array<glm::mat4, ShadowMapNumCascades>> GetLightViewProjMatrices();
 	glm::mat4 ComputeLightViewProjMatrix(f32 nearPlane, f32 farPlane);
@@ -238,14 +443,26 @@ void Renderer::Init(const glm::uvec2& screenSize)
 	m_MatricesUniformBuffer.Allocate(matricesSize);
 
 	m_SceneGraph.Init();
+	m_ThreadPool.Init();
+
+	// The streamed textures are the only allocations that can shrink when the video memory is over budget
+	GetGpuMemoryTracker().SetBudgetCallback([this](const usize usedBytes, const usize budgetBytes) {
+		m_TextureResidencyManager.FitInGpuBudget(m_TextureManager, usedBytes, budgetBytes);
+	});
 
 	m_DebugSphereLight = Mesh::CreateUvSphere(1.0f, 20, 20);
 	m_RenderQuad = Mesh::CreateQuad();
 
 	InitPipelines();
 
-	InitFramebuffers(screenSize);
+	m_WindowSize = screenSize;
+	m_ViewportSize = ComputeRenderSize();
+	InitFramebuffers(m_ViewportSize);
 	SetViewport({ 0, 0 }, screenSize);
+	m_GpuFrameTimer.Init();
+	m_GpuProfiler.Init();
+	m_GBufferMeshletCuller.Init();
+	m_ShadowMeshletCuller.Init();
 
 	m_Intervals = ComputeCascades();
 	InitSsao();
@@ -254,7 +471,20 @@ void Renderer::Init(const glm::uvec2& screenSize)
 
 void Renderer::InitPipelines()
 {
-	m_DepthPipeline.InitFromPath("shaders/shadow_map/depth.vert", "shaders/shadow_map/depth.frag");
+	// Every cascade is rendered in a single pass, the layer is selected in the vertex shader if possible
+	m_HasVertexShaderLayer =
+		HasGlExtension("GL_ARB_shader_viewport_layer_array") || HasGlExtension("GL_AMD_vertex_shader_layer");
+	if (m_HasVertexShaderLayer)
+	{
+		m_DepthPipeline.InitFromPath("shaders/shadow_map/depth_layer.vert", "shaders/shadow_map/depth.frag");
+	}
+	else
+	{
+		spdlog::info("gl_Layer is not writable from the vertex shader, using the geometry shader for shadow maps");
+		m_DepthPipeline.InitFromPath(
+			"shaders/shadow_map/depth.vert", "shaders/shadow_map/depth.geom", "shaders/shadow_map/depth.frag");
+	}
+
 	m_HdrPipeline.InitFromPath("shaders/quad.vert", "shaders/hdr/hdr.frag");
 	m_HdrPipeline.Bind();
 	m_HdrPipeline.SetInt("hdrBuffer", 0);
@@ -271,22 +501,15 @@ void Renderer::InitPipelines()
 	m_UpsamplePipeline.SetInt("srcTexture", 0);
 	m_UpsamplePipeline.UnBind();
 
-	m_GBufferPipeline.InitFromPath("shaders/pbr/gbuffer.vert", "shaders/pbr/gbuffer.frag");
-	m_GBufferPipeline.Bind();
-	m_GBufferPipeline.SetInt("texture_base_color", 0);
-	m_GBufferPipeline.SetInt("texture_normal", 1);
-	m_GBufferPipeline.SetInt("texture_ambient_occlusion", 2);
-	m_GBufferPipeline.SetInt("texture_roughness", 3);
-	m_GBufferPipeline.SetInt("texture_metallic", 4);
-	m_GBufferPipeline.UnBind();
-
-	m_GBufferNoAoPipeline.InitFromPath("shaders/pbr/gbuffer.vert", "shaders/pbr/gbuffer_no_ao.frag");
-	m_GBufferNoAoPipeline.Bind();
-	m_GBufferNoAoPipeline.SetInt("texture_base_color", 0);
-	m_GBufferNoAoPipeline.SetInt("texture_normal", 1);
-	m_GBufferNoAoPipeline.SetInt("texture_roughness", 2);
-	m_GBufferNoAoPipeline.SetInt("texture_metallic", 3);
-	m_GBufferNoAoPipeline.UnBind();
+	m_DownsampleComputePipeline.InitComputeFromPath("shaders/bloom/downsample.comp");
+	m_DownsampleComputePipeline.Bind();
+	m_DownsampleComputePipeline.SetInt("srcTexture", 0);
+	m_DownsampleComputePipeline.UnBind();
+
+	m_UpsampleComputePipeline.InitComputeFromPath("shaders/bloom/upsample.comp");
+	m_UpsampleComputePipeline.Bind();
+	m_UpsampleComputePipeline.SetInt("srcTexture", 0);
+	m_UpsampleComputePipeline.UnBind();
 
 	m_GBufferArmPipeline.InitFromPath("shaders/pbr/gbuffer.vert", "shaders/pbr/gbuffer_arm.frag");
 	m_GBufferArmPipeline.Bind();
@@ -318,26 +541,25 @@ void Renderer::InitPipelines()
 	m_DirectionalLightPipeline.SetInt("gPositionAmbientOcclusion", 0);
 	m_DirectionalLightPipeline.SetInt("gNormalRoughness", 1);
 	m_DirectionalLightPipeline.SetInt("gBaseColorMetallic", 2);
-	m_DirectionalLightPipeline.SetInt("shadowMaps[0]", 3);
-	m_DirectionalLightPipeline.SetInt("shadowMaps[1]", 4);
-	m_DirectionalLightPipeline.SetInt("shadowMaps[2]", 5);
-	m_DirectionalLightPipeline.SetInt("shadowMaps[3]", 6);
+	m_DirectionalLightPipeline.SetInt("shadowMaps", 3);
 	m_DirectionalLightPipeline.UnBind();
 
 	m_DebugLightsPipeline.InitFromPath("shaders/deferred/debug_light.vert", "shaders/deferred/debug_light.frag");
 
-	m_SsaoPipeline.InitFromPath("shaders/quad.vert", "shaders/ssao/ssao.frag");
-	m_SsaoPipeline.Bind();
-	m_SsaoPipeline.SetInt("gPositionAmbientOcclusion", 0);
-	m_SsaoPipeline.SetInt("gNormalRoughness", 1);
-	m_SsaoPipeline.SetInt("texNoise", 2);
-	m_SsaoPipeline.UnBind();
+	InitSsaoPipeline();
 
 	m_SsaoBlurPipeline.InitFromPath("shaders/quad.vert", "shaders/ssao/blur.frag");
 	m_SsaoBlurPipeline.Bind();
 	m_SsaoBlurPipeline.SetInt("gSsao", 0);
 	m_SsaoBlurPipeline.UnBind();
 
+	m_SsaoTemporalPipeline.InitFromPath("shaders/quad.vert", "shaders/ssao/temporal.frag");
+	m_SsaoTemporalPipeline.Bind();
+	m_SsaoTemporalPipeline.SetInt("gSsao", 0);
+	m_SsaoTemporalPipeline.SetInt("gSsaoHistory", 1);
+	m_SsaoTemporalPipeline.SetInt("gPositionAmbientOcclusion", 2);
+	m_SsaoTemporalPipeline.UnBind();
+
 	m_EquirectangularToCubemapPipeline.InitFromPath(
 		"shaders/pbr/equirectangular.vert", "shaders/pbr/equirectangular.frag");
 	m_EquirectangularToCubemapPipeline.Bind();
@@ -362,20 +584,30 @@ void Renderer::InitPipelines()
 	m_BrdfPipeline.InitFromPath("shaders/quad.vert", "shaders/pbr/brdf.frag");
 }
 
+void Renderer::InitSsaoPipeline()
+{
+	const std::array defines{ ShaderDefine{ "SAMPLES_COUNT", std::to_string(m_QualitySettings.ssaoKernelSize) } };
+	m_SsaoPipeline.InitFromPath("shaders/quad.vert", "shaders/ssao/ssao.frag", defines);
+	m_SsaoPipeline.Bind();
+	m_SsaoPipeline.SetInt("gPositionAmbientOcclusion", 0);
+	m_SsaoPipeline.SetInt("gNormalRoughness", 1);
+	m_SsaoPipeline.SetInt("texNoise", 2);
+	m_SsaoPipeline.UnBind();
+}
+
 void Renderer::InitFramebuffers(glm::uvec2 screenSize)
 {
 	{
 		FramebufferDepthStencilAttachment depthStencilAttachment{};
 		depthStencilAttachment.isRenderbufferObject = false;
 		depthStencilAttachment.hasStencil = false;
+		depthStencilAttachment.layerCount = ShadowMapNumCascades;
+		depthStencilAttachment.hasDepthCompare = true;
 		FramebufferDescription framebufferDescription{};
 		framebufferDescription.depthStencilAttachment = depthStencilAttachment;
-		framebufferDescription.framebufferSize = glm::uvec2{ ShadowMapSize, ShadowMapSize };
+		framebufferDescription.framebufferSize = glm::uvec2{ m_QualitySettings.shadowMapSize };
 
-		for (Framebuffer& lightDepthMapFramebuffer : m_LightDepthMapFramebuffers)
-		{
-			lightDepthMapFramebuffer.Init(framebufferDescription);
-		}
+		m_ShadowMapFramebuffer.Init(framebufferDescription);
 	}
 
 	{
@@ -437,6 +669,22 @@ void Renderer::InitFramebuffers(glm::uvec2 screenSize)
 		m_SsaoFramebuffer.Init(framebufferDescription);
 		m_SsaoBlurFramebuffer.Init(framebufferDescription);
 	}
+	{
+		// Accumulated ambient occlusion and view depth, used to reject the history on disocclusion
+		FramebufferColorAttachment colorAttachment{};
+		colorAttachment.format = FramebufferColorAttachment::Format::Rg;
+		colorAttachment.size = FramebufferColorAttachment::Size::Sixteen;
+		colorAttachment.type = FramebufferColorAttachment::Type::Float;
+
+		FramebufferDescription framebufferDescription{};
+		framebufferDescription.colorAttachmentsCount = 1;
+		framebufferDescription.colorAttachments[0] = colorAttachment;
+		framebufferDescription.framebufferSize = screenSize;
+		for (Framebuffer& historyFramebuffer : m_SsaoHistoryFramebuffers)
+		{
+			historyFramebuffer.Init(framebufferDescription);
+		}
+	}
 	{
 		FramebufferDepthStencilAttachment depthStencilAttachment{};
 		depthStencilAttachment.isRenderbufferObject = true;
@@ -444,7 +692,7 @@ void Renderer::InitFramebuffers(glm::uvec2 screenSize)
 
 		FramebufferDescription framebufferDescription{};
 		framebufferDescription.depthStencilAttachment = depthStencilAttachment;
-		framebufferDescription.framebufferSize = glm::uvec2{ SkyboxResolution, SkyboxResolution };
+		framebufferDescription.framebufferSize = glm::uvec2{ m_QualitySettings.skyboxResolution };
 
 		m_SkyboxCaptureFramebuffer.Init(framebufferDescription);
 		m_SkyboxCaptureFramebuffer.Bind();
@@ -486,7 +734,12 @@ void Renderer::InitFramebuffers(glm::uvec2 screenSize)
 		framebufferDescription.framebufferSize = screenSize;
 	}
 
-	const bool success = m_BloomFramebuffer.Init(screenSize, MipChainLength);
+	InitBloomFramebuffer(screenSize);
+}
+
+void Renderer::InitBloomFramebuffer(const glm::uvec2& screenSize)
+{
+	const bool success = m_BloomFramebuffer.Init(screenSize, m_QualitySettings.bloomMipChainLength);
 
 	if (!success)
 	{
@@ -497,7 +750,7 @@ void Renderer::InitFramebuffers(glm::uvec2 screenSize)
 
 void Renderer::InitSsao()
 {
-	m_SsaoKernel = GenerateSsaoKernel();
+	m_SsaoKernel = GenerateSsaoKernel(m_QualitySettings.ssaoKernelSize);
 	m_SsaoRandomTexture = GenerateSsaoRandomTexture();
 	glGenTextures(1, &m_SsaoGlRandomTexture);
 	glBindTexture(GL_TEXTURE_2D, m_SsaoGlRandomTexture);
@@ -510,6 +763,159 @@ void Renderer::InitSsao()
 
 void Renderer::InitSkybox()
 {
+	m_CubemapMesh = Mesh::CreateInsideCube();
+
+	LoadOrBakeSkybox();
+}
+
+void Renderer::LoadOrBakeSkybox()
+{
+	constexpr std::string_view hdrPath = "data/kloofendal_overcast_4k.hdr";
+	const std::array<std::filesystem::path, 6> bakeShaderPaths{
+		"shaders/pbr/equirectangular.vert",
+		"shaders/pbr/equirectangular.frag",
+		"shaders/pbr/irradiance_convolution.frag",
+		"shaders/pbr/prefilter_convolution.frag",
+		"shaders/quad.vert",
+		"shaders/pbr/brdf.frag",
+	};
+	const std::array<u32, 5> bakeParameters{ m_QualitySettings.skyboxResolution,
+		IrradianceMapResolution,
+		PrefilterMapResolution,
+		PrefilterMapMipLevels,
+		BrdfLutResolution };
+
+	Timer timer;
+	timer.Start();
+
+	const auto cacheKey = ComputeIblCacheKey(hdrPath, bakeShaderPaths, bakeParameters);
+	if (!cacheKey)
+	{
+		spdlog::warn("Could not compute the IBL cache key, the skybox will not be cached : {}", cacheKey.error());
+	}
+	else if (LoadCachedSkybox(GetIblCacheDirectory(cacheKey.value())))
+	{
+		spdlog::info("Loaded the baked skybox from the cache in {} ms", timer.GetElapsedTime().GetInMilliseconds());
+		return;
+	}
+
+	// The HDR map is only decoded when a bake is needed
+	if (m_HdrTexture.textureId == 0)
+	{
+		auto loadResult = Texture::LoadRadianceMapFromPath(hdrPath);
+
+		if (!loadResult)
+		{
+			spdlog::error(loadResult.error());
+		}
+
+		m_HdrTexture = std::move(loadResult.value());
+	}
+
+	BakeSkybox();
+	TrackBakedSkyboxGpuSize();
+	spdlog::info("Baked the skybox in {} ms", timer.GetElapsedTime().GetInMilliseconds());
+
+	if (cacheKey)
+	{
+		SaveSkyboxToCache(GetIblCacheDirectory(cacheKey.value()));
+	}
+}
+
+bool Renderer::LoadCachedSkybox(const std::filesystem::path& cacheDirectory)
+{
+	if (!std::filesystem::exists(cacheDirectory))
+	{
+		return false;
+	}
+
+	const auto environmentResult = LoadTextureFromKtx2(cacheDirectory / "environment.ktx2");
+	const auto irradianceResult = LoadTextureFromKtx2(cacheDirectory / "irradiance.ktx2");
+	const auto prefilterResult = LoadTextureFromKtx2(cacheDirectory / "prefilter.ktx2");
+	const auto brdfResult =
+		CopyKtx2ToTexture(cacheDirectory / "brdf_lut.ktx2", m_BrdfFramebuffer.GetColorAttachment(0), CachedRg16F);
+
+	if (!environmentResult || !irradianceResult || !prefilterResult || !brdfResult)
+	{
+		for (const auto& result : { environmentResult, irradianceResult, prefilterResult })
+		{
+			if (result)
+			{
+				glDeleteTextures(1, &result.value());
+			}
+			else
+			{
+				spdlog::warn("Invalid IBL cache : {}", result.error());
+			}
+		}
+
+		if (!brdfResult)
+		{
+			spdlog::warn("Invalid IBL cache : {}", brdfResult.error());
+		}
+
+		return false;
+	}
+
+	m_EnvironmentCubemap = environmentResult.value();
+	m_IrradianceMap = irradianceResult.value();
+	m_PrefilterMap = prefilterResult.value();
+
+	for (const GLuint cubemap : { m_EnvironmentCubemap, m_IrradianceMap, m_PrefilterMap })
+	{
+		glTextureParameteri(cubemap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(cubemap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(cubemap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(cubemap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glTextureParameteri(m_EnvironmentCubemap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(m_IrradianceMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_PrefilterMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	TrackBakedSkyboxGpuSize();
+	return true;
+}
+
+void Renderer::SaveSkyboxToCache(const std::filesystem::path& cacheDirectory) const
+{
+	// Only the base level of the environment is stored, its mips are generated when it is loaded
+	const std::array results{
+		SaveTextureToKtx2(
+			m_EnvironmentCubemap, GL_TEXTURE_CUBE_MAP, 1, CachedRgb16F, true, cacheDirectory / "environment.ktx2"),
+		SaveTextureToKtx2(
+			m_IrradianceMap, GL_TEXTURE_CUBE_MAP, 1, CachedRgb16F, false, cacheDirectory / "irradiance.ktx2"),
+		SaveTextureToKtx2(m_PrefilterMap,
+			GL_TEXTURE_CUBE_MAP,
+			PrefilterMapMipLevels,
+			CachedRgb16F,
+			false,
+			cacheDirectory / "prefilter.ktx2"),
+		SaveTextureToKtx2(m_BrdfFramebuffer.GetColorAttachment(0),
+			GL_TEXTURE_2D,
+			1,
+			CachedRg16F,
+			false,
+			cacheDirectory / "brdf_lut.ktx2"),
+	};
+
+	for (const auto& result : results)
+	{
+		if (!result)
+		{
+			spdlog::error("Could not save the baked skybox to the cache : {}", result.error());
+			std::error_code errorCode{};
+			std::filesystem::remove_all(cacheDirectory, errorCode);
+			return;
+		}
+	}
+
+	spdlog::info("Saved the baked skybox to {}", cacheDirectory.string());
+}
+
+void Renderer::BakeSkybox()
+{
+	const u32 skyboxResolution = m_QualitySettings.skyboxResolution;
+
 	glGenTextures(1, &m_EnvironmentCubemap);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, m_EnvironmentCubemap);
 	for (unsigned int i = 0; i < 6; ++i)
@@ -518,8 +924,8 @@ void Renderer::InitSkybox()
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
 			0,
 			GL_RGB16F,
-			SkyboxResolution,
-			SkyboxResolution,
+			static_cast<GLsizei>(skyboxResolution),
+			static_cast<GLsizei>(skyboxResolution),
 			0,
 			GL_RGB,
 			GL_FLOAT,
@@ -531,8 +937,6 @@ void Renderer::InitSkybox()
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	m_CubemapMesh = Mesh::CreateInsideCube();
-
 	const glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 	const std::array captureViews = {
 		lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
@@ -543,14 +947,11 @@ void Renderer::InitSkybox()
 		lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f))
 	};
 
-	auto loadResult = Texture::LoadRadianceMapFromPath("data/kloofendal_overcast_4k.hdr");
-
-	if (!loadResult)
-	{
-		spdlog::error(loadResult.error());
-	}
-
-	m_HdrTexture = std::move(loadResult.value());
+	// The capture framebuffer is left at the size of the last prefilter mip by a previous bake
+	m_SkyboxCaptureFramebuffer.Resize(glm::uvec2{ skyboxResolution });
+	m_SkyboxCaptureFramebuffer.Bind();
+	constexpr GLenum captureBuffer = GL_COLOR_ATTACHMENT0;
+	glDrawBuffers(1, &captureBuffer);
 
 	glActiveTexture(GL_TEXTURE0);
 	m_HdrTexture.Bind();
@@ -559,7 +960,7 @@ void Renderer::InitSkybox()
 	m_EquirectangularToCubemapPipeline.Bind();
 	m_EquirectangularToCubemapPipeline.SetMat4("projection", captureProjection);
 
-	glViewport(0, 0, SkyboxResolution, SkyboxResolution);
+	glViewport(0, 0, static_cast<GLsizei>(skyboxResolution), static_cast<GLsizei>(skyboxResolution));
 	for (usize i = 0; i < 6; i++)
 	{
 		m_EquirectangularToCubemapPipeline.SetMat4("view", captureViews.at(i));
@@ -571,7 +972,8 @@ void Renderer::InitSkybox()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		m_CubemapMesh.GetVertexArray().Bind();
-		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(
+			GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), m_CubemapMesh.GetIndexType(), nullptr);
 		m_CubemapMesh.GetVertexArray().UnBind();
 	}
 	m_EquirectangularToCubemapPipeline.UnBind();
@@ -622,7 +1024,8 @@ void Renderer::InitSkybox()
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		m_CubemapMesh.GetVertexArray().Bind();
-		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(
+			GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), m_CubemapMesh.GetIndexType(), nullptr);
 		m_CubemapMesh.GetVertexArray().UnBind();
 	}
 	m_SkyboxCaptureFramebuffer.UnBind();
@@ -659,8 +1062,7 @@ void Renderer::InitSkybox()
 
 	m_SkyboxCaptureFramebuffer.Bind();
 
-	constexpr u32 maxMipLevels = 5;
-	for (u32 mip = 0; mip < maxMipLevels; mip++)
+	for (u32 mip = 0; mip < PrefilterMapMipLevels; mip++)
 	{
 		const u32 mipSize = static_cast<u32>(PrefilterMapResolution * std::pow(0.5f, mip));
 		m_SkyboxCaptureFramebuffer.Resize(glm::uvec2{ mipSize });
@@ -670,7 +1072,7 @@ void Renderer::InitSkybox()
 
 		glViewport(0, 0, static_cast<GLsizei>(mipSize), static_cast<GLsizei>(mipSize));
 
-		const f32 roughness = static_cast<f32>(mip) / static_cast<f32>((maxMipLevels - 1));
+		const f32 roughness = static_cast<f32>(mip) / static_cast<f32>((PrefilterMapMipLevels - 1));
 		m_PrefilterShader.SetFloat("roughness", roughness);
 		for (u32 i = 0; i < 6; ++i)
 		{
@@ -683,8 +1085,10 @@ void Renderer::InitSkybox()
 
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			m_CubemapMesh.GetVertexArray().Bind();
-			glDrawElements(
-				GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+			glDrawElements(GL_TRIANGLES,
+				static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()),
+				m_CubemapMesh.GetIndexType(),
+				nullptr);
 			m_CubemapMesh.GetVertexArray().UnBind();
 		}
 	}
@@ -698,7 +1102,8 @@ void Renderer::InitSkybox()
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 
 	m_BrdfPipeline.UnBind();
@@ -707,12 +1112,102 @@ void Renderer::InitSkybox()
 	glViewport(0, 0, static_cast<GLsizei>(m_ViewportSize.x), static_cast<GLsizei>(m_ViewportSize.y));
 }
 
+void Renderer::TrackBakedSkyboxGpuSize()
+{
+	m_BakedSkyboxGpuSize = QueryTextureGpuSize(m_EnvironmentCubemap) + QueryTextureGpuSize(m_IrradianceMap)
+						   + QueryTextureGpuSize(m_PrefilterMap);
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::Environment, m_BakedSkyboxGpuSize);
+}
+
+void Renderer::DeleteBakedSkybox()
+{
+	if (m_EnvironmentCubemap != 0)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::Environment, m_BakedSkyboxGpuSize);
+		m_BakedSkyboxGpuSize = 0;
+	}
+
+	glDeleteTextures(1, &m_EnvironmentCubemap);
+	glDeleteTextures(1, &m_IrradianceMap);
+	glDeleteTextures(1, &m_PrefilterMap);
+	m_EnvironmentCubemap = 0;
+	m_IrradianceMap = 0;
+	m_PrefilterMap = 0;
+}
+
+void Renderer::ApplyQualitySettings(RenderQualitySettings settings)
+{
+	settings.Validate();
+
+	if (!m_IsInitialized)
+	{
+		m_QualitySettings = settings;
+		return;
+	}
+
+	const RenderQualitySettings previousSettings = m_QualitySettings;
+	m_QualitySettings = settings;
+
+	if (settings.shadowMapSize != previousSettings.shadowMapSize)
+	{
+		m_ShadowMapFramebuffer.Resize(glm::uvec2{ settings.shadowMapSize });
+	}
+
+	if (settings.ssaoKernelSize != previousSettings.ssaoKernelSize)
+	{
+		m_SsaoPipeline.Delete();
+		InitSsaoPipeline();
+		m_SsaoKernel = GenerateSsaoKernel(settings.ssaoKernelSize);
+	}
+
+	if (settings.ssaoKernelSize != previousSettings.ssaoKernelSize
+		|| settings.ssaoSamplesPerFrame != previousSettings.ssaoSamplesPerFrame)
+	{
+		m_IsSsaoHistoryValid = false;
+	}
+
+	if (settings.bloomMipChainLength != previousSettings.bloomMipChainLength)
+	{
+		m_BloomFramebuffer.Delete();
+		InitBloomFramebuffer(m_ViewportSize);
+	}
+
+	if (settings.skyboxResolution != previousSettings.skyboxResolution)
+	{
+		DeleteBakedSkybox();
+		LoadOrBakeSkybox();
+	}
+
+	spdlog::info("Applied render quality profile \"{}\" (shadow map {}, skybox {}, ssao samples {} ({} per frame), "
+				 "bloom mips {}, lod error {} px)",
+		ToString(settings.profile),
+		settings.shadowMapSize,
+		settings.skyboxResolution,
+		settings.ssaoKernelSize,
+		settings.ssaoSamplesPerFrame == 0 ? settings.ssaoKernelSize : settings.ssaoSamplesPerFrame,
+		settings.bloomMipChainLength,
+		settings.lodMaxPixelError);
+}
+
+const RenderQualitySettings& Renderer::GetQualitySettings() const { return m_QualitySettings; }
+
 void Renderer::DrawScene()
 {
+	PROFILE_FUNCTION();
+
+	UpdateDynamicResolution();
+	GetGpuMemoryTracker().CheckBudget();
+	m_TextureResidencyManager.Update(m_TextureManager, m_ThreadPool);
+	m_GpuFrameTimer.Begin();
+	m_GpuProfiler.BeginFrame();
+
+	glViewport(0, 0, static_cast<GLsizei>(m_ViewportSize.x), static_cast<GLsizei>(m_ViewportSize.y));
 	glDepthMask(GL_TRUE);
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_BLEND);
 
+	SelectLods();
+
 	RenderGBuffer();
 
 	RenderSsao();
@@ -725,6 +1220,10 @@ void Renderer::DrawScene()
 
 	RenderBloomToBloomFramebuffer(m_HdrFramebuffer.GetColorAttachment(0), FilterRadius);
 
+	// The HDR composite upscales the render targets to the window
+	m_GpuProfiler.BeginZone("HDR composite");
+	glBindFramebuffer(GL_FRAMEBUFFER, m_OutputFramebuffer);
+	glViewport(0, 0, static_cast<GLsizei>(m_WindowSize.x), static_cast<GLsizei>(m_WindowSize.y));
 	m_HdrPipeline.Bind();
 	glDisable(GL_DEPTH_TEST);
 
@@ -736,31 +1235,175 @@ void Renderer::DrawScene()
 	glBindTexture(GL_TEXTURE_2D, bloomTexture);
 
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 	glEnable(GL_DEPTH_TEST);
+	m_GpuProfiler.EndZone();
+
+	m_GpuProfiler.EndFrame();
+	m_GpuFrameTimer.End();
+}
+
+void Renderer::UpdateDynamicResolution()
+{
+	PROFILE_FUNCTION();
+
+	const std::optional<Duration> gpuFrameTime = m_GpuFrameTimer.PollElapsedTime();
+	if (!gpuFrameTime.has_value())
+	{
+		return;
+	}
+
+	const std::optional<f32> newScale = m_DynamicResolutionController.Update(gpuFrameTime.value());
+	if (!newScale.has_value())
+	{
+		return;
+	}
+
+	const glm::uvec2 previousRenderSize = m_ViewportSize;
+	SetRenderScale(newScale.value());
+
+	spdlog::info("Dynamic resolution : GPU frame time {:.2f} ms for a target of {:.2f} ms, render size {}x{} -> {}x{} "
+				 "(scale {:.2f})",
+		m_DynamicResolutionController.GetSmoothedFrameTimeMs(),
+		m_DynamicResolutionController.GetSettings().targetFrameTimeMs,
+		previousRenderSize.x,
+		previousRenderSize.y,
+		m_ViewportSize.x,
+		m_ViewportSize.y,
+		m_RenderScale);
+}
+
+void Renderer::SelectLods()
+{
+	PROFILE_FUNCTION();
+
+	const glm::mat4 view = m_Camera->GetViewMatrix();
+	const f32 projectionScale = m_Camera->GetProjectionMatrix()[1][1] * static_cast<f32>(m_ViewportSize.y) * 0.5f;
+	const auto maxPixelError = static_cast<f32>(m_QualitySettings.lodMaxPixelError);
+
+	m_SceneGraph.UpdateLods([this, &view, projectionScale, maxPixelError](
+								const SceneGraphElementIndex elementIndex, const glm::mat4& transformMatrix) {
+		const auto& mesh = m_Meshes[elementIndex.meshId];
+		const std::span<const MeshLod> lods = mesh.GetLods();
+
+		const glm::vec3 center{ view * transformMatrix * glm::vec4(mesh.GetBoundingSphereCenter(), 1.0f) };
+		const f32 scale = std::max({ glm::length(glm::vec3(transformMatrix[0])),
+			glm::length(glm::vec3(transformMatrix[1])),
+			glm::length(glm::vec3(transformMatrix[2])) });
+		const f32 distance = std::max(-center.z, mesh.GetBoundingSphereRadius() * scale);
+
+		// Size on screen, in pixels, of a distance of one in the model space of this instance
+		const f32 pixelsPerUnit = scale * projectionScale / std::max(distance, 0.001f);
+
+		// A coarser level is only taken once its error is well under the limit, and is kept until its error goes over
+		// the limit, so that an instance at the limit does not switch level every frame
+		usize lodIndex = std::min(elementIndex.lodIndex, lods.size() - 1);
+		while (lodIndex > 0 && lods[lodIndex].error * pixelsPerUnit > maxPixelError)
+		{
+			lodIndex--;
+		}
+		while (lodIndex + 1 < lods.size()
+			   && lods[lodIndex + 1].error * pixelsPerUnit <= maxPixelError * (1.0f - LodHysteresis))
+		{
+			lodIndex++;
+		}
+
+		return lodIndex;
+	});
+}
+
+void Renderer::CullMeshlets(MeshletCuller& culler, const u32 instancesPerMatrix)
+{
+	m_MeshletDrawCommands.clear();
+	m_SceneGraph.ForEach([this, &culler, instancesPerMatrix](const SceneGraphElementIndex elementIndex,
+							 const std::span<const glm::mat4> transformMatrices) {
+		// The meshlets are only built for the full detail level, the small meshes are not worth a dispatch
+		const auto& mesh = m_Meshes[elementIndex.meshId];
+		if (elementIndex.lodIndex != 0 || mesh.GetMeshletsCount() < MeshletCullingMinMeshletsCount)
+		{
+			return;
+		}
+
+		const auto instanceCount = static_cast<u32>(transformMatrices.size() * instancesPerMatrix);
+		const std::optional<u32> commandIndex = culler.Cull(mesh, transformMatrices, instanceCount);
+		if (commandIndex.has_value())
+		{
+			m_MeshletDrawCommands.emplace(elementIndex, commandIndex.value());
+		}
+	});
+
+	culler.EndCulling();
+}
+
+bool Renderer::CanConeCullMeshlets() const
+{
+	return m_EnableCullFace && m_CullFace == GL_BACK && m_FrontFace == GL_CCW;
 }
 
 void Renderer::RenderGBuffer()
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "G-buffer" };
+
+	m_MeshletDrawCommands.clear();
+	if (m_EnableMeshletCulling)
+	{
+		const GpuProfilerScope cullingProfilerScope{ m_GpuProfiler, "G-buffer meshlet culling" };
+		m_GBufferMeshletCuller.BeginPerspective(m_Camera->GetProjectionMatrix() * m_Camera->GetViewMatrix(),
+			m_Camera->GetPosition(),
+			CanConeCullMeshlets());
+		CullMeshlets(m_GBufferMeshletCuller, 1);
+	}
+
 	m_GBufferFramebuffer.Bind();
 	glClearColor(m_ClearColor.r, m_ClearColor.g, m_ClearColor.b, m_ClearColor.a);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	auto renderLambda = [this](const SceneGraphElementIndex elementIndex,
+	const glm::mat4 view = m_Camera->GetViewMatrix();
+	const f32 projectionScale = m_Camera->GetProjectionMatrix()[1][1] * static_cast<f32>(m_ViewportSize.y) * 0.5f;
+
+	auto renderLambda = [this, &view, projectionScale](const SceneGraphElementIndex elementIndex,
 							const std::span<const glm::mat4> transformMatrices) {
 		m_MatricesUniformBuffer.Bind();
 		const auto& material = m_MaterialManager[elementIndex.materialId];
 
-		BindMaterialForGBuffer(
-			material, m_TextureManager, { m_GBufferPipeline, m_GBufferNoAoPipeline, m_GBufferArmPipeline });
+		BindMaterialForGBuffer(material, m_TextureManager, { m_GBufferArmPipeline });
 
 		const auto& mesh = m_Meshes[elementIndex.meshId];
+
+		// The texture streaming needs the size of the material on screen, it is estimated from the bounding sphere of
+		// the largest instance, as if the UVs were covering the whole mesh once
+		f32 screenSize = 0.0f;
+		for (const glm::mat4& transformMatrix : transformMatrices)
+		{
+			const glm::vec3 center{ view * transformMatrix * glm::vec4(mesh.GetBoundingSphereCenter(), 1.0f) };
+			const f32 scale = std::max({ glm::length(glm::vec3(transformMatrix[0])),
+				glm::length(glm::vec3(transformMatrix[1])),
+				glm::length(glm::vec3(transformMatrix[2])) });
+			const f32 radius = mesh.GetBoundingSphereRadius() * scale;
+			const f32 distance = std::max(-center.z, radius);
+			screenSize = std::max(screenSize, 2.0f * radius * projectionScale / std::max(distance, 0.001f));
+		}
+		m_TextureResidencyManager.RequestMaterialSize(material, screenSize);
+
 		mesh.Bind(transformMatrices);
 
-		const auto size = static_cast<GLsizei>(mesh.GetIndicesSize());
-		glDrawElementsInstanced(
-			GL_TRIANGLES, size, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(transformMatrices.size()));
+		if (const auto drawCommand = m_MeshletDrawCommands.find(elementIndex);
+			drawCommand != m_MeshletDrawCommands.end())
+		{
+			m_GBufferMeshletCuller.Draw(mesh, drawCommand->second);
+		}
+		else
+		{
+			const MeshLod& lod = mesh.GetLods()[elementIndex.lodIndex];
+			glDrawElementsInstanced(GL_TRIANGLES,
+				static_cast<GLsizei>(lod.indicesCount),
+				mesh.GetIndexType(),
+				mesh.GetLodIndicesOffset(elementIndex.lodIndex),
+				static_cast<GLsizei>(transformMatrices.size()));
+		}
 
 		mesh.UnBind();
 		m_MatricesUniformBuffer.UnBind();
@@ -772,6 +1415,9 @@ void Renderer::RenderGBuffer()
 
 void Renderer::RenderSsao()
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "SSAO" };
+
 	m_SsaoFramebuffer.Bind();
 	Clear(GL_COLOR_BUFFER_BIT);
 
@@ -786,29 +1432,105 @@ void Renderer::RenderSsao()
 
 	m_SsaoPipeline.SetVec3V("samples", m_SsaoKernel);
 
+	const bool isTemporal = m_QualitySettings.ssaoSamplesPerFrame != 0;
+	if (isTemporal)
+	{
+		// The kernel grows with the index of the samples, so each frame takes one sample every stride instead of a
+		// contiguous range, which would only cover a band of distances. The next frame starts one sample further and
+		// the noise texture is shifted by one texel, the temporal pass then accumulates them
+		const u32 kernelSize = m_QualitySettings.ssaoKernelSize;
+		const u32 samplesPerFrame = m_QualitySettings.ssaoSamplesPerFrame;
+		const u32 sampleStride = (kernelSize + samplesPerFrame - 1) / samplesPerFrame;
+		const u32 noiseFrame = m_SsaoFrameIndex % SsaoRandomTextureSize;
+		constexpr f32 noiseTextureSide = 4.0f;
+		const glm::vec2 noiseOffset = glm::vec2{ noiseFrame % 4, noiseFrame / 4 } / noiseTextureSide;
+
+		m_SsaoPipeline.SetInt("sampleOffset", static_cast<i32>(m_SsaoFrameIndex % sampleStride));
+		m_SsaoPipeline.SetInt("sampleStride", static_cast<i32>(sampleStride));
+		m_SsaoPipeline.SetInt("samplesCount", static_cast<i32>(samplesPerFrame));
+		m_SsaoPipeline.SetVec2("noiseOffset", noiseOffset);
+	}
+	else
+	{
+		m_SsaoPipeline.SetInt("sampleOffset", 0);
+		m_SsaoPipeline.SetInt("sampleStride", 1);
+		m_SsaoPipeline.SetInt("samplesCount", static_cast<i32>(m_QualitySettings.ssaoKernelSize));
+		m_SsaoPipeline.SetVec2("noiseOffset", glm::vec2{ 0.0f });
+	}
+
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 
 	m_SsaoPipeline.UnBind();
 	m_SsaoFramebuffer.UnBind();
 
+	GLuint ssaoTexture = m_SsaoFramebuffer.GetColorAttachment(0);
+	if (isTemporal)
+	{
+		ssaoTexture = RenderSsaoTemporalAccumulation();
+	}
+	else
+	{
+		m_IsSsaoHistoryValid = false;
+	}
+
 	m_SsaoBlurFramebuffer.Bind();
 	m_SsaoBlurPipeline.Bind();
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_SsaoFramebuffer.GetColorAttachment(0));
+	glBindTexture(GL_TEXTURE_2D, ssaoTexture);
 
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 
 	m_SsaoBlurFramebuffer.UnBind();
 	m_SsaoBlurPipeline.UnBind();
 }
 
+GLuint Renderer::RenderSsaoTemporalAccumulation()
+{
+	const Framebuffer& historyFramebuffer = m_SsaoHistoryFramebuffers.at(1 - m_SsaoHistoryIndex);
+	const Framebuffer& currentFramebuffer = m_SsaoHistoryFramebuffers.at(m_SsaoHistoryIndex);
+
+	currentFramebuffer.Bind();
+	m_SsaoTemporalPipeline.Bind();
+	m_SsaoTemporalPipeline.SetMat4("previousViewProjection", m_PreviousViewProjection);
+	m_SsaoTemporalPipeline.SetMat4("previousView", m_PreviousView);
+	m_SsaoTemporalPipeline.SetBool("isHistoryValid", m_IsSsaoHistoryValid);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_SsaoFramebuffer.GetColorAttachment(0));
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, historyFramebuffer.GetColorAttachment(0));
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, m_GBufferFramebuffer.GetColorAttachment(0));
+
+	m_RenderQuad.GetVertexArray().Bind();
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
+	m_RenderQuad.GetVertexArray().UnBind();
+
+	m_SsaoTemporalPipeline.UnBind();
+	currentFramebuffer.UnBind();
+
+	m_PreviousView = m_Camera->GetViewMatrix();
+	m_PreviousViewProjection = m_Camera->GetProjectionMatrix() * m_PreviousView;
+	m_IsSsaoHistoryValid = true;
+	m_SsaoHistoryIndex = 1 - m_SsaoHistoryIndex;
+	m_SsaoFrameIndex++;
+
+	return currentFramebuffer.GetColorAttachment(0);
+}
+
 void Renderer::RenderLightsToHdrFramebuffer()
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "Lighting" };
+
 	const auto lightViewProjMatrices = GetLightViewProjMatrices();
 
 	if (m_DirectionalLight.has_value() && lightViewProjMatrices.has_value())
@@ -863,38 +1585,68 @@ void Renderer::RenderLightsToHdrFramebuffer()
 
 void Renderer::RenderShadowMaps(const std::array<glm::mat4, ShadowMapNumCascades>& lightViewProjMatrices)
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "Shadow maps" };
+
+	// With vertex shader layer selection, each instance is drawn once per cascade.
+	// The geometry shader fallback duplicates the triangles itself.
+	const u32 instancesPerMatrix = m_HasVertexShaderLayer ? ShadowMapNumCascades : 1;
+
+	// The culling binds its own pipeline, so it runs before the depth pipeline is set up
+	m_MeshletDrawCommands.clear();
+	if (m_EnableMeshletCulling)
+	{
+		const GpuProfilerScope cullingProfilerScope{ m_GpuProfiler, "Shadow meshlet culling" };
+		m_ShadowMeshletCuller.BeginOrthographic(
+			lightViewProjMatrices, m_DirectionalLight->direction, CanConeCullMeshlets());
+		CullMeshlets(m_ShadowMeshletCuller, instancesPerMatrix);
+	}
+
 	// glCullFace(GL_FRONT);
+	glEnable(GL_DEPTH_CLAMP);
+	m_DepthPipeline.Bind();
 	for (usize i = 0; i < lightViewProjMatrices.size(); i++)
 	{
-		glEnable(GL_DEPTH_CLAMP);
-		m_DepthPipeline.Bind();
-		m_DepthPipeline.SetMat4("lightViewProjMatrix", lightViewProjMatrices.at(i));
-
-		glViewport(0, 0, ShadowMapSize, ShadowMapSize);
-		m_LightDepthMapFramebuffers.at(i).Bind();
-		m_MatricesUniformBuffer.Bind();
+		m_DepthPipeline.SetMat4(std::format("lightViewProjMatrices[{}]", i), lightViewProjMatrices.at(i));
+	}
 
-		Clear(GL_DEPTH_BUFFER_BIT);
-		// Render meshes on light depth buffer
-		m_SceneGraph.ForEach([this](SceneGraphElementIndex elementIndex,
-								 const std::span<const glm::mat4> transformMatrices) {
-			m_MatricesUniformBuffer.Bind();
-			const auto& mesh = m_Meshes[elementIndex.meshId];
-			mesh.Bind(transformMatrices);
+	const auto shadowMapSize = static_cast<GLsizei>(m_QualitySettings.shadowMapSize);
+	glViewport(0, 0, shadowMapSize, shadowMapSize);
+	m_ShadowMapFramebuffer.Bind();
 
-			const auto indicesSize = static_cast<GLsizei>(mesh.GetIndicesSize());
-			glDrawElementsInstanced(
-				GL_TRIANGLES, indicesSize, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(transformMatrices.size()));
+	// Clears every layer of the shadow map array
+	Clear(GL_DEPTH_BUFFER_BIT);
 
-			mesh.UnBind();
-			m_MatricesUniformBuffer.UnBind();
-		});
+	// Render meshes on every cascade at once
+	m_SceneGraph.ForEach([this, instancesPerMatrix](SceneGraphElementIndex elementIndex,
+							 const std::span<const glm::mat4> transformMatrices) {
+		const auto& mesh = m_Meshes[elementIndex.meshId];
+		mesh.Bind(transformMatrices);
+		mesh.SetModelMatrixDivisor(instancesPerMatrix);
 
-		m_MatricesUniformBuffer.UnBind();
-		m_DepthPipeline.UnBind();
-		m_LightDepthMapFramebuffers.at(i).UnBind();
-		glDisable(GL_DEPTH_CLAMP);
-	}
+		if (const auto drawCommand = m_MeshletDrawCommands.find(elementIndex);
+			drawCommand != m_MeshletDrawCommands.end())
+		{
+			m_ShadowMeshletCuller.Draw(mesh, drawCommand->second);
+		}
+		else
+		{
+			const MeshLod& lod = mesh.GetLods()[elementIndex.lodIndex];
+			const auto instanceCount = static_cast<GLsizei>(transformMatrices.size() * instancesPerMatrix);
+			glDrawElementsInstanced(GL_TRIANGLES,
+				static_cast<GLsizei>(lod.indicesCount),
+				mesh.GetIndexType(),
+				mesh.GetLodIndicesOffset(elementIndex.lodIndex),
+				instanceCount);
+		}
+
+		mesh.SetModelMatrixDivisor(1);
+		mesh.UnBind();
+	});
+
+	m_DepthPipeline.UnBind();
+	m_ShadowMapFramebuffer.UnBind();
+	glDisable(GL_DEPTH_CLAMP);
 	glCullFace(GL_BACK);
 }
 
@@ -933,7 +1685,8 @@ void Renderer::RenderAmbient()
 	glBindTexture(GL_TEXTURE_2D, m_BrdfFramebuffer.GetColorAttachment(0));
 
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 
 	m_AmbientIblPipeline.UnBind();
@@ -973,8 +1726,10 @@ void Renderer::RenderPointLights()
 		m_MatricesUniformBuffer.Bind();
 
 		m_DebugSphereLight.GetVertexArray().Bind();
-		glDrawElements(
-			GL_TRIANGLES, static_cast<GLsizei>(m_DebugSphereLight.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(GL_TRIANGLES,
+			static_cast<GLsizei>(m_DebugSphereLight.GetIndicesSize()),
+			m_DebugSphereLight.GetIndexType(),
+			nullptr);
 		m_DebugSphereLight.GetVertexArray().UnBind();
 		m_MatricesUniformBuffer.UnBind();
 	}
@@ -1007,21 +1762,16 @@ void Renderer::RenderDirectionalLight(const std::array<glm::mat4, ShadowMapNumCa
 	glActiveTexture(GL_TEXTURE2);
 	glBindTexture(GL_TEXTURE_2D, m_GBufferFramebuffer.GetColorAttachment(2));
 
-	// Shadow map
-	for (usize i = 0; i < m_LightDepthMapFramebuffers.size(); i++)
+	// Shadow map array, one layer per cascade
+	glActiveTexture(GL_TEXTURE3);
+	const std::optional<GLuint> depthStencilAttachment = m_ShadowMapFramebuffer.GetDepthStencilAttachment();
+	if (!depthStencilAttachment)
 	{
-		glActiveTexture(static_cast<GLenum>(GL_TEXTURE3 + i));
-		const std::optional<GLuint> depthStencilAttachment =
-			m_LightDepthMapFramebuffers.at(i).GetDepthStencilAttachment();
-		if (!depthStencilAttachment)
-		{
-			spdlog::error("No depth stencil attachment... {} {}", __FILE__, __LINE__);
-			continue;
-		}
-
-		glBindTexture(GL_TEXTURE_2D, *depthStencilAttachment);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		spdlog::error("No depth stencil attachment... {} {}", __FILE__, __LINE__);
+	}
+	else
+	{
+		glBindTexture(GL_TEXTURE_2D_ARRAY, *depthStencilAttachment);
 	}
 
 	const DirectionalLight& directionalLight = m_DirectionalLight.value();
@@ -1031,7 +1781,8 @@ void Renderer::RenderDirectionalLight(const std::array<glm::mat4, ShadowMapNumCa
 	m_DirectionalLightPipeline.SetVec3("directionalLight.color", directionalLight.color);
 
 	m_RenderQuad.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 	m_RenderQuad.GetVertexArray().UnBind();
 	m_MatricesUniformBuffer.UnBind();
 	m_DirectionalLightPipeline.UnBind();
@@ -1039,6 +1790,9 @@ void Renderer::RenderDirectionalLight(const std::array<glm::mat4, ShadowMapNumCa
 
 void Renderer::RenderDebugLights()
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "Debug lights" };
+
 	glDepthMask(GL_TRUE);
 	glEnable(GL_DEPTH_TEST);
 	m_HdrFramebuffer.Bind();
@@ -1057,8 +1811,11 @@ void Renderer::RenderDebugLights()
 		model = scale(model, glm::vec3{ debugLightScale });
 
 		m_DebugSphereLight.Bind({ &model, 1 });
-		glDrawElementsInstanced(
-			GL_TRIANGLES, static_cast<GLsizei>(m_DebugSphereLight.GetIndicesSize()), GL_UNSIGNED_INT, nullptr, 1);
+		glDrawElementsInstanced(GL_TRIANGLES,
+			static_cast<GLsizei>(m_DebugSphereLight.GetIndicesSize()),
+			m_DebugSphereLight.GetIndexType(),
+			nullptr,
+			1);
 		m_DebugSphereLight.UnBind();
 
 		m_MatricesUniformBuffer.UnBind();
@@ -1067,6 +1824,16 @@ void Renderer::RenderDebugLights()
 
 void Renderer::RenderBloomToBloomFramebuffer(const GLuint hdrTexture, const f32 filterRadius)
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "Bloom" };
+
+	if (m_EnableComputeBloom)
+	{
+		ComputeDownsamples(hdrTexture);
+		ComputeUpsamples(filterRadius);
+		return;
+	}
+
 	m_BloomFramebuffer.Bind();
 	RenderDownsamples(hdrTexture);
 	RenderUpsamples(filterRadius);
@@ -1089,7 +1856,8 @@ void Renderer::RenderDownsamples(const GLuint hdrTexture)
 
 		// Render current mip
 		m_RenderQuad.GetVertexArray().Bind();
-		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(
+			GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 		m_RenderQuad.GetVertexArray().UnBind();
 
 		m_DownsamplePipeline.SetVec2("srcResolution", bloomMip.size);
@@ -1123,7 +1891,8 @@ void Renderer::RenderUpsamples(const f32 filterRadius)
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, nextBloomMip.texture, 0);
 
 		m_RenderQuad.GetVertexArray().Bind();
-		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(
+			GL_TRIANGLES, static_cast<GLsizei>(m_RenderQuad.GetIndicesSize()), m_RenderQuad.GetIndexType(), nullptr);
 		m_RenderQuad.GetVertexArray().UnBind();
 	}
 
@@ -1132,8 +1901,62 @@ void Renderer::RenderUpsamples(const f32 filterRadius)
 	m_UpsamplePipeline.UnBind();
 }
 
+void Renderer::ComputeDownsamples(const GLuint hdrTexture)
+{
+	const auto mipChain = m_BloomFramebuffer.MipChain();
+
+	m_DownsampleComputePipeline.Bind();
+	m_DownsampleComputePipeline.SetVec2("srcResolution", glm::vec2(m_ViewportSize));
+	m_DownsampleComputePipeline.SetInt("mipCount", static_cast<i32>(mipChain.size()));
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	m_BloomFramebuffer.BindMipImages();
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_BloomFramebuffer.CounterBuffer());
+
+	// One work group per tile of the first mip, the rest of the chain is built inside the same dispatch
+	const glm::uvec2 firstMipSize{ mipChain[0].intSize };
+	const glm::uvec2 groupCount = (firstMipSize + BloomDownsampleTileSize - 1u) / BloomDownsampleTileSize;
+	glDispatchCompute(groupCount.x, groupCount.y, 1);
+
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+	m_DownsampleComputePipeline.UnBind();
+}
+
+void Renderer::ComputeUpsamples(const f32 filterRadius)
+{
+	m_UpsampleComputePipeline.Bind();
+	m_UpsampleComputePipeline.SetFloat("filterRadius", filterRadius);
+
+	const auto mipChain = m_BloomFramebuffer.MipChain();
+
+	glActiveTexture(GL_TEXTURE0);
+	for (usize i = mipChain.size() - 1; i > 0; i--)
+	{
+		const BloomMip& bloomMip = mipChain[i];
+		const BloomMip& nextBloomMip = mipChain[i - 1];
+
+		glBindTexture(GL_TEXTURE_2D, bloomMip.texture);
+		glBindImageTexture(0, nextBloomMip.texture, 0, GL_FALSE, 0, GL_READ_WRITE, BloomMipFormat);
+
+		const glm::uvec2 nextMipSize{ nextBloomMip.intSize };
+		const glm::uvec2 groupCount = (nextMipSize + BloomUpsampleGroupSize - 1u) / BloomUpsampleGroupSize;
+		glDispatchCompute(groupCount.x, groupCount.y, 1);
+
+		// The next iteration samples what was just written
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	m_UpsampleComputePipeline.UnBind();
+}
+
 void Renderer::RenderCubemap()
 {
+	PROFILE_FUNCTION();
+	const GpuProfilerScope profilerScope{ m_GpuProfiler, "Skybox" };
+
 	m_HdrFramebuffer.Bind();
 	m_CubemapPipeline.Bind();
 	m_MatricesUniformBuffer.Bind();
@@ -1141,7 +1964,8 @@ void Renderer::RenderCubemap()
 	glBindTexture(GL_TEXTURE_CUBE_MAP, m_EnvironmentCubemap);
 
 	m_CubemapMesh.GetVertexArray().Bind();
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(
+		GL_TRIANGLES, static_cast<GLsizei>(m_CubemapMesh.GetIndicesSize()), m_CubemapMesh.GetIndexType(), nullptr);
 	m_CubemapMesh.GetVertexArray().UnBind();
 
 	m_MatricesUniformBuffer.UnBind();
@@ -1190,6 +2014,22 @@ void Renderer::SetEnableCullFace(const bool enableCullFace)
 	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 }
 
+[[maybe_unused]] void Renderer::SetEnableComputeBloom(const bool enableComputeBloom)
+{
+	m_EnableComputeBloom = enableComputeBloom;
+}
+
+bool Renderer::IsComputeBloomEnabled() const { return m_EnableComputeBloom; }
+
+[[maybe_unused]] void Renderer::SetEnableMeshletCulling(const bool enableMeshletCulling)
+{
+	m_EnableMeshletCulling = enableMeshletCulling;
+}
+
+bool Renderer::IsMeshletCullingEnabled() const { return m_EnableMeshletCulling; }
+
+void Renderer::SetOutputFramebuffer(const GLuint framebuffer) { m_OutputFramebuffer = framebuffer; }
+
 void Renderer::UpdateProjectionMatrix()
 {
 	assert(m_IsInitialized);
@@ -1208,13 +2048,143 @@ void Renderer::UpdateViewMatrix()
 
 void Renderer::SetViewport(const glm::ivec2& pos, const glm::uvec2& size)
 {
-	m_ViewportSize = size;
+	m_WindowSize = size;
 	glViewport(pos.x, pos.y, static_cast<GLsizei>(size.x), static_cast<GLsizei>(size.y));
 
-	m_HdrFramebuffer.Resize(size);
-	m_GBufferFramebuffer.Resize(size);
-	m_SsaoFramebuffer.Resize(size);
-	m_SsaoBlurFramebuffer.Resize(size);
+	ResizeRenderTargets();
+}
+
+void Renderer::SetRenderScale(const f32 renderScale)
+{
+	m_RenderScale = renderScale;
+	ResizeRenderTargets();
+}
+
+f32 Renderer::GetRenderScale() const { return m_RenderScale; }
+
+glm::uvec2 Renderer::GetRenderSize() const { return m_ViewportSize; }
+
+void Renderer::SetDynamicResolutionSettings(const DynamicResolutionSettings& settings)
+{
+	m_DynamicResolutionController.SetSettings(settings);
+
+	const DynamicResolutionSettings& validatedSettings = m_DynamicResolutionController.GetSettings();
+	spdlog::info("Dynamic resolution {} (target {:.2f} ms, scale between {:.2f} and {:.2f})",
+		validatedSettings.enabled ? "enabled" : "disabled",
+		validatedSettings.targetFrameTimeMs,
+		validatedSettings.minScale,
+		validatedSettings.maxScale);
+
+	SetRenderScale(validatedSettings.enabled ? m_DynamicResolutionController.GetScale() : 1.0f);
+}
+
+const DynamicResolutionSettings& Renderer::GetDynamicResolutionSettings() const
+{
+	return m_DynamicResolutionController.GetSettings();
+}
+
+void Renderer::SetTextureStreamingSettings(const TextureStreamingSettings& settings)
+{
+	m_TextureResidencyManager.SetSettings(settings);
+
+	const TextureStreamingSettings& validatedSettings = m_TextureResidencyManager.GetSettings();
+	m_TextureManager.SetInitialMaxSize(validatedSettings.enabled ? validatedSettings.initialMaxSize : 0);
+
+	spdlog::info("Texture streaming {} (budget {} MiB, initial size {})",
+		validatedSettings.enabled ? "enabled" : "disabled",
+		validatedSettings.budgetMb,
+		validatedSettings.initialMaxSize);
+}
+
+const TextureStreamingSettings& Renderer::GetTextureStreamingSettings() const
+{
+	return m_TextureResidencyManager.GetSettings();
+}
+
+void Renderer::SetGeometryResidency(const GeometryResidency residency) { m_GeometryResidency = residency; }
+
+GeometryResidency Renderer::GetGeometryResidency() const { return m_GeometryResidency; }
+
+usize Renderer::ReuploadMeshes()
+{
+	Timer timer;
+	usize meshesCount = 0;
+	usize uploadedBytes = 0;
+	for (Mesh& mesh : m_Meshes)
+	{
+		if (mesh.GetResidency() != GeometryResidency::KeepForReupload)
+		{
+			continue;
+		}
+
+		const MeshCpuData& cpuData = mesh.GetCpuData();
+		uploadedBytes += cpuData.vertices.size_bytes() + cpuData.indices.size_bytes();
+		mesh.Reupload();
+		meshesCount++;
+	}
+
+	if (meshesCount == 0)
+	{
+		spdlog::info("No mesh kept its geometry for a re-upload, set the residency to {} in data/geometry.cfg",
+			ToString(GeometryResidency::KeepForReupload));
+		return 0;
+	}
+
+	constexpr f64 bytesPerMebibyte = 1024.0 * 1024.0;
+	spdlog::info("Uploaded {} meshes again ({:0.1f} MiB) in {:0.0f} ms",
+		meshesCount,
+		static_cast<f64>(uploadedBytes) / bytesPerMebibyte,
+		timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	return meshesCount;
+}
+
+void Renderer::SetGpuMemorySettings(const GpuMemorySettings& settings)
+{
+	GetGpuMemoryTracker().SetSettings(settings);
+	spdlog::info("GPU memory budget {} MiB", GetGpuMemoryTracker().GetSettings().budgetMb);
+}
+
+GpuMemoryReport Renderer::GetGpuMemoryReport() const { return GetGpuMemoryTracker().GetReport(); }
+
+void Renderer::LogGpuMemoryReport() const { GetGpuMemoryTracker().LogReport(); }
+
+std::vector<GpuPassTiming> Renderer::GetGpuPassTimings() const { return m_GpuProfiler.GetPassTimings(); }
+
+[[maybe_unused]] void Renderer::SetGpuPassTimingsLogInterval(const u32 logIntervalFrames)
+{
+	m_GpuProfiler.SetLogInterval(logIntervalFrames);
+}
+
+glm::uvec2 Renderer::ComputeRenderSize() const
+{
+	const glm::vec2 scaledSize = glm::round(glm::vec2{ m_WindowSize } * m_RenderScale);
+	return glm::max(glm::uvec2{ scaledSize }, glm::uvec2{ 1 });
+}
+
+void Renderer::ResizeRenderTargets()
+{
+	const glm::uvec2 renderSize = ComputeRenderSize();
+
+	if (!m_IsInitialized || renderSize == m_ViewportSize)
+	{
+		m_ViewportSize = renderSize;
+		return;
+	}
+
+	m_ViewportSize = renderSize;
+	m_HdrFramebuffer.Resize(renderSize);
+	m_GBufferFramebuffer.Resize(renderSize);
+	m_SsaoFramebuffer.Resize(renderSize);
+	m_SsaoBlurFramebuffer.Resize(renderSize);
+	for (Framebuffer& historyFramebuffer : m_SsaoHistoryFramebuffers)
+	{
+		historyFramebuffer.Resize(renderSize);
+	}
+	m_IsSsaoHistoryValid = false;
+
+	m_BloomFramebuffer.Delete();
+	InitBloomFramebuffer(renderSize);
 }
 
 void Renderer::Clear(const GLbitfield mask)// NOLINT(readability-convert-member-functions-to-static)
@@ -1240,19 +2210,24 @@ void Renderer::SetOpenGlCapability(const bool enabled, const GLenum capability,
 void Renderer::Delete()
 {
 	m_IsInitialized = false;
+	GetGpuMemoryTracker().SetBudgetCallback({});
+	m_GpuFrameTimer.Delete();
+	m_GpuProfiler.Delete();
+	m_GBufferMeshletCuller.Delete();
+	m_ShadowMeshletCuller.Delete();
 	m_MatricesUniformBuffer.Delete();
+	m_TextureResidencyManager.Clear();
 	m_TextureManager.Delete();
+	m_ThreadPool.Delete();
 
 	for (auto& mesh : m_Meshes)
 	{
 		mesh.Delete();
 	}
+	m_GeometryArena.Clear();
 
 	m_DepthPipeline.Delete();
-	for (Framebuffer& lightDepthMapFramebuffer : m_LightDepthMapFramebuffers)
-	{
-		lightDepthMapFramebuffer.Delete();
-	}
+	m_ShadowMapFramebuffer.Delete();
 
 	m_HdrFramebuffer.Delete();
 	m_HdrPipeline.Delete();
@@ -1261,9 +2236,10 @@ void Renderer::Delete()
 	m_BloomFramebuffer.Delete();
 	m_DownsamplePipeline.Delete();
 	m_UpsamplePipeline.Delete();
+	m_DownsampleComputePipeline.Delete();
+	m_UpsampleComputePipeline.Delete();
 
 	m_PointLightPipeline.Delete();
-	m_GBufferPipeline.Delete();
 	m_GBufferFramebuffer.Delete();
 	m_DebugSphereLight.Delete();
 	m_DebugLightsPipeline.Delete();
@@ -1272,20 +2248,22 @@ void Renderer::Delete()
 	m_SsaoFramebuffer.Delete();
 	m_SsaoBlurFramebuffer.Delete();
 	m_SsaoBlurPipeline.Delete();
+	for (Framebuffer& historyFramebuffer : m_SsaoHistoryFramebuffers)
+	{
+		historyFramebuffer.Delete();
+	}
+	m_SsaoTemporalPipeline.Delete();
 	m_SkyboxCaptureFramebuffer.Delete();
 	m_EquirectangularToCubemapPipeline.Delete();
 	m_HdrTexture.Delete();
-	glDeleteTextures(1, &m_EnvironmentCubemap);
+	DeleteBakedSkybox();
 	m_CubemapMesh.Delete();
 	m_CubemapPipeline.Delete();
 	m_IrradiancePipeline.Delete();
 	m_PrefilterShader.Delete();
-	glDeleteTextures(1, &m_IrradianceMap);
-	glDeleteTextures(1, &m_PrefilterMap);
 	m_BrdfPipeline.Delete();
 	m_BrdfFramebuffer.Delete();
 	m_AmbientIblPipeline.Delete();
-	m_GBufferNoAoPipeline.Delete();
 	m_GBufferArmPipeline.Delete();
 }
 
@@ -1293,7 +2271,8 @@ void Renderer::Delete()
 
 std::expected<std::vector<usize>, std::string> Renderer::LoadModel(const std::filesystem::path& path, bool flipUVs)
 {
-	Assimp::Importer importer;
+	PROFILE_FUNCTION();
+
 	u32 assimpImportFlags = aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices
 							| aiProcess_Triangulate | aiProcess_GenUVCoords | aiProcess_SortByPType;
 	if (flipUVs)
@@ -1301,41 +2280,194 @@ std::expected<std::vector<usize>, std::string> Renderer::LoadModel(const std::fi
 		assimpImportFlags |= aiProcess_FlipUVs;
 	}
 
+	const auto workingDirectory = path.parent_path();
+	const std::filesystem::path cachePath = GetModelCachePath(path);
+
+	Timer timer;
+	timer.Start();
+
+	// The buffers of a glTF hold its geometry, so the cache must be rebuilt when they change too
+	std::vector<std::filesystem::path> dependencyPaths{};
+	if (IsGltfPath(path))
+	{
+		auto bufferPaths = GetGltfBufferPaths(path);
+		if (!bufferPaths)
+		{
+			return std::unexpected(bufferPaths.error());
+		}
+
+		dependencyPaths = std::move(bufferPaths.value());
+	}
+
+	const auto cacheKey = ComputeModelCacheKey(path, dependencyPaths, assimpImportFlags);
+	if (!cacheKey)
+	{
+		return std::unexpected(cacheKey.error());
+	}
+
+	// On a warm start, the meshes are uploaded straight from the mapped cache and Assimp never runs
+	const auto mappedCache = MappedFile::Open(cachePath);
+	if (mappedCache)
+	{
+		mappedCache->AdviseSequential();
+		const auto cachedModel = ReadModelCache(mappedCache->GetData(), cacheKey.value());
+		if (cachedModel)
+		{
+			spdlog::info("Read the model cache {} in {:0.0f} ms",
+				cachePath.string(),
+				timer.RestartAndGetElapsedTime().GetInMilliseconds());
+			return InstantiateModel(cachedModel.value(), workingDirectory);
+		}
+
+		spdlog::info("Ignoring the model cache {} : {}", cachePath.string(), cachedModel.error());
+	}
+
+	// The glTF files are read natively, and Assimp imports the other formats and the glTF files that use features the
+	// native loader does not handle
+	std::expected<ImportedModel, std::string> importedModel = std::unexpected(std::string{});
+	if (IsGltfPath(path))
+	{
+		importedModel = ImportGltfModel(path, flipUVs, m_ThreadPool);
+		if (!importedModel)
+		{
+			spdlog::warn("Importing {} with Assimp : {}", path.string(), importedModel.error());
+		}
+	}
+
+	if (!importedModel)
+	{
+		importedModel = ImportModel(path, assimpImportFlags, m_ThreadPool);
+		if (!importedModel)
+		{
+			return std::unexpected(importedModel.error());
+		}
+	}
+
+	OptimizeImportedModel(importedModel.value(), m_ThreadPool);
+
+	timer.RestartAndGetElapsedTime();
+
+	const auto saveResult = SaveModelCache(cachePath, cacheKey.value(), importedModel->data);
+	if (!saveResult)
+	{
+		spdlog::warn("Could not save the model cache : {}", saveResult.error());
+	}
+	else
+	{
+		spdlog::info("Saved the model cache {} in {:0.0f} ms",
+			cachePath.string(),
+			timer.RestartAndGetElapsedTime().GetInMilliseconds());
+	}
+
+	return InstantiateModel(importedModel->data, workingDirectory);
+}
+
+std::expected<ImportedModel, std::string> Renderer::ImportModel(
+	const std::filesystem::path& path, const u32 importFlags, ThreadPool& threadPool)
+{
+	PROFILE_FUNCTION();
+
+	Assimp::Importer importer;
 	const auto pathString = path.string();
 
 	Timer timer;
 	timer.Start();
 
-	const aiScene* assimpScene = importer.ReadFile(pathString.c_str(), assimpImportFlags);
+	const aiScene* importedScene = nullptr;
+	{
+		PROFILE_ZONE("AssimpReadFile");
+		importedScene = importer.ReadFile(pathString.c_str(), importFlags);
+	}
 
-	if (!assimpScene || assimpScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !assimpScene->mRootNode)
+	if (!importedScene || importedScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !importedScene->mRootNode)
 	{
 		return std::unexpected(importer.GetErrorString());
 	}
 
+	// The scene is taken from the importer, so that each Assimp mesh can be freed as soon as it is converted
+	std::unique_ptr<aiScene> assimpScene{ importer.GetOrphanedScene() };
+
 	spdlog::info(
 		"Assimp imported the model {} in {:0.0f} ms", pathString, timer.RestartAndGetElapsedTime().GetInMilliseconds());
 
-	auto workingDirectory = path.parent_path();
-	const std::size_t materialIndexOffset = m_MaterialManager.Size();
-	const std::vector<std::size_t> materialIndicesLoaded =
-		m_MaterialManager.LoadMaterialsFromAssimpScene(assimpScene, workingDirectory, m_TextureManager);
+	ImportedModel importedModel{};
+	ModelData& model = importedModel.data;
 
-	spdlog::info("Loaded materials in {:0.0f} ms", timer.RestartAndGetElapsedTime().GetInMilliseconds());
+	const std::span assimpMaterials{ assimpScene->mMaterials, assimpScene->mNumMaterials };
+	std::vector<u32> materialIndices(assimpMaterials.size(), InvalidModelIndex);
+	for (usize i = 0; i < assimpMaterials.size(); i++)
+	{
+		auto descriptor = MaterialManager::ReadMaterialDescriptor(assimpMaterials[i]);
+		if (descriptor)
+		{
+			materialIndices[i] = static_cast<u32>(model.materials.size());
+			model.materials.push_back(std::move(descriptor.value()));
+		}
+	}
+
+	// Each mesh is converted once, even if several nodes use it, and the meshes without a loaded material are skipped.
+	// The vertices and faces are split in chunks converted on the thread pool, so that even a single big mesh is
+	// converted on every core.
+	const std::span assimpSceneMeshes{ assimpScene->mMeshes, assimpScene->mNumMeshes };
+	std::vector<u32> modelMeshIndices(assimpSceneMeshes.size(), InvalidModelIndex);
+	std::vector<std::vector<std::future<void>>> meshTasks{};
+	std::vector<usize> assimpMeshIndices{};
+	importedModel.vertexArrays.reserve(assimpSceneMeshes.size());
+	importedModel.indexArrays.reserve(assimpSceneMeshes.size());
+	importedModel.lodArrays.reserve(assimpSceneMeshes.size());
+	for (usize i = 0; i < assimpSceneMeshes.size(); i++)
+	{
+		const aiMesh* assimpMesh = assimpSceneMeshes[i];
+		const u32 materialIndex = materialIndices[assimpMesh->mMaterialIndex];
+		if (materialIndex == InvalidModelIndex)
+		{
+			continue;
+		}
 
-	m_Meshes.reserve(m_Meshes.size() + assimpScene->mNumMeshes);
+		// The faces are sorted by primitive type during the import, so all the faces of a mesh have the same size.
+		// Everything is drawn as triangles, so the meshes of points and lines are skipped.
+		const usize facesCount = assimpMesh->mNumFaces;
+		const usize indicesPerFace = facesCount > 0 ? assimpMesh->mFaces[0].mNumIndices : 0;
+		if (indicesPerFace != 3)
+		{
+			continue;
+		}
+
+		// The arrays are sized before the tasks start and are never resized, so the spans given to the tasks stay valid
+		const std::span<Vertex> vertices = importedModel.vertexArrays.emplace_back(assimpMesh->mNumVertices);
+		const std::span<u32> indices = importedModel.indexArrays.emplace_back(facesCount * indicesPerFace);
+		importedModel.lodArrays.emplace_back();
+		std::vector<std::future<void>>& chunkTasks = meshTasks.emplace_back();
+
+		for (usize firstVertex = 0; firstVertex < vertices.size(); firstVertex += MeshProcessingChunkSize)
+		{
+			const std::span<Vertex> chunk =
+				vertices.subspan(firstVertex, std::min(MeshProcessingChunkSize, vertices.size() - firstVertex));
+			chunkTasks.push_back(threadPool.Submit(
+				[assimpMesh, firstVertex, chunk] { ProcessMeshVertices(assimpMesh, firstVertex, chunk); }));
+		}
+
+		for (usize firstFace = 0; firstFace < facesCount; firstFace += MeshProcessingChunkSize)
+		{
+			const usize chunkFacesCount = std::min(MeshProcessingChunkSize, facesCount - firstFace);
+			const std::span<u32> chunk = indices.subspan(firstFace * indicesPerFace, chunkFacesCount * indicesPerFace);
+			chunkTasks.push_back(threadPool.Submit(
+				[assimpMesh, firstFace, chunk] { ProcessMeshIndices(assimpMesh, firstFace, chunk); }));
+		}
+
+		assimpMeshIndices.push_back(i);
+		modelMeshIndices[i] = static_cast<u32>(model.meshes.size());
+		model.meshes.push_back({ vertices, indices, {}, {}, materialIndex });
+	}
 
 	std::queue<const aiNode*> assimpNodes;
 	assimpNodes.push(assimpScene->mRootNode);
-	const std::span assimpSceneMeshes{ assimpScene->mMeshes, assimpScene->mNumMeshes };
-
-	std::vector<usize> addedNodes;
 
 	// Add the node that holds the mesh
-	std::optional<usize> currentParent = m_SceneGraph.AddElementToRoot(InvalidId, InvalidId, glm::mat4(1.0f));
-	addedNodes.push_back(currentParent.value());
+	model.nodes.push_back({ ModelNodeLink::Root, InvalidModelIndex, InvalidModelIndex, glm::mat4(1.0f) });
+	std::optional<u32> currentParent = 0;
 
-	std::optional<usize> currentSibling{};
+	std::optional<u32> currentSibling{};
 	while (!assimpNodes.empty())
 	{
 		const aiNode* currentAssimpNode = assimpNodes.front();
@@ -1345,54 +2477,34 @@ std::expected<std::vector<usize>, std::string> Renderer::LoadModel(const std::fi
 		// If this node has no mesh, we create an empty one
 		if (nodeMeshIndices.empty())
 		{
-			const usize nodeIndex =
-				m_SceneGraph.AddChild(currentParent.value(), InvalidId, InvalidId, glm::mat4{ 1.0f });
-			currentParent = nodeIndex;
-			addedNodes.emplace_back(nodeIndex);
+			model.nodes.push_back(
+				{ ModelNodeLink::Child, currentParent.value(), InvalidModelIndex, glm::mat4{ 1.0f } });
+			currentParent = static_cast<u32>(model.nodes.size() - 1);
 		}
 
-		for (const u32 meshIndex : nodeMeshIndices)
+		for (const u32 assimpMeshIndex : nodeMeshIndices)
 		{
-			const aiMesh* assimpMesh = assimpSceneMeshes[meshIndex];
-
-			// Check if we loaded this material, if not, go to the next mesh
-			if (std::ranges::find(materialIndicesLoaded, assimpMesh->mMaterialIndex) == materialIndicesLoaded.end())
+			// Check if we loaded the material of this mesh, if not, go to the next mesh
+			const u32 meshIndex = modelMeshIndices[assimpMeshIndex];
+			if (meshIndex == InvalidModelIndex)
 			{
 				continue;
 			}
 
-			auto processMeshResult = ProcessMesh(assimpMesh, materialIndexOffset, materialIndicesLoaded);
-
-			if (!processMeshResult)
-			{
-				assert(false);
-			}
-
-			auto& [mesh, meshMaterialIndex] = processMeshResult.value();
-
-			m_Meshes.push_back(std::move(mesh));
-
 			const glm::mat4 transformMatrix = ConvertMatAssimpToGlm(currentAssimpNode->mTransformation);
 
-			usize nodeIndex = InvalidId;
-
 			if (currentSibling)
 			{
-				nodeIndex = m_SceneGraph.AddSibling(
-					currentSibling.value(), m_Meshes.size() - 1, meshMaterialIndex, transformMatrix);
-				currentSibling = nodeIndex;
+				model.nodes.push_back({ ModelNodeLink::Sibling, currentSibling.value(), meshIndex, transformMatrix });
+				currentSibling = static_cast<u32>(model.nodes.size() - 1);
 			}
 
 			if (currentParent)
 			{
-				nodeIndex = m_SceneGraph.AddChild(
-					currentParent.value(), m_Meshes.size() - 1, meshMaterialIndex, transformMatrix);
+				model.nodes.push_back({ ModelNodeLink::Child, currentParent.value(), meshIndex, transformMatrix });
 				currentParent = std::nullopt;
-				currentSibling = nodeIndex;
+				currentSibling = static_cast<u32>(model.nodes.size() - 1);
 			}
-
-			assert(nodeIndex != InvalidId);
-			addedNodes.emplace_back(nodeIndex);
 		}
 
 		const std::span nodeChildren{ currentAssimpNode->mChildren, currentAssimpNode->mNumChildren };
@@ -1402,27 +2514,250 @@ std::expected<std::vector<usize>, std::string> Renderer::LoadModel(const std::fi
 			// and if the current node had meshes
 			if (i == 0 && !nodeMeshIndices.empty())
 			{
-				currentParent = addedNodes.size() - 1;
+				currentParent = static_cast<u32>(model.nodes.size() - 1);
 			}
 			assimpNodes.push(nodeChildren[i]);
 		}
 	}
 
-	spdlog::info("Converted model {} in {:0.0f} ms", pathString, timer.RestartAndGetElapsedTime().GetInMilliseconds());
+	// The node tree is walked while the meshes are converted, then each Assimp mesh is freed once its chunks are done,
+	// while the next meshes are still being converted
+	for (usize meshIndex = 0; meshIndex < meshTasks.size(); meshIndex++)
+	{
+		for (std::future<void>& chunkTask : meshTasks[meshIndex])
+		{
+			chunkTask.get();
+		}
+
+		aiMesh*& assimpMesh = assimpScene->mMeshes[assimpMeshIndices[meshIndex]];
+		delete assimpMesh;
+		assimpMesh = nullptr;
+	}
+
+	// The remaining meshes were skipped and the materials and nodes were already read
+	assimpScene.reset();
+
+	spdlog::info("Converted {} meshes on {} threads in {:0.0f} ms",
+		model.meshes.size(),
+		threadPool.GetThreadsCount(),
+		timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	return importedModel;
+}
+
+void Renderer::OptimizeImportedModel(ImportedModel& importedModel, ThreadPool& threadPool)
+{
+	PROFILE_FUNCTION();
+
+	ModelData& model = importedModel.data;
+
+	Timer timer;
+	timer.Start();
+
+	// The triangles and vertices are reordered and the levels of detail and meshlets are generated before the cache is
+	// saved, so this is only paid on the first import. The outer arrays are not resized, so each task can use its own
+	// mesh.
+	importedModel.meshletArrays.resize(model.meshes.size());
+	std::vector<std::future<MeshOptimizationStats>> optimizationTasks{};
+	optimizationTasks.reserve(model.meshes.size());
+	for (usize meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
+	{
+		optimizationTasks.push_back(threadPool.Submit([&importedModel, meshIndex] {
+			PROFILE_ZONE("OptimizeMesh");
+			std::vector<Vertex>& vertices = importedModel.vertexArrays[meshIndex];
+			std::vector<u32>& indices = importedModel.indexArrays[meshIndex];
+			const MeshOptimizationStats stats = OptimizeMesh(vertices, indices);
+			importedModel.lodArrays[meshIndex] = GenerateLods(vertices, indices);
+
+			// The meshlets follow the vertex cache order of the most detailed level
+			const MeshLod& fullDetailLod = importedModel.lodArrays[meshIndex].front();
+			importedModel.meshletArrays[meshIndex] =
+				BuildMeshlets(vertices, indices, fullDetailLod.firstIndex, fullDetailLod.indicesCount);
+			return stats;
+		}));
+	}
+
+	f32 weightedAcmrBefore = 0.0f;
+	f32 weightedAcmrAfter = 0.0f;
+	usize trianglesCount = 0;
+	for (std::future<MeshOptimizationStats>& optimizationTask : optimizationTasks)
+	{
+		const MeshOptimizationStats stats = optimizationTask.get();
+		weightedAcmrBefore += stats.acmrBefore * static_cast<f32>(stats.trianglesCount);
+		weightedAcmrAfter += stats.acmrAfter * static_cast<f32>(stats.trianglesCount);
+		trianglesCount += stats.trianglesCount;
+	}
+
+	// The levels of detail are appended to the indices, which moved them to a new buffer
+	usize lodsCount = 0;
+	usize meshletsCount = 0;
+	for (usize meshIndex = 0; meshIndex < model.meshes.size(); meshIndex++)
+	{
+		model.meshes[meshIndex].indices = importedModel.indexArrays[meshIndex];
+		model.meshes[meshIndex].lods = importedModel.lodArrays[meshIndex];
+		model.meshes[meshIndex].meshlets = importedModel.meshletArrays[meshIndex];
+		lodsCount += importedModel.lodArrays[meshIndex].size() - 1;
+		meshletsCount += importedModel.meshletArrays[meshIndex].size();
+	}
+
+	if (trianglesCount > 0)
+	{
+		spdlog::info("Optimized {} meshes and generated {} levels of detail and {} meshlets in {:0.0f} ms, ACMR "
+					 "{:0.3f} -> {:0.3f} with a cache of {} vertices",
+			optimizationTasks.size(),
+			lodsCount,
+			meshletsCount,
+			timer.RestartAndGetElapsedTime().GetInMilliseconds(),
+			weightedAcmrBefore / static_cast<f32>(trianglesCount),
+			weightedAcmrAfter / static_cast<f32>(trianglesCount),
+			VertexCacheSize);
+	}
+}
+
+std::vector<usize> Renderer::InstantiateModel(const ModelData& model, const std::filesystem::path& workingDirectory)
+{
+	PROFILE_FUNCTION();
+
+	Timer timer;
+	timer.Start();
+
+	const std::size_t materialIndexOffset = m_MaterialManager.Size();
+	const std::size_t meshIndexOffset = m_Meshes.size();
+
+	// The textures are decoded on the thread pool while the meshes are uploaded, then uploaded at the end
+	m_TextureManager.BeginAsyncLoading(m_ThreadPool);
+	for (const MaterialDescriptor& material : model.materials)
+	{
+		m_MaterialManager.LoadMaterial(material, workingDirectory, m_TextureManager);
+	}
+
+	spdlog::info("Loaded materials in {:0.0f} ms", timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	// The model data only lives until the end of the load, so what the meshes keep is copied in the geometry arena
+	const usize arenaUsedSize = m_GeometryArena.GetUsedSize();
+	m_Meshes.reserve(m_Meshes.size() + model.meshes.size());
+	for (const ModelMeshData& meshData : model.meshes)
+	{
+		Mesh mesh;
+		mesh.Init(meshData.vertices, meshData.indices, VertexFormat::Quantized, meshData.lods, meshData.meshlets);
+
+		MeshCpuData cpuData{};
+		switch (m_GeometryResidency)
+		{
+		case GeometryResidency::DropAfterUpload:
+			break;
+		case GeometryResidency::KeepForPicking:
+		{
+			const std::span<glm::vec3> positions = m_GeometryArena.Allocate<glm::vec3>(meshData.vertices.size());
+			std::ranges::transform(meshData.vertices, positions.begin(), &Vertex::position);
+			cpuData.positions = positions;
+
+			const usize fullDetailIndicesCount =
+				meshData.lods.empty() ? meshData.indices.size() : meshData.lods[0].indicesCount;
+			cpuData.indices = m_GeometryArena.Copy(meshData.indices.first(fullDetailIndicesCount));
+			break;
+		}
+		case GeometryResidency::KeepForReupload:
+			cpuData.vertices = m_GeometryArena.Copy(meshData.vertices);
+			cpuData.indices = m_GeometryArena.Copy(meshData.indices);
+			break;
+		}
+		mesh.SetCpuData(m_GeometryResidency, cpuData);
+
+		m_Meshes.push_back(std::move(mesh));
+	}
+
+	std::vector<usize> addedNodes;
+	addedNodes.reserve(model.nodes.size());
+	for (const ModelNodeData& node : model.nodes)
+	{
+		std::size_t meshId = InvalidId;
+		std::size_t materialId = InvalidId;
+		if (node.meshIndex != InvalidModelIndex)
+		{
+			meshId = meshIndexOffset + node.meshIndex;
+			materialId = materialIndexOffset + model.meshes[node.meshIndex].materialIndex;
+		}
+
+		usize nodeIndex = InvalidId;
+		switch (node.link)
+		{
+		case ModelNodeLink::Root:
+			nodeIndex = m_SceneGraph.AddElementToRoot(meshId, materialId, node.transform);
+			break;
+		case ModelNodeLink::Child:
+			nodeIndex = m_SceneGraph.AddChild(addedNodes[node.linkedNodeIndex], meshId, materialId, node.transform);
+			break;
+		case ModelNodeLink::Sibling:
+			nodeIndex = m_SceneGraph.AddSibling(addedNodes[node.linkedNodeIndex], meshId, materialId, node.transform);
+			break;
+		}
+
+		assert(nodeIndex != InvalidId);
+		addedNodes.emplace_back(nodeIndex);
+	}
+
+	spdlog::info("Uploaded {} meshes in {:0.0f} ms",
+		model.meshes.size(),
+		timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	constexpr f64 bytesPerMebibyte = 1024.0 * 1024.0;
+	if (m_GeometryResidency != GeometryResidency::DropAfterUpload)
+	{
+		spdlog::info("Kept {:0.1f} MiB of geometry on the CPU, the geometry arena uses {:0.1f} MiB",
+			static_cast<f64>(m_GeometryArena.GetUsedSize() - arenaUsedSize) / bytesPerMebibyte,
+			static_cast<f64>(m_GeometryArena.GetReservedSize()) / bytesPerMebibyte);
+	}
+
+	m_TextureManager.FinishAsyncLoading();
 
-	return { std::move(addedNodes) };
+	spdlog::info("Uploaded textures in {:0.0f} ms", timer.RestartAndGetElapsedTime().GetInMilliseconds());
+
+	// The models often come with materials that no mesh uses, they are released so that their textures are deleted
+	// unless another material shares them. This is done once the textures are uploaded, their slots can then be reused.
+	std::vector<bool> isMaterialUsed(model.materials.size(), false);
+	for (const ModelNodeData& node : model.nodes)
+	{
+		if (node.meshIndex != InvalidModelIndex)
+		{
+			isMaterialUsed[model.meshes[node.meshIndex].materialIndex] = true;
+		}
+	}
+
+	usize releasedMaterialsCount = 0;
+	for (usize i = 0; i < isMaterialUsed.size(); i++)
+	{
+		if (!isMaterialUsed[i])
+		{
+			m_MaterialManager.ReleaseMaterial(materialIndexOffset + i, m_TextureManager);
+			releasedMaterialsCount++;
+		}
+	}
+
+	if (releasedMaterialsCount > 0)
+	{
+		spdlog::info("Released {} unused materials", releasedMaterialsCount);
+	}
+
+	const TextureCacheStats textureCacheStats = m_TextureManager.GetCacheStats();
+	spdlog::info("Texture cache : {} hits, {} misses, {} textures using {:0.1f} MiB, {:0.1f} MiB saved",
+		textureCacheStats.hitsCount,
+		textureCacheStats.missesCount,
+		textureCacheStats.texturesCount,
+		static_cast<f64>(textureCacheStats.residentBytes) / bytesPerMebibyte,
+		static_cast<f64>(textureCacheStats.savedBytes) / bytesPerMebibyte);
+	GetGpuMemoryTracker().LogReport();
+
+	return addedNodes;
 }
 
-std::optional<ProcessMeshResult> Renderer::ProcessMesh(
-	const aiMesh* assimpMesh, std::size_t materialIndexOffset, const std::vector<std::size_t>& loadedMaterialsIndices)
+void Renderer::ProcessMeshVertices(const aiMesh* assimpMesh, const usize firstVertex, const std::span<Vertex> vertices)
 {
-	std::vector<Vertex> vertices{};
-	vertices.reserve(assimpMesh->mNumVertices);
-	const std::span assimpMeshVertices{ assimpMesh->mVertices, assimpMesh->mNumVertices };
-	const std::span assimpMeshNormals{ assimpMesh->mNormals, assimpMesh->mNumVertices };
-	const std::span assimpMeshTangents{ assimpMesh->mTangents, assimpMesh->mNumVertices };
+	const std::span assimpMeshVertices{ assimpMesh->mVertices + firstVertex, vertices.size() };
+	const std::span assimpMeshNormals{ assimpMesh->mNormals + firstVertex, vertices.size() };
+	const std::span assimpMeshTangents{ assimpMesh->mTangents + firstVertex, vertices.size() };
 
-	for (std::size_t i = 0; i < assimpMesh->mNumVertices; ++i)
+	for (std::size_t i = 0; i < vertices.size(); ++i)
 	{
 		const aiVector3D meshVertex = assimpMeshVertices[i];
 		const aiVector3D meshNormal = assimpMeshNormals[i];
@@ -1431,17 +2766,17 @@ std::optional<ProcessMeshResult> Renderer::ProcessMesh(
 		glm::vec2 textureCoords(0.0f);
 		if (assimpMesh->mTextureCoords[0])
 		{
-			const std::span assimpMeshTextureCoords{ assimpMesh->mTextureCoords[0], assimpMesh->mNumVertices };
+			const std::span assimpMeshTextureCoords{ assimpMesh->mTextureCoords[0] + firstVertex, vertices.size() };
 			const auto meshTextureCoords = assimpMeshTextureCoords[i];
 			textureCoords.x = meshTextureCoords.x;
 			textureCoords.y = meshTextureCoords.y;
 		}
 
-		const Vertex vertex{ {
-								 meshVertex.x,
-								 meshVertex.y,
-								 meshVertex.z,
-							 },
+		vertices[i] = Vertex{ {
+								  meshVertex.x,
+								  meshVertex.y,
+								  meshVertex.z,
+							  },
 			{
 				meshNormal.x,
 				meshNormal.y,
@@ -1449,38 +2784,22 @@ std::optional<ProcessMeshResult> Renderer::ProcessMesh(
 			},
 			textureCoords,
 			{ meshTangent.x, meshTangent.y, meshTangent.z } };
-		vertices.push_back(vertex);
 	}
+}
+
+void Renderer::ProcessMeshIndices(const aiMesh* assimpMesh, const usize firstFace, const std::span<u32> indices)
+{
+	const usize indicesPerFace = assimpMesh->mFaces[firstFace].mNumIndices;
+	const std::span assimpMeshFaces{ assimpMesh->mFaces + firstFace, indices.size() / indicesPerFace };
 
-	std::vector<u32> indices{};
-	indices.reserve(static_cast<std::size_t>(assimpMesh->mNumFaces) * 3);
-	const std::span assimpMeshFaces{ assimpMesh->mFaces, assimpMesh->mNumFaces };
+	usize indexOffset = 0;
 	for (const aiFace& face : assimpMeshFaces)
 	{
+		assert(face.mNumIndices == indicesPerFace);
 		const std::span faceIndices{ face.mIndices, face.mNumIndices };
-		for (const u32 index : faceIndices)
-		{
-
-			indices.push_back(index);
-		}
+		std::ranges::copy(faceIndices, indices.begin() + static_cast<std::ptrdiff_t>(indexOffset));
+		indexOffset += indicesPerFace;
 	}
-
-	for (usize i = 0; i < loadedMaterialsIndices.size(); i++)
-	{
-		if (loadedMaterialsIndices.at(i) == assimpMesh->mMaterialIndex)
-		{
-			Mesh mesh;
-
-			const std::size_t materialIndex = materialIndexOffset + i;
-			mesh.Init(std::move(vertices), std::move(indices));
-
-			return ProcessMeshResult{ std::move(mesh), materialIndex };
-		}
-	}
-
-	// We should not be here
-	spdlog::error("Did not find material index for this mesh {} {}", __LINE__, __FILE__);
-	return std::nullopt;
 }
 
 void Renderer::SetDirectionalLight(DirectionalLight directionalLight)
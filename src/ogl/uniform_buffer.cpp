@@ -16,7 +16,9 @@ module;
 
 export module uniform_buffer;
 
+import number_types;
 import utils;
+import gpu_memory;
 
 export namespace stw
 {
@@ -42,6 +44,9 @@ class UniformBuffer
 private:
 	GLuint m_Ubo{};
 	GLuint m_BindingIndex{};
+
+	// Changing the data does not change which buffer is used, so SetData stays const
+	mutable usize m_Size = 0;
 };
 
 UniformBuffer::~UniformBuffer()
@@ -56,6 +61,7 @@ void UniformBuffer::Init(const GLuint bindingIndex)
 {
 	glGenBuffers(1, &m_Ubo);
 	m_BindingIndex = bindingIndex;
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::UniformBuffer, 0);
 }
 
 void UniformBuffer::Bind() const
@@ -88,6 +94,9 @@ void UniformBuffer::SetData(const GLsizeiptr size, const GLvoid* data) const
 	}
 
 	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STATIC_DRAW);
+
+	GetGpuMemoryTracker().TrackReallocation(GpuMemoryCategory::UniformBuffer, m_Size, static_cast<usize>(size));
+	m_Size = static_cast<usize>(size);
 }
 
 void UniformBuffer::SetSubData(const GLintptr offset, const GLsizeiptr size, const GLvoid* data) const
@@ -111,6 +120,12 @@ void UniformBuffer::UnBind() const
 
 void UniformBuffer::Delete()
 {
+	if (m_Ubo != 0)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::UniformBuffer, m_Size);
+		m_Size = 0;
+	}
+
 	glDeleteBuffers(1, &m_Ubo);
 	m_Ubo = 0;
 }
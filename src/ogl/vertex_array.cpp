@@ -61,7 +61,7 @@ void VertexArray::AddBuffer(const VertexBuffer<T>& vertexBuffer, const VertexBuf
 		const auto offsetVoid = reinterpret_cast<void*>(offset);// NOLINT(performance-no-int-to-ptr)
 
 		glVertexAttribPointer(glIndex, element.count, element.type, element.normalized, layout.GetStride(), offsetVoid);
-		offset += static_cast<std::size_t>(element.count) * VertexBufferElement::GetSizeOfType(element.type);
+		offset += static_cast<std::size_t>(element.GetSize());
 
 		if (element.divisor.has_value())
 		{
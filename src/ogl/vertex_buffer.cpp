@@ -20,6 +20,7 @@ export module vertex_buffer;
 
 import number_types;
 import utils;
+import gpu_memory;
 
 export namespace stw
 {
@@ -45,14 +46,18 @@ class VertexBuffer
 private:
 	GLuint m_BufferId{};
 	bool m_IsInitialized = false;
+
+	// Changing the data does not change which buffer is used, so SetData stays const
+	mutable usize m_Size = 0;
 };
 
 template<class T>
 VertexBuffer<T>::VertexBuffer(VertexBuffer&& other) noexcept
-	: m_BufferId(other.m_BufferId), m_IsInitialized(other.m_IsInitialized)
+	: m_BufferId(other.m_BufferId), m_IsInitialized(other.m_IsInitialized), m_Size(other.m_Size)
 {
 	other.m_BufferId = 0;
 	other.m_IsInitialized = false;
+	other.m_Size = 0;
 }
 
 template<class T>
@@ -74,8 +79,10 @@ VertexBuffer<T>& VertexBuffer<T>::operator=(VertexBuffer&& other) noexcept
 
 	m_BufferId = other.m_BufferId;
 	m_IsInitialized = other.m_IsInitialized;
+	m_Size = other.m_Size;
 	other.m_BufferId = 0;
 	other.m_IsInitialized = false;
+	other.m_Size = 0;
 
 	return *this;
 }
@@ -91,6 +98,7 @@ template<class T>
 void VertexBuffer<T>::Init()
 {
 	glGenBuffers(1, &m_BufferId);
+	GetGpuMemoryTracker().TrackAllocation(GpuMemoryCategory::VertexBuffer, 0);
 	m_IsInitialized = true;
 }
 
@@ -101,6 +109,9 @@ void VertexBuffer<T>::SetData(std::span<const T> data) const
 	Bind();
 	glBufferData(GL_ARRAY_BUFFER, data.size_bytes(), data.data(), GL_STATIC_DRAW);
 	UnBind();
+
+	GetGpuMemoryTracker().TrackReallocation(GpuMemoryCategory::VertexBuffer, m_Size, data.size_bytes());
+	m_Size = data.size_bytes();
 }
 
 template<class T>
@@ -120,6 +131,12 @@ void VertexBuffer<T>::UnBind() const
 template<class T>
 void VertexBuffer<T>::Delete()
 {
+	if (m_IsInitialized)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GpuMemoryCategory::VertexBuffer, m_Size);
+		m_Size = 0;
+	}
+
 	glDeleteBuffers(1, &m_BufferId);
 
 	m_IsInitialized = false;
@@ -40,11 +40,32 @@ export
 				return sizeof(GLfloat);
 			case GL_UNSIGNED_INT:
 				return sizeof(GLuint);
+			case GL_SHORT:
+				return sizeof(GLshort);
+			case GL_UNSIGNED_SHORT:
+				return sizeof(GLushort);
+			case GL_HALF_FLOAT:
+				return sizeof(GLhalf);
+			case GL_INT_2_10_10_10_REV:
+				return sizeof(GLuint);
 			default:
 				spdlog::error("Invalid type sent in {}, {}", __FILE__, __LINE__);
 				return 0;
 			}
 		}
+
+		/**
+		 * Gets the size of the whole attribute in the vertex. The packed types hold every component in one value.
+		 */
+		[[nodiscard]] GLsizei GetSize() const
+		{
+			if (type == GL_INT_2_10_10_10_REV)
+			{
+				return GetSizeOfType(type);
+			}
+
+			return count * GetSizeOfType(type);
+		}
 	};
 
 	class VertexBufferLayout
@@ -62,6 +83,14 @@ export
 		template<typename T>
 		void Push(GLint count, GLuint divisor);
 
+		/**
+		 * Adds an attribute of any OpenGL type, for the normalized and packed formats that have no matching C++ type.
+		 * @param type OpenGL type of the components, like GL_SHORT or GL_INT_2_10_10_10_REV.
+		 * @param count Number of components.
+		 * @param normalized Set this to true to map the integers to [0, 1] or [-1, 1] in the shader.
+		 */
+		void Push(GLenum type, GLint count, bool normalized);
+
 	private:
 		std::vector<VertexBufferElement> m_Elements{};
 		GLsizei m_Stride{};
@@ -91,6 +120,12 @@ export
 	template<>
 	void VertexBufferLayout::Push<u32>(GLint count, GLuint divisor);
 
+	void VertexBufferLayout::Push(const GLenum type, const GLint count, const bool normalized)
+	{
+		m_Elements.push_back({ type, count, static_cast<GLboolean>(normalized ? GL_TRUE : GL_FALSE) });
+		m_Stride += m_Elements.back().GetSize();
+	}
+
 	GLsizei VertexBufferLayout::GetStride() const { return m_Stride; }
 
 	const std::vector<VertexBufferElement>& VertexBufferLayout::GetElements() const { return m_Elements; }
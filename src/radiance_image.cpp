@@ -0,0 +1,400 @@
+/**
+ * @file radiance_image.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions that decode Radiance HDR images scanline by scanline.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <expected>
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define STW_HAS_SSE2
+	#include <immintrin.h>
+#endif
+
+export module radiance_image;
+
+import number_types;
+
+export namespace stw
+{
+/**
+ * Largest finite value of a half float.
+ */
+constexpr f32 MaxHalfValue = 65504.0f;
+
+constexpr usize RgbeComponentsCount = 4;
+constexpr usize RgbComponentsCount = 3;
+
+struct RadianceHeader
+{
+	u32 width;
+	u32 height;
+
+	/**
+	 * Offset of the first scanline in the file.
+	 */
+	usize dataOffset;
+};
+
+/**
+ * Parses the header of a Radiance HDR file. Only the standard orientation (-Y height +X width), where the first
+ * scanline is the top of the image, is supported.
+ * @param file Content of the file.
+ * @return The header or an error message.
+ */
+std::expected<RadianceHeader, std::string> ParseRadianceHeader(std::span<const u8> file);
+
+/**
+ * Decodes one scanline of a Radiance HDR file, flat or run length encoded.
+ * @param file Content of the file.
+ * @param offset Offset of the scanline in the file.
+ * @param rgbe Receives the RGBE pixels of the scanline, its size must be four times the width of the image.
+ * @return The offset of the next scanline or an error message.
+ */
+std::expected<usize, std::string> DecodeRadianceScanline(std::span<const u8> file, usize offset, std::span<u8> rgbe);
+
+/**
+ * Converts RGBE pixels (8 bits mantissas sharing an 8 bits exponent) to RGB floats.
+ * @param rgbe Pixels to convert, four bytes each.
+ * @param rgb Receives the converted pixels, three floats each.
+ */
+void ConvertRgbeToFloats(std::span<const u8> rgbe, std::span<f32> rgb);
+
+/**
+ * Converts floats to half floats, four or eight at a time when the CPU allows it. The values are clamped to
+ * [0, MaxHalfValue], so that very bright pixels like the sun do not become infinite and break the convolutions.
+ * @param values Floats to convert.
+ * @param halves Receives the bits of the half floats, must have the same size as values.
+ */
+void ConvertFloatsToHalves(std::span<const f32> values, std::span<u16> halves);
+
+/**
+ * Converts a single float in [0, MaxHalfValue] to a half float, rounding to the nearest even.
+ */
+[[nodiscard]] u16 ConvertFloatToHalf(f32 value);
+
+/**
+ * Reads a line of the header, without its line return.
+ * @return The line or an error message if the file ends before the line return.
+ */
+std::expected<std::string_view, std::string> ReadHeaderLine(const std::span<const u8> file, usize& offset)
+{
+	const std::string_view text{ reinterpret_cast<const char*>(file.data()), file.size() };
+	const usize end = text.find('\n', offset);
+	if (end == std::string_view::npos)
+	{
+		return std::unexpected("Unexpected end of the header");
+	}
+
+	const std::string_view line = text.substr(offset, end - offset);
+	offset = end + 1;
+	return line;
+}
+
+/**
+ * Parses a dimension of the resolution line, like "-Y 2048".
+ */
+std::expected<u32, std::string> ParseResolutionDimension(std::string_view& line, const std::string_view axis)
+{
+	if (!line.starts_with(axis))
+	{
+		return std::unexpected(std::format("Unsupported resolution line, expected \"{}\"", axis));
+	}
+	line.remove_prefix(axis.size());
+
+	u32 value = 0;
+	const auto [end, error] = std::from_chars(line.data(), line.data() + line.size(), value);
+	if (error != std::errc{} || value == 0)
+	{
+		return std::unexpected("Invalid resolution");
+	}
+	line.remove_prefix(static_cast<usize>(end - line.data()));
+
+	if (line.starts_with(' '))
+	{
+		line.remove_prefix(1);
+	}
+
+	return value;
+}
+
+std::expected<RadianceHeader, std::string> ParseRadianceHeader(const std::span<const u8> file)
+{
+	usize offset = 0;
+
+	auto line = ReadHeaderLine(file, offset);
+	if (!line || !line.value().starts_with("#?"))
+	{
+		return std::unexpected("Not a Radiance HDR file");
+	}
+
+	// The variables end with an empty line
+	while (true)
+	{
+		line = ReadHeaderLine(file, offset);
+		if (!line)
+		{
+			return std::unexpected(line.error());
+		}
+
+		if (line.value().empty())
+		{
+			break;
+		}
+
+		constexpr std::string_view formatVariable = "FORMAT=";
+		if (line.value().starts_with(formatVariable) && line.value().substr(formatVariable.size()) != "32-bit_rle_rgbe")
+		{
+			return std::unexpected(std::format("Unsupported format {}", line.value().substr(formatVariable.size())));
+		}
+	}
+
+	line = ReadHeaderLine(file, offset);
+	if (!line)
+	{
+		return std::unexpected(line.error());
+	}
+
+	std::string_view resolution = line.value();
+	const auto height = ParseResolutionDimension(resolution, "-Y ");
+	if (!height)
+	{
+		return std::unexpected(height.error());
+	}
+
+	const auto width = ParseResolutionDimension(resolution, "+X ");
+	if (!width)
+	{
+		return std::unexpected(width.error());
+	}
+
+	return RadianceHeader{ width.value(), height.value(), offset };
+}
+
+/**
+ * Decodes a scanline that is not run length encoded per channel, with the old run length encoding where a pixel of
+ * 1, 1, 1 repeats the previous pixel.
+ */
+std::expected<usize, std::string> DecodeFlatRadianceScanline(
+	const std::span<const u8> file, usize offset, const std::span<u8> rgbe)
+{
+	const usize width = rgbe.size() / RgbeComponentsCount;
+	usize pixelIndex = 0;
+	u32 repeatShift = 0;
+
+	while (pixelIndex < width)
+	{
+		if (offset + RgbeComponentsCount > file.size())
+		{
+			return std::unexpected("Unexpected end of the pixels");
+		}
+
+		const std::span pixel = file.subspan(offset, RgbeComponentsCount);
+		offset += RgbeComponentsCount;
+
+		if (pixel[0] == 1 && pixel[1] == 1 && pixel[2] == 1)
+		{
+			if (pixelIndex == 0)
+			{
+				return std::unexpected("Run at the start of a scanline");
+			}
+
+			const usize repeatCount = static_cast<usize>(pixel[3]) << repeatShift;
+			if (pixelIndex + repeatCount > width)
+			{
+				return std::unexpected("Run longer than the scanline");
+			}
+
+			const std::span previousPixel = rgbe.subspan((pixelIndex - 1) * RgbeComponentsCount, RgbeComponentsCount);
+			for (usize i = 0; i < repeatCount; i++)
+			{
+				std::ranges::copy(previousPixel, rgbe.subspan(pixelIndex * RgbeComponentsCount).begin());
+				pixelIndex++;
+			}
+
+			// Consecutive runs are the next bytes of a larger count
+			repeatShift = std::min(repeatShift + 8, 24u);
+			continue;
+		}
+
+		std::ranges::copy(pixel, rgbe.subspan(pixelIndex * RgbeComponentsCount).begin());
+		pixelIndex++;
+		repeatShift = 0;
+	}
+
+	return offset;
+}
+
+std::expected<usize, std::string> DecodeRadianceScanline(
+	const std::span<const u8> file, usize offset, const std::span<u8> rgbe)
+{
+	const usize width = rgbe.size() / RgbeComponentsCount;
+	if (offset + RgbeComponentsCount > file.size())
+	{
+		return std::unexpected("Unexpected end of the pixels");
+	}
+
+	// The scanlines that use the per channel run length encoding start with 2, 2 and their width
+	const bool isRunLengthEncoded = width >= 8 && width <= 0x7fff && file[offset] == 2 && file[offset + 1] == 2
+									&& (file[offset + 2] & 0x80) == 0;
+	if (!isRunLengthEncoded)
+	{
+		return DecodeFlatRadianceScanline(file, offset, rgbe);
+	}
+
+	const usize encodedWidth = static_cast<usize>(file[offset + 2]) << 8 | file[offset + 3];
+	if (encodedWidth != width)
+	{
+		return std::unexpected("Scanline width does not match the image width");
+	}
+	offset += RgbeComponentsCount;
+
+	// Each channel is stored separately, as runs of a single value or of different values
+	for (usize channel = 0; channel < RgbeComponentsCount; channel++)
+	{
+		usize pixelIndex = 0;
+		while (pixelIndex < width)
+		{
+			if (offset >= file.size())
+			{
+				return std::unexpected("Unexpected end of the pixels");
+			}
+
+			usize count = file[offset];
+			offset++;
+
+			const bool isRun = count > 128;
+			if (isRun)
+			{
+				count -= 128;
+			}
+
+			if (count == 0 || pixelIndex + count > width || offset + (isRun ? 1 : count) > file.size())
+			{
+				return std::unexpected("Invalid run in a scanline");
+			}
+
+			for (usize i = 0; i < count; i++)
+			{
+				rgbe[(pixelIndex + i) * RgbeComponentsCount + channel] = file[isRun ? offset : offset + i];
+			}
+
+			pixelIndex += count;
+			offset += isRun ? 1 : count;
+		}
+	}
+
+	return offset;
+}
+
+void ConvertRgbeToFloats(const std::span<const u8> rgbe, const std::span<f32> rgb)
+{
+	const usize pixelsCount = rgbe.size() / RgbeComponentsCount;
+	for (usize i = 0; i < pixelsCount; i++)
+	{
+		const std::span pixel = rgbe.subspan(i * RgbeComponentsCount, RgbeComponentsCount);
+		const i32 exponent = pixel[3];
+
+		// The mantissas are 8 bits fixed point values, the scale is 2^(exponent - 128 - 8)
+		f32 scale = 0.0f;
+		if (exponent >= 10)
+		{
+			scale = std::bit_cast<f32>(static_cast<u32>(exponent - 9) << 23);
+		}
+		else if (exponent > 0)
+		{
+			scale = std::ldexp(1.0f, exponent - 136);
+		}
+
+		rgb[i * RgbComponentsCount] = static_cast<f32>(pixel[0]) * scale;
+		rgb[i * RgbComponentsCount + 1] = static_cast<f32>(pixel[1]) * scale;
+		rgb[i * RgbComponentsCount + 2] = static_cast<f32>(pixel[2]) * scale;
+	}
+}
+
+u16 ConvertFloatToHalf(const f32 value)
+{
+	const u32 bits = std::bit_cast<u32>(std::clamp(value, 0.0f, MaxHalfValue));
+
+	// Smallest normal half float
+	if (bits < 0x38800000)
+	{
+		// Adding 0.5 moves the mantissa so that its last bit has the weight of the last bit of a denormal half,
+		// the FPU does the rounding
+		return static_cast<u16>(std::bit_cast<u32>(std::bit_cast<f32>(bits) + 0.5f) - 0x3f000000);
+	}
+
+	// Rounds to nearest even on the 13 bits that are dropped, then rebias the exponent from 127 to 15
+	const u32 rounded = bits + 0xfff + ((bits >> 13) & 1);
+	return static_cast<u16>((rounded - 0x38000000) >> 13);
+}
+
+void ConvertFloatsToHalves(const std::span<const f32> values, const std::span<u16> halves)
+{
+	usize i = 0;
+
+// GCC and Clang only define __F16C__ with -mf16c, -mavx2 alone does not enable it. MSVC never defines it, but every
+// CPU that /arch:AVX2 targets has F16C
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+	const __m256 max = _mm256_set1_ps(MaxHalfValue);
+	const __m256 zero = _mm256_setzero_ps();
+	for (; i + 8 <= values.size(); i += 8)
+	{
+		const __m256 clamped = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(values.data() + i), max), zero);
+		const __m128i converted = _mm256_cvtps_ph(clamped, _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(halves.data() + i), converted);
+	}
+#elif defined(STW_HAS_SSE2)
+	// Same as ConvertFloatToHalf, with the two cases computed for four values and then selected
+	const __m128 max = _mm_set1_ps(MaxHalfValue);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128i smallestNormal = _mm_set1_epi32(0x38800000);
+	const __m128i denormalMagic = _mm_set1_epi32(0x3f000000);
+	const __m128i roundingBias = _mm_set1_epi32(0xfff);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i exponentRebias = _mm_set1_epi32(0x38000000);
+
+	const auto convertFour = [&](const f32* source) {
+		const __m128 clamped = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(source), max), zero);
+		const __m128i bits = _mm_castps_si128(clamped);
+
+		const __m128i denormal = _mm_sub_epi32(
+			_mm_castps_si128(_mm_add_ps(clamped, _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+		const __m128i oddBit = _mm_and_si128(_mm_srli_epi32(bits, 13), one);
+		const __m128i rounded = _mm_add_epi32(_mm_add_epi32(bits, roundingBias), oddBit);
+		const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(rounded, exponentRebias), 13);
+
+		const __m128i isDenormal = _mm_cmplt_epi32(bits, smallestNormal);
+		return _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+	};
+
+	for (; i + 8 <= values.size(); i += 8)
+	{
+		// The halves are at most 0x7bff, so the signed saturation of the pack never changes them
+		const __m128i packed = _mm_packs_epi32(convertFour(values.data() + i), convertFour(values.data() + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(halves.data() + i), packed);
+	}
+#endif
+
+	for (; i < values.size(); i++)
+	{
+		halves[i] = ConvertFloatToHalf(values[i]);
+	}
+}
+}// namespace stw
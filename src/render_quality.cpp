@@ -0,0 +1,244 @@
+/**
+ * @file render_quality.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the render quality profiles and their config file loader.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+export module render_quality;
+
+import number_types;
+import consts;
+import utils;
+
+export namespace stw
+{
+enum class QualityProfile : u8
+{
+	Low,
+	Medium,
+	High,
+	Custom,
+};
+
+/**
+ * Every rendering parameter that can be changed at runtime to scale the cost of a frame.
+ */
+struct RenderQualitySettings
+{
+	QualityProfile profile = QualityProfile::High;
+	u32 shadowMapSize = 4096;
+	u32 skyboxResolution = 4096;
+	u32 ssaoKernelSize = 32;
+
+	/**
+	 * Number of SSAO samples evaluated each frame. When lower than the kernel size, the sample set is rotated every
+	 * frame and accumulated with the reprojected result of the previous frames. Zero uses the whole kernel every frame.
+	 */
+	u32 ssaoSamplesPerFrame = 0;
+	u32 bloomMipChainLength = 5;
+
+	/**
+	 * Largest error, in pixels, that a level of detail of a mesh can have on screen.
+	 */
+	u32 lodMaxPixelError = 1;
+
+	bool operator==(const RenderQualitySettings& other) const = default;
+
+	/**
+	 * Gets the settings of a predefined profile. Custom returns the High settings.
+	 */
+	[[nodiscard]] static RenderQualitySettings FromProfile(QualityProfile profile);
+
+	/**
+	 * Clamps every value in the range supported by the renderer.
+	 */
+	void Validate();
+};
+
+[[nodiscard]] std::string_view ToString(QualityProfile profile);
+[[nodiscard]] std::optional<QualityProfile> ParseQualityProfile(std::string_view name);
+
+/**
+ * Loads the render quality settings from a config file.
+ * The file contains one "key = value" pair per line, and lines starting with '#' are comments.
+ * The "profile" key selects the base values, every other key overrides one value.
+ * If an override is present, the resulting profile is Custom.
+ * @param path Path of the config file.
+ * @return The loaded settings or an error message.
+ */
+std::expected<RenderQualitySettings, std::string> LoadRenderQualitySettings(const std::filesystem::path& path);
+
+RenderQualitySettings RenderQualitySettings::FromProfile(const QualityProfile profile)
+{
+	RenderQualitySettings settings{};
+	settings.profile = profile;
+
+	switch (profile)
+	{
+	case QualityProfile::Low:
+		settings.shadowMapSize = 1024;
+		settings.skyboxResolution = 1024;
+		settings.ssaoKernelSize = 16;
+		settings.ssaoSamplesPerFrame = 4;
+		settings.bloomMipChainLength = 4;
+		settings.lodMaxPixelError = 4;
+		break;
+	case QualityProfile::Medium:
+		settings.shadowMapSize = 2048;
+		settings.skyboxResolution = 2048;
+		settings.ssaoKernelSize = 32;
+		settings.ssaoSamplesPerFrame = 8;
+		settings.bloomMipChainLength = 5;
+		settings.lodMaxPixelError = 2;
+		break;
+	case QualityProfile::High:
+	case QualityProfile::Custom:
+		break;
+	}
+
+	return settings;
+}
+
+void RenderQualitySettings::Validate()
+{
+	constexpr u32 minTextureSize = 64;
+	constexpr u32 maxTextureSize = 8192;
+
+	shadowMapSize = std::clamp(shadowMapSize, minTextureSize, maxTextureSize);
+	skyboxResolution = std::clamp(skyboxResolution, minTextureSize, maxTextureSize);
+	ssaoKernelSize = std::clamp(ssaoKernelSize, 1u, MaxSsaoKernelSize);
+	if (ssaoSamplesPerFrame >= ssaoKernelSize)
+	{
+		ssaoSamplesPerFrame = 0;
+	}
+	bloomMipChainLength = std::clamp(bloomMipChainLength, 1u, MaxComputeBloomMips);
+	lodMaxPixelError = std::clamp(lodMaxPixelError, 1u, MaxLodPixelError);
+}
+
+std::string_view ToString(const QualityProfile profile)
+{
+	switch (profile)
+	{
+	case QualityProfile::Low:
+		return "low";
+	case QualityProfile::Medium:
+		return "medium";
+	case QualityProfile::High:
+		return "high";
+	case QualityProfile::Custom:
+		return "custom";
+	}
+
+	return "unknown";
+}
+
+std::optional<QualityProfile> ParseQualityProfile(const std::string_view name)
+{
+	for (const QualityProfile profile :
+		{ QualityProfile::Low, QualityProfile::Medium, QualityProfile::High, QualityProfile::Custom })
+	{
+		if (ToString(profile) == name)
+		{
+			return profile;
+		}
+	}
+
+	return std::nullopt;
+}
+
+std::expected<RenderQualitySettings, std::string> LoadRenderQualitySettings(const std::filesystem::path& path)
+{
+	const auto entries = ReadConfigFile(path);
+	if (!entries)
+	{
+		return std::unexpected(entries.error());
+	}
+
+	std::optional<QualityProfile> profile{};
+	std::vector<std::pair<std::string, u32>> overrides{};
+
+	for (const ConfigEntry& entry : entries.value())
+	{
+		if (entry.key == "profile")
+		{
+			profile = ParseQualityProfile(entry.value);
+			if (!profile)
+			{
+				return std::unexpected(
+					std::format("{}:{} : unknown profile \"{}\"", path.string(), entry.lineNumber, entry.value));
+			}
+			continue;
+		}
+
+		const auto parsedValue = ParseNumber<u32>(entry.value);
+		if (!parsedValue)
+		{
+			return std::unexpected(std::format("{}:{} : {}", path.string(), entry.lineNumber, parsedValue.error()));
+		}
+
+		overrides.emplace_back(entry.key, parsedValue.value());
+	}
+
+	RenderQualitySettings settings = RenderQualitySettings::FromProfile(profile.value_or(QualityProfile::High));
+	const RenderQualitySettings baseSettings = settings;
+
+	for (const auto& [key, value] : overrides)
+	{
+		if (key == "shadow_map_size")
+		{
+			settings.shadowMapSize = value;
+		}
+		else if (key == "skybox_resolution")
+		{
+			settings.skyboxResolution = value;
+		}
+		else if (key == "ssao_kernel_size")
+		{
+			settings.ssaoKernelSize = value;
+		}
+		else if (key == "ssao_samples_per_frame")
+		{
+			settings.ssaoSamplesPerFrame = value;
+		}
+		else if (key == "bloom_mip_chain_length")
+		{
+			settings.bloomMipChainLength = value;
+		}
+		else if (key == "lod_max_pixel_error")
+		{
+			settings.lodMaxPixelError = value;
+		}
+		else
+		{
+			spdlog::warn("Unknown render quality key \"{}\" in {}", key, path.string());
+		}
+	}
+
+	settings.Validate();
+	if (settings != baseSettings)
+	{
+		settings.profile = QualityProfile::Custom;
+	}
+
+	return settings;
+}
+}// namespace stw
@@ -37,6 +37,8 @@ struct SceneGraphElement
 	std::size_t materialId = InvalidId;
 	glm::mat4 localTransformMatrix{ 1.0f };
 	glm::mat4 parentTransformMatrix{ 1.0f };
+	// Level of detail of the mesh selected on the last frame
+	usize lodIndex = 0;
 };
 
 // This is a type used for caching when iterating over the scene graph
@@ -44,6 +46,7 @@ struct SceneGraphElementIndex
 {
 	std::size_t meshId = InvalidId;
 	std::size_t materialId = InvalidId;
+	usize lodIndex = 0;
 
 	bool operator==(const SceneGraphElementIndex& other) const;
 };
@@ -56,7 +59,8 @@ struct std::hash<stw::SceneGraphElementIndex>
 	{
 		const std::size_t h1 = std::hash<std::size_t>{}(sceneGraphElementIndex.meshId);
 		const std::size_t h2 = std::hash<std::size_t>{}(sceneGraphElementIndex.materialId);
-		return h1 ^ (h2 << 1);
+		const std::size_t h3 = std::hash<std::size_t>{}(sceneGraphElementIndex.lodIndex);
+		return h1 ^ (h2 << 1) ^ (h3 << 2);
 	}
 };
 
@@ -105,7 +109,7 @@ class SceneGraph
 			}
 
 			const glm::mat4 transform = element.parentTransformMatrix * element.localTransformMatrix;
-			const SceneGraphElementIndex index{ element.meshId, element.materialId };
+			const SceneGraphElementIndex index{ element.meshId, element.materialId, element.lodIndex };
 
 			instancingMap[index].push_back(transform);
 		};
@@ -118,6 +122,25 @@ class SceneGraph
 		}
 	}
 
+	/// Selects the level of detail of each element, which ForEach then uses to group the instances.
+	/// \param function Function that returns the level of detail of an element. Has these parameters :
+	/// `usize(SceneGraphElementIndex elementIndex, const glm::mat4& transformMatrix)`, where the level of detail of
+	/// `elementIndex` is the one selected on the last call.
+	void UpdateLods(Callable<usize, SceneGraphElementIndex, const glm::mat4&> auto&& function)
+	{
+		for (SceneGraphElement& element : m_Elements)
+		{
+			if (element.materialId == InvalidId || element.meshId == InvalidId)
+			{
+				continue;
+			}
+
+			const glm::mat4 transform = element.parentTransformMatrix * element.localTransformMatrix;
+			element.lodIndex = std::invoke(
+				function, SceneGraphElementIndex{ element.meshId, element.materialId, element.lodIndex }, transform);
+		}
+	}
+
 	/// Will call `function` for each elements in the scene graph with the correct transform matrix.
 	/// \param function Function that will be called on each elements. Has these parameters :
 	/// `void(SceneGraphElementIndex elementIndex, const glm::mat4& transformMatrix)`.
@@ -140,7 +163,7 @@ void SceneGraph::ForEachNoInstancing(Consumer<SceneGraphElementIndex, glm::mat4>
 		}
 
 		const glm::mat4 transform = element.parentTransformMatrix * element.localTransformMatrix;
-		std::invoke(function, { element.meshId, element.materialId }, transform);
+		std::invoke(function, { element.meshId, element.materialId, element.lodIndex }, transform);
 	};
 	ForEachChildren(m_Nodes[0], lambda);
 }
@@ -318,8 +341,8 @@ usize SceneGraph::AddSibling(
 
 	const auto& siblingElement = m_Elements[siblingNode.elementId];
 
-	const glm::mat4 siblingTransform = siblingElement.parentTransformMatrix * siblingElement.localTransformMatrix;
-	const SceneGraphElement elem{ meshId, materialId, transformMatrix, siblingTransform };
+	// A sibling shares the parent of the node it follows, not its local transform
+	const SceneGraphElement elem{ meshId, materialId, transformMatrix, siblingElement.parentTransformMatrix };
 	m_Elements.push_back(elem);
 	const SceneGraphNode node{ m_Elements.size() - 1, std::nullopt, std::nullopt, std::nullopt };
 	m_Nodes.push_back(node);
@@ -330,6 +353,6 @@ usize SceneGraph::AddSibling(
 
 bool SceneGraphElementIndex::operator==(const SceneGraphElementIndex& other) const
 {
-	return meshId == other.meshId && materialId == other.materialId;
+	return meshId == other.meshId && materialId == other.materialId && lodIndex == other.lodIndex;
 }
 }// namespace stw
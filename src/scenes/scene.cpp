@@ -37,5 +37,11 @@ class Scene
 	virtual void OnEvent(const SDL_Event& event) {}
 
 	virtual void OnResize(const i32 sizeX, const i32 sizeY) {}
+
+	/**
+	 * Sets the framebuffer that the scene is presented to, instead of the default framebuffer of the window.
+	 * @param framebuffer OpenGL name of the framebuffer.
+	 */
+	virtual void SetOutputFramebuffer(const u32 framebuffer) {}
 };
 }// namespace stw
@@ -26,6 +26,11 @@ import camera;
 import scene;
 import pipeline;
 import renderer;
+import render_quality;
+import dynamic_resolution;
+import texture_residency;
+import gpu_memory;
+import geometry_arena;
 
 export namespace stw
 {
@@ -38,7 +43,69 @@ class SsaoScene final : public Scene
 		m_Camera.SetMovementSpeed(4.0f);
 
 		m_Renderer = std::make_unique<Renderer>(&m_Camera);
+
+		const auto qualityResult = LoadRenderQualitySettings("data/render_quality.cfg");
+		if (qualityResult.has_value())
+		{
+			m_CustomQualitySettings = qualityResult.value();
+		}
+		else
+		{
+			spdlog::warn("Using the default render quality : {}", qualityResult.error());
+		}
+		m_Renderer->ApplyQualitySettings(m_CustomQualitySettings);
+
 		m_Renderer->Init(screenSize);
+
+		DynamicResolutionSettings dynamicResolutionSettings{};
+		const auto dynamicResolutionResult = LoadDynamicResolutionSettings("data/dynamic_resolution.cfg");
+		if (dynamicResolutionResult.has_value())
+		{
+			dynamicResolutionSettings = dynamicResolutionResult.value();
+		}
+		else
+		{
+			spdlog::warn("Using the default dynamic resolution settings : {}", dynamicResolutionResult.error());
+		}
+		m_Renderer->SetDynamicResolutionSettings(dynamicResolutionSettings);
+
+		TextureStreamingSettings textureStreamingSettings{};
+		const auto textureStreamingResult = LoadTextureStreamingSettings("data/texture_streaming.cfg");
+		if (textureStreamingResult.has_value())
+		{
+			textureStreamingSettings = textureStreamingResult.value();
+		}
+		else
+		{
+			spdlog::warn("Using the default texture streaming settings : {}", textureStreamingResult.error());
+		}
+		m_Renderer->SetTextureStreamingSettings(textureStreamingSettings);
+
+		GpuMemorySettings gpuMemorySettings{};
+		const auto gpuMemoryResult = LoadGpuMemorySettings("data/gpu_memory.cfg");
+		if (gpuMemoryResult.has_value())
+		{
+			gpuMemorySettings = gpuMemoryResult.value();
+		}
+		else
+		{
+			spdlog::warn("Using the default GPU memory settings : {}", gpuMemoryResult.error());
+		}
+		m_Renderer->SetGpuMemorySettings(gpuMemorySettings);
+
+		GeometrySettings geometrySettings{};
+		const auto geometryResult = LoadGeometrySettings("data/geometry.cfg");
+		if (geometryResult.has_value())
+		{
+			geometrySettings = geometryResult.value();
+		}
+		else
+		{
+			spdlog::warn("Using the default geometry settings : {}", geometryResult.error());
+		}
+		m_Renderer->SetGeometryResidency(geometrySettings.residency);
+		spdlog::info("Geometry residency {}", ToString(geometrySettings.residency));
+
 		m_Renderer->SetEnableDepthTest(true);
 		m_Renderer->SetDepthFunc(GL_LEQUAL);
 		m_Renderer->SetClearColor(glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f });
@@ -159,6 +226,41 @@ class SsaoScene final : public Scene
 			{
 				m_Camera.IncrementMovementSpeed(1.0f);
 			}
+			else if (event.key.keysym.sym == SDLK_b)
+			{
+				m_Renderer->SetEnableComputeBloom(!m_Renderer->IsComputeBloomEnabled());
+				spdlog::info("Compute bloom {}", m_Renderer->IsComputeBloomEnabled() ? "enabled" : "disabled");
+			}
+			else if (event.key.keysym.sym == SDLK_r)
+			{
+				DynamicResolutionSettings settings = m_Renderer->GetDynamicResolutionSettings();
+				settings.enabled = !settings.enabled;
+				m_Renderer->SetDynamicResolutionSettings(settings);
+			}
+			else if (event.key.keysym.sym == SDLK_m)
+			{
+				m_Renderer->LogGpuMemoryReport();
+			}
+			else if (event.key.keysym.sym == SDLK_u)
+			{
+				m_Renderer->ReuploadMeshes();
+			}
+			else if (event.key.keysym.sym == SDLK_1)
+			{
+				m_Renderer->ApplyQualitySettings(RenderQualitySettings::FromProfile(QualityProfile::Low));
+			}
+			else if (event.key.keysym.sym == SDLK_2)
+			{
+				m_Renderer->ApplyQualitySettings(RenderQualitySettings::FromProfile(QualityProfile::Medium));
+			}
+			else if (event.key.keysym.sym == SDLK_3)
+			{
+				m_Renderer->ApplyQualitySettings(RenderQualitySettings::FromProfile(QualityProfile::High));
+			}
+			else if (event.key.keysym.sym == SDLK_4)
+			{
+				m_Renderer->ApplyQualitySettings(m_CustomQualitySettings);
+			}
 			break;
 		default:
 			break;
@@ -172,6 +274,8 @@ class SsaoScene final : public Scene
 		UpdateProjection();
 	}
 
+	void SetOutputFramebuffer(const u32 framebuffer) override { m_Renderer->SetOutputFramebuffer(framebuffer); }
+
 	void Delete() override { m_Renderer->Delete(); }
 
 private:
@@ -179,6 +283,7 @@ class SsaoScene final : public Scene
 	Camera m_Camera{ glm::vec3{ 0.0f, 1.5f, 5.0f } };
 	std::unique_ptr<Renderer> m_Renderer{};
 	usize m_CatNodeIndex{};
+	RenderQualitySettings m_CustomQualitySettings{};
 	bool isFullscreen = false;
 };
 }// namespace stw
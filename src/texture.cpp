@@ -11,10 +11,22 @@
 
 module;
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <expected>
 #include <filesystem>
+#include <format>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 #ifndef NDEBUG
@@ -32,6 +44,9 @@ export module texture;
 import utils;
 import consts;
 import number_types;
+import mapped_file;
+import radiance_image;
+import gpu_memory;
 
 export namespace stw
 {
@@ -56,6 +71,75 @@ enum class TextureSpace : u8
 
 aiTextureType ToAssimpTextureType(TextureType type);
 
+/**
+ * Number of scanlines of a radiance map that are decoded before being uploaded together.
+ */
+constexpr u32 RadianceUploadRowsCount = 64;
+
+/**
+ * Pixels of an image decoded on the CPU. Decoding can be done on any thread, then the image is uploaded to OpenGL
+ * from the context thread with Texture::CreateFromDecodedImage.
+ */
+struct DecodedImage
+{
+	i32 width = 0;
+	i32 height = 0;
+	i32 componentsCount = 0;
+	std::unique_ptr<u8, void (*)(void*)> pixels{ nullptr, stbi_image_free };
+};
+
+/**
+ * Gets the color space in which a type of texture is authored. Only colors are sRGB, data textures are linear.
+ */
+[[nodiscard]] TextureSpace GetTextureSpace(TextureType type);
+
+/**
+ * Gets the category in which the video memory of a type of texture is reported.
+ */
+[[nodiscard]] GpuMemoryCategory GetGpuMemoryCategory(TextureType type);
+
+/**
+ * Gets the number of levels in the full mip chain of an image.
+ */
+[[nodiscard]] u32 ComputeMipLevelsCount(u32 width, u32 height);
+
+/**
+ * Computes the next level of a mip chain with a box filter.
+ * sRGB channels are averaged in linear space, and normals are normalized after being averaged.
+ */
+[[nodiscard]] std::vector<u8> DownsampleMip(
+	std::span<const u8> source, u32 width, u32 height, u32 channelsCount, TextureSpace space, bool isNormalMap);
+
+/**
+ * Skips the first levels of the mip chain of a decoded image. This does not use OpenGL.
+ * @param image Decoded image at its full resolution.
+ * @param skippedLevelsCount Number of times the size of the image is halved.
+ * @param type What the image is used for, to filter it in the right color space.
+ * @return The image at the requested mip level.
+ */
+[[nodiscard]] DecodedImage DownsampleImage(const DecodedImage& image, u32 skippedLevelsCount, TextureType type);
+
+/**
+ * Creates a 1x1 image that stands in for a texture that could not be loaded, with a neutral value for its type: white
+ * colors, flat normals, and no occlusion, full roughness and no metalness for the packed maps.
+ */
+[[nodiscard]] DecodedImage CreateFallbackImage(TextureType type);
+
+/**
+ * Decodes ambient occlusion, roughness and metallic maps and packs them in the red, green and blue channels of a
+ * single image. This does not use OpenGL.
+ * When a file is used by several maps, it is considered already packed, and each map reads its own channel from it.
+ * Otherwise, the maps read the first channel of their file. Maps of different sizes are resized to the largest one.
+ * @param ambientOcclusionPath Path to the ambient occlusion map. Without it, the occlusion is set to one.
+ * @param roughnessPath Path to the roughness map.
+ * @param metallicPath Path to the metallic map.
+ * @return The packed image or an error message.
+ */
+std::expected<DecodedImage, std::string> DecodeOrmFromPaths(
+	const std::optional<std::filesystem::path>& ambientOcclusionPath,
+	const std::filesystem::path& roughnessPath,
+	const std::filesystem::path& metallicPath);
+
 class Texture
 {
 public:
@@ -71,6 +155,32 @@ class Texture
 
 	static std::expected<Texture, std::string> LoadFromPath(
 		const std::filesystem::path& path, TextureType type, TextureSpace space);
+
+	/**
+	 * Decodes an image file without touching OpenGL, so it can be called from a worker thread.
+	 * @param path Path to the image.
+	 * @return The decoded pixels or an error message.
+	 */
+	static std::expected<DecodedImage, std::string> DecodeFromPath(const std::filesystem::path& path);
+
+	/**
+	 * Uploads decoded pixels to a new texture and generates its mipmaps. Must be called on the OpenGL context thread.
+	 */
+	static Texture CreateFromDecodedImage(const DecodedImage& image, TextureType type, TextureSpace space);
+
+	/**
+	 * Creates a smaller copy of a 2D texture, that starts at one of its mip levels. The copy is done on the GPU.
+	 * @param source Texture to copy.
+	 * @param level Mip level of the source that becomes the base level of the copy.
+	 */
+	static Texture CreateFromTextureLevel(const Texture& source, u32 level);
+
+	/**
+	 * Loads a Radiance HDR image into a half float texture, flipped vertically. The file is memory mapped and decoded
+	 * a band of scanlines at a time, so the full image never exists as floats in memory.
+	 * @param path Path to the HDR image.
+	 * @return The texture or an error message.
+	 */
 	static std::expected<Texture, std::string> LoadRadianceMapFromPath(const std::filesystem::path& path);
 	static std::expected<Texture, std::string> LoadKtxFromPath(const std::filesystem::path& path, TextureType type);
 	static std::expected<Texture, std::string> LoadCubeMap(
@@ -93,11 +203,20 @@ class Texture
 	void SetFormat(int nbComponents);
 
 	/**
-	 * Sets metadata about the texture.
+	 * Allocates the immutable storage of every mip level of the texture, and of every face for a cube map.
+	 * The format must be set before.
+	 * @param width Width of the base level.
+	 * @param height Height of the base level.
+	 * @param levelsCount Number of mip levels to allocate.
+	 */
+	void Allocate(GLsizei width, GLsizei height, GLsizei levelsCount);
+
+	/**
+	 * Uploads the pixels of the base level of the texture. The storage must be allocated before.
 	 * @param width Width of the texture
 	 * @param height Height of the texture
 	 * @param data Pixels of the texture
-	 * @param optionalTarget If this is set, it will specify the provided texture instead of the current one.
+	 * @param optionalTarget If this is set, it will specify the provided cube map face instead of the whole texture.
 	 * @param dataType Data type fo the pixels of the texture.
 	 */
 	void Specify(GLsizei width,
@@ -111,6 +230,12 @@ class Texture
 	void SetWrapS(GLint wrap) const;
 	void SetWrapT(GLint wrap) const;
 	void SetWrapR(GLint wrap) const;
+
+	/**
+	 * Queries OpenGL for the size of every mip level of the texture.
+	 * @return An estimation of the video memory used by the texture, in bytes.
+	 */
+	[[nodiscard]] usize ComputeGpuSize() const;
 	void Delete();
 
 private:
@@ -123,6 +248,13 @@ class Texture
 	Texture(GLuint textureId, GLenum glFormat, GLint internalFormat, GLenum glTextureTarget);
 	Texture(GLuint textureId, GLenum glTextureTarget, TextureType textureType);
 	GLenum m_GlTextureTarget = GL_INVALID_ENUM;
+	usize m_TrackedGpuSize = 0;
+	bool m_IsGpuSizeTracked = false;
+
+	/**
+	 * Reports the current size of the texture to the GPU memory tracker. Must be called after every allocation.
+	 */
+	void TrackGpuSize();
 };
 
 
@@ -151,24 +283,44 @@ GLenum GetGlTextureTarget(const TextureType type)
 std::expected<Texture, std::string> Texture::LoadFromPath(
 	const std::filesystem::path& path, const TextureType type, const TextureSpace space)
 {
-	i32 width = 0;
-	i32 height = 0;
-	i32 nbrComponents = 0;
+	const auto decodeResult = DecodeFromPath(path);
+	if (!decodeResult)
+	{
+		return std::unexpected(decodeResult.error());
+	}
+
+	return { CreateFromDecodedImage(decodeResult.value(), type, space) };
+}
+
+std::expected<DecodedImage, std::string> Texture::DecodeFromPath(const std::filesystem::path& path)
+{
+	DecodedImage image{};
 	const auto stringPath = path.string();
-	unsigned char* data = stbi_load(stringPath.c_str(), &width, &height, &nbrComponents, 0);
+	image.pixels.reset(stbi_load(stringPath.c_str(), &image.width, &image.height, &image.componentsCount, 0));
 
-	if (data == nullptr)
+	if (image.pixels == nullptr)
 	{
-		stbi_image_free(data);
 		return std::unexpected(
 			std::format("Texture failed to load at path: {}\n{}", stringPath, stbi_failure_reason()));
 	}
 
+	return { std::move(image) };
+}
+
+Texture Texture::CreateFromDecodedImage(const DecodedImage& image, const TextureType type, const TextureSpace space)
+{
 	Texture texture;
 	texture.Init(type, space);
-	texture.SetFormat(nbrComponents);
+	texture.SetFormat(image.componentsCount);
 	texture.Bind();
-	texture.Specify(width, height, data);
+	texture.Allocate(image.width,
+		image.height,
+		static_cast<GLsizei>(ComputeMipLevelsCount(static_cast<u32>(image.width), static_cast<u32>(image.height))));
+
+	// Rows of images with one or three components are not always aligned on four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	texture.Specify(image.width, image.height, image.pixels.get());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	texture.GenerateMipmap();
 
 	texture.SetMinFilter(GL_LINEAR_MIPMAP_LINEAR);
@@ -176,9 +328,50 @@ std::expected<Texture, std::string> Texture::LoadFromPath(
 	texture.SetWrapS(GL_REPEAT);
 	texture.SetWrapT(GL_REPEAT);
 
-	stbi_image_free(data);
+	return texture;
+}
 
-	return { std::move(texture) };
+Texture Texture::CreateFromTextureLevel(const Texture& source, const u32 level)
+{
+	GLint width = 0;
+	GLint height = 0;
+	glGetTextureLevelParameteriv(source.textureId, static_cast<GLint>(level), GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(source.textureId, static_cast<GLint>(level), GL_TEXTURE_HEIGHT, &height);
+
+	Texture texture;
+	texture.Init(source.textureType, source.space);
+	texture.glFormat = source.glFormat;
+	texture.internalFormat = source.internalFormat;
+	texture.Bind();
+	texture.Allocate(width,
+		height,
+		static_cast<GLsizei>(ComputeMipLevelsCount(static_cast<u32>(width), static_cast<u32>(height))));
+
+	glCopyImageSubData(source.textureId,
+		source.m_GlTextureTarget,
+		static_cast<GLint>(level),
+		0,
+		0,
+		0,
+		texture.textureId,
+		texture.m_GlTextureTarget,
+		0,
+		0,
+		0,
+		0,
+		width,
+		height,
+		1);
+
+	// The smaller levels are regenerated from the copy instead of being copied one by one
+	texture.GenerateMipmap();
+
+	texture.SetMinFilter(GL_LINEAR_MIPMAP_LINEAR);
+	texture.SetMagFilter(GL_LINEAR);
+	texture.SetWrapS(GL_REPEAT);
+	texture.SetWrapT(GL_REPEAT);
+
+	return texture;
 }
 
 std::expected<Texture, std::string> Texture::LoadKtxFromPath(const std::filesystem::path& path, const TextureType type)
@@ -190,13 +383,39 @@ std::expected<Texture, std::string> Texture::LoadKtxFromPath(const std::filesyst
 	GLenum target = GL_INVALID_ENUM;
 
 
-	result = ktxTexture_CreateFromNamedFile(path.string().c_str(), KTX_TEXTURE_CREATE_NO_FLAGS, &kTexture);
+	result = ktxTexture_CreateFromNamedFile(path.string().c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture);
 	if (result != KTX_SUCCESS)
 	{
 		return std::unexpected(
 			std::format("Could not load KTX file with libktx error code : {}", static_cast<int>(result)));
 	}
 
+	// Cooked textures are stored as UASTC, and are transcoded to the smallest BC format that keeps their channels.
+	// BC4, BC5 and BC7 are always available since OpenGL 4.2.
+	if (kTexture->classId == ktxTexture2_c && ktxTexture2_NeedsTranscoding(reinterpret_cast<ktxTexture2*>(kTexture)))
+	{
+		const ktx_uint32_t componentsCount = ktxTexture2_GetNumComponents(reinterpret_cast<ktxTexture2*>(kTexture));
+		ktx_transcode_fmt_e transcodeFormat = KTX_TTF_BC7_RGBA;
+		if (type == TextureType::Normal)
+		{
+			// The shaders rebuild the Z component of the normals. BC5 takes X from red and Y from alpha, which is
+			// where the texture cooker stores the green channel of the normal maps
+			transcodeFormat = KTX_TTF_BC5_RG;
+		}
+		else if (componentsCount == 1)
+		{
+			transcodeFormat = KTX_TTF_BC4_R;
+		}
+
+		result = ktxTexture2_TranscodeBasis(reinterpret_cast<ktxTexture2*>(kTexture), transcodeFormat, 0);
+		if (result != KTX_SUCCESS)
+		{
+			ktxTexture_Destroy(kTexture);
+			return std::unexpected(
+				std::format("Could not transcode KTX file with libktx error code : {}", static_cast<int>(result)));
+		}
+	}
+
 	GLenum glError = GL_INVALID_ENUM;
 	result = ktxTexture_GLUpload(kTexture, &texture, &target, &glError);
 
@@ -213,42 +432,129 @@ std::expected<Texture, std::string> Texture::LoadKtxFromPath(const std::filesyst
 			std::format("Could not upload OpenGl image with libktx error code : {}", static_cast<int>(result)));
 	}
 
+	if (target == GL_TEXTURE_2D)
+	{
+		glTextureParameteri(
+			texture, GL_TEXTURE_MIN_FILTER, kTexture->numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+
 	ktxTexture_Destroy(kTexture);
 
 	Texture t{ texture, target, type };
+	t.TrackGpuSize();
 	return t;
 }
 
 std::expected<Texture, std::string> Texture::LoadRadianceMapFromPath(const std::filesystem::path& path)
 {
-	i32 width = 0;
-	i32 height = 0;
-	i32 nbrComponents = 0;
 	const auto stringPath = path.string();
-	stbi_set_flip_vertically_on_load(1);
-	f32* data = stbi_loadf(stringPath.c_str(), &width, &height, &nbrComponents, 0);
-	stbi_set_flip_vertically_on_load(0);
 
-	if (data == nullptr)
+	// The file is decoded straight from the mapped pages, so only a few scanlines exist as floats at any time
+	auto mappedFile = MappedFile::Open(path);
+	if (!mappedFile)
 	{
-		stbi_image_free(data);
 		return std::unexpected(
-			std::format("Radiance map failed to load at path: {}\n{}", stringPath, stbi_failure_reason()));
+			std::format("Radiance map failed to load at path: {}\n{}", stringPath, mappedFile.error()));
+	}
+	mappedFile->AdviseSequential();
+
+	const std::span<const u8> file = mappedFile->GetData();
+	const auto header = ParseRadianceHeader(file);
+	if (!header)
+	{
+		return std::unexpected(std::format("Radiance map failed to load at path: {}\n{}", stringPath, header.error()));
 	}
 
+	const u32 width = header->width;
+	const u32 height = header->height;
+
 	GLuint hdrTexture = 0;
-	glGenTextures(1, &hdrTexture);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
+	glCreateTextures(GL_TEXTURE_2D, 1, &hdrTexture);
+	glTextureStorage2D(hdrTexture, 1, GL_RGB16F, static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+
+	glTextureParameteri(hdrTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(hdrTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(hdrTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(hdrTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// The half floats are written in a pixel unpack buffer, a band of scanlines at a time. Invalidating the buffer
+	// before each band lets the driver give a new one while the previous band is still being copied
+	const u32 bandRowsCount = std::min(RadianceUploadRowsCount, height);
+	const usize rowComponentsCount = static_cast<usize>(width) * RgbComponentsCount;
+	const usize rowSize = rowComponentsCount * sizeof(u16);
+
+	GLuint unpackBuffer = 0;
+	glCreateBuffers(1, &unpackBuffer);
+	glNamedBufferData(unpackBuffer, static_cast<GLsizeiptr>(rowSize * bandRowsCount), nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+
+	std::vector<u8> rgbeRow(static_cast<usize>(width) * RgbeComponentsCount);
+	std::vector<f32> floatRow(rowComponentsCount);
+	usize offset = header->dataOffset;
+	std::optional<std::string> error{};
+
+	for (u32 firstRow = 0; firstRow < height && !error; firstRow += bandRowsCount)
+	{
+		const u32 rowsCount = std::min(bandRowsCount, height - firstRow);
+		auto* const band = static_cast<u16*>(glMapNamedBufferRange(unpackBuffer,
+			0,
+			static_cast<GLsizeiptr>(rowSize * rowsCount),
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+		if (band == nullptr)
+		{
+			error = "Could not map the pixel unpack buffer";
+			break;
+		}
+
+		for (u32 row = 0; row < rowsCount; row++)
+		{
+			const auto nextOffset = DecodeRadianceScanline(file, offset, rgbeRow);
+			if (!nextOffset)
+			{
+				error = nextOffset.error();
+				break;
+			}
+			offset = nextOffset.value();
+
+			ConvertRgbeToFloats(rgbeRow, floatRow);
+
+			// The file starts with the top row and OpenGL with the bottom one, so the band is filled upside down
+			const usize bandRow = rowsCount - 1 - row;
+			ConvertFloatsToHalves(floatRow, std::span{ band + bandRow * rowComponentsCount, rowComponentsCount });
+		}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glUnmapNamedBuffer(unpackBuffer);
 
-	stbi_image_free(data);
+		if (!error)
+		{
+			glTextureSubImage2D(hdrTexture,
+				0,
+				0,
+				static_cast<GLint>(height - firstRow - rowsCount),
+				static_cast<GLsizei>(width),
+				static_cast<GLsizei>(rowsCount),
+				GL_RGB,
+				GL_HALF_FLOAT,
+				nullptr);
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	glDeleteBuffers(1, &unpackBuffer);
+
+	if (error)
+	{
+		glDeleteTextures(1, &hdrTexture);
+		return std::unexpected(std::format("Radiance map failed to load at path: {}\n{}", stringPath, error.value()));
+	}
 
-	Texture tex{ hdrTexture, TextureType::RadianceMap, TextureSpace::Linear, GL_RGB16F, GL_RGB, GL_TEXTURE_2D };
+	Texture tex{ hdrTexture, TextureType::RadianceMap, TextureSpace::Linear, GL_RGB, GL_RGB16F, GL_TEXTURE_2D };
+	tex.TrackGpuSize();
 
 	return { std::move(tex) };
 }
@@ -275,7 +581,13 @@ std::expected<Texture, std::string> Texture::LoadCubeMap(
 			return std::unexpected(std::format("Texture failed to load at path: {}", stringPath));
 		}
 
-		texture.SetFormat(nbrComponents);
+		// Every face shares the storage that is allocated with the first one
+		if (i == 0)
+		{
+			texture.SetFormat(nbrComponents);
+			texture.Allocate(width, height, 1);
+		}
+
 		const auto target = static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i);
 		texture.Specify(width, height, data, { target });
 		stbi_image_free(data);
@@ -300,31 +612,24 @@ void Texture::Init(const TextureType type, const TextureSpace textureSpace)
 
 void Texture::SetFormat(const int nbComponents)
 {
+	// Immutable storage needs sized internal formats
 	switch (nbComponents)
 	{
 	case 1:
 		glFormat = GL_RED;
-		internalFormat = static_cast<GLint>(glFormat);
+		internalFormat = GL_R8;
 		break;
 	case 2:
 		glFormat = GL_RG;
-		internalFormat = static_cast<GLint>(glFormat);
+		internalFormat = GL_RG8;
 		break;
 	case 3:
 		glFormat = GL_RGB;
-		internalFormat = static_cast<GLint>(glFormat);
-		if (space == TextureSpace::Srgb)
-		{
-			internalFormat = GL_SRGB;
-		}
+		internalFormat = space == TextureSpace::Srgb ? GL_SRGB8 : GL_RGB8;
 		break;
 	case 4:
 		glFormat = GL_RGBA;
-		internalFormat = static_cast<GLint>(glFormat);
-		if (space == TextureSpace::Srgb)
-		{
-			internalFormat = GL_SRGB_ALPHA;
-		}
+		internalFormat = space == TextureSpace::Srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
 		break;
 	default:
 		glFormat = GL_INVALID_ENUM;
@@ -352,15 +657,22 @@ void Texture::Specify(const GLsizei width,
 {
 	if (optionalTarget.has_value())
 	{
-		glTexImage2D(optionalTarget.value(), 0, internalFormat, width, height, 0, glFormat, dataType, data);
+		const auto face = static_cast<GLint>(optionalTarget.value() - GL_TEXTURE_CUBE_MAP_POSITIVE_X);
+		glTextureSubImage3D(textureId, 0, 0, 0, face, width, height, 1, glFormat, dataType, data);
 	}
 	else
 	{
-		glTexImage2D(m_GlTextureTarget, 0, internalFormat, width, height, 0, glFormat, dataType, data);
+		glTextureSubImage2D(textureId, 0, 0, 0, width, height, glFormat, dataType, data);
 	}
 }
 
-void Texture::GenerateMipmap() const { glGenerateMipmap(m_GlTextureTarget); }
+void Texture::Allocate(const GLsizei width, const GLsizei height, const GLsizei levelsCount)
+{
+	glTextureStorage2D(textureId, levelsCount, static_cast<GLenum>(internalFormat), width, height);
+	TrackGpuSize();
+}
+
+void Texture::GenerateMipmap() const { glGenerateTextureMipmap(textureId); }
 
 void Texture::SetMinFilter(const GLint filter) const
 {
@@ -378,12 +690,293 @@ void Texture::SetWrapT(const GLint wrap) const { glTexParameteri(m_GlTextureTarg
 
 void Texture::SetWrapR(const GLint wrap) const { glTexParameteri(m_GlTextureTarget, GL_TEXTURE_WRAP_R, wrap); }
 
+usize Texture::ComputeGpuSize() const { return QueryTextureGpuSize(textureId); }
+
 void Texture::Delete()
 {
+	if (m_IsGpuSizeTracked)
+	{
+		GetGpuMemoryTracker().TrackDeallocation(GetGpuMemoryCategory(textureType), m_TrackedGpuSize);
+		m_TrackedGpuSize = 0;
+		m_IsGpuSizeTracked = false;
+	}
+
 	glDeleteTextures(1, &textureId);
 	textureId = 0;
 }
 
+void Texture::TrackGpuSize()
+{
+	const usize size = ComputeGpuSize();
+	GpuMemoryTracker& tracker = GetGpuMemoryTracker();
+	if (m_IsGpuSizeTracked)
+	{
+		tracker.TrackReallocation(GetGpuMemoryCategory(textureType), m_TrackedGpuSize, size);
+	}
+	else
+	{
+		tracker.TrackAllocation(GetGpuMemoryCategory(textureType), size);
+	}
+
+	m_TrackedGpuSize = size;
+	m_IsGpuSizeTracked = true;
+}
+
+GpuMemoryCategory GetGpuMemoryCategory(const TextureType type)
+{
+	switch (type)
+	{
+	case TextureType::CubeMap:
+	case TextureType::RadianceMap:
+		return GpuMemoryCategory::Environment;
+	case TextureType::DepthMap:
+		return GpuMemoryCategory::RenderTarget;
+	default:
+		return GpuMemoryCategory::Texture;
+	}
+}
+
+TextureSpace GetTextureSpace(const TextureType type)
+{
+	switch (type)
+	{
+	case TextureType::BaseColor:
+	case TextureType::Specular:
+	case TextureType::CubeMap:
+		return TextureSpace::Srgb;
+	default:
+		return TextureSpace::Linear;
+	}
+}
+
+f32 SrgbToLinear(const f32 value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+f32 LinearToSrgb(const f32 value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+std::vector<u8> DownsampleMip(const std::span<const u8> source,
+	const u32 width,
+	const u32 height,
+	const u32 channelsCount,
+	const TextureSpace space,
+	const bool isNormalMap)
+{
+	const u32 mipWidth = std::max(width / 2, 1u);
+	const u32 mipHeight = std::max(height / 2, 1u);
+	std::vector<u8> mip(static_cast<usize>(mipWidth) * mipHeight * channelsCount);
+
+	const auto toFloat = [space](const u8 value, const u32 channel) {
+		const f32 normalized = static_cast<f32>(value) / 255.0f;
+		// Alpha is always linear
+		return space == TextureSpace::Srgb && channel < 3 ? SrgbToLinear(normalized) : normalized;
+	};
+	const auto toByte = [space](f32 value, const u32 channel) {
+		if (space == TextureSpace::Srgb && channel < 3)
+		{
+			value = LinearToSrgb(value);
+		}
+		return static_cast<u8>(std::clamp(std::round(value * 255.0f), 0.0f, 255.0f));
+	};
+
+	for (u32 y = 0; y < mipHeight; y++)
+	{
+		for (u32 x = 0; x < mipWidth; x++)
+		{
+			std::array<f32, 4> sum{};
+			for (u32 offsetY = 0; offsetY < 2; offsetY++)
+			{
+				for (u32 offsetX = 0; offsetX < 2; offsetX++)
+				{
+					const u32 sourceX = std::min(x * 2 + offsetX, width - 1);
+					const u32 sourceY = std::min(y * 2 + offsetY, height - 1);
+					const usize sourceIndex = (static_cast<usize>(sourceY) * width + sourceX) * channelsCount;
+					for (u32 channel = 0; channel < channelsCount; channel++)
+					{
+						sum.at(channel) += toFloat(source[sourceIndex + channel], channel);
+					}
+				}
+			}
+
+			for (f32& value : sum)
+			{
+				value *= 0.25f;
+			}
+
+			if (isNormalMap && channelsCount >= 3)
+			{
+				const f32 normalX = sum[0] * 2.0f - 1.0f;
+				const f32 normalY = sum[1] * 2.0f - 1.0f;
+				const f32 normalZ = sum[2] * 2.0f - 1.0f;
+				const f32 length = std::max(std::sqrt(normalX * normalX + normalY * normalY + normalZ * normalZ), 0.0001f);
+				sum[0] = normalX / length * 0.5f + 0.5f;
+				sum[1] = normalY / length * 0.5f + 0.5f;
+				sum[2] = normalZ / length * 0.5f + 0.5f;
+			}
+
+			const usize mipIndex = (static_cast<usize>(y) * mipWidth + x) * channelsCount;
+			for (u32 channel = 0; channel < channelsCount; channel++)
+			{
+				mip[mipIndex + channel] = toByte(sum.at(channel), channel);
+			}
+		}
+	}
+
+	return mip;
+}
+
+u32 ComputeMipLevelsCount(const u32 width, const u32 height)
+{
+	return static_cast<u32>(std::floor(std::log2(std::max({ width, height, 1u })))) + 1;
+}
+
+DecodedImage DownsampleImage(const DecodedImage& image, const u32 skippedLevelsCount, const TextureType type)
+{
+	const auto channelsCount = static_cast<u32>(image.componentsCount);
+	auto width = static_cast<u32>(image.width);
+	auto height = static_cast<u32>(image.height);
+	std::vector<u8> level(image.pixels.get(), image.pixels.get() + static_cast<usize>(width) * height * channelsCount);
+
+	const u32 levelsCount = std::min(skippedLevelsCount, ComputeMipLevelsCount(width, height) - 1);
+	for (u32 levelIndex = 0; levelIndex < levelsCount; levelIndex++)
+	{
+		level = DownsampleMip(level, width, height, channelsCount, GetTextureSpace(type), type == TextureType::Normal);
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	// The pixels are freed like the ones from stb_image, which uses malloc
+	DecodedImage downsampledImage{};
+	downsampledImage.width = static_cast<i32>(width);
+	downsampledImage.height = static_cast<i32>(height);
+	downsampledImage.componentsCount = image.componentsCount;
+	downsampledImage.pixels = { static_cast<u8*>(std::malloc(level.size())), std::free };
+	std::memcpy(downsampledImage.pixels.get(), level.data(), level.size());
+
+	return downsampledImage;
+}
+
+DecodedImage CreateFallbackImage(const TextureType type)
+{
+	std::array<u8, 3> color{ 255, 255, 255 };
+	switch (type)
+	{
+	case TextureType::Normal:
+		color = { 128, 128, 255 };
+		break;
+	case TextureType::Roughness:
+		// Packed occlusion, roughness and metallic
+		color = { 255, 255, 0 };
+		break;
+	case TextureType::Metallic:
+		color = { 0, 0, 0 };
+		break;
+	default:
+		break;
+	}
+
+	// The pixels are freed like the ones from stb_image, which uses malloc
+	DecodedImage image{};
+	image.width = 1;
+	image.height = 1;
+	image.componentsCount = static_cast<i32>(color.size());
+	image.pixels = { static_cast<u8*>(std::malloc(color.size())), std::free };
+	std::memcpy(image.pixels.get(), color.data(), color.size());
+
+	return image;
+}
+
+std::expected<DecodedImage, std::string> DecodeOrmFromPaths(
+	const std::optional<std::filesystem::path>& ambientOcclusionPath,
+	const std::filesystem::path& roughnessPath,
+	const std::filesystem::path& metallicPath)
+{
+	constexpr usize ChannelsCount = 3;
+	const std::array<std::optional<std::filesystem::path>, ChannelsCount> paths{
+		ambientOcclusionPath, roughnessPath, metallicPath
+	};
+
+	// Every file is decoded once, even when it is used by several maps
+	std::vector<std::pair<std::filesystem::path, DecodedImage>> images;
+	// The images are referenced by pointer, so the vector must never reallocate
+	images.reserve(ChannelsCount);
+	std::array<const DecodedImage*, ChannelsCount> channelImages{};
+	std::array<i32, ChannelsCount> sourceChannels{};
+	for (usize channel = 0; channel < ChannelsCount; channel++)
+	{
+		if (!paths[channel].has_value())
+		{
+			continue;
+		}
+
+		const std::filesystem::path& path = paths[channel].value();
+		auto image = std::ranges::find(images, path, &std::pair<std::filesystem::path, DecodedImage>::first);
+		if (image == images.end())
+		{
+			auto decodeResult = Texture::DecodeFromPath(path);
+			if (!decodeResult)
+			{
+				return std::unexpected(decodeResult.error());
+			}
+			images.emplace_back(path, std::move(decodeResult.value()));
+			image = std::prev(images.end());
+		}
+
+		const bool isSharedFile = std::ranges::count(paths, std::optional{ path }) > 1;
+		channelImages[channel] = &image->second;
+		const i32 sourceChannel = isSharedFile ? static_cast<i32>(channel) : 0;
+		sourceChannels[channel] = std::min(sourceChannel, image->second.componentsCount - 1);
+	}
+
+	i32 width = 1;
+	i32 height = 1;
+	for (const auto& [path, image] : images)
+	{
+		width = std::max(width, image.width);
+		height = std::max(height, image.height);
+	}
+
+	DecodedImage packedImage{};
+	packedImage.width = width;
+	packedImage.height = height;
+	packedImage.componentsCount = static_cast<i32>(ChannelsCount);
+	const usize pixelsCount = static_cast<usize>(width) * static_cast<usize>(height);
+	packedImage.pixels = { static_cast<u8*>(std::malloc(pixelsCount * ChannelsCount)), std::free };
+
+	for (usize channel = 0; channel < ChannelsCount; channel++)
+	{
+		const DecodedImage* image = channelImages[channel];
+		for (i32 y = 0; y < height; y++)
+		{
+			for (i32 x = 0; x < width; x++)
+			{
+				const usize packedIndex =
+					(static_cast<usize>(y) * static_cast<usize>(width) + static_cast<usize>(x)) * ChannelsCount + channel;
+				if (image == nullptr)
+				{
+					packedImage.pixels.get()[packedIndex] = std::numeric_limits<u8>::max();
+					continue;
+				}
+
+				// Nearest neighbour is enough, the maps of a material rarely have different sizes
+				const i32 sourceX = x * image->width / width;
+				const i32 sourceY = y * image->height / height;
+				const usize sourcePixelIndex =
+					static_cast<usize>(sourceY) * static_cast<usize>(image->width) + static_cast<usize>(sourceX);
+				const usize sourceIndex = sourcePixelIndex * static_cast<usize>(image->componentsCount)
+										  + static_cast<usize>(sourceChannels[channel]);
+				packedImage.pixels.get()[packedIndex] = image->pixels.get()[sourceIndex];
+			}
+		}
+	}
+
+	return { std::move(packedImage) };
+}
+
 aiTextureType ToAssimpTextureType(const TextureType type)
 {
 	switch (type)
@@ -401,12 +994,15 @@ aiTextureType ToAssimpTextureType(const TextureType type)
 
 Texture::Texture(Texture&& other) noexcept
 	: textureId(other.textureId), textureType(other.textureType), space(other.space), glFormat(other.glFormat),
-	  internalFormat(other.internalFormat), m_GlTextureTarget(other.m_GlTextureTarget)
+	  internalFormat(other.internalFormat), m_GlTextureTarget(other.m_GlTextureTarget),
+	  m_TrackedGpuSize(other.m_TrackedGpuSize), m_IsGpuSizeTracked(other.m_IsGpuSizeTracked)
 {
 	other.textureId = 0;
 	other.glFormat = GL_INVALID_ENUM;
 	other.internalFormat = -1;
 	other.m_GlTextureTarget = GL_INVALID_ENUM;
+	other.m_TrackedGpuSize = 0;
+	other.m_IsGpuSizeTracked = false;
 }
 
 Texture::~Texture()
@@ -431,10 +1027,14 @@ Texture& Texture::operator=(Texture&& other) noexcept
 	glFormat = other.glFormat;
 	internalFormat = other.internalFormat;
 	m_GlTextureTarget = other.m_GlTextureTarget;
+	m_TrackedGpuSize = other.m_TrackedGpuSize;
+	m_IsGpuSizeTracked = other.m_IsGpuSizeTracked;
 	other.textureId = 0;
 	other.glFormat = GL_INVALID_ENUM;
 	other.internalFormat = -1;
 	other.m_GlTextureTarget = GL_INVALID_ENUM;
+	other.m_TrackedGpuSize = 0;
+	other.m_IsGpuSizeTracked = false;
 
 	return *this;
 }
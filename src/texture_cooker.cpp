@@ -0,0 +1,195 @@
+/**
+ * @file texture_cooker.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the functions that convert source textures into block compressed KTX2 files.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ktx.h>
+#include <spdlog/spdlog.h>
+#include <stb_image/stb_image.h>
+
+export module texture_cooker;
+
+import number_types;
+import texture;
+
+export namespace stw
+{
+/**
+ * Zstandard level used for the supercompression of the cooked textures. Higher is smaller but slower to cook, the
+ * decompression speed does not change much.
+ */
+constexpr u32 CookedTextureZstdLevel = 18;
+
+[[nodiscard]] std::optional<TextureType> ParseCookedTextureType(std::string_view name);
+
+/**
+ * Cooks a source texture (PNG, JPG...) into a KTX2 file with a full mip chain, compressed to UASTC and supercompressed
+ * with Zstandard. The transfer function (sRGB or linear) comes from the texture type.
+ * @param sourcePath Path of the source texture.
+ * @param outputPath Path of the KTX2 file to write.
+ * @param type What the texture is used for.
+ */
+std::expected<void, std::string> CookTexture(
+	const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath, TextureType type);
+
+std::optional<TextureType> ParseCookedTextureType(const std::string_view name)
+{
+	constexpr std::array<std::pair<std::string_view, TextureType>, 6> textureTypeNames{ {
+		{ "base_color", TextureType::BaseColor },
+		{ "specular", TextureType::Specular },
+		{ "normal", TextureType::Normal },
+		{ "roughness", TextureType::Roughness },
+		{ "ambient_occlusion", TextureType::AmbientOcclusion },
+		{ "metallic", TextureType::Metallic },
+	} };
+
+	for (const auto& [typeName, type] : textureTypeNames)
+	{
+		if (typeName == name)
+		{
+			return type;
+		}
+	}
+
+	return std::nullopt;
+}
+
+/**
+ * Gets the VkFormat of an 8 bits per channel image.
+ */
+u32 GetVkFormat(const i32 channelsCount, const TextureSpace space)
+{
+	// Values of VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM and VK_FORMAT_R8G8B8A8_UNORM
+	constexpr std::array<u32, 4> unormFormats{ 9, 16, 23, 37 };
+	// Values of VK_FORMAT_R8_SRGB, VK_FORMAT_R8G8_SRGB, VK_FORMAT_R8G8B8_SRGB and VK_FORMAT_R8G8B8A8_SRGB
+	constexpr std::array<u32, 4> srgbFormats{ 15, 22, 29, 43 };
+
+	const auto index = static_cast<usize>(channelsCount - 1);
+	return space == TextureSpace::Srgb ? srgbFormats.at(index) : unormFormats.at(index);
+}
+
+std::expected<void, std::string> CookTexture(
+	const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath, const TextureType type)
+{
+	const TextureSpace space = GetTextureSpace(type);
+	const bool isNormalMap = type == TextureType::Normal;
+
+	i32 width = 0;
+	i32 height = 0;
+	i32 channelsCount = 0;
+	const auto sourceString = sourcePath.string();
+	u8* data = stbi_load(sourceString.c_str(), &width, &height, &channelsCount, 0);
+	if (data == nullptr)
+	{
+		return std::unexpected(std::format("Could not load {} : {}", sourceString, stbi_failure_reason()));
+	}
+
+	std::vector<u8> level(data, data + static_cast<usize>(width) * static_cast<usize>(height) * channelsCount);
+	stbi_image_free(data);
+
+	const u32 levelsCount = ComputeMipLevelsCount(static_cast<u32>(width), static_cast<u32>(height));
+
+	ktxTextureCreateInfo createInfo{};
+	createInfo.vkFormat = GetVkFormat(channelsCount, space);
+	createInfo.baseWidth = static_cast<ktx_uint32_t>(width);
+	createInfo.baseHeight = static_cast<ktx_uint32_t>(height);
+	createInfo.baseDepth = 1;
+	createInfo.numDimensions = 2;
+	createInfo.numLevels = levelsCount;
+	createInfo.numLayers = 1;
+	createInfo.numFaces = 1;
+	createInfo.isArray = KTX_FALSE;
+	createInfo.generateMipmaps = KTX_FALSE;
+
+	ktxTexture2* kTexture = nullptr;
+	KTX_error_code result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &kTexture);
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not create KTX2 texture : {}", ktxErrorString(result)));
+	}
+
+	auto levelWidth = static_cast<u32>(width);
+	auto levelHeight = static_cast<u32>(height);
+	for (u32 levelIndex = 0; levelIndex < levelsCount; levelIndex++)
+	{
+		result = ktxTexture_SetImageFromMemory(ktxTexture(kTexture), levelIndex, 0, 0, level.data(), level.size());
+		if (result != KTX_SUCCESS)
+		{
+			ktxTexture_Destroy(ktxTexture(kTexture));
+			return std::unexpected(std::format("Could not set mip {} : {}", levelIndex, ktxErrorString(result)));
+		}
+
+		if (levelIndex + 1 < levelsCount)
+		{
+			level = DownsampleMip(
+				level, levelWidth, levelHeight, static_cast<u32>(channelsCount), space, isNormalMap);
+			levelWidth = std::max(levelWidth / 2, 1u);
+			levelHeight = std::max(levelHeight / 2, 1u);
+		}
+	}
+
+	ktxBasisParams basisParams{};
+	basisParams.structSize = sizeof(basisParams);
+	basisParams.uastc = KTX_TRUE;
+	basisParams.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
+	basisParams.threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	basisParams.normalMap = isNormalMap ? KTX_TRUE : KTX_FALSE;
+	// The BC5 transcode of the loader reads X from the red channel and Y from the alpha channel, so the green channel
+	// of the normal maps is moved to alpha. Two channels images are already stored that way.
+	basisParams.separateRGToRGB_A = isNormalMap && channelsCount >= 3 ? KTX_TRUE : KTX_FALSE;
+
+	result = ktxTexture2_CompressBasisEx(kTexture, &basisParams);
+	if (result != KTX_SUCCESS)
+	{
+		ktxTexture_Destroy(ktxTexture(kTexture));
+		return std::unexpected(std::format("Could not compress {} : {}", sourceString, ktxErrorString(result)));
+	}
+
+	result = ktxTexture2_DeflateZstd(kTexture, CookedTextureZstdLevel);
+	if (result != KTX_SUCCESS)
+	{
+		ktxTexture_Destroy(ktxTexture(kTexture));
+		return std::unexpected(std::format("Could not supercompress {} : {}", sourceString, ktxErrorString(result)));
+	}
+
+	std::error_code errorCode{};
+	std::filesystem::create_directories(outputPath.parent_path(), errorCode);
+
+	result = ktxTexture_WriteToNamedFile(ktxTexture(kTexture), outputPath.string().c_str());
+	ktxTexture_Destroy(ktxTexture(kTexture));
+	if (result != KTX_SUCCESS)
+	{
+		return std::unexpected(std::format("Could not write {} : {}", outputPath.string(), ktxErrorString(result)));
+	}
+
+	spdlog::info("Cooked {} into {} ({}x{}, {} mips, {})",
+		sourceString,
+		outputPath.string(),
+		width,
+		height,
+		levelsCount,
+		space == TextureSpace::Srgb ? "sRGB" : "linear");
+
+	return {};
+}
+}// namespace stw
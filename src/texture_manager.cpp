@@ -10,9 +10,16 @@
  */
 module;
 
+#include <algorithm>
+#include <cassert>
 #include <expected>
 #include <filesystem>
+#include <format>
+#include <functional>
+#include <future>
+#include <memory>
 #include <optional>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -24,18 +31,105 @@ import texture;
 import number_types;
 import consts;
 import utils;
+import thread_pool;
 
 export namespace stw
 {
+struct TextureCacheStats
+{
+	u64 hitsCount = 0;
+	u64 missesCount = 0;
+	usize texturesCount = 0;
+
+	/**
+	 * Estimated video memory used by the loaded textures.
+	 */
+	usize residentBytes = 0;
+
+	/**
+	 * Video memory that would have been used if every cache hit had loaded the texture again.
+	 */
+	usize savedBytes = 0;
+};
+
+/**
+ * Decodes the full resolution image of a texture. It must be safe to call from a worker thread.
+ */
+using ImageDecoder = std::function<std::expected<DecodedImage, std::string>()>;
+
+/**
+ * Image decoded for a texture whose first mip levels may have been skipped.
+ */
+struct StreamedImage
+{
+	DecodedImage image;
+	u32 fullWidth = 0;
+	u32 fullHeight = 0;
+	u32 skippedLevelsCount = 0;
+};
+
+/**
+ * Decodes an image and skips its largest mip levels until it fits in a maximum size. This does not use OpenGL.
+ * @param decoder Function that decodes the image.
+ * @param type What the image is used for.
+ * @param maxSize Maximum width and height of the image, or zero to keep the full resolution.
+ */
+std::expected<StreamedImage, std::string> DecodeStreamedImage(
+	const ImageDecoder& decoder, TextureType type, u32 maxSize);
+
+/**
+ * Gets the path used as a key by the texture cache, which is the same for every way to write the path of a file.
+ */
+[[nodiscard]] std::filesystem::path GetCanonicalPath(const std::filesystem::path& path);
+
+/**
+ * Hashes the canonical path of a file with its size and its last write time, so that a file that is replaced is loaded
+ * again. A missing file only hashes its path, its loading fails anyway.
+ * @param path Path of the file.
+ * @param hash Hash to continue from, to make a key from several files.
+ */
+[[nodiscard]] u64 HashTextureFile(const std::filesystem::path& path, u64 hash);
+
+/**
+ * Streaming state of a texture that was decoded from a file, and whose resolution can change at runtime.
+ */
+struct TextureStreamingInfo
+{
+	ImageDecoder decoder;
+	TextureType type = TextureType::BaseColor;
+	TextureSpace space = TextureSpace::Srgb;
+	u32 fullWidth = 0;
+	u32 fullHeight = 0;
+
+	/**
+	 * Mip level of the full image that is the base level of the texture on the GPU.
+	 */
+	u32 residentLevel = 0;
+	usize size = 0;
+
+	/**
+	 * Every mip level of the full image, built by the first stream of the texture and kept while it is seen, so that
+	 * the next streams do not decode the file again. Empty until then.
+	 */
+	std::shared_ptr<const std::vector<DecodedImage>> mipChain{};
+
+	/**
+	 * Identifies the texture among every one that was streamed, since the slot of a released texture is given to the
+	 * next one that is loaded.
+	 */
+	u64 streamId = 0;
+};
+
 /**
  * Manages all textures in this renderer. When a material wants to reference a texture, it gets an ID that can be used
  * on this manager.
+ * Textures are shared between every user that loads the same file, and are deleted when the last of them releases it.
  */
 class TextureManager
 {
 public:
 	/**
-	 * Loads a texture from the provided path.
+	 * Loads a texture from the provided path, or adds a reference to it if it was already loaded.
 	 * @param path Path to the texture.
 	 * @param type What will this texture be used for ?
 	 * @param space This is usually SRGB for Base Color and Linear for the rest.
@@ -43,50 +137,489 @@ class TextureManager
 	 */
 	std::optional<std::size_t> LoadTextureFromPath(
 		const std::filesystem::path& path, TextureType type, TextureSpace space);
+
+	/**
+	 * Loads separate ambient occlusion, roughness and metallic maps packed in the channels of a single linear texture.
+	 * The packing is done when decoding, so the maps only take the memory and the sampler of one texture.
+	 * @param ambientOcclusionPath Path to the ambient occlusion map, or nothing to have no occlusion.
+	 * @param roughnessPath Path to the roughness map.
+	 * @param metallicPath Path to the metallic map.
+	 * @return An index to the packed texture or nothing if the loading failed.
+	 */
+	std::optional<std::size_t> LoadOrmTextureFromPaths(const std::optional<std::filesystem::path>& ambientOcclusionPath,
+		const std::filesystem::path& roughnessPath,
+		const std::filesystem::path& metallicPath);
+
+	/**
+	 * Removes a reference to a texture. The texture is deleted once it has no reference left, and its index may be
+	 * given to another texture.
+	 * @param index Index returned by LoadTextureFromPath.
+	 */
+	void ReleaseTexture(std::size_t index);
+
 	[[nodiscard]] Texture& GetTexture(std::size_t index);
 	[[nodiscard]] const Texture& GetTexture(std::size_t index) const;
+	[[nodiscard]] TextureCacheStats GetCacheStats() const;
+
+	/**
+	 * Starts a batch of asynchronous loads. Until FinishAsyncLoading is called, LoadTextureFromPath decodes the images
+	 * on the thread pool and immediately returns the index that the texture will have once uploaded.
+	 * @param threadPool Pool on which the images are decoded.
+	 */
+	void BeginAsyncLoading(ThreadPool& threadPool);
+
+	/**
+	 * Waits for the images of the batch to be decoded and uploads them to OpenGL, in the order they were requested.
+	 * A texture that failed to load gets a neutral 1x1 image and is removed from the cache, so that loading its file
+	 * again retries.
+	 */
+	void FinishAsyncLoading();
+
+	/**
+	 * Sets the maximum size of the textures when they are first loaded, so that they load fast and use little memory
+	 * until the residency manager streams their larger mips. Zero loads the full resolution.
+	 */
+	void SetInitialMaxSize(u32 maxSize);
+	[[nodiscard]] u32 GetInitialMaxSize() const;
+
+	/**
+	 * Gets the number of texture slots, including the released ones.
+	 */
+	[[nodiscard]] std::size_t GetSlotsCount() const;
+
+	/**
+	 * Gets the streaming state of a texture. It is only valid until the texture is replaced or released.
+	 * @return The state or null if the texture is released, still loading, or not loaded from a streamable file.
+	 */
+	[[nodiscard]] const TextureStreamingInfo* GetStreamingInfo(std::size_t index) const;
+
+	/**
+	 * Keeps the decoded mip levels of a streamed texture, or frees them when null.
+	 */
+	void SetStreamingMipChain(std::size_t index, std::shared_ptr<const std::vector<DecodedImage>> mipChain);
+
+	/**
+	 * Replaces a texture by a version of it that starts at another mip level. The index of the texture does not
+	 * change.
+	 */
+	void ReplaceResidentLevel(std::size_t index, Texture&& texture, u32 residentLevel);
 
 	void Delete();
 
 private:
+	struct PendingTexture
+	{
+		std::size_t index;
+		TextureType type;
+		TextureSpace space;
+		ImageDecoder decoder;
+		std::future<std::expected<StreamedImage, std::string>> decodedImage;
+	};
+
+	struct TextureEntry
+	{
+		u32 referencesCount = 0;
+		u64 hitsCount = 0;
+		usize size = 0;
+		std::optional<TextureStreamingInfo> streamingInfo{};
+	};
+
 	std::vector<Texture> m_Textures;
-	std::unordered_map<std::filesystem::path, std::size_t> m_TexturesCache;
+	std::vector<TextureEntry> m_Entries;
+	std::vector<std::size_t> m_FreeIndices;
+
+	/**
+	 * Hash of the canonical path, size, last write time and color space of every file that was requested, to the index
+	 * of its texture. Unlike a hash of the content, the key is computed without reading the file, which is then only
+	 * read once by the decoding.
+	 */
+	std::unordered_map<u64, std::size_t> m_TexturesCache;
+
+	u64 m_HitsCount = 0;
+	u64 m_MissesCount = 0;
+
+	ThreadPool* m_ThreadPool = nullptr;
+	std::vector<PendingTexture> m_PendingTextures;
+	u32 m_InitialMaxSize = 0;
+	u64 m_NextStreamId = 1;
+
+	/**
+	 * Uploads a streamed image in a slot and keeps what is needed to stream it later.
+	 */
+	void CreateStreamedTexture(std::size_t index, const PendingTexture& pendingTexture, const StreamedImage& image);
+
+	/**
+	 * Looks for a texture in the cache. On a hit, adds a reference to it.
+	 * @param cacheKey Key of the requested file, made with HashTextureFile.
+	 * @return The index of the cached texture, if it was found.
+	 */
+	std::optional<std::size_t> FindCachedTexture(u64 cacheKey);
+
+	/**
+	 * Stores a new texture in the cache. If no cooked texture is provided, the image is decoded and can be streamed.
+	 * @return The index of the new texture or nothing if the loading failed.
+	 */
+	std::optional<std::size_t> AddTexture(u64 cacheKey,
+		std::optional<std::expected<Texture, std::string>> cookedTexture,
+		ImageDecoder decoder,
+		TextureType type,
+		TextureSpace space);
+
+	/**
+	 * Adds a reference to an already loaded texture.
+	 */
+	std::size_t AddCacheHit(std::size_t index);
+
+	/**
+	 * Gets the index of a slot in which a new texture can be stored.
+	 */
+	std::size_t AllocateIndex();
 };
 
 Texture& TextureManager::GetTexture(const std::size_t index) { return m_Textures[index]; }
 
 const Texture& TextureManager::GetTexture(const std::size_t index) const { return m_Textures[index]; }
 
+TextureCacheStats TextureManager::GetCacheStats() const
+{
+	TextureCacheStats stats{};
+	stats.hitsCount = m_HitsCount;
+	stats.missesCount = m_MissesCount;
+
+	for (const TextureEntry& entry : m_Entries)
+	{
+		if (entry.referencesCount == 0)
+		{
+			continue;
+		}
+
+		stats.texturesCount++;
+		stats.residentBytes += entry.size;
+		stats.savedBytes += entry.size * entry.hitsCount;
+	}
+
+	return stats;
+}
+
+std::filesystem::path GetCanonicalPath(const std::filesystem::path& path)
+{
+	std::error_code errorCode{};
+	std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, errorCode);
+	if (errorCode)
+	{
+		return path.lexically_normal();
+	}
+
+	return canonicalPath;
+}
+
+u64 HashTextureFile(const std::filesystem::path& path, const u64 hash)
+{
+	const u64 pathHash = HashFnv1a(GetCanonicalPath(path).generic_string(), hash);
+	return HashFileStampFnv1a(path, pathHash).value_or(pathHash);
+}
+
 std::optional<std::size_t> TextureManager::LoadTextureFromPath(
 	const std::filesystem::path& path, const TextureType type, const TextureSpace space)
 {
 	spdlog::debug("Loading texture {}...", path.string());
 
-	if (const auto result = m_TexturesCache.find(path); result != m_TexturesCache.end())
+	// The same pixels are a different texture when they are not interpreted in the same color space
+	const auto spaceValue = static_cast<u8>(space);
+	const u64 spaceHash = HashFnv1a(std::as_bytes(std::span{ &spaceValue, 1 }));
+	const u64 cacheKey = HashTextureFile(path, spaceHash);
+
+	if (const auto cachedIndex = FindCachedTexture(cacheKey))
 	{
-		return { result->second };
+		return cachedIndex;
 	}
 
-	std::expected<Texture, std::string> textureResult;
 	const auto extension = path.extension();
+
+	// Textures cooked by the asset cooker are next to their source with the KTX2 extension
+	std::filesystem::path cookedPath = path;
+	cookedPath.replace_extension(".ktx2");
+
+	std::optional<std::expected<Texture, std::string>> cookedTexture{};
 	if (extension == ".ktx" || extension == ".ktx2")
 	{
-		textureResult = Texture::LoadKtxFromPath(path, type);
+		cookedTexture = Texture::LoadKtxFromPath(path, type);
 	}
-	else
+	else if (std::filesystem::exists(cookedPath))
+	{
+		cookedTexture = Texture::LoadKtxFromPath(cookedPath, type);
+	}
+
+	return AddTexture(cacheKey,
+		std::move(cookedTexture),
+		[path] { return Texture::DecodeFromPath(path); },
+		type,
+		space);
+}
+
+std::optional<std::size_t> TextureManager::LoadOrmTextureFromPaths(
+	const std::optional<std::filesystem::path>& ambientOcclusionPath,
+	const std::filesystem::path& roughnessPath,
+	const std::filesystem::path& metallicPath)
+{
+	// The maps are often already packed in a single file, like the metallic roughness texture of glTF
+	if (ambientOcclusionPath.has_value() && ambientOcclusionPath.value() == roughnessPath && roughnessPath == metallicPath)
+	{
+		return LoadTextureFromPath(roughnessPath, TextureType::Roughness, TextureSpace::Linear);
+	}
+
+	spdlog::debug("Packing textures {}, {} and {}...",
+		ambientOcclusionPath.value_or("no ambient occlusion").string(),
+		roughnessPath.string(),
+		metallicPath.string());
+
+	// The packed texture has no file of its own, its key is made from the keys of the packed files
+	u64 cacheKey = HashFnv1a("orm");
+	cacheKey = ambientOcclusionPath.has_value() ? HashTextureFile(ambientOcclusionPath.value(), cacheKey)
+												: HashFnv1a("none", cacheKey);
+	cacheKey = HashTextureFile(roughnessPath, cacheKey);
+	cacheKey = HashTextureFile(metallicPath, cacheKey);
+
+	if (const auto cachedIndex = FindCachedTexture(cacheKey))
+	{
+		return cachedIndex;
+	}
+
+	return AddTexture(
+		cacheKey,
+		std::nullopt,
+		[ambientOcclusionPath, roughnessPath, metallicPath] {
+			return DecodeOrmFromPaths(ambientOcclusionPath, roughnessPath, metallicPath);
+		},
+		TextureType::Roughness,
+		TextureSpace::Linear);
+}
+
+std::optional<std::size_t> TextureManager::FindCachedTexture(const u64 cacheKey)
+{
+	if (const auto result = m_TexturesCache.find(cacheKey); result != m_TexturesCache.end())
+	{
+		return { AddCacheHit(result->second) };
+	}
+
+	return std::nullopt;
+}
+
+std::optional<std::size_t> TextureManager::AddTexture(const u64 cacheKey,
+	std::optional<std::expected<Texture, std::string>> cookedTexture,
+	ImageDecoder decoder,
+	const TextureType type,
+	const TextureSpace space)
+{
+	// Images that are not loaded asynchronously are decoded here and uploaded right away
+	std::optional<std::expected<StreamedImage, std::string>> streamedImage{};
+	if (!cookedTexture && m_ThreadPool == nullptr)
 	{
-		textureResult = Texture::LoadFromPath(path, type, space);
+		streamedImage = DecodeStreamedImage(decoder, type, m_InitialMaxSize);
 	}
 
+	if (cookedTexture && !cookedTexture->has_value())
+	{
+		spdlog::error("Error while loading texture : {}", cookedTexture->error());
+		return {};
+	}
 
-	if (!textureResult.has_value())
+	if (streamedImage && !streamedImage->has_value())
 	{
-		spdlog::error("Error while loading texture : {}", textureResult.error());
+		spdlog::error("Error while loading texture : {}", streamedImage->error());
 		return {};
 	}
 
-	m_Textures.push_back(std::move(textureResult.value()));
-	return { m_Textures.size() - 1 };
+	m_MissesCount++;
+	const std::size_t index = AllocateIndex();
+	TextureEntry& entry = m_Entries[index];
+	entry.referencesCount = 1;
+	entry.hitsCount = 0;
+
+	if (cookedTexture)
+	{
+		m_Textures[index] = std::move(cookedTexture->value());
+		entry.size = m_Textures[index].ComputeGpuSize();
+	}
+	else if (streamedImage)
+	{
+		CreateStreamedTexture(index, { index, type, space, std::move(decoder), {} }, streamedImage->value());
+	}
+	else
+	{
+		// The index is reserved now so that materials can reference the texture before it is uploaded
+		auto decodedImage = m_ThreadPool->Submit(
+			[decoder, type, maxSize = m_InitialMaxSize] { return DecodeStreamedImage(decoder, type, maxSize); });
+		m_PendingTextures.push_back({ index, type, space, std::move(decoder), std::move(decodedImage) });
+	}
+
+	m_TexturesCache.emplace(cacheKey, index);
+
+	return { index };
+}
+
+void TextureManager::ReleaseTexture(const std::size_t index)
+{
+	// The index of a pending texture must not be given to another texture before the upload
+	assert(m_PendingTextures.empty());
+
+	TextureEntry& entry = m_Entries[index];
+	assert(entry.referencesCount > 0);
+
+	entry.referencesCount--;
+	if (entry.referencesCount > 0)
+	{
+		return;
+	}
+
+	std::erase_if(m_TexturesCache, [index](const auto& cacheEntry) { return cacheEntry.second == index; });
+
+	m_Textures[index].Delete();
+	entry = {};
+	m_FreeIndices.push_back(index);
+}
+
+std::size_t TextureManager::AddCacheHit(const std::size_t index)
+{
+	TextureEntry& entry = m_Entries[index];
+	entry.referencesCount++;
+	entry.hitsCount++;
+	m_HitsCount++;
+	return index;
+}
+
+std::size_t TextureManager::AllocateIndex()
+{
+	if (!m_FreeIndices.empty())
+	{
+		const std::size_t index = m_FreeIndices.back();
+		m_FreeIndices.pop_back();
+		return index;
+	}
+
+	m_Textures.emplace_back();
+	m_Entries.emplace_back();
+	return m_Textures.size() - 1;
+}
+
+void TextureManager::BeginAsyncLoading(ThreadPool& threadPool)
+{
+	assert(m_ThreadPool == nullptr);
+	m_ThreadPool = &threadPool;
+}
+
+void TextureManager::FinishAsyncLoading()
+{
+	assert(m_ThreadPool != nullptr);
+
+	for (PendingTexture& pendingTexture : m_PendingTextures)
+	{
+		const auto decodeResult = pendingTexture.decodedImage.get();
+		if (!decodeResult.has_value())
+		{
+			spdlog::error("Error while loading texture : {}", decodeResult.error());
+
+			// The materials already reference the slot, so it must hold a texture they can bind
+			const std::size_t index = pendingTexture.index;
+			m_Textures[index] = Texture::CreateFromDecodedImage(
+				CreateFallbackImage(pendingTexture.type), pendingTexture.type, pendingTexture.space);
+			m_Entries[index].size = m_Textures[index].ComputeGpuSize();
+			std::erase_if(m_TexturesCache, [index](const auto& cacheEntry) { return cacheEntry.second == index; });
+			continue;
+		}
+
+		CreateStreamedTexture(pendingTexture.index, pendingTexture, decodeResult.value());
+	}
+
+	m_PendingTextures.clear();
+	m_ThreadPool = nullptr;
+}
+
+void TextureManager::SetInitialMaxSize(const u32 maxSize) { m_InitialMaxSize = maxSize; }
+
+u32 TextureManager::GetInitialMaxSize() const { return m_InitialMaxSize; }
+
+std::size_t TextureManager::GetSlotsCount() const { return m_Textures.size(); }
+
+const TextureStreamingInfo* TextureManager::GetStreamingInfo(const std::size_t index) const
+{
+	const TextureEntry& entry = m_Entries[index];
+	if (entry.referencesCount == 0 || !entry.streamingInfo.has_value())
+	{
+		return nullptr;
+	}
+
+	return &entry.streamingInfo.value();
+}
+
+void TextureManager::SetStreamingMipChain(
+	const std::size_t index, std::shared_ptr<const std::vector<DecodedImage>> mipChain)
+{
+	TextureEntry& entry = m_Entries[index];
+	assert(entry.streamingInfo.has_value());
+
+	entry.streamingInfo->mipChain = std::move(mipChain);
+}
+
+void TextureManager::ReplaceResidentLevel(const std::size_t index, Texture&& texture, const u32 residentLevel)
+{
+	TextureEntry& entry = m_Entries[index];
+	assert(entry.streamingInfo.has_value());
+
+	m_Textures[index] = std::move(texture);
+	entry.size = m_Textures[index].ComputeGpuSize();
+	entry.streamingInfo->residentLevel = residentLevel;
+	entry.streamingInfo->size = entry.size;
+}
+
+void TextureManager::CreateStreamedTexture(
+	const std::size_t index, const PendingTexture& pendingTexture, const StreamedImage& image)
+{
+	m_Textures[index] = Texture::CreateFromDecodedImage(image.image, pendingTexture.type, pendingTexture.space);
+
+	TextureEntry& entry = m_Entries[index];
+	entry.size = m_Textures[index].ComputeGpuSize();
+	entry.streamingInfo = TextureStreamingInfo{ pendingTexture.decoder,
+		pendingTexture.type,
+		pendingTexture.space,
+		image.fullWidth,
+		image.fullHeight,
+		image.skippedLevelsCount,
+		entry.size,
+		{},
+		m_NextStreamId++ };
+}
+
+std::expected<StreamedImage, std::string> DecodeStreamedImage(
+	const ImageDecoder& decoder, const TextureType type, const u32 maxSize)
+{
+	auto decodeResult = decoder();
+	if (!decodeResult)
+	{
+		return std::unexpected(decodeResult.error());
+	}
+
+	StreamedImage streamedImage{};
+	streamedImage.fullWidth = static_cast<u32>(decodeResult->width);
+	streamedImage.fullHeight = static_cast<u32>(decodeResult->height);
+
+	if (maxSize == 0)
+	{
+		streamedImage.image = std::move(decodeResult.value());
+		return streamedImage;
+	}
+
+	const u32 levelsCount = ComputeMipLevelsCount(streamedImage.fullWidth, streamedImage.fullHeight);
+	while (streamedImage.skippedLevelsCount + 1 < levelsCount
+		   && std::max(streamedImage.fullWidth, streamedImage.fullHeight) >> streamedImage.skippedLevelsCount > maxSize)
+	{
+		streamedImage.skippedLevelsCount++;
+	}
+
+	streamedImage.image = streamedImage.skippedLevelsCount == 0
+							  ? std::move(decodeResult.value())
+							  : DownsampleImage(decodeResult.value(), streamedImage.skippedLevelsCount, type);
+	return streamedImage;
 }
 
 void TextureManager::Delete()
@@ -95,5 +628,10 @@ void TextureManager::Delete()
 	{
 		texture.Delete();
 	}
+
+	m_Textures.clear();
+	m_Entries.clear();
+	m_FreeIndices.clear();
+	m_TexturesCache.clear();
 }
 }// namespace stw
@@ -0,0 +1,547 @@
+/**
+ * @file texture_residency.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the residency manager that streams the mip levels of the textures.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+export module texture_residency;
+
+import number_types;
+import utils;
+import texture;
+import texture_manager;
+import thread_pool;
+import material;
+
+export namespace stw
+{
+/**
+ * Video memory that the textures can always use, even when the rest of the allocations are over the GPU budget.
+ */
+constexpr u32 MinTextureBudgetMb = 16;
+
+struct TextureStreamingSettings
+{
+	bool enabled = true;
+
+	/**
+	 * Video memory that the textures should not use more than, in mebibytes.
+	 */
+	u32 budgetMb = 512;
+
+	/**
+	 * Maximum width and height of a texture when it is first loaded.
+	 */
+	u32 initialMaxSize = 128;
+
+	/**
+	 * Maximum number of textures that change resolution in a frame, to avoid hitches.
+	 */
+	u32 maxUploadsPerFrame = 2;
+
+	/**
+	 * Number of frames a texture must be unseen before its largest mips are evicted.
+	 */
+	u32 evictionDelayFrames = 120;
+
+	/**
+	 * Clamps every value in a range that makes sense.
+	 */
+	void Validate();
+};
+
+/**
+ * Loads the texture streaming settings from a config file made of "key = value" lines.
+ * @param path Path of the config file.
+ * @return The loaded settings or an error message.
+ */
+std::expected<TextureStreamingSettings, std::string> LoadTextureStreamingSettings(const std::filesystem::path& path);
+
+/**
+ * Chooses which mip levels of the textures are resident on the GPU.
+ * Every frame, the renderer requests a screen size for the materials it draws. The larger mips of the textures that
+ * cover many pixels are then decoded on the thread pool and uploaded a few at a time, while the textures that are
+ * unseen or that do not fit in the memory budget lose theirs.
+ */
+class TextureResidencyManager
+{
+public:
+	void SetSettings(const TextureStreamingSettings& settings);
+	[[nodiscard]] const TextureStreamingSettings& GetSettings() const;
+
+	/**
+	 * Requests the textures of a material to have enough texels for the size it covers on screen.
+	 * @param material Material that is drawn.
+	 * @param screenSize Size covered by the material on screen, in pixels.
+	 */
+	void RequestMaterialSize(const Material& material, f32 screenSize);
+
+	/**
+	 * Requests a texture to have enough texels for the size it covers on screen.
+	 * @param index Index of the texture in the texture manager.
+	 * @param screenSize Size covered by the texture on screen, in pixels.
+	 */
+	void RequestTextureSize(std::size_t index, f32 screenSize);
+
+	/**
+	 * Uploads the mips that finished decoding, evicts the textures that are unused or over budget and starts decoding
+	 * the mips that are now needed. Must be called once per frame, after the requests.
+	 */
+	void Update(TextureManager& textureManager, ThreadPool& threadPool);
+
+	/**
+	 * Limits the video memory the textures may use to what the other allocations leave of the GPU budget. The limit is
+	 * computed again on every call, so it grows back once the other allocations are freed. When it is lowered, the
+	 * next updates drop the mips of the least needed textures first.
+	 * @param textureManager Texture manager that contains the streamed textures.
+	 * @param usedBytes Video memory used by every allocation, the textures included.
+	 * @param budgetBytes Budget of the whole video memory, or zero if there is none.
+	 */
+	void FitInGpuBudget(const TextureManager& textureManager, usize usedBytes, usize budgetBytes);
+
+	/**
+	 * Waits for the decodes that are still running and forgets every request.
+	 */
+	void Clear();
+
+private:
+	struct TextureRequest
+	{
+		f32 screenSize = 0.0f;
+		u64 lastRequestedFrame = 0;
+		bool hasBeenRequested = false;
+	};
+
+	struct PendingStream
+	{
+		std::size_t index;
+		/**
+		 * Texture the mips are decoded for. If its slot is released meanwhile, they are dropped.
+		 */
+		u64 streamId;
+		u32 level;
+		std::future<std::expected<std::shared_ptr<const std::vector<DecodedImage>>, std::string>> mipChain;
+	};
+
+	TextureStreamingSettings m_Settings{};
+	std::vector<TextureRequest> m_Requests;
+	std::vector<PendingStream> m_PendingStreams;
+	u64 m_FrameIndex = 0;
+
+	/**
+	 * Limit set by FitInGpuBudget, on top of the budget of the settings.
+	 */
+	usize m_MaxResidentBytes = std::numeric_limits<usize>::max();
+
+	/**
+	 * Gets the mip level that has about one texel per pixel for a screen size.
+	 */
+	[[nodiscard]] static u32 ComputeWantedLevel(const TextureStreamingInfo& info, f32 screenSize);
+
+	/**
+	 * Uploads the decoded mips, up to a number of uploads.
+	 * @return The number of uploads that were made.
+	 */
+	u32 UploadFinishedStreams(TextureManager& textureManager, u32 maxUploadsCount);
+
+	/**
+	 * Decodes the full image of a texture and builds every one of its mip levels. It can run on any thread.
+	 */
+	static std::expected<std::shared_ptr<const std::vector<DecodedImage>>, std::string> DecodeMipChain(
+		const ImageDecoder& decoder, TextureType type);
+};
+
+void TextureStreamingSettings::Validate()
+{
+	budgetMb = std::max(budgetMb, MinTextureBudgetMb);
+	initialMaxSize = std::clamp(initialMaxSize, 1u, 4096u);
+	maxUploadsPerFrame = std::max(maxUploadsPerFrame, 1u);
+}
+
+std::expected<TextureStreamingSettings, std::string> LoadTextureStreamingSettings(const std::filesystem::path& path)
+{
+	const auto entries = ReadConfigFile(path);
+	if (!entries)
+	{
+		return std::unexpected(entries.error());
+	}
+
+	TextureStreamingSettings settings{};
+	for (const ConfigEntry& entry : entries.value())
+	{
+		if (entry.key == "enabled")
+		{
+			if (entry.value != "true" && entry.value != "false")
+			{
+				return std::unexpected(
+					std::format("{}:{} : expected true or false, got \"{}\"", path.string(), entry.lineNumber, entry.value));
+			}
+			settings.enabled = entry.value == "true";
+			continue;
+		}
+
+		const auto value = ParseNumber<u32>(entry.value);
+		if (!value)
+		{
+			return std::unexpected(std::format("{}:{} : {}", path.string(), entry.lineNumber, value.error()));
+		}
+
+		if (entry.key == "budget_mb")
+		{
+			settings.budgetMb = value.value();
+		}
+		else if (entry.key == "initial_max_size")
+		{
+			settings.initialMaxSize = value.value();
+		}
+		else if (entry.key == "max_uploads_per_frame")
+		{
+			settings.maxUploadsPerFrame = value.value();
+		}
+		else if (entry.key == "eviction_delay_frames")
+		{
+			settings.evictionDelayFrames = value.value();
+		}
+		else
+		{
+			spdlog::warn("Unknown texture streaming key \"{}\" in {}", entry.key, path.string());
+		}
+	}
+
+	settings.Validate();
+	return settings;
+}
+
+void TextureResidencyManager::SetSettings(const TextureStreamingSettings& settings)
+{
+	m_Settings = settings;
+	m_Settings.Validate();
+	m_MaxResidentBytes = std::numeric_limits<usize>::max();
+}
+
+const TextureStreamingSettings& TextureResidencyManager::GetSettings() const { return m_Settings; }
+
+void TextureResidencyManager::RequestMaterialSize(const Material& material, const f32 screenSize)
+{
+	const auto requestTextures = [this, screenSize](const auto... textureIndices) {
+		(RequestTextureSize(textureIndices, screenSize), ...);
+	};
+
+	const auto invalid = [](const InvalidMaterial&) {};
+	const auto pbrNormalArm = [&requestTextures](const MaterialPbrNormalArm& pbrMaterial) {
+		requestTextures(pbrMaterial.baseColorMapIndex, pbrMaterial.normalMapIndex, pbrMaterial.armMapIndex);
+	};
+
+	std::visit(Overloaded{ invalid, pbrNormalArm }, material);
+}
+
+void TextureResidencyManager::RequestTextureSize(const std::size_t index, const f32 screenSize)
+{
+	if (index >= m_Requests.size())
+	{
+		m_Requests.resize(index + 1);
+	}
+
+	TextureRequest& request = m_Requests[index];
+	if (request.lastRequestedFrame != m_FrameIndex || !request.hasBeenRequested)
+	{
+		request.screenSize = 0.0f;
+	}
+
+	request.screenSize = std::max(request.screenSize, screenSize);
+	request.lastRequestedFrame = m_FrameIndex;
+	request.hasBeenRequested = true;
+}
+
+void TextureResidencyManager::Update(TextureManager& textureManager, ThreadPool& threadPool)
+{
+	if (!m_Settings.enabled)
+	{
+		m_FrameIndex++;
+		return;
+	}
+
+	u32 uploadsCount = UploadFinishedStreams(textureManager, m_Settings.maxUploadsPerFrame);
+
+	// The resident level and size are the ones from before the evictions of this update
+	struct Candidate
+	{
+		std::size_t index;
+		const TextureStreamingInfo* info;
+		u32 residentLevel;
+		usize size;
+		u32 wantedLevel;
+		f32 priority;
+		bool isEvicted = false;
+	};
+
+	const TextureRequest unrequestedTexture{};
+	std::vector<Candidate> candidates;
+	usize residentBytes = textureManager.GetCacheStats().residentBytes;
+	const usize budgetBytes = std::min(static_cast<usize>(m_Settings.budgetMb) * 1024 * 1024, m_MaxResidentBytes);
+
+	for (std::size_t index = 0; index < textureManager.GetSlotsCount(); index++)
+	{
+		const TextureStreamingInfo* info = textureManager.GetStreamingInfo(index);
+		if (info == nullptr)
+		{
+			continue;
+		}
+
+		const TextureRequest& request = index < m_Requests.size() ? m_Requests[index] : unrequestedTexture;
+		const bool isSeen = request.hasBeenRequested && m_FrameIndex - request.lastRequestedFrame <= 1;
+		const bool isForgotten =
+			!request.hasBeenRequested || m_FrameIndex - request.lastRequestedFrame > m_Settings.evictionDelayFrames;
+
+		u32 wantedLevel = info->residentLevel;
+		if (isSeen)
+		{
+			wantedLevel = ComputeWantedLevel(*info, request.screenSize);
+		}
+		else if (isForgotten)
+		{
+			// Unseen textures go back to the size they had when loaded, and their decoded mips are freed
+			wantedLevel = std::max(
+				info->residentLevel, ComputeWantedLevel(*info, static_cast<f32>(m_Settings.initialMaxSize)));
+			if (info->mipChain != nullptr)
+			{
+				textureManager.SetStreamingMipChain(index, nullptr);
+			}
+		}
+
+		// The priority is how many pixels are covered by each texel, the textures that are the most stretched on
+		// screen need their mips first
+		const u32 residentSize = std::max(std::max(info->fullWidth, info->fullHeight) >> info->residentLevel, 1u);
+		const f32 priority = isSeen ? request.screenSize / static_cast<f32>(residentSize) : 0.0f;
+		candidates.push_back({ index, info, info->residentLevel, info->size, wantedLevel, priority, false });
+	}
+
+	// Evictions are copies done on the GPU, so they are done before the uploads to make room in the budget
+	std::ranges::sort(candidates, {}, &Candidate::priority);
+	for (Candidate& candidate : candidates)
+	{
+		if (uploadsCount >= m_Settings.maxUploadsPerFrame)
+		{
+			break;
+		}
+
+		const bool isOverBudget = residentBytes > budgetBytes;
+		u32 newLevel = candidate.wantedLevel;
+		if (isOverBudget && newLevel <= candidate.residentLevel)
+		{
+			newLevel = candidate.residentLevel + 1;
+		}
+
+		const u32 levelsCount = ComputeMipLevelsCount(candidate.info->fullWidth, candidate.info->fullHeight);
+		if (newLevel <= candidate.residentLevel || newLevel >= levelsCount)
+		{
+			continue;
+		}
+
+		const Texture& texture = textureManager.GetTexture(candidate.index);
+		Texture evictedTexture = Texture::CreateFromTextureLevel(texture, newLevel - candidate.residentLevel);
+		textureManager.ReplaceResidentLevel(candidate.index, std::move(evictedTexture), newLevel);
+
+		residentBytes = residentBytes - std::min(residentBytes, candidate.size) + candidate.info->size;
+		candidate.isEvicted = true;
+		uploadsCount++;
+	}
+
+	// The most stretched textures get their mips first, as long as they fit in the budget
+	std::ranges::reverse(candidates);
+	const usize maxPendingStreamsCount = static_cast<usize>(m_Settings.maxUploadsPerFrame) * 2;
+	for (const Candidate& candidate : candidates)
+	{
+		if (m_PendingStreams.size() >= maxPendingStreamsCount)
+		{
+			break;
+		}
+
+		// A texture that was just evicted would be counted at its old size, and streaming it back would undo the
+		// eviction every frame
+		if (candidate.isEvicted || candidate.wantedLevel >= candidate.residentLevel)
+		{
+			continue;
+		}
+
+		const bool isAlreadyPending = std::ranges::any_of(m_PendingStreams,
+			[&candidate](const PendingStream& pendingStream) { return pendingStream.index == candidate.index; });
+		if (isAlreadyPending)
+		{
+			continue;
+		}
+
+		// The levels that were already decoded are uploaded right away
+		const bool hasMipChain = candidate.info->mipChain != nullptr;
+		if (hasMipChain && uploadsCount >= m_Settings.maxUploadsPerFrame)
+		{
+			continue;
+		}
+
+		// Each level is four times as large as the next one
+		const u32 levelsDelta = candidate.residentLevel - candidate.wantedLevel;
+		const usize newSize = candidate.size << (2 * levelsDelta);
+		if (residentBytes - std::min(residentBytes, candidate.size) + newSize > budgetBytes)
+		{
+			continue;
+		}
+		residentBytes = residentBytes - std::min(residentBytes, candidate.size) + newSize;
+
+		if (hasMipChain)
+		{
+			const DecodedImage& image = (*candidate.info->mipChain)[candidate.wantedLevel];
+			Texture texture = Texture::CreateFromDecodedImage(image, candidate.info->type, candidate.info->space);
+			textureManager.ReplaceResidentLevel(candidate.index, std::move(texture), candidate.wantedLevel);
+			uploadsCount++;
+			continue;
+		}
+
+		m_PendingStreams.push_back({ candidate.index,
+			candidate.info->streamId,
+			candidate.wantedLevel,
+			threadPool.Submit([decoder = candidate.info->decoder, type = candidate.info->type] {
+				return DecodeMipChain(decoder, type);
+			}) });
+	}
+
+	m_FrameIndex++;
+}
+
+void TextureResidencyManager::FitInGpuBudget(
+	const TextureManager& textureManager, const usize usedBytes, const usize budgetBytes)
+{
+	const usize settingsBudgetBytes = static_cast<usize>(m_Settings.budgetMb) * 1024 * 1024;
+	const bool wasLimited = m_MaxResidentBytes < settingsBudgetBytes;
+
+	usize maxResidentBytes = std::numeric_limits<usize>::max();
+	if (budgetBytes > 0)
+	{
+		// The textures keep a minimum when the other allocations alone are over budget, or every mip would be dropped
+		const usize textureBytes = textureManager.GetCacheStats().residentBytes;
+		const usize otherBytes = usedBytes - std::min(usedBytes, textureBytes);
+		maxResidentBytes = std::max(budgetBytes - std::min(budgetBytes, otherBytes),
+			static_cast<usize>(MinTextureBudgetMb) * 1024 * 1024);
+	}
+
+	m_MaxResidentBytes = maxResidentBytes;
+
+	const bool isLimited = m_MaxResidentBytes < settingsBudgetBytes;
+	if (isLimited && !wasLimited)
+	{
+		spdlog::warn("GPU memory over budget, the textures are limited to {:0.1f} MiB",
+			static_cast<f64>(m_MaxResidentBytes) / (1024.0 * 1024.0));
+	}
+	else if (!isLimited && wasLimited)
+	{
+		spdlog::info("GPU memory back under budget, the textures can use {} MiB again", m_Settings.budgetMb);
+	}
+}
+
+void TextureResidencyManager::Clear()
+{
+	for (PendingStream& pendingStream : m_PendingStreams)
+	{
+		pendingStream.mipChain.wait();
+	}
+
+	m_PendingStreams.clear();
+	m_Requests.clear();
+	m_MaxResidentBytes = std::numeric_limits<usize>::max();
+}
+
+u32 TextureResidencyManager::ComputeWantedLevel(const TextureStreamingInfo& info, const f32 screenSize)
+{
+	const u32 levelsCount = ComputeMipLevelsCount(info.fullWidth, info.fullHeight);
+	const f32 fullSize = static_cast<f32>(std::max(info.fullWidth, info.fullHeight));
+	const f32 level = std::floor(std::log2(fullSize / std::max(screenSize, 1.0f)));
+	return std::min(static_cast<u32>(std::max(level, 0.0f)), levelsCount - 1);
+}
+
+u32 TextureResidencyManager::UploadFinishedStreams(TextureManager& textureManager, const u32 maxUploadsCount)
+{
+	u32 uploadsCount = 0;
+	for (auto iterator = m_PendingStreams.begin(); iterator != m_PendingStreams.end();)
+	{
+		if (uploadsCount >= maxUploadsCount)
+		{
+			break;
+		}
+
+		if (iterator->mipChain.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+		{
+			++iterator;
+			continue;
+		}
+
+		auto mipChain = iterator->mipChain.get();
+		const TextureStreamingInfo* info = textureManager.GetStreamingInfo(iterator->index);
+		if (!mipChain.has_value())
+		{
+			spdlog::error("Error while streaming texture : {}", mipChain.error());
+		}
+		else if (info != nullptr && info->streamId == iterator->streamId)
+		{
+			if (iterator->level < info->residentLevel)
+			{
+				const DecodedImage& image = (*mipChain.value())[iterator->level];
+				Texture texture = Texture::CreateFromDecodedImage(image, info->type, info->space);
+				textureManager.ReplaceResidentLevel(iterator->index, std::move(texture), iterator->level);
+				uploadsCount++;
+			}
+
+			textureManager.SetStreamingMipChain(iterator->index, std::move(mipChain.value()));
+		}
+
+		iterator = m_PendingStreams.erase(iterator);
+	}
+
+	return uploadsCount;
+}
+
+std::expected<std::shared_ptr<const std::vector<DecodedImage>>, std::string> TextureResidencyManager::DecodeMipChain(
+	const ImageDecoder& decoder, const TextureType type)
+{
+	auto image = decoder();
+	if (!image)
+	{
+		return std::unexpected(image.error());
+	}
+
+	// Each level is built from the previous one, so the file is decoded once for every level
+	const u32 levelsCount =
+		ComputeMipLevelsCount(static_cast<u32>(image->width), static_cast<u32>(image->height));
+	auto mipChain = std::make_shared<std::vector<DecodedImage>>();
+	mipChain->reserve(levelsCount);
+	mipChain->push_back(std::move(image.value()));
+	for (u32 level = 1; level < levelsCount; level++)
+	{
+		DecodedImage nextLevel = DownsampleImage(mipChain->back(), 1, type);
+		mipChain->push_back(std::move(nextLevel));
+	}
+
+	return mipChain;
+}
+}// namespace stw
@@ -0,0 +1,181 @@
+/**
+ * @file thread_pool.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Contains the ThreadPool class.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+module;
+
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <format>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "profiler.hpp"
+
+export module thread_pool;
+
+import number_types;
+import cpu_profiler;
+
+export namespace stw
+{
+/**
+ * Fixed amount of worker threads that run tasks in the order they were submitted.
+ * Tasks must not call OpenGL, the context only lives on the main thread.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool() = default;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	~ThreadPool();
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	/**
+	 * Starts the worker threads.
+	 * @param threadsCount Number of worker threads. By default, one per hardware thread except the main one.
+	 */
+	void Init(usize threadsCount = GetDefaultThreadsCount());
+
+	/**
+	 * Waits for every submitted task to finish and stops the worker threads.
+	 */
+	void Delete();
+
+	/**
+	 * Submits a task to be run on a worker thread.
+	 * @param task Callable without parameters.
+	 * @return A future containing the result of the task.
+	 */
+	template<typename F>
+	std::future<std::invoke_result_t<F>> Submit(F&& task);
+
+	[[nodiscard]] usize GetThreadsCount() const;
+	[[nodiscard]] static usize GetDefaultThreadsCount();
+
+private:
+	bool m_IsInitialized = false;
+	bool m_IsStopping = false;
+	std::vector<std::thread> m_Threads;
+	std::queue<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	void WorkerLoop(usize workerIndex);
+};
+
+ThreadPool::~ThreadPool()
+{
+	if (m_IsInitialized)
+	{
+		spdlog::error("Destructor called on thread pool that is still initialized");
+	}
+}
+
+void ThreadPool::Init(const usize threadsCount)
+{
+	assert(!m_IsInitialized);
+
+	m_IsStopping = false;
+	m_Threads.reserve(threadsCount);
+	for (usize i = 0; i < threadsCount; i++)
+	{
+		m_Threads.emplace_back([this, i] { WorkerLoop(i); });
+	}
+
+	m_IsInitialized = true;
+}
+
+void ThreadPool::Delete()
+{
+	assert(m_IsInitialized);
+
+	{
+		std::scoped_lock lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+	m_Threads.clear();
+
+	m_IsInitialized = false;
+}
+
+template<typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::Submit(F&& task)
+{
+	assert(m_IsInitialized);
+
+	using ResultType = std::invoke_result_t<F>;
+
+	// std::function must be copyable, so the packaged task is shared
+	auto packagedTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+	std::future<ResultType> future = packagedTask->get_future();
+
+	{
+		std::scoped_lock lock{ m_Mutex };
+		m_Tasks.emplace([packagedTask] { (*packagedTask)(); });
+	}
+	m_Condition.notify_one();
+
+	return future;
+}
+
+usize ThreadPool::GetThreadsCount() const { return m_Threads.size(); }
+
+usize ThreadPool::GetDefaultThreadsCount()
+{
+	const usize hardwareThreadsCount = std::thread::hardware_concurrency();
+	return std::max<usize>(hardwareThreadsCount, 2) - 1;
+}
+
+void ThreadPool::WorkerLoop(const usize workerIndex)
+{
+	SetCpuProfilerThreadName(std::format("Worker {}", workerIndex));
+
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_Condition.wait(lock, [this] { return m_IsStopping || !m_Tasks.empty(); });
+
+			// The remaining tasks are still run when stopping, so that no future is left without a value
+			if (m_Tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+
+		PROFILE_ZONE("Task");
+		task();
+	}
+}
+}// namespace stw
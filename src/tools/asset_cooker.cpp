@@ -0,0 +1,50 @@
+/**
+ * @file asset_cooker.cpp
+ * @author Fabian Huber (fabian.hbr@protonmail.ch)
+ * @brief Entry point of the offline asset cooker, that converts source textures into KTX2 files.
+ * @version 1.0
+ * @date 18/10/2026
+ *
+ * @copyright SAE (c) 2023
+ *
+ */
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+import texture_cooker;
+
+int main(const int argc, char* argv[])
+{
+	const std::span arguments{ argv, static_cast<std::size_t>(argc) };
+	if (arguments.size() != 4)
+	{
+		spdlog::error("Usage : asset_cooker <source texture> <output ktx2> <texture type>");
+		return 1;
+	}
+
+	const std::filesystem::path sourcePath = arguments[1];
+	const std::filesystem::path outputPath = arguments[2];
+	const std::string_view typeName = arguments[3];
+
+	const auto type = stw::ParseCookedTextureType(typeName);
+	if (!type)
+	{
+		spdlog::error("Unknown texture type \"{}\", expected base_color, specular, normal, roughness, "
+					  "ambient_occlusion or metallic",
+			typeName);
+		return 1;
+	}
+
+	const auto result = stw::CookTexture(sourcePath, outputPath, type.value());
+	if (!result)
+	{
+		spdlog::error(result.error());
+		return 1;
+	}
+
+	return 0;
+}
@@ -12,11 +12,19 @@
 module;
 
 #include <array>
+#include <charconv>
 #include <concepts>
+#include <cstddef>
+#include <expected>
 #include <filesystem>
+#include <format>
 #include <fstream>
 #include <optional>
 #include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <assimp/matrix4x4.h>
 #include <glad/glad.h>
@@ -122,6 +130,171 @@ std::optional<std::string> ReadFileAsString(const std::filesystem::path& path)
 	return content;
 }
 
+constexpr u64 Fnv1aOffsetBasis = 14'695'981'039'346'656'037ull;
+constexpr u64 Fnv1aPrime = 1'099'511'628'211ull;
+
+/**
+ * Computes the 64 bits FNV-1a hash of some bytes. It is not a cryptographic hash, only use it to detect changes.
+ * @param data Bytes to hash.
+ * @param hash Hash to continue from, to hash several buffers as one.
+ * @return The hash of the bytes.
+ */
+constexpr u64 HashFnv1a(const std::span<const std::byte> data, u64 hash = Fnv1aOffsetBasis)
+{
+	for (const std::byte byte : data)
+	{
+		hash ^= static_cast<u64>(byte);
+		hash *= Fnv1aPrime;
+	}
+
+	return hash;
+}
+
+/**
+ * Computes the 64 bits FNV-1a hash of a string.
+ */
+u64 HashFnv1a(const std::string_view text, const u64 hash = Fnv1aOffsetBasis)
+{
+	return HashFnv1a(std::as_bytes(std::span{ text.data(), text.size() }), hash);
+}
+
+/**
+ * Computes the 64 bits FNV-1a hash of the content of a file, without loading it entirely in memory.
+ * @param path Path of the file to hash.
+ * @param hash Hash to continue from, to hash several buffers as one.
+ * @return The hash or nothing if the file could not be read.
+ */
+std::optional<u64> HashFileFnv1a(const std::filesystem::path& path, u64 hash = Fnv1aOffsetBasis)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	constexpr usize chunkSize = 64 * 1024;
+	std::vector<char> chunk(chunkSize);
+	while (file)
+	{
+		file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+		const auto readCount = static_cast<usize>(file.gcount());
+		hash = HashFnv1a(std::as_bytes(std::span{ chunk.data(), readCount }), hash);
+	}
+
+	return hash;
+}
+
+/**
+ * Computes the 64 bits FNV-1a hash of the size and of the last write time of a file, which tells if it changed without
+ * reading it.
+ * @param path Path of the file.
+ * @param hash Hash to continue from, to hash several files as one.
+ * @return The hash or nothing if the file could not be found.
+ */
+std::optional<u64> HashFileStampFnv1a(const std::filesystem::path& path, u64 hash = Fnv1aOffsetBasis)
+{
+	std::error_code errorCode{};
+	const auto size = static_cast<u64>(std::filesystem::file_size(path, errorCode));
+	if (errorCode)
+	{
+		return {};
+	}
+
+	const auto writeTime = std::filesystem::last_write_time(path, errorCode);
+	if (errorCode)
+	{
+		return {};
+	}
+
+	const auto writeTimeCount = static_cast<i64>(writeTime.time_since_epoch().count());
+	hash = HashFnv1a(std::as_bytes(std::span{ &size, 1 }), hash);
+	return HashFnv1a(std::as_bytes(std::span{ &writeTimeCount, 1 }), hash);
+}
+
+/**
+ * A "key = value" line of a config file.
+ */
+struct ConfigEntry
+{
+	std::string key;
+	std::string value;
+	usize lineNumber;
+};
+
+/**
+ * Removes the spaces, tabs and line returns at the start and at the end of a string.
+ */
+std::string_view TrimWhitespace(const std::string_view text)
+{
+	constexpr std::string_view whitespaces = " \t\r\n";
+	const auto start = text.find_first_not_of(whitespaces);
+	if (start == std::string_view::npos)
+	{
+		return {};
+	}
+
+	const auto end = text.find_last_not_of(whitespaces);
+	return text.substr(start, end - start + 1);
+}
+
+/**
+ * Reads a config file made of "key = value" lines. Empty lines and lines starting with '#' are ignored.
+ * @param path Path of the config file.
+ * @return Every entry of the file in order, or an error message.
+ */
+std::expected<std::vector<ConfigEntry>, std::string> ReadConfigFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		return std::unexpected(std::format("Could not open config file {}", path.string()));
+	}
+
+	std::vector<ConfigEntry> entries{};
+	std::string line;
+	usize lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		const std::string_view trimmedLine = TrimWhitespace(line);
+		if (trimmedLine.empty() || trimmedLine.front() == '#')
+		{
+			continue;
+		}
+
+		const auto separator = trimmedLine.find('=');
+		if (separator == std::string_view::npos)
+		{
+			return std::unexpected(std::format("{}:{} : expected \"key = value\"", path.string(), lineNumber));
+		}
+
+		entries.push_back({ std::string{ TrimWhitespace(trimmedLine.substr(0, separator)) },
+			std::string{ TrimWhitespace(trimmedLine.substr(separator + 1)) },
+			lineNumber });
+	}
+
+	return entries;
+}
+
+/**
+ * Parses a whole string as a number.
+ * @tparam T Type of the number.
+ * @param value String to parse.
+ * @return The number or an error message.
+ */
+template<Number T>
+std::expected<T, std::string> ParseNumber(const std::string_view value)
+{
+	T result{};
+	const auto [ptr, errorCode] = std::from_chars(value.data(), value.data() + value.size(), result);
+	if (errorCode != std::errc{} || ptr != value.data() + value.size())
+	{
+		return std::unexpected(std::format("\"{}\" is not a valid number", value));
+	}
+
+	return result;
+}
+
 /**
  * Converts the id to an OpenGL texture enum (GL_TEXTURE). May return GL_INVALID_ENUM if id > 31.
  * @param id Texture ID to convert.
@@ -155,6 +328,27 @@ void ClearGlErrors()
 	}
 }
 
+/**
+ * Checks if the current OpenGL context exposes an extension.
+ * @param extensionName Name of the extension, for example "GL_ARB_shader_viewport_layer_array".
+ * @return True if the extension is available.
+ */
+bool HasGlExtension(const std::string_view extensionName)
+{
+	GLint extensionsCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionsCount);
+	for (GLint i = 0; i < extensionsCount; i++)
+	{
+		const auto* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+		if (extension != nullptr && extensionName == extension)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /**
  * Computes the shadow cascade ranges.
  * @return An array will every shadow cascade values.
@@ -178,14 +372,15 @@ std::array<f32, ShadowMapNumCascades> ComputeCascades()
 
 /**
  * Generates the kernel used in SSAO shader.
+ * @param kernelSize Number of samples in the kernel, it must match SAMPLES_COUNT in the shader.
  */
-std::array<glm::vec3, SsaoKernelSize> GenerateSsaoKernel()
+std::vector<glm::vec3> GenerateSsaoKernel(const usize kernelSize)
 {
 	std::random_device rd;
 	std::default_random_engine generator(rd());
 	std::uniform_real_distribution randomFloats(0.0f, 1.0f);
-	std::array<glm::vec3, SsaoKernelSize> ssaoKernel{};
-	for (usize i = 0; i < SsaoKernelSize; i++)
+	std::vector<glm::vec3> ssaoKernel(kernelSize);
+	for (usize i = 0; i < kernelSize; i++)
 	{
 		glm::vec3 sample(
 			randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator));
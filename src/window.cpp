@@ -19,11 +19,14 @@ module;
 #include <SDL_opengl.h>
 #include <spdlog/spdlog.h>
 
+#include "profiler.hpp"
+
 export module window;
 
 import utils;
 import number_types;
 import timer;
+import cpu_profiler;
 import scene;
 
 export namespace stw
@@ -170,6 +173,7 @@ Window<T>::Window(const std::string_view windowName, i32 windowWidth, i32 window
 	: m_Scene(std::make_unique<T>()), m_WindowName(windowName)
 {
 	spdlog::info("Creating window...");
+	SetCpuProfilerThreadName("Main");
 	SDL_SetHintWithPriority(SDL_HINT_WINDOWS_DPI_AWARENESS, "permonitorv2", SDL_HINT_OVERRIDE);
 	SDL_SetHintWithPriority(SDL_HINT_RENDER_VSYNC, "0", SDL_HINT_OVERRIDE);
 
@@ -237,12 +241,20 @@ void Window<T>::Loop()
 	bool isOpen = true;
 	while (isOpen)
 	{
+		PROFILE_ZONE("Frame");
+
 		const Duration duration = timer.RestartAndGetElapsedTime();
 		f32 deltaTime = m_IsActive ? static_cast<float>(duration.GetInSeconds()) : 0.0f;
 
-		isOpen = HandleEvents();
+		{
+			PROFILE_ZONE("HandleEvents");
+			isOpen = HandleEvents();
+		}
 
-		m_Scene->Update(deltaTime);
+		{
+			PROFILE_ZONE("SceneUpdate");
+			m_Scene->Update(deltaTime);
+		}
 
 		frameCounter++;
 		frameDurationAccumulator += duration.GetInSeconds();
@@ -257,6 +269,7 @@ void Window<T>::Loop()
 			frameCounter = 0;
 		}
 
+		PROFILE_ZONE("SwapWindow");
 		SDL_GL_SwapWindow(m_Window);
 	}
 }
@@ -300,6 +313,14 @@ bool Window<T>::HandleEvents()
 				m_IsFullscreen = !m_IsFullscreen;
 				SDL_SetWindowFullscreen(m_Window, sdlFlags);
 			}
+			else if (event.key.keysym.sym == SDLK_F12)
+			{
+				const auto saveResult = SaveChromeTrace("logs/trace.json");
+				if (!saveResult)
+				{
+					spdlog::error("Could not save the CPU trace : {}", saveResult.error());
+				}
+			}
 			break;
 		case SDL_MOUSEBUTTONDOWN:
 			SDL_SetRelativeMouseMode(SDL_TRUE);